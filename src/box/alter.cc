@@ -179,6 +179,20 @@ index_opts_decode(struct index_opts *opts, const char *map,
 	if (opts->run_size_ratio <= 1)
 		tnt_raise(ClientError, ER_WRONG_SPACE_OPTIONS,
 			  BOX_INDEX_FIELD_OPTS, "run_size_ratio must be > 1");
+	if (opts->blob_threshold < 0)
+		tnt_raise(ClientError, ER_WRONG_INDEX_OPTIONS,
+			  BOX_INDEX_FIELD_OPTS, "blob_threshold must be >= 0");
+	if (opts->cache_size < 0)
+		tnt_raise(ClientError, ER_WRONG_INDEX_OPTIONS,
+			  BOX_INDEX_FIELD_OPTS, "cache_size must be >= 0");
+	if (opts->ttl < 0)
+		tnt_raise(ClientError, ER_WRONG_INDEX_OPTIONS,
+			  BOX_INDEX_FIELD_OPTS, "ttl must be >= 0");
+	if (opts->ttl > 0 && (opts->ttl_field < 1 ||
+			      opts->ttl_field > BOX_INDEX_FIELD_MAX))
+		tnt_raise(ClientError, ER_WRONG_INDEX_OPTIONS,
+			  BOX_INDEX_FIELD_OPTS,
+			  "ttl_field must be a field number");
 }
 
 /**
@@ -263,6 +277,11 @@ space_opts_decode(struct space_opts *opts, const char *map,
 	if (opts_decode(opts, space_opts_reg, &map, ER_WRONG_SPACE_OPTIONS,
 			BOX_SPACE_FIELD_OPTS, region) != 0)
 		diag_raise();
+	if (opts->compression == space_compression_MAX) {
+		tnt_raise(ClientError, ER_WRONG_SPACE_OPTIONS,
+			  BOX_SPACE_FIELD_OPTS, "compression must be either "\
+			  "'none' or 'zstd'");
+	}
 	if (opts->sql != NULL) {
 		char *sql = strdup(opts->sql);
 		if (sql == NULL) {
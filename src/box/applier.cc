@@ -31,7 +31,11 @@
 #include "applier.h"
 
 #include <msgpuck.h>
+#include <fcntl.h>
+#include <scoped_guard.h>
 
+#include "cfg.h"
+#include "coio_file.h"
 #include "xlog.h"
 #include "fiber.h"
 #include "fiber_cond.h"
@@ -229,6 +233,114 @@ done:
 
 }
 
+enum {
+	/** Size of a chunk of a checkpoint file read at once. */
+	APPLIER_FILE_CHUNK = 1024 * 1024,
+};
+
+/**
+ * Receive a checkpoint file sent by the master on file-based
+ * JOIN and store it in the directory of the engine it belongs
+ * to. The file is written under a temporary name, which is
+ * replaced once it is synced to disk.
+ */
+static void
+applier_recv_file(struct applier *applier, struct xrow_header *row)
+{
+	struct ev_io *coio = &applier->io;
+	struct ibuf *ibuf = &applier->ibuf;
+
+	const char *name;
+	uint32_t name_len;
+	uint64_t size;
+	xrow_decode_join_file_xc(row, &name, &name_len, &size);
+
+	/* The name is <engine>/<path relative to the engine dir>. */
+	const char *sep = (const char *) memchr(name, '/', name_len);
+	if (sep == NULL || sep == name || sep + 1 == name + name_len ||
+	    memmem(name, name_len, "..", 2) != NULL) {
+		tnt_raise(ClientError, ER_INVALID_MSGPACK,
+			  tt_sprintf("invalid file name '%s'",
+				     tt_cstr(name, name_len)));
+	}
+	const char *engine_name = tt_cstr(name, sep - name);
+	const char *dir = cfg_gets(tt_sprintf("%s_dir", engine_name));
+	if (dir == NULL)
+		tnt_raise(ClientError, ER_NO_SUCH_ENGINE, engine_name);
+
+	char path[PATH_MAX];
+	char tmp_path[PATH_MAX];
+	int len = snprintf(path, sizeof(path), "%s/%.*s", dir,
+			   (int) (name + name_len - sep - 1), sep + 1);
+	if (len < 0 || len >= (int) sizeof(path) ||
+	    snprintf(tmp_path, sizeof(tmp_path), "%s.inprogress",
+		     path) >= (int) sizeof(tmp_path)) {
+		tnt_raise(ClientError, ER_INVALID_MSGPACK,
+			  tt_sprintf("file name '%s' is too long",
+				     tt_cstr(name, name_len)));
+	}
+
+	/* Vinyl files are stored in per index subdirectories. */
+	for (char *p = path + strlen(dir) + 1; *p != '\0'; p++) {
+		if (*p != '/')
+			continue;
+		*p = '\0';
+		if (coio_mkdir(path, 0777) != 0 && errno != EEXIST)
+			tnt_raise(SystemError, "failed to create directory '%s'",
+				  path);
+		*p = '/';
+	}
+
+	int fd = coio_file_open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+		tnt_raise(SystemError, "failed to create file '%s'", tmp_path);
+	auto fd_guard = make_scoped_guard([&]{
+		coio_file_close(fd);
+		coio_unlink(tmp_path);
+	});
+
+	/*
+	 * The replica adopts the log files as its own, so sign
+	 * them with its uuid, otherwise recovery would refuse
+	 * them. Files without a log header, e.g. vinyl blobs,
+	 * are left as is. Note, the beginning of the file may
+	 * have been read ahead along with the row, so consume
+	 * the input buffer first.
+	 */
+	size_t meta_size = MIN(size, (uint64_t) XLOG_META_LEN_MAX);
+	if (ibuf_used(ibuf) < meta_size)
+		coio_breadn(coio, ibuf, meta_size - ibuf_used(ibuf));
+	if (xlog_meta_set_instance_uuid(ibuf->rpos, meta_size,
+					&INSTANCE_UUID) < 0)
+		diag_raise();
+
+	uint64_t offset = 0;
+	while (offset < size) {
+		if (ibuf_used(ibuf) == 0) {
+			ibuf_reset(ibuf);
+			coio_breadn(coio, ibuf, MIN(size - offset,
+						    APPLIER_FILE_CHUNK));
+		}
+		size_t n = MIN(ibuf_used(ibuf), size - offset);
+		ssize_t written = coio_pwrite(fd, ibuf->rpos, n, offset);
+		if (written < 0)
+			tnt_raise(SystemError, "failed to write file '%s'",
+				  tmp_path);
+		ibuf->rpos += written;
+		offset += written;
+		applier->last_row_time = ev_monotonic_now(loop());
+	}
+	if (coio_fsync(fd) != 0)
+		tnt_raise(SystemError, "failed to sync file '%s'", tmp_path);
+	fd_guard.is_active = false;
+	coio_file_close(fd);
+	if (coio_rename(tmp_path, path) != 0) {
+		coio_unlink(tmp_path);
+		tnt_raise(SystemError, "failed to rename '%s'", tmp_path);
+	}
+	say_info("received `%s'", path);
+}
+
 /**
  * Execute and process JOIN request (bootstrap the instance).
  */
@@ -239,8 +351,9 @@ applier_join(struct applier *applier)
 	struct ev_io *coio = &applier->io;
 	struct ibuf *ibuf = &applier->ibuf;
 	struct xrow_header row;
-	xrow_encode_join_xc(&row, &INSTANCE_UUID);
+	xrow_encode_join_xc(&row, &INSTANCE_UUID, replication_file_join);
 	coio_write_xrow(coio, &row);
+	applier->file_join = false;
 
 	/**
 	 * Tarantool < 1.7.0: if JOIN is successful, there is no "OK"
@@ -260,8 +373,12 @@ applier_join(struct applier *applier)
 		 * the master is sending to the replica.
 		 * Used to initialize the replica's initial
 		 * vclock in bootstrap_from_master()
+		 *
+		 * The master may refuse to send files, e.g.
+		 * if it doesn't support file-based join.
 		 */
-		xrow_decode_vclock_xc(&row, &replicaset_vclock);
+		xrow_decode_join_response_xc(&row, &replicaset_vclock,
+					     &applier->file_join);
 	}
 
 	applier_set_state(applier, APPLIER_INITIAL_JOIN);
@@ -275,6 +392,9 @@ applier_join(struct applier *applier)
 		applier->last_row_time = ev_monotonic_now(loop());
 		if (iproto_type_is_dml(row.type)) {
 			xstream_write_xc(applier->join_stream, &row);
+		} else if (row.type == IPROTO_JOIN_FILE &&
+			   applier->file_join) {
+			applier_recv_file(applier, &row);
 		} else if (row.type == IPROTO_OK) {
 			if (applier->version_id < version_id(1, 7, 0)) {
 				/*
@@ -402,6 +522,7 @@ applier_subscribe(struct applier *applier)
 		uri_format(name + pos, sizeof(name) - pos, &applier->uri, false);
 
 		applier->writer = fiber_new_xc(name, applier_writer_f);
+		fiber_set_prio(applier->writer, FIBER_PRIO_REPLICATION);
 		fiber_set_joinable(applier->writer, true);
 		fiber_start(applier->writer, applier);
 	}
@@ -581,6 +702,7 @@ applier_start(struct applier *applier)
 	 * fiber any time we want.
 	 */
 	fiber_set_joinable(f, true);
+	fiber_set_prio(f, FIBER_PRIO_REPLICATION);
 	applier->reader = f;
 	fiber_start(f, applier);
 }
@@ -92,6 +92,8 @@ struct applier {
 	struct uri uri;
 	/** Remote version encoded as a number, see version_id() macro */
 	uint32_t version_id;
+	/** Set if the master sends checkpoint files on initial JOIN */
+	bool file_join;
 	/** Remote address */
 	union {
 		struct sockaddr addr;
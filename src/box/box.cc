@@ -50,6 +50,7 @@
 #include "schema.h"
 #include "engine.h"
 #include "memtx_engine.h"
+#include "memtx_tx.h"
 #include "sysview_engine.h"
 #include "vinyl.h"
 #include "space.h"
@@ -438,6 +439,67 @@ box_check_checkpoint_count(int checkpoint_count)
 	}
 }
 
+static void
+box_check_memtx_snap_parts(int memtx_snap_parts)
+{
+	if (memtx_snap_parts < 1 || memtx_snap_parts > MEMTX_SNAP_PARTS_MAX) {
+		tnt_raise(ClientError, ER_CFG, "memtx_snap_parts",
+			  tt_sprintf("the value must be between 1 and %d",
+				     MEMTX_SNAP_PARTS_MAX));
+	}
+}
+
+static void
+box_check_memtx_snap_deltas(int memtx_snap_deltas)
+{
+	if (memtx_snap_deltas < 0) {
+		tnt_raise(ClientError, ER_CFG, "memtx_snap_deltas",
+			  "the value must be >= 0");
+	}
+}
+
+static void
+box_check_memtx_defrag_threshold(double memtx_defrag_threshold)
+{
+	if (memtx_defrag_threshold < 0 || memtx_defrag_threshold > 1) {
+		tnt_raise(ClientError, ER_CFG, "memtx_defrag_threshold",
+			  "the value must be between 0 and 1");
+	}
+}
+
+static int64_t
+box_check_fiber_pool_stack_size(int64_t stack_size)
+{
+	if (stack_size < FIBER_STACK_SIZE_MINIMAL) {
+		tnt_raise(ClientError, ER_CFG, "fiber_pool_stack_size",
+			  tt_sprintf("the value must be >= %d",
+				     FIBER_STACK_SIZE_MINIMAL));
+	}
+	return stack_size;
+}
+
+static enum tuple_arena_pages
+box_check_memtx_huge_pages(const char *pages_name)
+{
+	assert(pages_name != NULL); /* checked in Lua */
+	int pages = strindex(tuple_arena_pages_STRS, pages_name,
+			     TUPLE_ARENA_PAGES_MAX);
+	if (pages == TUPLE_ARENA_PAGES_MAX)
+		tnt_raise(ClientError, ER_CFG, "memtx_huge_pages", pages_name);
+	return (enum tuple_arena_pages) pages;
+}
+
+static int
+box_check_memtx_numa_node(int numa_node)
+{
+	if (numa_node < -1 || numa_node > TUPLE_ARENA_NUMA_NODE_MAX) {
+		tnt_raise(ClientError, ER_CFG, "memtx_numa_node",
+			  tt_sprintf("the value must be between -1 and %d",
+				     TUPLE_ARENA_NUMA_NODE_MAX));
+	}
+	return numa_node;
+}
+
 static int64_t
 box_check_wal_max_rows(int64_t wal_max_rows)
 {
@@ -473,7 +535,13 @@ box_check_config()
 	box_check_replication_timeout();
 	box_check_replication_connect_quorum();
 	box_check_readahead(cfg_geti("readahead"));
+	box_check_fiber_pool_stack_size(cfg_geti64("fiber_pool_stack_size"));
 	box_check_checkpoint_count(cfg_geti("checkpoint_count"));
+	box_check_memtx_snap_parts(cfg_geti("memtx_snap_parts"));
+	box_check_memtx_snap_deltas(cfg_geti("memtx_snap_deltas"));
+	box_check_memtx_defrag_threshold(cfg_getd("memtx_defrag_threshold"));
+	box_check_memtx_huge_pages(cfg_gets("memtx_huge_pages"));
+	box_check_memtx_numa_node(cfg_geti("memtx_numa_node"));
 	box_check_wal_max_rows(cfg_geti64("rows_per_wal"));
 	box_check_wal_max_size(cfg_geti64("wal_max_size"));
 	box_check_wal_mode(cfg_gets("wal_mode"));
@@ -621,6 +689,39 @@ box_set_snap_io_rate_limit(void)
 			cfg_getd("snap_io_rate_limit"));
 }
 
+void
+box_set_memtx_snap_parts(void)
+{
+	int memtx_snap_parts = cfg_geti("memtx_snap_parts");
+	box_check_memtx_snap_parts(memtx_snap_parts);
+	struct memtx_engine *memtx;
+	memtx = (struct memtx_engine *)engine_by_name("memtx");
+	assert(memtx != NULL);
+	memtx_engine_set_snap_part_count(memtx, memtx_snap_parts);
+}
+
+void
+box_set_memtx_snap_deltas(void)
+{
+	int memtx_snap_deltas = cfg_geti("memtx_snap_deltas");
+	box_check_memtx_snap_deltas(memtx_snap_deltas);
+	struct memtx_engine *memtx;
+	memtx = (struct memtx_engine *)engine_by_name("memtx");
+	assert(memtx != NULL);
+	memtx_engine_set_snap_delta_max(memtx, memtx_snap_deltas);
+}
+
+void
+box_set_memtx_defrag_threshold(void)
+{
+	double memtx_defrag_threshold = cfg_getd("memtx_defrag_threshold");
+	box_check_memtx_defrag_threshold(memtx_defrag_threshold);
+	struct memtx_engine *memtx;
+	memtx = (struct memtx_engine *)engine_by_name("memtx");
+	assert(memtx != NULL);
+	memtx_engine_set_defrag_threshold(memtx, memtx_defrag_threshold);
+}
+
 void
 box_set_memtx_max_tuple_size(void)
 {
@@ -677,6 +778,16 @@ box_set_vinyl_timeout(void)
 	vinyl_engine_set_timeout(vinyl,	cfg_getd("vinyl_timeout"));
 }
 
+void
+box_set_vinyl_parallel_lookup(void)
+{
+	struct vinyl_engine *vinyl;
+	vinyl = (struct vinyl_engine *)engine_by_name("vinyl");
+	assert(vinyl != NULL);
+	vinyl_engine_set_parallel_lookup(vinyl,
+			cfg_geti("vinyl_parallel_lookup"));
+}
+
 /* }}} configuration bindings */
 
 /**
@@ -1172,10 +1283,12 @@ box_process_join(struct ev_io *io, struct xrow_header *header)
 	 *
 	 * Replica => Master
 	 *
-	 * => JOIN { INSTANCE_UUID: replica_uuid }
-	 * <= OK { VCLOCK: start_vclock }
+	 * => JOIN { INSTANCE_UUID: replica_uuid, FILE_JOIN: true }
+	 * <= OK { VCLOCK: start_vclock, FILE_JOIN: true }
 	 *    Replica has enough permissions and master is ready for JOIN.
 	 *     - start_vclock - vclock of the latest master's checkpoint.
+	 *     - FILE_JOIN - optional, set if the replica asks for
+	 *       checkpoint files, echoed if the master sends them.
 	 *
 	 * <= INSERT
 	 *    ...
@@ -1184,6 +1297,15 @@ box_process_join(struct ev_io *io, struct xrow_header *header)
 	 *    use REPLICA_ID, LSN and other fields for internal purposes.
 	 *    ...
 	 * <= INSERT
+	 *
+	 *    Or, if FILE_JOIN is set:
+	 *
+	 * <= JOIN_FILE { FILE_NAME: engine/path, FILE_SIZE: size }
+	 *    followed by `size` bytes of the file
+	 *    ...
+	 *    Initial data: files of the latest master's checkpoint.
+	 *    The replica recovers from them as from its own.
+	 *    ...
 	 * <= OK { VCLOCK: stop_vclock } - end of initial JOIN stage.
 	 *     - `stop_vclock` - master's vclock when it's done
 	 *     done sending rows from the snapshot (i.e. vclock
@@ -1211,7 +1333,8 @@ box_process_join(struct ev_io *io, struct xrow_header *header)
 
 	/* Decode JOIN request */
 	struct tt_uuid instance_uuid = uuid_nil;
-	xrow_decode_join(header, &instance_uuid);
+	bool file_join;
+	xrow_decode_join_xc(header, &instance_uuid, &file_join);
 
 	/* Check that bootstrap has been finished */
 	if (!is_box_configured)
@@ -1257,14 +1380,19 @@ box_process_join(struct ev_io *io, struct xrow_header *header)
 
 	/* Respond to JOIN request with start_vclock. */
 	struct xrow_header row;
-	xrow_encode_vclock_xc(&row, &start_vclock);
+	xrow_encode_join_response_xc(&row, &start_vclock, file_join);
 	row.sync = header->sync;
 	coio_write_xrow(io, &row);
 
 	/*
-	 * Initial stream: feed replica with dirty data from engines.
+	 * Initial stream: feed replica with dirty data from
+	 * engines or with files of the last checkpoint, which
+	 * the replica recovers from as if they were its own.
 	 */
-	relay_initial_join(io->fd, header->sync, &start_vclock);
+	if (file_join)
+		relay_initial_join_files(io->fd, header->sync, &start_vclock);
+	else
+		relay_initial_join(io->fd, header->sync, &start_vclock);
 	say_info("initial data sent.");
 
 	/**
@@ -1441,13 +1569,20 @@ engine_init()
 	 * so it must be registered first.
 	 */
 	struct memtx_engine *memtx;
+	memtx_tx_manager_use_mvcc_engine = cfg_geti("memtx_use_mvcc_engine");
 	memtx = memtx_engine_new_xc(cfg_gets("memtx_dir"),
 				    cfg_geti("force_recovery"),
 				    cfg_getd("memtx_memory"),
 				    cfg_geti("memtx_min_tuple_size"),
-				    cfg_getd("slab_alloc_factor"));
+				    cfg_getd("slab_alloc_factor"),
+				    box_check_memtx_huge_pages(
+					cfg_gets("memtx_huge_pages")),
+				    box_check_memtx_numa_node(
+					cfg_geti("memtx_numa_node")));
 	engine_register((struct engine *)memtx);
 	box_set_memtx_max_tuple_size();
+	box_set_memtx_snap_deltas();
+	box_set_memtx_defrag_threshold();
 
 	struct sysview_engine *sysview = sysview_engine_new_xc();
 	engine_register((struct engine *)sysview);
@@ -1462,6 +1597,7 @@ engine_init()
 	engine_register((struct engine *)vinyl);
 	box_set_vinyl_max_tuple_size();
 	box_set_vinyl_timeout();
+	box_set_vinyl_parallel_lookup();
 }
 
 /**
@@ -1522,18 +1658,37 @@ bootstrap_from_master(struct replica *master)
 	assert(!tt_uuid_is_nil(&INSTANCE_UUID));
 	applier_resume_to_state(applier, APPLIER_INITIAL_JOIN, TIMEOUT_INFINITY);
 
-	/*
-	 * Process initial data (snapshot or dirty disk data).
-	 */
-	engine_begin_initial_recovery_xc(NULL);
-	applier_resume_to_state(applier, APPLIER_FINAL_JOIN, TIMEOUT_INFINITY);
+	struct recovery_journal journal;
+	recovery_journal_create(&journal, &replicaset_vclock);
+
+	if (applier->file_join) {
+		/*
+		 * Receive files of the master's checkpoint and
+		 * recover from them as on local recovery.
+		 * replicaset_vclock is the checkpoint vclock.
+		 */
+		applier_resume_to_state(applier, APPLIER_FINAL_JOIN,
+					TIMEOUT_INFINITY);
+		engine_begin_initial_recovery_xc(&replicaset_vclock);
+		struct memtx_engine *memtx;
+		memtx = (struct memtx_engine *)engine_by_name("memtx");
+		assert(memtx != NULL);
+		journal_set(&journal.base);
+		memtx_engine_recover_snapshot_xc(memtx, &replicaset_vclock);
+		journal_set(NULL);
+	} else {
+		/*
+		 * Process initial data (snapshot or dirty disk data).
+		 */
+		engine_begin_initial_recovery_xc(NULL);
+		applier_resume_to_state(applier, APPLIER_FINAL_JOIN,
+					TIMEOUT_INFINITY);
+	}
 
 	/*
 	 * Process final data (WALs).
 	 */
 	engine_begin_final_recovery_xc();
-	struct recovery_journal journal;
-	recovery_journal_create(&journal, &replicaset_vclock);
 	journal_set(&journal.base);
 
 	applier_resume_to_state(applier, APPLIER_JOINED, TIMEOUT_INFINITY);
@@ -1617,7 +1772,8 @@ box_cfg_xc(void)
 {
 	/* Join the cord interconnect as "tx" endpoint. */
 	fiber_pool_create(&tx_fiber_pool, "tx", FIBER_POOL_SIZE,
-			  FIBER_POOL_IDLE_TIMEOUT);
+			  FIBER_POOL_IDLE_TIMEOUT,
+			  cfg_geti64("fiber_pool_stack_size"));
 	/* Add an extra endpoint for WAL wake up/rollback messages. */
 	cbus_endpoint_create(&tx_prio_endpoint, "tx_prio", tx_prio_cb, &tx_prio_endpoint);
 
@@ -1645,6 +1801,7 @@ box_cfg_xc(void)
 	box_set_too_long_threshold();
 	box_set_replication_timeout();
 	box_set_replication_connect_quorum();
+	replication_file_join = cfg_geti("replication_file_join");
 	xstream_create(&join_stream, apply_initial_join_row);
 	xstream_create(&subscribe_stream, apply_row);
 
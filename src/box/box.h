@@ -148,12 +148,16 @@ void box_set_log_level(void);
 void box_set_log_format(void);
 void box_set_io_collect_interval(void);
 void box_set_snap_io_rate_limit(void);
+void box_set_memtx_snap_parts(void);
+void box_set_memtx_snap_deltas(void);
+void box_set_memtx_defrag_threshold(void);
 void box_set_too_long_threshold(void);
 void box_set_readahead(void);
 void box_set_checkpoint_count(void);
 void box_set_memtx_max_tuple_size(void);
 void box_set_vinyl_max_tuple_size(void);
 void box_set_vinyl_timeout(void);
+void box_set_vinyl_parallel_lookup(void);
 void box_set_replication_timeout(void);
 void box_set_replication_connect_quorum(void);
 
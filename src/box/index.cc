@@ -430,6 +430,24 @@ box_index_info(uint32_t space_id, uint32_t index_id,
 	return 0;
 }
 
+int
+box_index_aggregate(uint32_t space_id, uint32_t index_id, uint32_t part,
+		    struct index_aggregate *result)
+{
+	struct space *space;
+	struct index *index;
+	if (check_index(space_id, index_id, &space, &index) != 0)
+		return -1;
+	if (part >= index->def->key_def->part_count) {
+		diag_set(ClientError, ER_ILLEGAL_PARAMS,
+			 "Invalid key part number");
+		return -1;
+	}
+	/* No tx management, aggregation is for analytics. */
+	memset(result, 0, sizeof(*result));
+	return index_aggregate(index, part, result);
+}
+
 /* }}} */
 
 /* {{{ Internal API */
@@ -615,6 +633,16 @@ generic_index_count(struct index *index, enum iterator_type type,
 	return count;
 }
 
+int
+generic_index_aggregate(struct index *index, uint32_t part,
+			struct index_aggregate *result)
+{
+	(void)part;
+	(void)result;
+	diag_set(UnsupportedIndexFeature, index->def, "aggregate()");
+	return -1;
+}
+
 int
 generic_index_get(struct index *index, const char *key,
 		  uint32_t part_count, struct tuple **result)
@@ -216,6 +216,35 @@ int
 box_index_info(uint32_t space_id, uint32_t index_id,
 	       struct info_handler *info);
 
+/** Result of aggregation of values of a key part. */
+struct index_aggregate {
+	/** Number of aggregated values. */
+	uint64_t count;
+	/** Sum of the values, wraps around on overflow. */
+	int64_t sum;
+	/** Minimal value, undefined if count is 0. */
+	int64_t min;
+	/** Maximal value, undefined if count is 0. */
+	int64_t max;
+	/** Set if the values are to be interpreted as unsigned. */
+	bool is_unsigned;
+};
+
+/**
+ * Compute count, sum, min and max of values of a key part
+ * over all tuples stored in the index (index:aggregate()).
+ *
+ * \param space_id space identifier
+ * \param index_id index identifier
+ * \param part key part number, 0-based
+ * \param[out] result aggregated values
+ * \retval -1 on error (check box_error_last())
+ * \retval 0 on success
+ */
+int
+box_index_aggregate(uint32_t space_id, uint32_t index_id, uint32_t part,
+		    struct index_aggregate *result);
+
 struct iterator {
 	/**
 	 * Iterate to the next tuple.
@@ -357,6 +386,9 @@ struct index_vtab {
 	int (*random)(struct index *index, uint32_t rnd, struct tuple **result);
 	ssize_t (*count)(struct index *index, enum iterator_type type,
 			 const char *key, uint32_t part_count);
+	/** Aggregate values of a key part over the whole index. */
+	int (*aggregate)(struct index *index, uint32_t part,
+			 struct index_aggregate *result);
 	int (*get)(struct index *index, const char *key,
 		   uint32_t part_count, struct tuple **result);
 	int (*replace)(struct index *index, struct tuple *old_tuple,
@@ -498,6 +530,13 @@ index_count(struct index *index, enum iterator_type type,
 	return index->vtab->count(index, type, key, part_count);
 }
 
+static inline int
+index_aggregate(struct index *index, uint32_t part,
+		struct index_aggregate *result)
+{
+	return index->vtab->aggregate(index, part, result);
+}
+
 static inline int
 index_get(struct index *index, const char *key,
 	   uint32_t part_count, struct tuple **result)
@@ -567,6 +606,8 @@ int generic_index_max(struct index *, const char *, uint32_t, struct tuple **);
 int generic_index_random(struct index *, uint32_t, struct tuple **);
 ssize_t generic_index_count(struct index *, enum iterator_type,
 			    const char *, uint32_t);
+int generic_index_aggregate(struct index *, uint32_t,
+			    struct index_aggregate *);
 int generic_index_get(struct index *, const char *, uint32_t, struct tuple **);
 int generic_index_replace(struct index *, struct tuple *, struct tuple *,
 			  enum dup_replace_mode, struct tuple **);
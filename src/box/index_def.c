@@ -32,7 +32,8 @@
 #include "schema_def.h"
 #include "identifier.h"
 
-const char *index_type_strs[] = { "HASH", "TREE", "BITSET", "RTREE" };
+const char *index_type_strs[] = { "HASH", "TREE", "BITSET", "RTREE",
+				  "COLUMN" };
 
 const char *rtree_index_distance_type_strs[] = { "EUCLID", "MANHATTAN" };
 
@@ -45,6 +46,10 @@ const struct index_opts index_opts_default = {
 	/* .run_count_per_level = */ 2,
 	/* .run_size_ratio      = */ 3.5,
 	/* .bloom_fpr           = */ 0.05,
+	/* .blob_threshold      = */ 0,
+	/* .cache_size          = */ 0,
+	/* .ttl                 = */ 0,
+	/* .ttl_field           = */ 0,
 	/* .lsn                 = */ 0,
 	/* .sql                 = */ NULL,
 };
@@ -59,6 +64,10 @@ const struct opt_def index_opts_reg[] = {
 	OPT_DEF("run_count_per_level", OPT_INT64, struct index_opts, run_count_per_level),
 	OPT_DEF("run_size_ratio", OPT_FLOAT, struct index_opts, run_size_ratio),
 	OPT_DEF("bloom_fpr", OPT_FLOAT, struct index_opts, bloom_fpr),
+	OPT_DEF("blob_threshold", OPT_INT64, struct index_opts, blob_threshold),
+	OPT_DEF("cache_size", OPT_INT64, struct index_opts, cache_size),
+	OPT_DEF("ttl", OPT_INT64, struct index_opts, ttl),
+	OPT_DEF("ttl_field", OPT_INT64, struct index_opts, ttl_field),
 	OPT_DEF("lsn", OPT_INT64, struct index_opts, lsn),
 	OPT_DEF("sql", OPT_STRPTR, struct index_opts, sql),
 	OPT_END,
@@ -44,6 +44,7 @@ enum index_type {
 	TREE,     /* TREE Index */
 	BITSET,   /* BITSET Index */
 	RTREE,    /* R-Tree Index */
+	COLUMN,   /* Columnar Index */
 	index_type_MAX,
 };
 
@@ -91,6 +92,29 @@ struct index_opts {
 	double run_size_ratio;
 	/* Bloom filter false positive rate. */
 	double bloom_fpr;
+	/**
+	 * Bodies of primary index statements of this size or
+	 * larger are stored in separate blob files so that
+	 * compaction doesn't need to rewrite them. 0 disables
+	 * blob files.
+	 */
+	int64_t blob_threshold;
+	/**
+	 * Max size of memory that can be occupied by cached
+	 * statements of the index. 0 means that the index is
+	 * only limited by the common cache quota.
+	 */
+	int64_t cache_size;
+	/**
+	 * Time to live of tuples of a vinyl space, in seconds.
+	 * A tuple expires when this time passes since the time
+	 * stored in field @ttl_field. Expired tuples are hidden
+	 * from reads and dropped by dump and compaction. 0
+	 * disables expiration. Only applicable to a primary index.
+	 */
+	int64_t ttl;
+	/** Number of the field storing tuple creation time, from 1. */
+	int64_t ttl_field;
 	/**
 	 * LSN from the time of index creation.
 	 */
@@ -143,6 +167,14 @@ index_opts_cmp(const struct index_opts *o1, const struct index_opts *o2)
 		return o1->run_size_ratio < o2->run_size_ratio ? -1 : 1;
 	if (o1->bloom_fpr != o2->bloom_fpr)
 		return o1->bloom_fpr < o2->bloom_fpr ? -1 : 1;
+	if (o1->blob_threshold != o2->blob_threshold)
+		return o1->blob_threshold < o2->blob_threshold ? -1 : 1;
+	if (o1->cache_size != o2->cache_size)
+		return o1->cache_size < o2->cache_size ? -1 : 1;
+	if (o1->ttl != o2->ttl)
+		return o1->ttl < o2->ttl ? -1 : 1;
+	if (o1->ttl_field != o2->ttl_field)
+		return o1->ttl_field < o2->ttl_field ? -1 : 1;
 	return 0;
 }
 
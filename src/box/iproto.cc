@@ -1030,6 +1030,7 @@ tx_fiber_init(struct session *session, uint64_t sync)
 	 */
 	fiber_set_session(fiber(), session);
 	fiber_set_user(fiber(), &session->credentials);
+	fiber_set_prio(fiber(), session->prio);
 }
 
 /**
@@ -1394,6 +1395,7 @@ tx_process_join_subscribe(struct cmsg *m)
 	struct iproto_connection *con = msg->connection;
 
 	tx_fiber_init(con->session, msg->header.sync);
+	fiber_set_prio(fiber(), FIBER_PRIO_REPLICATION);
 
 	try {
 		switch (msg->header.type) {
@@ -191,6 +191,9 @@ const char *iproto_key_strs[IPROTO_KEY_MAX] = {
 	"SQL options",      /* 0x42 */
 	"SQL info",         /* 0x43 */
 	"SQL row count",    /* 0x44 */
+	"file join",        /* 0x45 */
+	"file name",        /* 0x46 */
+	"file size",        /* 0x47 */
 };
 
 const char *vy_page_info_key_strs[VY_PAGE_INFO_KEY_MAX] = {
@@ -210,10 +213,20 @@ const char *vy_run_info_key_strs[VY_RUN_INFO_KEY_MAX] = {
 	"min lsn",
 	"max lsn",
 	"page count",
-	"bloom filter"
+	"bloom filter",
+	"blobs"
 };
 
 const char *vy_row_index_key_strs[VY_ROW_INDEX_KEY_MAX] = {
 	NULL,
 	"row index",
 };
+
+const char *vy_blob_ref_key_strs[VY_BLOB_REF_KEY_MAX] = {
+	NULL,
+	"type",
+	"key",
+	"file",
+	"offset",
+	"size",
+};
@@ -112,6 +112,11 @@ enum iproto_key {
 	 */
 	IPROTO_SQL_INFO = 0x43,
 	IPROTO_SQL_ROW_COUNT = 0x44,
+
+	/* File-based join keys (body). */
+	IPROTO_FILE_JOIN = 0x45,
+	IPROTO_FILE_NAME = 0x46,
+	IPROTO_FILE_SIZE = 0x47,
 	IPROTO_KEY_MAX
 };
 
@@ -185,6 +190,11 @@ enum iproto_type {
 	IPROTO_JOIN = 65,
 	/** Replication SUBSCRIBE command */
 	IPROTO_SUBSCRIBE = 66,
+	/**
+	 * A checkpoint file sent on file-based join. The row
+	 * is followed by IPROTO_FILE_SIZE bytes of the file.
+	 */
+	IPROTO_JOIN_FILE = 67,
 
 	/** Vinyl run info stored in .index file */
 	VY_INDEX_RUN_INFO = 100,
@@ -192,6 +202,8 @@ enum iproto_type {
 	VY_INDEX_PAGE_INFO = 101,
 	/** Vinyl row index stored in .run file */
 	VY_RUN_ROW_INDEX = 102,
+	/** Vinyl statement stored in a blob file */
+	VY_RUN_BLOB_REF = 103,
 
 	/**
 	 * Error codes = (IPROTO_TYPE_ERROR | ER_XXX from errcode.h)
@@ -219,6 +231,8 @@ iproto_type_name(uint32_t type)
 		return "PAGEINFO";
 	case VY_RUN_ROW_INDEX:
 		return "ROWINDEX";
+	case VY_RUN_BLOB_REF:
+		return "BLOBREF";
 	default:
 		return NULL;
 	}
@@ -320,6 +334,8 @@ enum vy_run_info_key {
 	VY_RUN_INFO_PAGE_COUNT = 5,
 	/** Bloom filter for keys. */
 	VY_RUN_INFO_BLOOM = 6,
+	/** Size and live bytes of each blob file of the run. */
+	VY_RUN_INFO_BLOBS = 7,
 	/** The last key in this enum + 1 */
 	VY_RUN_INFO_KEY_MAX
 };
@@ -395,6 +411,39 @@ vy_row_index_key_name(enum vy_row_index_key key)
 	return vy_row_index_key_strs[key];
 }
 
+/**
+ * Xrow keys for a Vinyl statement whose body is stored
+ * in a blob file.
+ * @sa struct vy_blob_ref.
+ */
+enum vy_blob_ref_key {
+	/** Type of the statement, REPLACE or INSERT. */
+	VY_BLOB_REF_TYPE = 1,
+	/** Key parts of the statement. */
+	VY_BLOB_REF_KEY = 2,
+	/** Number of the blob file in the run. */
+	VY_BLOB_REF_FILE = 3,
+	/** Offset of the statement body in the blob file. */
+	VY_BLOB_REF_OFFSET = 4,
+	/** Size of the statement body. */
+	VY_BLOB_REF_SIZE = 5,
+	/** The last key in this enum + 1 */
+	VY_BLOB_REF_KEY_MAX
+};
+
+/**
+ * Return vy_blob_ref key name by @a key code.
+ * @param key key
+ */
+static inline const char *
+vy_blob_ref_key_name(enum vy_blob_ref_key key)
+{
+	if (key <= 0 || key >= VY_BLOB_REF_KEY_MAX)
+		return NULL;
+	extern const char *vy_blob_ref_key_strs[];
+	return vy_blob_ref_key_strs[key];
+}
+
 #if defined(__cplusplus)
 } /* extern "C" */
 #endif
@@ -226,6 +226,45 @@ lbox_index_count(lua_State *L)
 	return 1;
 }
 
+static void
+lbox_push_aggregate_value(struct lua_State *L, int64_t value, bool is_unsigned)
+{
+	if (is_unsigned)
+		luaL_pushuint64(L, value);
+	else
+		luaL_pushint64(L, value);
+}
+
+static int
+lbox_index_aggregate(lua_State *L)
+{
+	if (lua_gettop(L) != 3 || !lua_isnumber(L, 1) || !lua_isnumber(L, 2) ||
+	    !lua_isnumber(L, 3)) {
+		return luaL_error(L, "usage index.aggregate(space_id, index_id, "
+				  "part)");
+	}
+
+	uint32_t space_id = lua_tonumber(L, 1);
+	uint32_t index_id = lua_tonumber(L, 2);
+	uint32_t part = lua_tonumber(L, 3);
+
+	struct index_aggregate result;
+	if (box_index_aggregate(space_id, index_id, part, &result) != 0)
+		return luaT_error(L);
+	lua_newtable(L);
+	luaL_pushuint64(L, result.count);
+	lua_setfield(L, -2, "count");
+	lbox_push_aggregate_value(L, result.sum, result.is_unsigned);
+	lua_setfield(L, -2, "sum");
+	if (result.count > 0) {
+		lbox_push_aggregate_value(L, result.min, result.is_unsigned);
+		lua_setfield(L, -2, "min");
+		lbox_push_aggregate_value(L, result.max, result.is_unsigned);
+		lua_setfield(L, -2, "max");
+	}
+	return 1;
+}
+
 static void
 box_index_init_iterator_types(struct lua_State *L, int idx)
 {
@@ -346,6 +385,7 @@ box_lua_index_init(struct lua_State *L)
 		{"min", lbox_index_min},
 		{"max", lbox_index_max},
 		{"count", lbox_index_count},
+		{"aggregate", lbox_index_aggregate},
 		{"iterator", lbox_index_iterator},
 		{"iterator_next", lbox_iterator_next},
 		{"truncate", lbox_truncate},
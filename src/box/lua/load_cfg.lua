@@ -12,6 +12,12 @@ local default_cfg = {
     memtx_memory        = 256 * 1024 *1024,
     memtx_min_tuple_size = 16,
     memtx_max_tuple_size = 1024 * 1024,
+    memtx_snap_parts    = 1,
+    memtx_snap_deltas   = 0,
+    memtx_defrag_threshold = 0,
+    memtx_use_mvcc_engine = false,
+    memtx_huge_pages    = 'none',
+    memtx_numa_node     = -1,
     slab_alloc_factor   = 1.05,
     work_dir            = nil,
     memtx_dir           = ".",
@@ -29,6 +35,7 @@ local default_cfg = {
     vinyl_range_size          = 1024 * 1024 * 1024,
     vinyl_page_size           = 8 * 1024,
     vinyl_bloom_fpr           = 0.05,
+    vinyl_parallel_lookup     = false,
     log                 = nil,
     log_nonblock        = true,
     log_level           = 5,
@@ -55,8 +62,10 @@ local default_cfg = {
     checkpoint_interval = 3600,
     checkpoint_count    = 2,
     worker_pool_threads = 4,
+    fiber_pool_stack_size = 64 * 1024,
     replication_timeout = 1,
-    replication_connect_quorum = nil
+    replication_connect_quorum = nil,
+    replication_file_join = false,
 }
 
 -- types of available options
@@ -66,6 +75,12 @@ local template_cfg = {
     memtx_memory        = 'number',
     memtx_min_tuple_size  = 'number',
     memtx_max_tuple_size  = 'number',
+    memtx_snap_parts    = 'number',
+    memtx_snap_deltas   = 'number',
+    memtx_defrag_threshold = 'number',
+    memtx_use_mvcc_engine = 'boolean',
+    memtx_huge_pages    = 'string',
+    memtx_numa_node     = 'number',
     slab_alloc_factor   = 'number',
     work_dir            = 'string',
     memtx_dir            = 'string',
@@ -82,6 +97,7 @@ local template_cfg = {
     vinyl_range_size          = 'number',
     vinyl_page_size           = 'number',
     vinyl_bloom_fpr           = 'number',
+    vinyl_parallel_lookup     = 'boolean',
 
     log              = 'string',
     log_nonblock     = 'boolean',
@@ -109,8 +125,10 @@ local template_cfg = {
     read_only           = 'boolean',
     hot_standby         = 'boolean',
     worker_pool_threads = 'number',
+    fiber_pool_stack_size = 'number',
     replication_timeout = 'number',
     replication_connect_quorum = 'number',
+    replication_file_join = 'boolean',
 }
 
 local function normalize_uri(port)
@@ -165,8 +183,12 @@ local dynamic_cfg = {
     snap_io_rate_limit      = private.cfg_set_snap_io_rate_limit,
     read_only               = private.cfg_set_read_only,
     memtx_max_tuple_size    = private.cfg_set_memtx_max_tuple_size,
+    memtx_snap_parts        = private.cfg_set_memtx_snap_parts,
+    memtx_snap_deltas       = private.cfg_set_memtx_snap_deltas,
+    memtx_defrag_threshold  = private.cfg_set_memtx_defrag_threshold,
     vinyl_max_tuple_size    = private.cfg_set_vinyl_max_tuple_size,
     vinyl_timeout           = private.cfg_set_vinyl_timeout,
+    vinyl_parallel_lookup   = private.cfg_set_vinyl_parallel_lookup,
     checkpoint_count        = private.cfg_set_checkpoint_count,
     checkpoint_interval     = private.checkpoint_daemon.set_checkpoint_interval,
     worker_pool_threads     = private.cfg_set_worker_pool_threads,
@@ -38,6 +38,7 @@
 #include "box/iproto_constants.h"
 #include "box/lua/tuple.h" /* luamp_convert_tuple() / luamp_convert_key() */
 #include "box/xrow.h"
+#include "box/tuple.h"
 
 #include "lua/msgpack.h"
 #include "third_party/base64.h"
@@ -581,6 +582,65 @@ netbox_encode_execute(lua_State *L)
 	return 0;
 }
 
+/**
+ * Decode an array of tuples and push a Lua table of box.tuple
+ * objects. Each tuple is created directly from the msgpack in
+ * the receive buffer, without building an intermediate Lua table.
+ */
+static void
+netbox_decode_data(struct lua_State *L, const char **data)
+{
+	uint32_t count = mp_decode_array(data);
+	lua_createtable(L, count, 0);
+	struct tuple_format *format = box_tuple_format_default();
+	for (uint32_t i = 0; i < count; ++i) {
+		const char *begin = *data;
+		mp_next(data);
+		struct tuple *tuple = box_tuple_new(format, begin, *data);
+		if (tuple == NULL)
+			luaT_error(L);
+		luaT_pushtuple(L, tuple);
+		lua_rawseti(L, -2, i + 1);
+	}
+}
+
+/**
+ * decode_select(body_rpos) -> {tuple, ...}, body_end
+ *
+ * Decode the body of a successful response to a SELECT or DML
+ * request. The body is expected to be a map containing the
+ * IPROTO_DATA key, other keys are skipped.
+ */
+static int
+netbox_decode_select(struct lua_State *L)
+{
+	if (lua_gettop(L) != 1)
+		return luaL_error(L, "Usage: netbox.decode_select(body_rpos)");
+	uint32_t ctypeid;
+	const char *data = *(const char **)luaL_checkcdata(L, 1, &ctypeid);
+	assert(mp_typeof(*data) == MP_MAP);
+	uint32_t map_size = mp_decode_map(&data);
+	bool has_data = false;
+	for (uint32_t i = 0; i < map_size; ++i) {
+		if (mp_typeof(*data) != MP_UINT) {
+			/* Skip an unknown key and its value. */
+			mp_next(&data);
+			mp_next(&data);
+			continue;
+		}
+		if (mp_decode_uint(&data) != IPROTO_DATA || has_data) {
+			mp_next(&data);
+			continue;
+		}
+		netbox_decode_data(L, &data);
+		has_data = true;
+	}
+	if (!has_data)
+		lua_newtable(L);
+	*(const char **)luaL_pushcdata(L, ctypeid) = data;
+	return 2;
+}
+
 int
 luaopen_net_box(struct lua_State *L)
 {
@@ -598,6 +658,7 @@ luaopen_net_box(struct lua_State *L)
 		{ "encode_execute", netbox_encode_execute},
 		{ "encode_auth",    netbox_encode_auth },
 		{ "decode_greeting",netbox_decode_greeting },
+		{ "decode_select",  netbox_decode_select },
 		{ "communicate",    netbox_communicate },
 		{ NULL, NULL}
 	};
@@ -26,6 +26,7 @@ local communicate     = internal.communicate
 local encode_auth     = internal.encode_auth
 local encode_select   = internal.encode_select
 local decode_greeting = internal.decode_greeting
+local decode_select   = internal.decode_select
 
 local sequence_mt      = { __serialize = 'sequence' }
 local TIMEOUT_INFINITY = 500 * 365 * 86400
@@ -73,11 +74,29 @@ local method_codec           = {
     end
 }
 
+-- methods whose response body is an array of tuples, decoded in C
+-- straight into box.tuple objects
+local method_decoder         = {
+    insert  = decode_select,
+    replace = decode_select,
+    delete  = decode_select,
+    update  = decode_select,
+    upsert  = decode_select,
+    select  = decode_select,
+}
+
 local function next_id(id) return band(id + 1, 0x7FFFFFFF) end
 
+-- Make an error object without raising it.
+local function new_error(code, reason)
+    local _, err = pcall(box.error, {code = code, reason = reason})
+    return err
+end
+
 -- function create_transport(host, port, user, password, callback)
 --
--- Transport methods: connect(), close(), perfrom_request(), wait_state()
+-- Transport methods: connect(), close(), perfrom_request(),
+-- perform_async_request(), wait_state()
 --
 -- Basically, *transport* is a TCP connection speaking one of
 -- Tarantool network protocols. This is a low-level interface.
@@ -172,7 +191,8 @@ local function create_transport(host, port, user, password, callback)
                 local id, request = next_id, next_request
                 next_id, next_request = next(requests, id)
                 if request.schema_version ~= schema_version then
-                    requests[id] = nil -- this marks the request as completed
+                    requests[id] = nil
+                    request.id = nil -- this marks the request as completed
                     request.errno  = new_errno
                     request.response = new_error
                 end
@@ -224,11 +244,88 @@ local function create_transport(host, port, user, password, callback)
     end
 
     -- REQUEST/RESPONSE --
-    local function perform_request(timeout, buffer, method, schema_version, ...)
-        if state ~= 'active' then
-            return last_errno or E_NO_CONNECTION, last_error
+    --
+    -- A request object is returned to the user as a future when
+    -- the request is asynchronous. It is completed either by the
+    -- worker fiber on response arrival or by set_state() on
+    -- connection failure. A completed request has no id.
+    local request_index = {}
+
+    function request_index:is_ready()
+        return self.id == nil
+    end
+
+    --
+    -- Get the result of a completed request.
+    -- Returns response or nil, error.
+    --
+    function request_index:result()
+        if self.id ~= nil then
+            return nil, new_error(E_PROC_LUA, 'Response is not ready')
+        elseif self.errno ~= nil then
+            return nil, new_error(self.errno, self.response)
         end
+        if self.postproc == nil then
+            return self.response
+        end
+        local ok, res = pcall(self.postproc, self.method, self.buffer,
+                              self.response)
+        if not ok then
+            return nil, res
+        end
+        return res
+    end
+
+    --
+    -- Wait until the request is completed or the timeout
+    -- expires. Returns true if the request is completed.
+    --
+    function request_index:wait(timeout)
         local deadline = fiber_clock() + (timeout or TIMEOUT_INFINITY)
+        self.client = fiber_self()
+        -- beware spurious wakeups
+        while self.id ~= nil do
+            if not state_cond:wait(max(0, deadline - fiber_clock())) then
+                break
+            end
+        end
+        self.client = nil
+        return self.id == nil
+    end
+
+    function request_index:wait_result(timeout)
+        if not self:wait(timeout) then
+            return nil, new_error(E_TIMEOUT, 'Timeout exceeded')
+        end
+        return self:result()
+    end
+
+    --
+    -- Forget about the request. The response, if it arrives,
+    -- is silently dropped by the worker fiber.
+    --
+    function request_index:discard()
+        if self.id ~= nil then
+            requests[self.id] = nil
+            self.id = nil
+            self.errno = E_PROC_LUA
+            self.response = 'Response is discarded'
+        end
+    end
+
+    local request_mt = { __index = request_index }
+
+    --
+    -- Encode a request into the send buffer and return the request
+    -- object without waiting for the response. The worker fiber
+    -- is only alerted when the buffer was empty, so all requests
+    -- encoded before the caller yields are written to the socket
+    -- in a single batch.
+    --
+    local function perform_async_request(buffer, method, schema_version, ...)
+        if state ~= 'active' then
+            return nil, last_errno or E_NO_CONNECTION, last_error
+        end
         -- alert worker to notify it of the queued outgoing data;
         -- if the buffer wasn't empty, assume the worker was already alerted
         if send_buf:size() == 0 then
@@ -237,27 +334,33 @@ local function create_transport(host, port, user, password, callback)
         local id = next_request_id
         method_codec[method](send_buf, id, schema_version, ...)
         next_request_id = next_id(id)
-        -- reserve space for 8 keys: client, method,
+        -- reserve space for 10 keys: id, client, method,
         -- schema_version, buffer, errno, response, metadata,
-        -- sql_info.
-        local request = table_new(0, 8)
-        request.client = fiber_self()
+        -- sql_info, postproc.
+        local request = setmetatable(table_new(0, 10), request_mt)
+        request.id = id
         request.method = method
         request.schema_version = schema_version
         request.buffer = buffer
         requests[id] = request
-        repeat
-            local timeout = max(0, deadline - fiber_clock())
-            if not state_cond:wait(timeout) then
-                requests[id] = nil
-                return E_TIMEOUT, 'Timeout exceeded'
-            end
-        until requests[id] == nil -- i.e. completed (beware spurious wakeups)
+        return request
+    end
+
+    local function perform_request(timeout, buffer, method, schema_version, ...)
+        local request, err, msg =
+            perform_async_request(buffer, method, schema_version, ...)
+        if request == nil then
+            return err, msg
+        end
+        if not request:wait(timeout) then
+            request:discard()
+            return E_TIMEOUT, 'Timeout exceeded'
+        end
         return request.errno, request.response, request.metadata, request.info
     end
 
     local function wakeup_client(client)
-        if client:status() ~= 'dead' then
+        if client ~= nil and client:status() ~= 'dead' then
             client:wakeup()
         end
     end
@@ -269,6 +372,7 @@ local function create_transport(host, port, user, password, callback)
             return
         end
         requests[id] = nil
+        request.id = nil
         local status = hdr[IPROTO_STATUS_KEY]
         local body, body_end_check
 
@@ -293,6 +397,15 @@ local function create_transport(host, port, user, password, callback)
             return
         end
 
+        local decoder = method_decoder[request.method]
+        if decoder ~= nil then
+            -- Decode xrow.body[DATA] to tuples
+            request.response, body_end_check = decoder(body_rpos)
+            assert(body_end == body_end_check, "invalid xrow length")
+            wakeup_client(request.client)
+            return
+        end
+
         -- Decode xrow.body[DATA] to Lua objects
         body, body_end_check = decode(body_rpos)
         assert(body_end == body_end_check, "invalid xrow length")
@@ -409,6 +522,7 @@ local function create_transport(host, port, user, password, callback)
                 return
             end
             requests[rid] = nil
+            request.id = nil
             request.response = response
             wakeup_client(request.client)
             return console_sm(next_id(rid))
@@ -517,7 +631,8 @@ local function create_transport(host, port, user, password, callback)
         close           = close,
         connect         = connect,
         wait_state      = wait_state,
-        perform_request = perform_request
+        perform_request = perform_request,
+        perform_async_request = perform_async_request
     }
 end
 
@@ -731,7 +846,67 @@ function remote_methods:request_timeout(request_opts)
     return timeout
 end
 
-function remote_methods:_request(method, opts, ...)
+--
+-- Convert a decoded response body to what the request returns:
+-- a sequence of tuples for everything but eval and call, or the
+-- length of xrow.body if the body was copied to a user buffer.
+-- Responses to SELECT and DML are already decoded to tuples
+-- by the worker fiber, see method_decoder.
+--
+local function decode_response(method, buffer, res)
+    if buffer ~= nil then
+        return res -- the length of xrow.body
+    end
+    setmetatable(res, sequence_mt)
+    if method == 'call_16' then
+        local tnew = box.tuple.new
+        for i, v in pairs(res) do
+            res[i] = tnew(v)
+        end
+    end
+    return res
+end
+
+local function one_tuple(tab)
+    if type(tab) ~= 'table' then
+        return tab
+    elseif tab[1] ~= nil then
+        return tab[1]
+    end
+end
+
+local function decode_one_tuple(method, buffer, res)
+    return one_tuple(decode_response(method, buffer, res))
+end
+
+local function decode_get(method, buffer, res)
+    res = decode_response(method, buffer, res)
+    if res[2] ~= nil then box.error(box.error.MORE_THAN_ONE_TUPLE) end
+    if res[1] ~= nil then return res[1] end
+end
+
+local function decode_count(method, buffer, res)
+    return decode_response(method, buffer, res)[1][1]
+end
+
+local function decode_nothing()
+end
+
+--
+-- Perform a request and return its result converted by
+-- decode(method, buffer, response). If opts.is_async is set,
+-- return a future object instead of waiting for the response.
+-- The future has the following methods:
+--  * is_ready() - true if the response has arrived or the request
+--    has failed;
+--  * result() - the converted response, or nil, error;
+--  * wait_result(timeout) - wait for the response and return
+--    result();
+--  * discard() - do not wait for the response.
+-- Asynchronous requests are not retried on schema version
+-- mismatch, the error is returned to the user instead.
+--
+function remote_methods:_request(method, opts, decode, ...)
     local this_fiber = fiber_self()
     local transport = self._transport
     local perform_request = transport.perform_request
@@ -746,6 +921,18 @@ function remote_methods:_request(method, opts, ...)
         deadline = self._deadlines[this_fiber]
     end
     local buffer = opts and opts.buffer
+    if opts and opts.is_async then
+        if self.state ~= 'active' then
+            wait_state('active', deadline and max(0, deadline - fiber_clock()))
+        end
+        local request, err, res = transport.perform_async_request(buffer,
+                                        method, self.schema_version, ...)
+        if request == nil then
+            box.error({code = err, reason = res})
+        end
+        request.postproc = decode
+        return request
+    end
     local err, res
     repeat
         local timeout = deadline and max(0, deadline - fiber_clock())
@@ -755,18 +942,8 @@ function remote_methods:_request(method, opts, ...)
         end
         err, res = perform_request(timeout, buffer, method,
                                    self.schema_version, ...)
-        if not err and buffer ~= nil then
-            return res -- the length of xrow.body
-        elseif not err then
-            setmetatable(res, sequence_mt)
-            local postproc = method ~= 'eval' and method ~= 'call_17'
-            if postproc then
-                local tnew = box.tuple.new
-                for i, v in pairs(res) do
-                    res[i] = tnew(v)
-                end
-            end
-            return res
+        if not err then
+            return decode(method, buffer, res)
         elseif err == E_WRONG_SCHEMA_VERSION then
             err = nil
         end
@@ -784,22 +961,24 @@ end
 
 function remote_methods:reload_schema()
     check_remote_arg(self, 'reload_schema')
-    self:_request('select', nil, VSPACE_ID, 0, box.index.GE, 0, 0xFFFFFFFF,
-                  nil)
+    self:_request('select', nil, decode_response, VSPACE_ID, 0, box.index.GE,
+                  0, 0xFFFFFFFF, nil)
 end
 
 -- @deprecated since 1.7.4
 function remote_methods:call_16(func_name, ...)
     check_remote_arg(self, 'call')
-    return self:_request('call_16', nil, tostring(func_name), {...})
+    return self:_request('call_16', nil, decode_response, tostring(func_name),
+                         {...})
 end
 
 function remote_methods:call(func_name, args, opts)
     check_remote_arg(self, 'call')
     check_call_args(args)
     args = args or {}
-    local res = self:_request('call_17', opts, tostring(func_name), args)
-    if type(res) ~= 'table' then
+    local res = self:_request('call_17', opts, decode_response,
+                              tostring(func_name), args)
+    if type(res) ~= 'table' or opts and opts.is_async then
         return res
     end
     return unpack(res)
@@ -808,15 +987,15 @@ end
 -- @deprecated since 1.7.4
 function remote_methods:eval_16(code, ...)
     check_remote_arg(self, 'eval')
-    return unpack(self:_request('eval', nil, code, {...}))
+    return unpack(self:_request('eval', nil, decode_response, code, {...}))
 end
 
 function remote_methods:eval(code, args, opts)
     check_remote_arg(self, 'eval')
     check_eval_args(args)
     args = args or {}
-    local res = self:_request('eval', opts, code, args)
-    if type(res) ~= 'table' then
+    local res = self:_request('eval', opts, decode_response, code, args)
+    if type(res) ~= 'table' or opts and opts.is_async then
         return res
     end
     return unpack(res)
@@ -998,25 +1177,19 @@ function console_methods:eval(line, timeout)
     return res[1] or res
 end
 
-local function one_tuple(tab)
-    if type(tab) ~= 'table' then
-        return tab
-    elseif tab[1] ~= nil then
-        return tab[1]
-    end
-end
-
 space_metatable = function(remote)
     local methods = {}
 
     function methods:insert(tuple, opts)
         check_space_arg(self, 'insert')
-        return one_tuple(remote:_request('insert', opts, self.id, tuple))
+        return remote:_request('insert', opts, decode_one_tuple, self.id,
+                               tuple)
     end
 
     function methods:replace(tuple, opts)
         check_space_arg(self, 'replace')
-        return one_tuple(remote:_request('replace', opts, self.id, tuple))
+        return remote:_request('replace', opts, decode_one_tuple, self.id,
+                               tuple)
     end
 
     function methods:select(key, opts)
@@ -1036,8 +1209,11 @@ space_metatable = function(remote)
 
     function methods:upsert(key, oplist, opts)
         check_space_arg(self, 'upsert')
-        remote:_request('upsert', opts, self.id, key, oplist)
-        return
+        local res = remote:_request('upsert', opts, decode_nothing, self.id,
+                                    key, oplist)
+        if opts and opts.is_async then
+            return res
+        end
     end
 
     function methods:get(key, opts)
@@ -1066,8 +1242,8 @@ index_metatable = function(remote)
         local iterator = check_iterator_type(opts, key_is_nil)
         local offset = tonumber(opts and opts.offset) or 0
         local limit = tonumber(opts and opts.limit) or 0xFFFFFFFF
-        return remote:_request('select', opts, self.space.id, self.id,
-                               iterator, offset, limit, key)
+        return remote:_request('select', opts, decode_response, self.space.id,
+                               self.id, iterator, offset, limit, key)
     end
 
     function methods:get(key, opts)
@@ -1075,10 +1251,8 @@ index_metatable = function(remote)
         if opts and opts.buffer then
             error("index:get() doesn't support `buffer` argument")
         end
-        local res = remote:_request('select', opts, self.space.id, self.id,
-                                    box.index.EQ, 0, 2, key)
-        if res[2] ~= nil then box.error(box.error.MORE_THAN_ONE_TUPLE) end
-        if res[1] ~= nil then return res[1] end
+        return remote:_request('select', opts, decode_get, self.space.id,
+                               self.id, box.index.EQ, 0, 2, key)
     end
 
     function methods:min(key, opts)
@@ -1086,9 +1260,8 @@ index_metatable = function(remote)
         if opts and opts.buffer then
             error("index:min() doesn't support `buffer` argument")
         end
-        local res = remote:_request('select', opts, self.space.id, self.id,
-                                    box.index.GE, 0, 1, key)
-        return one_tuple(res)
+        return remote:_request('select', opts, decode_one_tuple,
+                               self.space.id, self.id, box.index.GE, 0, 1, key)
     end
 
     function methods:max(key, opts)
@@ -1096,9 +1269,8 @@ index_metatable = function(remote)
         if opts and opts.buffer then
             error("index:max() doesn't support `buffer` argument")
         end
-        local res = remote:_request('select', opts, self.space.id, self.id,
-                                    box.index.LE, 0, 1, key)
-        return one_tuple(res)
+        return remote:_request('select', opts, decode_one_tuple,
+                               self.space.id, self.id, box.index.LE, 0, 1, key)
     end
 
     function methods:count(key, opts)
@@ -1108,21 +1280,19 @@ index_metatable = function(remote)
         end
         local code = string.format('box.space.%s.index.%s:count',
                                    self.space.name, self.name)
-        return remote:_request('call_16', opts, code, { key })[1][1]
+        return remote:_request('call_16', opts, decode_count, code, { key })
     end
 
     function methods:delete(key, opts)
         check_index_arg(self, 'delete')
-        local res = remote:_request('delete', opts, self.space.id, self.id,
-                                    key)
-        return one_tuple(res)
+        return remote:_request('delete', opts, decode_one_tuple,
+                               self.space.id, self.id, key)
     end
 
     function methods:update(key, oplist, opts)
         check_index_arg(self, 'update')
-        local res = remote:_request('update', opts, self.space.id, self.id,
-                                    key, oplist)
-        return one_tuple(res)
+        return remote:_request('update', opts, decode_one_tuple,
+                               self.space.id, self.id, key, oplist)
     end
 
     return { __index = methods, __metatable = false }
@@ -369,11 +369,14 @@ box.schema.space.create = function(name, options)
         user = 'string, number',
         format = 'table',
         temporary = 'boolean',
+        defer_deletes = 'boolean',
+        compression = 'string',
     }
     local options_defaults = {
         engine = 'memtx',
         field_count = 0,
         temporary = false,
+        defer_deletes = false,
     }
     check_param_table(options, options_template)
     options = update_param_table(options, options_defaults)
@@ -412,6 +415,8 @@ box.schema.space.create = function(name, options)
     -- filter out global parameters from the options array
     local space_options = setmap({
         temporary = options.temporary and true or nil,
+        defer_deletes = options.defer_deletes and true or nil,
+        compression = options.compression,
     })
     _space:insert{id, uid, name, options.engine, options.field_count,
         space_options, format}
@@ -616,6 +621,10 @@ local index_options = {
     range_size = 'number',
     page_size = 'number',
     bloom_fpr = 'number',
+    blob_threshold = 'number',
+    cache_size = 'number',
+    ttl = 'number',
+    ttl_field = 'number',
 }
 
 --
@@ -657,6 +666,7 @@ box.schema.index.create = function(space_id, name, options)
     local type_dependent_defaults = {
         rtree = {parts = { 2, 'array' }, unique = false},
         bitset = {parts = { 2, 'unsigned' }, unique = false},
+        column = {parts = { 2, 'unsigned' }, unique = false},
         other = {parts = { 1, 'unsigned' }, unique = true},
     }
     options_defaults = type_dependent_defaults[options.type]
@@ -720,6 +730,10 @@ box.schema.index.create = function(space_id, name, options)
             run_count_per_level = options.run_count_per_level,
             run_size_ratio = options.run_size_ratio,
             bloom_fpr = options.bloom_fpr,
+            blob_threshold = options.blob_threshold,
+            cache_size = options.cache_size,
+            ttl = options.ttl,
+            ttl_field = options.ttl_field,
     }
     local field_type_aliases = {
         num = 'unsigned'; -- Deprecated since 1.7.2
@@ -1262,6 +1276,15 @@ function box.schema.space.bless(space)
         return internal.info(index.space_id, index.id);
     end
 
+    index_mt.aggregate = function(index, part)
+        check_index_arg(index, 'aggregate')
+        part = part or 1
+        if type(part) ~= 'number' or part < 1 then
+            box.error(box.error.PROC_LUA, "Usage: index:aggregate([part])")
+        end
+        return internal.aggregate(index.space_id, index.id, part - 1)
+    end
+
     index_mt.drop = function(index)
         check_index_arg(index, 'drop')
         return box.schema.index.drop(index.space_id, index.id)
@@ -100,6 +100,29 @@ lbox_session_sync(struct lua_State *L)
 	return 1;
 }
 
+/**
+ * Get or set the priority class of fibers serving requests
+ * of the current session. Setting it also changes the class
+ * of the current fiber. Can be used in an on_connect or
+ * on_auth trigger to assign a class per user.
+ */
+static int
+lbox_session_prio(struct lua_State *L)
+{
+	struct session *session = current_session();
+	if (lua_gettop(L) == 0) {
+		lua_pushstring(L, fiber_prio_STRS[session->prio]);
+		return 1;
+	}
+	const char *str = luaL_checkstring(L, 1);
+	uint32_t prio = strindex(fiber_prio_STRS, str, FIBER_PRIO_MAX);
+	if (prio == FIBER_PRIO_MAX)
+		return luaL_error(L, "Unknown fiber priority '%s'", str);
+	session->prio = (enum fiber_prio) prio;
+	fiber_set_prio(fiber(), session->prio);
+	return 0;
+}
+
 /**
  * Session effective user id.
  * Note: user id (effective_user()->uid)
@@ -414,6 +437,7 @@ box_lua_session_init(struct lua_State *L)
 		{"id", lbox_session_id},
 		{"type", lbox_session_type},
 		{"sync", lbox_session_sync},
+		{"prio", lbox_session_prio},
 		{"uid", lbox_session_uid},
 		{"euid", lbox_session_euid},
 		{"user", lbox_session_user},
@@ -41,9 +41,12 @@
 #include "small/small.h"
 #include "small/quota.h"
 #include "memory.h"
+#include "box/tuple.h"
 
 extern struct small_alloc memtx_alloc;
 extern struct mempool memtx_index_extent_pool;
+extern enum tuple_arena_pages memtx_arena_pages;
+extern int memtx_arena_numa_node;
 
 static int
 small_stats_noop_cb(const struct mempool_stats *stats, void *cb_ctx)
@@ -218,6 +221,56 @@ lbox_slab_info(struct lua_State *L)
 	return 1;
 }
 
+/**
+ * Show how much of the memtx arena is backed by huge pages.
+ * Unlike box.slab.info(), this asks the kernel, which takes
+ * time proportional to the arena size.
+ */
+static int
+lbox_slab_huge_pages(struct lua_State *L)
+{
+	struct slab_arena *arena = memtx_alloc.cache->arena;
+	struct tuple_arena_stat stat;
+	if (tuple_arena_stat(arena, &stat) != 0)
+		return luaT_error(L);
+
+	lua_newtable(L);
+
+	/* Pages the arena ended up with, see box.cfg.memtx_huge_pages */
+	lua_pushstring(L, "pages");
+	lua_pushstring(L, tuple_arena_pages_STRS[memtx_arena_pages]);
+	lua_settable(L, -3);
+
+	lua_pushstring(L, "numa_node");
+	lua_pushinteger(L, memtx_arena_numa_node);
+	lua_settable(L, -3);
+
+	lua_pushstring(L, "page_size");
+	luaL_pushuint64(L, stat.page_size);
+	lua_settable(L, -3);
+
+	/* How much of the arena is in RAM */
+	lua_pushstring(L, "resident");
+	luaL_pushuint64(L, stat.resident);
+	lua_settable(L, -3);
+
+	/* How much of the resident memory is in huge pages */
+	lua_pushstring(L, "huge");
+	luaL_pushuint64(L, stat.huge);
+	lua_settable(L, -3);
+
+	double ratio = 100 * ((double) stat.huge /
+			      ((double) stat.resident + 0.0001));
+	char ratio_buf[32];
+	snprintf(ratio_buf, sizeof(ratio_buf), "%0.1lf%%", ratio);
+
+	lua_pushstring(L, "huge_ratio");
+	lua_pushstring(L, ratio_buf);
+	lua_settable(L, -3);
+
+	return 1;
+}
+
 static int
 lbox_runtime_info(struct lua_State *L)
 {
@@ -268,6 +321,10 @@ box_lua_slab_init(struct lua_State *L)
 	lua_pushcfunction(L, lbox_slab_check);
 	lua_settable(L, -3);
 
+	lua_pushstring(L, "huge_pages");
+	lua_pushcfunction(L, lbox_slab_huge_pages);
+	lua_settable(L, -3);
+
 	lua_settable(L, -3); /* box.slab */
 
 	lua_pushstring(L, "runtime");
@@ -39,6 +39,7 @@
 #include "fiber.h"
 #include "tuple.h"
 #include "memtx_engine.h"
+#include "memtx_tx.h"
 
 #ifndef OLD_GOOD_BITSET
 #include "small/matras.h"
@@ -184,17 +185,22 @@ bitset_index_iterator_next(struct iterator *iterator, struct tuple **ret)
 	assert(iterator->free == bitset_index_iterator_free);
 	struct bitset_index_iterator *it = bitset_index_iterator(iterator);
 
-	size_t value = bitset_iterator_next(&it->bitset_it);
-	if (value == SIZE_MAX) {
-		*ret = NULL;
-		return 0;
-	}
+	do {
+		size_t value = bitset_iterator_next(&it->bitset_it);
+		if (value == SIZE_MAX) {
+			*ret = NULL;
+			return 0;
+		}
 
 #ifndef OLD_GOOD_BITSET
-	*ret = memtx_bitset_index_value_to_tuple(it->bitset_index, value);
+		*ret = memtx_bitset_index_value_to_tuple(it->bitset_index,
+							 value);
 #else /* #ifndef OLD_GOOD_BITSET */
-	*ret = value_to_tuple(value);
+		*ret = value_to_tuple(value);
 #endif /* #ifndef OLD_GOOD_BITSET */
+		/* Skip versions invisible to the current transaction. */
+		*ret = memtx_tx_tuple_clarify(*ret, iterator->index_id);
+	} while (*ret == NULL);
 	return 0;
 }
 
@@ -383,6 +389,7 @@ memtx_bitset_index_create_iterator(struct index *base, enum iterator_type type,
 	}
 
 	bitset_expr_destroy(&expr);
+	memtx_tx_track_read(base, NULL);
 	return (struct iterator *)it;
 fail:
 	bitset_expr_destroy(&expr);
@@ -464,6 +471,7 @@ static const struct index_vtab memtx_bitset_index_vtab = {
 	/* .max = */ generic_index_max,
 	/* .random = */ generic_index_random,
 	/* .count = */ memtx_bitset_index_count,
+	/* .aggregate = */ generic_index_aggregate,
 	/* .get = */ generic_index_get,
 	/* .replace = */ memtx_bitset_index_replace,
 	/* .create_iterator = */ memtx_bitset_index_create_iterator,
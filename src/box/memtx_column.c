@@ -0,0 +1,932 @@
+/*
+ * Copyright 2010-2016, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "memtx_column.h"
+
+#include <string.h>
+#include <small/mempool.h>
+
+#include "trivia/util.h"
+
+#include "fiber.h"
+#include "tuple.h"
+#include "info.h"
+#include "memtx_engine.h"
+#include "memtx_tx.h"
+#include "schema.h"
+
+enum {
+	/** Number of rows in a block. */
+	COLUMN_BLOCK_ROWS = 1024,
+	/** Max number of values in a block dictionary. */
+	COLUMN_DICT_MAX = 256,
+	/** Size of the hash table used to build a dictionary. */
+	COLUMN_DICT_HASH_SIZE = 2 * COLUMN_DICT_MAX,
+	/**
+	 * Sealed blocks with fewer live rows are compacted:
+	 * their rows are moved to the open block.
+	 */
+	COLUMN_BLOCK_COMPACT_ROWS = COLUMN_BLOCK_ROWS / 4,
+};
+
+enum column_encoding {
+	/** A value per row. */
+	COLUMN_PLAIN,
+	/** Runs of equal values. */
+	COLUMN_RLE,
+	/** A dictionary of values and a one-byte code per row. */
+	COLUMN_DICT,
+};
+
+/** Values of a key part stored in a block. */
+struct column_vector {
+	enum column_encoding encoding;
+	/** Number of runs (RLE) or dictionary size (DICT). */
+	uint32_t size;
+	/**
+	 * PLAIN: value of each row.
+	 * RLE: value of each run.
+	 * DICT: dictionary.
+	 */
+	int64_t *values;
+	/** RLE: number of the row following each run. */
+	uint16_t *run_end;
+	/** DICT: dictionary code of each row. */
+	uint8_t *codes;
+};
+
+struct column_block {
+	/** Link in memtx_column_index::blocks. */
+	struct rlist in_index;
+	/** Unique id, grows with each new block. */
+	uint64_t id;
+	/** Number of rows appended to the block. */
+	uint32_t row_count;
+	/** Number of rows that have not been deleted. */
+	uint32_t live_count;
+	/** Set when the block is full and its vectors are encoded. */
+	bool is_sealed;
+	/** A bit per row, set if the row is deleted. */
+	uint64_t deleted[COLUMN_BLOCK_ROWS / 64];
+	/** Tuple of each row. */
+	struct tuple *tuples[COLUMN_BLOCK_ROWS];
+	/** A vector per key part. */
+	struct column_vector columns[0];
+};
+
+struct column_hash_entry {
+	struct tuple *tuple;
+	struct column_block *block;
+	uint32_t row;
+};
+
+#define mh_int_t uint32_t
+#define mh_arg_t int
+
+#if UINTPTR_MAX == 0xffffffff
+#define mh_hash_key(a, arg) ((uintptr_t)(a))
+#else
+#define mh_hash_key(a, arg) ((uint32_t)(((uintptr_t)(a)) >> 33 ^ ((uintptr_t)(a)) ^ ((uintptr_t)(a)) << 11))
+#endif
+#define mh_hash(a, arg) mh_hash_key((a)->tuple, arg)
+#define mh_cmp(a, b, arg) ((a)->tuple != (b)->tuple)
+#define mh_cmp_key(a, b, arg) ((a) != (b)->tuple)
+
+#define mh_node_t struct column_hash_entry
+#define mh_key_t struct tuple *
+#define mh_name _column_index
+#define MH_SOURCE 1
+#include <salad/mhash.h>
+
+static inline bool
+column_block_is_deleted(struct column_block *block, uint32_t row)
+{
+	return (block->deleted[row / 64] & (1ULL << (row % 64))) != 0;
+}
+
+static inline void
+column_block_set_deleted(struct column_block *block, uint32_t row)
+{
+	block->deleted[row / 64] |= 1ULL << (row % 64);
+}
+
+static size_t
+column_vector_bsize(struct column_vector *vector)
+{
+	switch (vector->encoding) {
+	case COLUMN_PLAIN:
+		return COLUMN_BLOCK_ROWS * sizeof(int64_t);
+	case COLUMN_RLE:
+		return vector->size * (sizeof(int64_t) + sizeof(uint16_t));
+	case COLUMN_DICT:
+		return vector->size * sizeof(int64_t) +
+		       COLUMN_BLOCK_ROWS * sizeof(uint8_t);
+	default:
+		unreachable();
+		return 0;
+	}
+}
+
+static void
+column_vector_destroy(struct column_vector *vector)
+{
+	free(vector->values);
+	free(vector->run_end);
+	free(vector->codes);
+}
+
+/**
+ * Replace plain values of a full block with runs.
+ * Returns -1 on memory allocation error, in which case
+ * the vector is left intact.
+ */
+static int
+column_vector_encode_rle(struct column_vector *vector, uint32_t run_count)
+{
+	int64_t *values = malloc(run_count * sizeof(*values));
+	uint16_t *run_end = malloc(run_count * sizeof(*run_end));
+	if (values == NULL || run_end == NULL) {
+		free(values);
+		free(run_end);
+		return -1;
+	}
+	const int64_t *plain = vector->values;
+	uint32_t run = 0;
+	for (uint32_t row = 1; row <= COLUMN_BLOCK_ROWS; row++) {
+		if (row < COLUMN_BLOCK_ROWS && plain[row] == plain[row - 1])
+			continue;
+		values[run] = plain[row - 1];
+		run_end[run] = row;
+		run++;
+	}
+	assert(run == run_count);
+	free(vector->values);
+	vector->encoding = COLUMN_RLE;
+	vector->size = run_count;
+	vector->values = values;
+	vector->run_end = run_end;
+	return 0;
+}
+
+/**
+ * Replace plain values of a full block with a dictionary
+ * of @dict_size values and per-row codes.
+ */
+static int
+column_vector_encode_dict(struct column_vector *vector,
+			  const int64_t *dict, uint32_t dict_size,
+			  uint8_t *codes)
+{
+	int64_t *values = malloc(dict_size * sizeof(*values));
+	uint8_t *row_codes = malloc(COLUMN_BLOCK_ROWS * sizeof(*row_codes));
+	if (values == NULL || row_codes == NULL) {
+		free(values);
+		free(row_codes);
+		return -1;
+	}
+	memcpy(values, dict, dict_size * sizeof(*values));
+	memcpy(row_codes, codes, COLUMN_BLOCK_ROWS * sizeof(*row_codes));
+	free(vector->values);
+	vector->encoding = COLUMN_DICT;
+	vector->size = dict_size;
+	vector->values = values;
+	vector->codes = row_codes;
+	return 0;
+}
+
+/**
+ * Build a dictionary of values of a full block.
+ * Returns the dictionary size or 0 if the block has too
+ * many distinct values.
+ */
+static uint32_t
+column_dict_build(const int64_t *plain, int64_t *dict, uint8_t *codes)
+{
+	/* Dictionary code + 1 or 0 if the slot is empty. */
+	uint16_t slots[COLUMN_DICT_HASH_SIZE];
+	memset(slots, 0, sizeof(slots));
+	uint32_t dict_size = 0;
+	for (uint32_t row = 0; row < COLUMN_BLOCK_ROWS; row++) {
+		int64_t value = plain[row];
+		uint32_t slot = ((uint64_t)value * 0x9E3779B97F4A7C15ULL) >>
+				(64 - 9);
+		assert(slot < COLUMN_DICT_HASH_SIZE);
+		while (slots[slot] != 0 && dict[slots[slot] - 1] != value)
+			slot = (slot + 1) % COLUMN_DICT_HASH_SIZE;
+		if (slots[slot] == 0) {
+			if (dict_size == COLUMN_DICT_MAX)
+				return 0;
+			dict[dict_size++] = value;
+			slots[slot] = dict_size;
+		}
+		codes[row] = slots[slot] - 1;
+	}
+	return dict_size;
+}
+
+/**
+ * Pick the most compact encoding for values of a full block.
+ * If memory allocation fails, the values stay plain.
+ */
+static void
+column_vector_encode(struct column_vector *vector)
+{
+	assert(vector->encoding == COLUMN_PLAIN);
+	const int64_t *plain = vector->values;
+	uint32_t run_count = 1;
+	for (uint32_t row = 1; row < COLUMN_BLOCK_ROWS; row++)
+		run_count += plain[row] != plain[row - 1];
+
+	int64_t dict[COLUMN_DICT_MAX];
+	uint8_t codes[COLUMN_BLOCK_ROWS];
+	uint32_t dict_size = column_dict_build(plain, dict, codes);
+
+	size_t plain_bsize = COLUMN_BLOCK_ROWS * sizeof(int64_t);
+	size_t rle_bsize = run_count * (sizeof(int64_t) + sizeof(uint16_t));
+	size_t dict_bsize = dict_size == 0 ? SIZE_MAX :
+			    dict_size * sizeof(int64_t) + sizeof(codes);
+	if (rle_bsize <= dict_bsize && rle_bsize < plain_bsize)
+		column_vector_encode_rle(vector, run_count);
+	else if (dict_bsize < plain_bsize)
+		column_vector_encode_dict(vector, dict, dict_size, codes);
+}
+
+static struct column_block *
+column_block_new(struct memtx_column_index *index)
+{
+	uint32_t part_count = index->part_count;
+	struct column_block *block = calloc(1, sizeof(*block) +
+				part_count * sizeof(struct column_vector));
+	if (block == NULL) {
+		diag_set(OutOfMemory, sizeof(*block), "malloc",
+			 "struct column_block");
+		return NULL;
+	}
+	for (uint32_t i = 0; i < part_count; i++) {
+		struct column_vector *vector = &block->columns[i];
+		vector->encoding = COLUMN_PLAIN;
+		vector->values = malloc(COLUMN_BLOCK_ROWS * sizeof(int64_t));
+		if (vector->values == NULL) {
+			diag_set(OutOfMemory,
+				 COLUMN_BLOCK_ROWS * sizeof(int64_t),
+				 "malloc", "column values");
+			for (uint32_t j = 0; j < i; j++)
+				column_vector_destroy(&block->columns[j]);
+			free(block);
+			return NULL;
+		}
+		index->bsize += column_vector_bsize(vector);
+	}
+	index->bsize += sizeof(*block);
+	block->id = index->next_block_id++;
+	rlist_add_tail_entry(&index->blocks, block, in_index);
+	return block;
+}
+
+static void
+column_block_delete(struct memtx_column_index *index,
+		    struct column_block *block)
+{
+	for (uint32_t i = 0; i < index->part_count; i++) {
+		struct column_vector *vector = &block->columns[i];
+		index->bsize -= column_vector_bsize(vector);
+		column_vector_destroy(vector);
+	}
+	index->bsize -= sizeof(*block);
+	rlist_del_entry(block, in_index);
+	free(block);
+	index->version++;
+}
+
+/** Encode vectors of a full block. */
+static void
+column_block_seal(struct memtx_column_index *index,
+		  struct column_block *block)
+{
+	assert(block->row_count == COLUMN_BLOCK_ROWS);
+	for (uint32_t i = 0; i < index->part_count; i++) {
+		struct column_vector *vector = &block->columns[i];
+		index->bsize -= column_vector_bsize(vector);
+		column_vector_encode(vector);
+		index->bsize += column_vector_bsize(vector);
+	}
+	block->is_sealed = true;
+}
+
+/** Get a key part value as it is stored in a vector. */
+static int
+column_extract_value(struct memtx_column_index *index,
+		     struct tuple *tuple, uint32_t part, int64_t *value)
+{
+	struct key_part *key_part = &index->base.def->key_def->parts[part];
+	const char *field = tuple_field(tuple, key_part->fieldno);
+	assert(field != NULL);
+	switch (mp_typeof(*field)) {
+	case MP_UINT: {
+		uint64_t u = mp_decode_uint(&field);
+		if (key_part->type == FIELD_TYPE_INTEGER && u > INT64_MAX) {
+			diag_set(ClientError, ER_UNSUPPORTED, "COLUMN index",
+				 "integer values greater than INT64_MAX");
+			return -1;
+		}
+		*value = (int64_t)u;
+		return 0;
+	}
+	case MP_INT:
+		*value = mp_decode_int(&field);
+		return 0;
+	default:
+		unreachable();
+		return -1;
+	}
+}
+
+/** Append a row to the open block. */
+static int
+memtx_column_index_append(struct memtx_column_index *index,
+			  struct tuple *tuple)
+{
+	struct column_block *block = NULL;
+	if (!rlist_empty(&index->blocks))
+		block = rlist_last_entry(&index->blocks,
+					 struct column_block, in_index);
+	if (block == NULL || block->is_sealed) {
+		block = column_block_new(index);
+		if (block == NULL)
+			return -1;
+	}
+	uint32_t row = block->row_count;
+	for (uint32_t i = 0; i < index->part_count; i++) {
+		int64_t *value = &block->columns[i].values[row];
+		if (column_extract_value(index, tuple, i, value) != 0)
+			return -1;
+	}
+	struct column_hash_entry entry;
+	entry.tuple = tuple;
+	entry.block = block;
+	entry.row = row;
+	uint32_t pos = mh_column_index_put(index->tuple_to_row,
+					   &entry, NULL, 0);
+	if (pos == mh_end(index->tuple_to_row)) {
+		diag_set(OutOfMemory, (ssize_t)pos, "hash", "key");
+		return -1;
+	}
+	block->tuples[row] = tuple;
+	block->row_count++;
+	block->live_count++;
+	index->size++;
+	if (block->row_count == COLUMN_BLOCK_ROWS)
+		column_block_seal(index, block);
+	return 0;
+}
+
+/**
+ * Move live rows of a sparse sealed block to the open block
+ * and free it. Stops silently on memory allocation error:
+ * compaction is an optimization, the rows which have not
+ * been moved stay valid.
+ */
+static void
+memtx_column_index_compact(struct memtx_column_index *index,
+			   struct column_block *block)
+{
+	assert(block->is_sealed);
+	for (uint32_t row = 0; row < block->row_count; row++) {
+		if (column_block_is_deleted(block, row))
+			continue;
+		if (memtx_column_index_append(index,
+					      block->tuples[row]) != 0) {
+			diag_clear(diag_get());
+			return;
+		}
+		column_block_set_deleted(block, row);
+		block->live_count--;
+		index->size--;
+	}
+	assert(block->live_count == 0);
+	column_block_delete(index, block);
+}
+
+static void
+memtx_column_index_remove(struct memtx_column_index *index,
+			  struct column_hash_entry *entry, uint32_t pos)
+{
+	struct column_block *block = entry->block;
+	uint32_t row = entry->row;
+	mh_column_index_del(index->tuple_to_row, pos, 0);
+	assert(!column_block_is_deleted(block, row));
+	column_block_set_deleted(block, row);
+	block->live_count--;
+	index->size--;
+	if (!block->is_sealed) {
+		if (block->live_count == 0) {
+			/*
+			 * Reuse the open block. Give it a new id
+			 * so that iterators positioned in it
+			 * restart from the first row.
+			 */
+			block->row_count = 0;
+			memset(block->deleted, 0, sizeof(block->deleted));
+			block->id = index->next_block_id++;
+			index->version++;
+		}
+	} else if (block->live_count == 0) {
+		column_block_delete(index, block);
+	} else if (block->live_count < COLUMN_BLOCK_COMPACT_ROWS) {
+		memtx_column_index_compact(index, block);
+	}
+}
+
+static void
+memtx_column_index_destroy(struct index *base)
+{
+	struct memtx_column_index *index = (struct memtx_column_index *)base;
+	struct column_block *block, *tmp;
+	rlist_foreach_entry_safe(block, &index->blocks, in_index, tmp)
+		column_block_delete(index, block);
+	mh_column_index_delete(index->tuple_to_row);
+	free(index);
+}
+
+static ssize_t
+memtx_column_index_size(struct index *base)
+{
+	struct memtx_column_index *index = (struct memtx_column_index *)base;
+	return index->size;
+}
+
+static ssize_t
+memtx_column_index_bsize(struct index *base)
+{
+	struct memtx_column_index *index = (struct memtx_column_index *)base;
+	return index->bsize + mh_column_index_memsize(index->tuple_to_row);
+}
+
+static int
+memtx_column_index_replace(struct index *base, struct tuple *old_tuple,
+			   struct tuple *new_tuple, enum dup_replace_mode mode,
+			   struct tuple **result)
+{
+	struct memtx_column_index *index = (struct memtx_column_index *)base;
+
+	assert(!base->def->opts.is_unique);
+	assert(old_tuple != NULL || new_tuple != NULL);
+	assert(old_tuple != new_tuple);
+	(void) mode;
+
+	*result = NULL;
+
+	/*
+	 * Append the new tuple first: on failure the index
+	 * must be left unchanged.
+	 */
+	if (new_tuple != NULL &&
+	    memtx_column_index_append(index, new_tuple) != 0)
+		return -1;
+
+	if (old_tuple != NULL) {
+		uint32_t pos = mh_column_index_find(index->tuple_to_row,
+						    old_tuple, 0);
+		if (pos != mh_end(index->tuple_to_row)) {
+			struct column_hash_entry *entry =
+				mh_column_index_node(index->tuple_to_row, pos);
+			memtx_column_index_remove(index, entry, pos);
+			*result = old_tuple;
+		}
+	}
+	return 0;
+}
+
+/* {{{ Aggregation */
+
+static inline bool
+column_value_less(int64_t a, int64_t b, bool is_unsigned)
+{
+	return is_unsigned ? (uint64_t)a < (uint64_t)b : a < b;
+}
+
+/** Account @count values with the given sum, min and max. */
+static inline void
+column_aggregate_merge(struct index_aggregate *agg, uint64_t count,
+		       uint64_t sum, int64_t min, int64_t max,
+		       bool is_unsigned)
+{
+	if (count == 0)
+		return;
+	if (agg->count == 0 ||
+	    column_value_less(min, agg->min, is_unsigned))
+		agg->min = min;
+	if (agg->count == 0 ||
+	    column_value_less(agg->max, max, is_unsigned))
+		agg->max = max;
+	agg->sum = (uint64_t)agg->sum + sum;
+	agg->count += count;
+}
+
+/** Account @count occurrences of @value. */
+static inline void
+column_aggregate_add(struct index_aggregate *agg, int64_t value,
+		     uint64_t count, bool is_unsigned)
+{
+	column_aggregate_merge(agg, count, (uint64_t)value * count,
+			       value, value, is_unsigned);
+}
+
+static inline void
+column_vector_aggregate_plain(struct column_vector *vector,
+			      struct column_block *block,
+			      struct index_aggregate *agg, bool is_unsigned)
+{
+	const int64_t *values = vector->values;
+	uint32_t row_count = block->row_count;
+	if (block->live_count < row_count) {
+		for (uint32_t row = 0; row < row_count; row++) {
+			if (!column_block_is_deleted(block, row))
+				column_aggregate_add(agg, values[row], 1,
+						     is_unsigned);
+		}
+		return;
+	}
+	/*
+	 * No deleted rows: let the compiler vectorize
+	 * the loop.
+	 */
+	uint64_t sum = 0;
+	int64_t min = values[0];
+	int64_t max = values[0];
+	for (uint32_t row = 0; row < row_count; row++) {
+		int64_t value = values[row];
+		sum += (uint64_t)value;
+		if (column_value_less(value, min, is_unsigned))
+			min = value;
+		if (column_value_less(max, value, is_unsigned))
+			max = value;
+	}
+	column_aggregate_merge(agg, row_count, sum, min, max, is_unsigned);
+}
+
+static inline void
+column_vector_aggregate_rle(struct column_vector *vector,
+			    struct column_block *block,
+			    struct index_aggregate *agg, bool is_unsigned)
+{
+	bool has_deleted = block->live_count < block->row_count;
+	uint32_t run_begin = 0;
+	for (uint32_t run = 0; run < vector->size; run++) {
+		uint32_t run_end = vector->run_end[run];
+		uint64_t count = run_end - run_begin;
+		if (has_deleted) {
+			for (uint32_t row = run_begin; row < run_end; row++)
+				count -= column_block_is_deleted(block, row);
+		}
+		column_aggregate_add(agg, vector->values[run], count,
+				     is_unsigned);
+		run_begin = run_end;
+	}
+}
+
+static inline void
+column_vector_aggregate_dict(struct column_vector *vector,
+			     struct column_block *block,
+			     struct index_aggregate *agg, bool is_unsigned)
+{
+	uint32_t histogram[COLUMN_DICT_MAX];
+	memset(histogram, 0, vector->size * sizeof(histogram[0]));
+	const uint8_t *codes = vector->codes;
+	if (block->live_count < block->row_count) {
+		for (uint32_t row = 0; row < block->row_count; row++) {
+			if (!column_block_is_deleted(block, row))
+				histogram[codes[row]]++;
+		}
+	} else {
+		for (uint32_t row = 0; row < block->row_count; row++)
+			histogram[codes[row]]++;
+	}
+	for (uint32_t code = 0; code < vector->size; code++)
+		column_aggregate_add(agg, vector->values[code],
+				     histogram[code], is_unsigned);
+}
+
+static inline void
+column_vector_aggregate(struct column_vector *vector,
+			struct column_block *block,
+			struct index_aggregate *agg, bool is_unsigned)
+{
+	switch (vector->encoding) {
+	case COLUMN_PLAIN:
+		column_vector_aggregate_plain(vector, block, agg, is_unsigned);
+		break;
+	case COLUMN_RLE:
+		column_vector_aggregate_rle(vector, block, agg, is_unsigned);
+		break;
+	case COLUMN_DICT:
+		column_vector_aggregate_dict(vector, block, agg, is_unsigned);
+		break;
+	default:
+		unreachable();
+	}
+}
+
+/**
+ * Aggregate values of tuples visible to the current transaction
+ * by looking them up one by one rather than scanning vectors.
+ */
+static int
+memtx_column_index_aggregate_visible(struct memtx_column_index *index,
+				     uint32_t part, bool is_unsigned,
+				     struct index_aggregate *result)
+{
+	uint32_t iid = index->base.def->iid;
+	struct column_block *block;
+	rlist_foreach_entry(block, &index->blocks, in_index) {
+		for (uint32_t row = 0; row < block->row_count; row++) {
+			if (column_block_is_deleted(block, row))
+				continue;
+			struct tuple *tuple =
+				memtx_tx_tuple_clarify(block->tuples[row], iid);
+			if (tuple == NULL)
+				continue;
+			int64_t value;
+			if (column_extract_value(index, tuple, part,
+						 &value) != 0)
+				return -1;
+			column_aggregate_add(result, value, 1, is_unsigned);
+		}
+	}
+	return 0;
+}
+
+static int
+memtx_column_index_aggregate(struct index *base, uint32_t part,
+			     struct index_aggregate *result)
+{
+	struct memtx_column_index *index = (struct memtx_column_index *)base;
+	assert(part < base->def->key_def->part_count);
+	bool is_unsigned =
+		base->def->key_def->parts[part].type == FIELD_TYPE_UNSIGNED;
+	result->is_unsigned = is_unsigned;
+	memtx_tx_track_read(base, NULL);
+	/*
+	 * Column vectors contain all versions of tuples, so
+	 * fall back on iterating visible ones if some tuples
+	 * of the space have more than one version.
+	 */
+	struct space *space = space_by_id(base->def->space_id);
+	if (space != NULL && memtx_tx_space_has_history(space)) {
+		return memtx_column_index_aggregate_visible(index, part,
+							    is_unsigned,
+							    result);
+	}
+	struct column_block *block;
+	rlist_foreach_entry(block, &index->blocks, in_index) {
+		if (block->live_count == 0)
+			continue;
+		/*
+		 * Pass the signedness as a constant to let
+		 * the compiler specialize the loops.
+		 */
+		struct column_vector *vector = &block->columns[part];
+		if (is_unsigned)
+			column_vector_aggregate(vector, block, result, true);
+		else
+			column_vector_aggregate(vector, block, result, false);
+	}
+	return 0;
+}
+
+/* }}} */
+
+/* {{{ Iterator */
+
+struct column_index_iterator {
+	struct iterator base; /* Must be the first member. */
+	/** Block the iterator is positioned at or NULL on EOF. */
+	struct column_block *block;
+	/** Id of the block, used to restore the position. */
+	uint64_t block_id;
+	/** Next row to look at. */
+	uint32_t row;
+	/** Index version the block pointer is valid for. */
+	uint32_t version;
+	/** Memory pool the iterator was allocated from. */
+	struct mempool *pool;
+};
+
+static void
+column_index_iterator_free(struct iterator *iterator)
+{
+	assert(iterator->free == column_index_iterator_free);
+	struct column_index_iterator *it =
+		(struct column_index_iterator *)iterator;
+	mempool_free(it->pool, it);
+}
+
+/**
+ * Position the iterator at the first block with id not less
+ * than the one it was positioned at.
+ */
+static void
+column_index_iterator_restore(struct column_index_iterator *it,
+			      struct memtx_column_index *index)
+{
+	struct column_block *block;
+	it->block = NULL;
+	rlist_foreach_entry(block, &index->blocks, in_index) {
+		if (block->id >= it->block_id) {
+			if (block->id != it->block_id)
+				it->row = 0;
+			it->block = block;
+			it->block_id = block->id;
+			break;
+		}
+	}
+	it->version = index->version;
+}
+
+static int
+column_index_iterator_next(struct iterator *iterator, struct tuple **ret)
+{
+	assert(iterator->free == column_index_iterator_free);
+	struct column_index_iterator *it =
+		(struct column_index_iterator *)iterator;
+	struct memtx_column_index *index =
+		(struct memtx_column_index *)iterator->index;
+
+	*ret = NULL;
+	if (it->version != index->version)
+		column_index_iterator_restore(it, index);
+	while (it->block != NULL) {
+		struct column_block *block = it->block;
+		while (it->row < block->row_count) {
+			uint32_t row = it->row++;
+			if (column_block_is_deleted(block, row))
+				continue;
+			/* Skip versions invisible to the transaction. */
+			*ret = memtx_tx_tuple_clarify(block->tuples[row],
+						      iterator->index_id);
+			if (*ret != NULL)
+				return 0;
+		}
+		if (rlist_next(&block->in_index) == &index->blocks) {
+			/* Stay at the end of the open block. */
+			break;
+		}
+		it->block = rlist_next_entry(block, in_index);
+		it->block_id = it->block->id;
+		it->row = 0;
+	}
+	return 0;
+}
+
+static struct iterator *
+memtx_column_index_create_iterator(struct index *base, enum iterator_type type,
+				   const char *key, uint32_t part_count)
+{
+	struct memtx_column_index *index = (struct memtx_column_index *)base;
+	struct memtx_engine *memtx = (struct memtx_engine *)base->engine;
+
+	assert(part_count == 0 || key != NULL);
+	(void) key;
+	(void) part_count;
+
+	if (type != ITER_ALL) {
+		diag_set(UnsupportedIndexFeature, base->def,
+			 "requested iterator type");
+		return NULL;
+	}
+
+	struct column_index_iterator *it =
+		mempool_alloc(&memtx->column_iterator_pool);
+	if (it == NULL) {
+		diag_set(OutOfMemory, sizeof(*it),
+			 "memtx_column_index", "iterator");
+		return NULL;
+	}
+	iterator_create(&it->base, base);
+	it->pool = &memtx->column_iterator_pool;
+	it->base.next = column_index_iterator_next;
+	it->base.free = column_index_iterator_free;
+	it->block_id = 0;
+	it->row = 0;
+	column_index_iterator_restore(it, index);
+	memtx_tx_track_read(base, NULL);
+	return (struct iterator *)it;
+}
+
+/* }}} */
+
+static ssize_t
+memtx_column_index_count(struct index *base, enum iterator_type type,
+			 const char *key, uint32_t part_count)
+{
+	if (type == ITER_ALL)
+		return memtx_column_index_size(base);
+	return generic_index_count(base, type, key, part_count);
+}
+
+static void
+memtx_column_index_info(struct index *base, struct info_handler *h)
+{
+	struct memtx_column_index *index = (struct memtx_column_index *)base;
+	int64_t block_count = 0;
+	int64_t encoding_count[3] = {0, 0, 0};
+	struct column_block *block;
+	rlist_foreach_entry(block, &index->blocks, in_index) {
+		block_count++;
+		for (uint32_t i = 0; i < index->part_count; i++)
+			encoding_count[block->columns[i].encoding]++;
+	}
+	info_begin(h);
+	info_append_int(h, "blocks", block_count);
+	info_table_begin(h, "vectors");
+	info_append_int(h, "plain", encoding_count[COLUMN_PLAIN]);
+	info_append_int(h, "rle", encoding_count[COLUMN_RLE]);
+	info_append_int(h, "dict", encoding_count[COLUMN_DICT]);
+	info_table_end(h);
+	info_end(h);
+}
+
+static const struct index_vtab memtx_column_index_vtab = {
+	/* .destroy = */ memtx_column_index_destroy,
+	/* .commit_create = */ generic_index_commit_create,
+	/* .commit_drop = */ generic_index_commit_drop,
+	/* .size = */ memtx_column_index_size,
+	/* .bsize = */ memtx_column_index_bsize,
+	/* .min = */ generic_index_min,
+	/* .max = */ generic_index_max,
+	/* .random = */ generic_index_random,
+	/* .count = */ memtx_column_index_count,
+	/* .aggregate = */ memtx_column_index_aggregate,
+	/* .get = */ generic_index_get,
+	/* .replace = */ memtx_column_index_replace,
+	/* .create_iterator = */ memtx_column_index_create_iterator,
+	/* .create_snapshot_iterator = */
+		generic_index_create_snapshot_iterator,
+	/* .info = */ memtx_column_index_info,
+	/* .begin_build = */ generic_index_begin_build,
+	/* .reserve = */ generic_index_reserve,
+	/* .build_next = */ generic_index_build_next,
+	/* .end_build = */ generic_index_end_build,
+};
+
+struct memtx_column_index *
+memtx_column_index_new(struct memtx_engine *memtx, struct index_def *def)
+{
+	assert(!def->opts.is_unique);
+
+	if (!mempool_is_initialized(&memtx->column_iterator_pool)) {
+		mempool_create(&memtx->column_iterator_pool, cord_slab_cache(),
+			       sizeof(struct column_index_iterator));
+	}
+
+	struct memtx_column_index *index =
+		(struct memtx_column_index *)calloc(1, sizeof(*index));
+	if (index == NULL) {
+		diag_set(OutOfMemory, sizeof(*index),
+			 "malloc", "struct memtx_column_index");
+		return NULL;
+	}
+	index->tuple_to_row = mh_column_index_new();
+	if (index->tuple_to_row == NULL) {
+		free(index);
+		diag_set(OutOfMemory, sizeof(*index->tuple_to_row),
+			 "malloc", "struct mh_column_index_t");
+		return NULL;
+	}
+	if (index_create(&index->base, (struct engine *)memtx,
+			 &memtx_column_index_vtab, def) != 0) {
+		mh_column_index_delete(index->tuple_to_row);
+		free(index);
+		return NULL;
+	}
+	rlist_create(&index->blocks);
+	index->part_count = def->key_def->part_count;
+	return index;
+}
@@ -0,0 +1,83 @@
+#ifndef TARANTOOL_BOX_MEMTX_COLUMN_H_INCLUDED
+#define TARANTOOL_BOX_MEMTX_COLUMN_H_INCLUDED
+/*
+ * Copyright 2010-2016, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * COLUMN index stores values of its key parts column-wise:
+ * rows are grouped in blocks of a fixed size and each block
+ * keeps a typed vector per key part. Full blocks are sealed
+ * and their vectors are compressed with run-length or
+ * dictionary encoding. New rows are always appended to the
+ * last, open block, while deleted rows are only marked in a
+ * per-block bitmap, so the index is cheap to maintain and
+ * fast to scan, but does not support key lookups.
+ */
+#include "index.h"
+#include <small/rlist.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+struct memtx_engine;
+struct mh_column_index_t;
+
+struct memtx_column_index {
+	struct index base;
+	/** List of blocks ordered by id, the last one is open. */
+	struct rlist blocks;
+	/** Tuple -> row position. */
+	struct mh_column_index_t *tuple_to_row;
+	/** Number of key parts, i.e. vectors in a block. */
+	uint32_t part_count;
+	/** Number of rows that have not been deleted. */
+	size_t size;
+	/** Size of memory allocated for blocks. */
+	size_t bsize;
+	/** Id to assign to the next block. */
+	uint64_t next_block_id;
+	/**
+	 * Incremented whenever a block is freed or reset so
+	 * that iterators know they must look up their block
+	 * again.
+	 */
+	uint32_t version;
+};
+
+struct memtx_column_index *
+memtx_column_index_new(struct memtx_engine *memtx, struct index_def *def);
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif /* defined(__cplusplus) */
+
+#endif /* TARANTOOL_BOX_MEMTX_COLUMN_H_INCLUDED */
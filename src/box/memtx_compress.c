@@ -0,0 +1,364 @@
+/*
+ * Copyright 2010-2016, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "memtx_compress.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <zdict.h>
+
+#include "trivia/util.h"
+#include "diag.h"
+#include "fiber.h"
+#include "fiber_cond.h"
+#include "coio_task.h"
+#include "say.h"
+#include "errcode.h"
+#include "memtx_tuple.h"
+
+enum {
+	/** Compression level used for tuples. */
+	MEMTX_COMPRESS_LEVEL = 3,
+	/** Max size of a trained dictionary. */
+	MEMTX_ZDICT_SIZE = 16 * 1024,
+	/** Size of samples needed to train a dictionary. */
+	MEMTX_ZDICT_SAMPLES_SIZE = 1024 * 1024,
+	/** Max number of samples used to train a dictionary. */
+	MEMTX_ZDICT_SAMPLE_COUNT_MAX = 16 * 1024,
+	/** Longer samples are truncated. */
+	MEMTX_ZDICT_SAMPLE_SIZE_MAX = 4 * 1024,
+	/**
+	 * Once a dictionary has been trained, only every
+	 * MEMTX_ZDICT_SAMPLE_RATE-th compressed block is taken
+	 * as a sample for the next one.
+	 */
+	MEMTX_ZDICT_SAMPLE_RATE = 16,
+};
+
+/**
+ * How often the compression fiber releases decompressed
+ * tuple data, in seconds.
+ */
+static const double MEMTX_COMPRESS_SWEEP_INTERVAL = 1.0;
+
+/** Contexts used by the tx thread. */
+static ZSTD_CCtx *memtx_cctx;
+static ZSTD_DCtx *memtx_dctx;
+
+/** Set while a checkpoint is in progress. */
+static bool memtx_zdict_gc_delayed;
+/** Unused dictionaries to free after the checkpoint. */
+static RLIST_HEAD(memtx_zdict_garbage);
+
+/** Compressors that have collected enough samples. */
+static RLIST_HEAD(memtx_train_queue);
+/** Fiber that trains dictionaries and releases decompressed data. */
+static struct fiber *memtx_compress_fiber;
+/** Signaled when a compressor is added to the train queue. */
+static struct fiber_cond memtx_compress_cond;
+
+static void
+memtx_zdict_delete(struct memtx_zdict *dict)
+{
+	ZSTD_freeCDict(dict->cdict);
+	ZSTD_freeDDict(dict->ddict);
+	free(dict);
+}
+
+void
+memtx_zdict_unref(struct memtx_zdict *dict)
+{
+	assert(dict->refs > 0);
+	if (--dict->refs > 0)
+		return;
+	if (memtx_zdict_gc_delayed)
+		rlist_add_tail_entry(&memtx_zdict_garbage, dict, in_garbage);
+	else
+		memtx_zdict_delete(dict);
+}
+
+void
+memtx_zdict_delay_gc(bool delay)
+{
+	memtx_zdict_gc_delayed = delay;
+	if (delay)
+		return;
+	struct memtx_zdict *dict, *tmp;
+	rlist_foreach_entry_safe(dict, &memtx_zdict_garbage, in_garbage, tmp)
+		memtx_zdict_delete(dict);
+	rlist_create(&memtx_zdict_garbage);
+}
+
+int
+memtx_zdict_decompress(struct memtx_zdict *dict, ZSTD_DCtx *dctx,
+		       const char *src, size_t src_size,
+		       char *dst, size_t dst_size)
+{
+	if (dctx == NULL)
+		dctx = memtx_dctx;
+	size_t rc;
+	if (dict != NULL) {
+		rc = ZSTD_decompress_usingDDict(dctx, dst, dst_size,
+						src, src_size, dict->ddict);
+	} else {
+		rc = ZSTD_decompressDCtx(dctx, dst, dst_size, src, src_size);
+	}
+	if (ZSTD_isError(rc)) {
+		diag_set(ClientError, ER_DECOMPRESSION,
+			 ZSTD_getErrorName(rc));
+		return -1;
+	}
+	if (rc != dst_size) {
+		diag_set(ClientError, ER_DECOMPRESSION,
+			 "decompressed size mismatch");
+		return -1;
+	}
+	return 0;
+}
+
+struct memtx_compressor *
+memtx_compressor_new(void)
+{
+	struct memtx_compressor *compressor = calloc(1, sizeof(*compressor));
+	if (compressor == NULL) {
+		diag_set(OutOfMemory, sizeof(*compressor),
+			 "malloc", "struct memtx_compressor");
+		return NULL;
+	}
+	compressor->refs = 1;
+	rlist_create(&compressor->in_train_queue);
+	return compressor;
+}
+
+void
+memtx_compressor_unref(struct memtx_compressor *compressor)
+{
+	assert(compressor->refs > 0);
+	if (--compressor->refs > 0)
+		return;
+	assert(!compressor->is_training);
+	rlist_del_entry(compressor, in_train_queue);
+	if (compressor->dict != NULL)
+		memtx_zdict_unref(compressor->dict);
+	free(compressor->samples);
+	free(compressor->sample_sizes);
+	free(compressor);
+}
+
+/**
+ * Take a block of data as a sample for training the next
+ * dictionary. Failure to allocate the sample buffer is not
+ * an error: we just don't get a new dictionary.
+ */
+static void
+memtx_compressor_add_sample(struct memtx_compressor *compressor,
+			    const char *data, size_t size)
+{
+	if (compressor->is_training ||
+	    !rlist_empty(&compressor->in_train_queue))
+		return;
+	if (compressor->dict != NULL &&
+	    ++compressor->skip_count < MEMTX_ZDICT_SAMPLE_RATE)
+		return;
+	compressor->skip_count = 0;
+	if (compressor->samples == NULL) {
+		compressor->samples = malloc(MEMTX_ZDICT_SAMPLES_SIZE);
+		compressor->sample_sizes = malloc(MEMTX_ZDICT_SAMPLE_COUNT_MAX *
+						  sizeof(size_t));
+		if (compressor->samples == NULL ||
+		    compressor->sample_sizes == NULL) {
+			free(compressor->samples);
+			free(compressor->sample_sizes);
+			compressor->samples = NULL;
+			compressor->sample_sizes = NULL;
+			return;
+		}
+	}
+	size = MIN(size, (size_t)MEMTX_ZDICT_SAMPLE_SIZE_MAX);
+	size = MIN(size, MEMTX_ZDICT_SAMPLES_SIZE - compressor->samples_size);
+	memcpy(compressor->samples + compressor->samples_size, data, size);
+	compressor->samples_size += size;
+	compressor->sample_sizes[compressor->sample_count++] = size;
+	if (compressor->samples_size == MEMTX_ZDICT_SAMPLES_SIZE ||
+	    compressor->sample_count == MEMTX_ZDICT_SAMPLE_COUNT_MAX) {
+		rlist_add_tail_entry(&memtx_train_queue, compressor,
+				     in_train_queue);
+		fiber_cond_signal(&memtx_compress_cond);
+	}
+}
+
+ssize_t
+memtx_compressor_compress(struct memtx_compressor *compressor,
+			  const char *src, size_t src_size,
+			  char *dst, size_t dst_size,
+			  struct memtx_zdict **p_dict)
+{
+	struct memtx_zdict *dict = compressor->dict;
+	size_t rc;
+	if (dict != NULL) {
+		rc = ZSTD_compress_usingCDict(memtx_cctx, dst, dst_size,
+					      src, src_size, dict->cdict);
+	} else {
+		rc = ZSTD_compressCCtx(memtx_cctx, dst, dst_size,
+				       src, src_size, MEMTX_COMPRESS_LEVEL);
+	}
+	memtx_compressor_add_sample(compressor, src, src_size);
+	/* Most likely, the data is incompressible. */
+	if (ZSTD_isError(rc))
+		return -1;
+	if (dict != NULL)
+		memtx_zdict_ref(dict);
+	*p_dict = dict;
+	return rc;
+}
+
+static ssize_t
+memtx_zdict_train_f(va_list ap)
+{
+	const char *samples = va_arg(ap, const char *);
+	const size_t *sample_sizes = va_arg(ap, const size_t *);
+	unsigned sample_count = va_arg(ap, unsigned);
+	struct memtx_zdict **p_dict = va_arg(ap, struct memtx_zdict **);
+
+	char *buf = malloc(MEMTX_ZDICT_SIZE);
+	if (buf == NULL) {
+		diag_set(OutOfMemory, MEMTX_ZDICT_SIZE, "malloc", "zdict");
+		return -1;
+	}
+	size_t size = ZDICT_trainFromBuffer(buf, MEMTX_ZDICT_SIZE, samples,
+					    sample_sizes, sample_count);
+	if (ZDICT_isError(size)) {
+		diag_set(ClientError, ER_COMPRESSION,
+			 ZDICT_getErrorName(size));
+		free(buf);
+		return -1;
+	}
+	struct memtx_zdict *dict = calloc(1, sizeof(*dict));
+	if (dict == NULL) {
+		diag_set(OutOfMemory, sizeof(*dict), "malloc",
+			 "struct memtx_zdict");
+		free(buf);
+		return -1;
+	}
+	dict->refs = 1;
+	dict->cdict = ZSTD_createCDict(buf, size, MEMTX_COMPRESS_LEVEL);
+	dict->ddict = ZSTD_createDDict(buf, size);
+	free(buf);
+	if (dict->cdict == NULL || dict->ddict == NULL) {
+		diag_set(OutOfMemory, size, "ZSTD_createCDict", "zdict");
+		memtx_zdict_delete(dict);
+		return -1;
+	}
+	*p_dict = dict;
+	return 0;
+}
+
+/** Train a new dictionary on samples collected by a compressor. */
+static void
+memtx_compressor_train(struct memtx_compressor *compressor)
+{
+	assert(!compressor->is_training);
+	rlist_del_entry(compressor, in_train_queue);
+	compressor->is_training = true;
+	memtx_compressor_ref(compressor);
+	struct memtx_zdict *dict = NULL;
+	if (coio_call(memtx_zdict_train_f, compressor->samples,
+		      compressor->sample_sizes, compressor->sample_count,
+		      &dict) == 0) {
+		if (compressor->dict != NULL)
+			memtx_zdict_unref(compressor->dict);
+		compressor->dict = dict;
+		say_debug("trained compression dictionary on %u samples",
+			  compressor->sample_count);
+	} else {
+		say_warn("failed to train compression dictionary");
+		diag_log();
+	}
+	compressor->samples_size = 0;
+	compressor->sample_count = 0;
+	compressor->is_training = false;
+	memtx_compressor_unref(compressor);
+}
+
+static int
+memtx_compress_f(va_list ap)
+{
+	(void)ap;
+	while (memtx_compress_fiber != NULL) {
+		if (!rlist_empty(&memtx_train_queue)) {
+			struct memtx_compressor *compressor;
+			compressor = rlist_first_entry(&memtx_train_queue,
+						       struct memtx_compressor,
+						       in_train_queue);
+			memtx_compressor_train(compressor);
+			continue;
+		}
+		memtx_tuple_release_bodies();
+		fiber_cond_wait_timeout(&memtx_compress_cond,
+					MEMTX_COMPRESS_SWEEP_INTERVAL);
+	}
+	return 0;
+}
+
+int
+memtx_compress_init(void)
+{
+	memtx_cctx = ZSTD_createCCtx();
+	memtx_dctx = ZSTD_createDCtx();
+	if (memtx_cctx == NULL || memtx_dctx == NULL) {
+		diag_set(OutOfMemory, 0, "ZSTD_createCCtx", "memtx_cctx");
+		goto fail;
+	}
+	memtx_compress_fiber = fiber_new("memtx.compress", memtx_compress_f);
+	if (memtx_compress_fiber == NULL)
+		goto fail;
+	fiber_cond_create(&memtx_compress_cond);
+	fiber_start(memtx_compress_fiber);
+	return 0;
+fail:
+	ZSTD_freeCCtx(memtx_cctx);
+	ZSTD_freeDCtx(memtx_dctx);
+	memtx_cctx = NULL;
+	memtx_dctx = NULL;
+	return -1;
+}
+
+void
+memtx_compress_free(void)
+{
+	/* Stop the compression fiber. */
+	memtx_compress_fiber = NULL;
+	fiber_cond_signal(&memtx_compress_cond);
+	fiber_cond_destroy(&memtx_compress_cond);
+	ZSTD_freeCCtx(memtx_cctx);
+	ZSTD_freeDCtx(memtx_dctx);
+	memtx_cctx = NULL;
+	memtx_dctx = NULL;
+}
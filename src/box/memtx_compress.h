@@ -0,0 +1,175 @@
+#ifndef TARANTOOL_BOX_MEMTX_COMPRESS_H_INCLUDED
+#define TARANTOOL_BOX_MEMTX_COMPRESS_H_INCLUDED
+/*
+ * Copyright 2010-2016, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * Compression of memtx tuples. Tuples of a space with the
+ * compression option are compressed with zstd using a
+ * dictionary trained on the tuples of the same space. Samples
+ * for training are collected as tuples are compressed, and the
+ * dictionary is (re)trained in the coio thread pool once enough
+ * samples have been collected. A compressed tuple references
+ * the dictionary it was compressed with, so switching to a new
+ * dictionary doesn't require recompressing old tuples.
+ */
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <small/rlist.h>
+#include <zstd.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+/** Compression dictionary shared by compressed tuples. */
+struct memtx_zdict {
+	/** Number of tuples and compressors using the dictionary. */
+	int refs;
+	ZSTD_CDict *cdict;
+	ZSTD_DDict *ddict;
+	/** Link in the list of dictionaries pending release. */
+	struct rlist in_garbage;
+};
+
+static inline void
+memtx_zdict_ref(struct memtx_zdict *dict)
+{
+	dict->refs++;
+}
+
+/**
+ * Unreference a dictionary and free it if it's not used
+ * anymore. If a checkpoint is in progress, the dictionary
+ * is freed only after the checkpoint has completed, because
+ * it may still be used to read tuples being written to the
+ * snapshot, see memtx_zdict_delay_gc().
+ */
+void
+memtx_zdict_unref(struct memtx_zdict *dict);
+
+/**
+ * Delay freeing of unused dictionaries while a checkpoint is
+ * in progress. Free all dictionaries that became unused while
+ * freeing was delayed on @a delay == false.
+ */
+void
+memtx_zdict_delay_gc(bool delay);
+
+/**
+ * Decompress a block of data.
+ * @param dict Dictionary the data was compressed with or NULL.
+ * @param dctx Decompression context or NULL to use the one of
+ *             the tx thread.
+ * @param src Compressed data.
+ * @param src_size Size of @a src.
+ * @param dst Buffer to decompress the data to.
+ * @param dst_size Exact size of the decompressed data.
+ * @retval 0 Success.
+ * @retval -1 The data is corrupted.
+ */
+int
+memtx_zdict_decompress(struct memtx_zdict *dict, ZSTD_DCtx *dctx,
+		       const char *src, size_t src_size,
+		       char *dst, size_t dst_size);
+
+/** Per-space compression state. */
+struct memtx_compressor {
+	/** Reference counter. */
+	int refs;
+	/** Dictionary used for new tuples or NULL. */
+	struct memtx_zdict *dict;
+	/** Samples collected for training a dictionary. */
+	char *samples;
+	/** Size of collected samples. */
+	size_t samples_size;
+	/** Sizes of individual samples. */
+	size_t *sample_sizes;
+	/** Number of collected samples. */
+	uint32_t sample_count;
+	/** Number of compressed blocks since the last sample. */
+	uint32_t skip_count;
+	/** Set while a dictionary is being trained. */
+	bool is_training;
+	/** Link in the list of compressors ready for training. */
+	struct rlist in_train_queue;
+};
+
+/** Create a compressor. */
+struct memtx_compressor *
+memtx_compressor_new(void);
+
+static inline void
+memtx_compressor_ref(struct memtx_compressor *compressor)
+{
+	compressor->refs++;
+}
+
+void
+memtx_compressor_unref(struct memtx_compressor *compressor);
+
+/**
+ * Compress a block of data with the current dictionary of
+ * a compressor, if any, and take it as a sample for the next
+ * dictionary. Must be called from the tx thread.
+ * @param compressor Compressor.
+ * @param src Data to compress.
+ * @param src_size Size of @a src.
+ * @param dst Buffer for compressed data.
+ * @param dst_size Size of @a dst.
+ * @param[out] p_dict Dictionary used for compression or NULL,
+ *                    referenced by this function.
+ * @return Size of the compressed data or -1 if the data
+ *         doesn't fit in @a dst after compression.
+ */
+ssize_t
+memtx_compressor_compress(struct memtx_compressor *compressor,
+			  const char *src, size_t src_size,
+			  char *dst, size_t dst_size,
+			  struct memtx_zdict **p_dict);
+
+/**
+ * Start a fiber that trains dictionaries for compressors
+ * which have collected enough samples.
+ */
+int
+memtx_compress_init(void);
+
+void
+memtx_compress_free(void);
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif /* defined(__cplusplus) */
+
+#endif /* TARANTOOL_BOX_MEMTX_COMPRESS_H_INCLUDED */
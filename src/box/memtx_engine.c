@@ -31,12 +31,19 @@
 #include "memtx_engine.h"
 #include "memtx_space.h"
 #include "memtx_tuple.h"
+#include "memtx_tx.h"
 
+#include <errno.h>
+#include <unistd.h>
 #include <small/small.h>
 #include <small/mempool.h>
 
+#include "assoc.h"
+#include "cbus.h"
 #include "coio_file.h"
 #include "tuple.h"
+#include "tuple_compare.h"
+#include "tuple_hash.h"
 #include "txn.h"
 #include "memtx_tree.h"
 #include "iproto_constants.h"
@@ -130,6 +137,13 @@ static void
 memtx_engine_shutdown(struct engine *engine)
 {
 	struct memtx_engine *memtx = (struct memtx_engine *)engine;
+	/* Stop the defragmentation fiber. */
+	memtx->defrag_fiber = NULL;
+	/* Sic: fiber_cancel() can't be used here. */
+	fiber_cond_signal(&memtx->defrag_cond);
+	fiber_cond_destroy(&memtx->defrag_cond);
+	memtx_compress_free();
+	memtx_tx_manager_free();
 	if (mempool_is_initialized(&memtx->tree_iterator_pool))
 		mempool_destroy(&memtx->tree_iterator_pool);
 	if (mempool_is_initialized(&memtx->rtree_iterator_pool))
@@ -138,6 +152,8 @@ memtx_engine_shutdown(struct engine *engine)
 		mempool_destroy(&memtx->hash_iterator_pool);
 	if (mempool_is_initialized(&memtx->bitset_iterator_pool))
 		mempool_destroy(&memtx->bitset_iterator_pool);
+	if (mempool_is_initialized(&memtx->column_iterator_pool))
+		mempool_destroy(&memtx->column_iterator_pool);
 	xdir_destroy(&memtx->snap_dir);
 	free(memtx);
 	memtx_tuple_free();
@@ -147,13 +163,78 @@ static int
 memtx_engine_recover_snapshot_row(struct memtx_engine *memtx,
 				  struct xrow_header *row);
 
-int
-memtx_engine_recover_snapshot(struct memtx_engine *memtx,
-			      const struct vclock *vclock)
+static int
+memtx_engine_recover_snapshot_parts(struct memtx_engine *memtx,
+				    int64_t signature, uint32_t part_count);
+
+/**
+ * Get the signature of the snapshot an incremental snapshot
+ * was taken against, or 0 if the snapshot is full.
+ */
+static int
+memtx_snap_prev_signature(struct xdir *dir, int64_t signature,
+			  int64_t *prev_signature)
+{
+	struct xlog_cursor cursor;
+	if (xlog_cursor_open(&cursor, xdir_format_filename(dir, signature,
+							   NONE)) < 0)
+		return -1;
+	*prev_signature = cursor.meta.prev_signature;
+	xlog_cursor_close(&cursor, false);
+	return 0;
+}
+
+/**
+ * Collect signatures of the snapshots needed to recover the
+ * checkpoint with @a signature: the last full snapshot taken
+ * before it followed by incremental snapshots up to the
+ * checkpoint itself. The array is allocated with malloc().
+ */
+static int64_t *
+memtx_snap_chain(struct xdir *dir, int64_t signature, uint32_t *count)
+{
+	int64_t *chain = NULL;
+	uint32_t n = 0;
+	while (signature > 0) {
+		int64_t *new_chain = realloc(chain, (n + 1) * sizeof(*chain));
+		if (new_chain == NULL) {
+			diag_set(OutOfMemory, (n + 1) * sizeof(*chain),
+				 "realloc", "snapshot chain");
+			goto fail;
+		}
+		chain = new_chain;
+		chain[n++] = signature;
+		if (memtx_snap_prev_signature(dir, signature,
+					      &signature) != 0)
+			goto fail;
+	}
+	if (n == 0) {
+		/* An empty checkpoint is always full. */
+		chain = malloc(sizeof(*chain));
+		if (chain == NULL) {
+			diag_set(OutOfMemory, sizeof(*chain),
+				 "malloc", "snapshot chain");
+			return NULL;
+		}
+		chain[n++] = signature;
+	}
+	/* The last full snapshot goes first. */
+	for (uint32_t i = 0; i < n / 2; i++) {
+		int64_t tmp = chain[i];
+		chain[i] = chain[n - i - 1];
+		chain[n - i - 1] = tmp;
+	}
+	*count = n;
+	return chain;
+fail:
+	free(chain);
+	return NULL;
+}
+
+static int
+memtx_engine_recover_full_snapshot(struct memtx_engine *memtx,
+				   int64_t signature)
 {
-	/* Process existing snapshot */
-	say_info("recovery start");
-	int64_t signature = vclock_sum(vclock);
 	const char *filename = xdir_format_filename(&memtx->snap_dir,
 						    signature, NONE);
 
@@ -183,6 +264,7 @@ memtx_engine_recover_snapshot(struct memtx_engine *memtx,
 			fiber_yield_timeout(0);
 		}
 	}
+	uint32_t part_count = cursor.meta.part_count;
 	xlog_cursor_close(&cursor, false);
 	if (rc < 0)
 		return -1;
@@ -195,9 +277,343 @@ memtx_engine_recover_snapshot(struct memtx_engine *memtx,
 	if (!xlog_cursor_is_eof(&cursor))
 		panic("snapshot `%s' has no EOF marker", filename);
 
+	/*
+	 * The main file stores system spaces, so other parts
+	 * may only be recovered after it.
+	 */
+	if (part_count > 1 &&
+	    memtx_engine_recover_snapshot_parts(memtx, signature,
+						part_count) != 0)
+		return -1;
+	return 0;
+}
+
+/** Replay a row of an incremental snapshot. */
+static int
+memtx_engine_recover_delta_row(struct memtx_engine *memtx,
+			       struct xrow_header *row)
+{
+	struct request request;
+	if (xrow_decode_dml(row, &request, dml_request_key_map(row->type)) != 0)
+		return -1;
+	struct space *space = space_cache_find(request.space_id);
+	if (space == NULL)
+		return -1;
+	if (space->engine != (struct engine *)memtx) {
+		diag_set(ClientError, ER_CROSS_ENGINE_TRANSACTION);
+		return -1;
+	}
+	struct txn *txn = txn_begin_stmt(space);
+	if (txn == NULL)
+		return -1;
+	int rc;
+	struct tuple *unused;
+	switch (row->type) {
+	case IPROTO_REPLACE:
+		rc = space_execute_replace(space, txn, &request, &unused);
+		break;
+	case IPROTO_DELETE:
+		rc = space_execute_delete(space, txn, &request, &unused);
+		break;
+	default:
+		diag_set(ClientError, ER_UNKNOWN_REQUEST_TYPE,
+			 (uint32_t) row->type);
+		rc = -1;
+	}
+	if (rc != 0) {
+		txn_rollback_stmt();
+		return -1;
+	}
+	if (txn_commit_stmt(txn, &request) != 0)
+		return -1;
+	fiber_gc();
+	return 0;
+}
+
+/**
+ * Apply an incremental snapshot on top of the snapshot it
+ * was taken against.
+ */
+static int
+memtx_engine_recover_delta_snapshot(struct memtx_engine *memtx,
+				    int64_t signature)
+{
+	/*
+	 * Rows of an incremental snapshot replace and delete
+	 * tuples, which requires the primary keys to be built,
+	 * so switch to the WAL replay mode.
+	 */
+	if (memtx->state == MEMTX_INITIAL_RECOVERY) {
+		space_foreach(memtx_end_build_primary_key, memtx);
+		memtx->state = MEMTX_FINAL_RECOVERY;
+	}
+
+	const char *filename = xdir_format_filename(&memtx->snap_dir,
+						    signature, NONE);
+	say_info("recovering from `%s'", filename);
+	struct xlog_cursor cursor;
+	if (xlog_cursor_open(&cursor, filename) < 0)
+		return -1;
+
+	int rc;
+	struct xrow_header row;
+	uint64_t row_count = 0;
+	while ((rc = xlog_cursor_next(&cursor, &row,
+				      memtx->force_recovery)) == 0) {
+		row.lsn = signature;
+		rc = memtx_engine_recover_delta_row(memtx, &row);
+		if (rc < 0) {
+			if (!memtx->force_recovery)
+				break;
+			say_error("can't apply row: ");
+			diag_log();
+		}
+		++row_count;
+		if (row_count % 100000 == 0) {
+			say_info("%.1fM rows processed",
+				 row_count / 1000000.);
+			fiber_yield_timeout(0);
+		}
+	}
+	xlog_cursor_close(&cursor, false);
+	if (rc < 0)
+		return -1;
+	if (!xlog_cursor_is_eof(&cursor))
+		panic("snapshot `%s' has no EOF marker", filename);
+	return 0;
+}
+
+int
+memtx_engine_recover_snapshot(struct memtx_engine *memtx,
+			      const struct vclock *vclock)
+{
+	/* Process existing snapshot */
+	say_info("recovery start");
+	uint32_t count;
+	int64_t *chain = memtx_snap_chain(&memtx->snap_dir,
+					  vclock_sum(vclock), &count);
+	if (chain == NULL)
+		return -1;
+	int rc = memtx_engine_recover_full_snapshot(memtx, chain[0]);
+	for (uint32_t i = 1; rc == 0 && i < count; i++)
+		rc = memtx_engine_recover_delta_snapshot(memtx, chain[i]);
+	free(chain);
+	if (rc != 0)
+		return -1;
+
+	memtx->snap_delta_count = count - 1;
+	/*
+	 * Rows replayed from WAL were written after the last
+	 * checkpoint, so the next checkpoint may be incremental.
+	 */
+	memtx->changes_tracked = memtx->snap_delta_max > 0;
+	return 0;
+}
+
+/**
+ * A thread reading a part of a snapshot split into several
+ * files, see memtx_engine_recover_snapshot_parts().
+ */
+struct memtx_snap_reader {
+	/** Reader thread. */
+	struct cord cord;
+	/** Pipe to the reader thread. */
+	struct cpipe reader_pipe;
+	/** Pipe from the reader thread to tx. */
+	struct cpipe tx_pipe;
+	/** Cursor over the part, used by the reader thread. */
+	struct xlog_cursor cursor;
+	/** Name of the part file. */
+	char filename[PATH_MAX];
+	/** Fiber applying rows of the part in tx. */
+	struct fiber *fiber;
+	/** Memtx engine. */
+	struct memtx_engine *memtx;
+	/** Signature of the snapshot. */
+	int64_t signature;
+};
+
+/** A call to a snapshot reader thread. */
+struct memtx_snap_reader_msg {
+	struct cbus_call_msg base;
+	/** Reader to process. */
+	struct memtx_snap_reader *reader;
+	/** [out] Return code of xlog_cursor_next_tx(). */
+	int rc;
+};
+
+static int
+memtx_snap_reader_f(va_list ap)
+{
+	struct memtx_snap_reader *reader =
+		va_arg(ap, struct memtx_snap_reader *);
+	struct cbus_endpoint endpoint;
+
+	cpipe_create(&reader->tx_pipe, "tx_prio");
+	cbus_endpoint_create(&endpoint, cord_name(cord()),
+			     fiber_schedule_cb, fiber());
+	cbus_loop(&endpoint);
+	cbus_endpoint_destroy(&endpoint, cbus_process);
+	cpipe_destroy(&reader->tx_pipe);
+	return 0;
+}
+
+/**
+ * The cursor buffers are allocated from the slab cache of
+ * the thread that opened the cursor, so the cursor is opened,
+ * advanced, and closed only in the reader thread, while rows
+ * of the current tx are decoded by tx.
+ */
+static int
+memtx_snap_reader_open_cb(struct cbus_call_msg *base)
+{
+	struct memtx_snap_reader_msg *msg =
+		(struct memtx_snap_reader_msg *)base;
+	struct memtx_snap_reader *reader = msg->reader;
+	return xlog_cursor_open(&reader->cursor, reader->filename);
+}
+
+static int
+memtx_snap_reader_next_tx_cb(struct cbus_call_msg *base)
+{
+	struct memtx_snap_reader_msg *msg =
+		(struct memtx_snap_reader_msg *)base;
+	msg->rc = xlog_cursor_next_tx(&msg->reader->cursor);
+	return msg->rc < 0 ? -1 : 0;
+}
+
+static int
+memtx_snap_reader_close_cb(struct cbus_call_msg *base)
+{
+	struct memtx_snap_reader_msg *msg =
+		(struct memtx_snap_reader_msg *)base;
+	xlog_cursor_close(&msg->reader->cursor, false);
+	return 0;
+}
+
+/**
+ * Execute @a func in a snapshot reader thread.
+ * @return return code of xlog_cursor_next_tx() if @a func
+ * is memtx_snap_reader_next_tx_cb(), 0 otherwise, or -1 on
+ * error (diag is set).
+ */
+static int
+memtx_snap_reader_call(struct memtx_snap_reader *reader, cbus_call_f func)
+{
+	struct memtx_snap_reader_msg msg;
+	msg.reader = reader;
+	msg.rc = 0;
+	int rc = cbus_call(&reader->reader_pipe, &reader->tx_pipe,
+			   &msg.base, func, NULL, TIMEOUT_INFINITY);
+	assert(msg.base.complete);
+	return rc != 0 ? -1 : msg.rc;
+}
+
+/** Apply rows of a snapshot part read by a reader thread. */
+static int
+memtx_snap_reader_apply_f(va_list ap)
+{
+	struct memtx_snap_reader *reader =
+		va_arg(ap, struct memtx_snap_reader *);
+	struct memtx_engine *memtx = reader->memtx;
+
+	say_info("recovering from `%s'", reader->filename);
+	if (memtx_snap_reader_call(reader, memtx_snap_reader_open_cb) != 0)
+		return -1;
+
+	int rc;
+	struct xrow_header row;
+	uint64_t row_count = 0;
+	while ((rc = memtx_snap_reader_call(reader,
+				memtx_snap_reader_next_tx_cb)) == 0) {
+		while ((rc = xlog_cursor_next_row(&reader->cursor,
+						  &row)) == 0) {
+			row.lsn = reader->signature;
+			rc = memtx_engine_recover_snapshot_row(memtx, &row);
+			if (rc < 0) {
+				if (!memtx->force_recovery)
+					goto out;
+				say_error("can't apply row: ");
+				diag_log();
+			}
+			++row_count;
+			if (row_count % 100000 == 0) {
+				say_info("%s: %.1fM rows processed",
+					 reader->filename,
+					 row_count / 1000000.);
+				fiber_yield_timeout(0);
+			}
+		}
+		if (rc < 0)
+			break;
+	}
+out:
+	memtx_snap_reader_call(reader, memtx_snap_reader_close_cb);
+	if (rc < 0)
+		return -1;
+	if (!xlog_cursor_is_eof(&reader->cursor))
+		panic("snapshot `%s' has no EOF marker", reader->filename);
 	return 0;
 }
 
+/**
+ * Recover parts of a snapshot other than the main file. Each
+ * part is read and decompressed by its own thread, while rows
+ * are applied by tx, so that disk reads of all parts overlap
+ * with building spaces.
+ */
+static int
+memtx_engine_recover_snapshot_parts(struct memtx_engine *memtx,
+				    int64_t signature, uint32_t part_count)
+{
+	uint32_t reader_count = part_count - 1;
+	struct memtx_snap_reader *readers = calloc(reader_count,
+						   sizeof(*readers));
+	if (readers == NULL) {
+		diag_set(OutOfMemory, reader_count * sizeof(*readers),
+			 "calloc", "struct memtx_snap_reader");
+		return -1;
+	}
+	int rc = 0;
+	uint32_t started = 0;
+	for (; started < reader_count; started++) {
+		struct memtx_snap_reader *reader = &readers[started];
+		reader->memtx = memtx;
+		reader->signature = signature;
+		snprintf(reader->filename, sizeof(reader->filename), "%s",
+			 xdir_format_part_filename(&memtx->snap_dir, signature,
+						   started + 1, NONE));
+		char name[FIBER_NAME_MAX];
+		snprintf(name, sizeof(name), "snap.reader.%u",
+			 (unsigned)started + 1);
+		if (cord_costart(&reader->cord, name,
+				 memtx_snap_reader_f, reader) != 0) {
+			rc = -1;
+			break;
+		}
+		cpipe_create(&reader->reader_pipe, name);
+		reader->fiber = fiber_new(name, memtx_snap_reader_apply_f);
+		if (reader->fiber == NULL) {
+			started++;
+			rc = -1;
+			break;
+		}
+		fiber_set_joinable(reader->fiber, true);
+		fiber_start(reader->fiber, reader);
+	}
+	for (uint32_t i = 0; i < started; i++) {
+		struct memtx_snap_reader *reader = &readers[i];
+		if (reader->fiber != NULL && fiber_join(reader->fiber) != 0)
+			rc = -1;
+		cbus_stop_loop(&reader->reader_pipe);
+		cpipe_destroy(&reader->reader_pipe);
+		if (cord_join(&reader->cord) != 0)
+			rc = -1;
+	}
+	free(readers);
+	return rc;
+}
+
 static int
 memtx_engine_recover_snapshot_row(struct memtx_engine *memtx,
 				  struct xrow_header *row)
@@ -260,6 +676,9 @@ memtx_engine_begin_final_recovery(struct engine *engine)
 	struct memtx_engine *memtx = (struct memtx_engine *)engine;
 	if (memtx->state == MEMTX_OK)
 		return 0;
+	/* Primary keys are built to apply an incremental snapshot. */
+	if (memtx->state == MEMTX_FINAL_RECOVERY)
+		return 0;
 
 	assert(memtx->state == MEMTX_INITIAL_RECOVERY);
 	/* End of the fast path: loaded the primary key. */
@@ -314,12 +733,11 @@ memtx_engine_create_space(struct engine *engine, struct space_def *def,
 	return memtx_space_new(memtx, def, key_list);
 }
 
-static int
-memtx_engine_prepare(struct engine *engine, struct txn *txn)
+static void
+memtx_engine_clear_txn_triggers(struct txn *txn)
 {
-	(void)engine;
 	if (txn->is_autocommit)
-		return 0;
+		return;
 	/*
 	 * These triggers are only used for memtx and only
 	 * when autocommit == false, so we are saving
@@ -327,13 +745,28 @@ memtx_engine_prepare(struct engine *engine, struct txn *txn)
 	 */
 	trigger_clear(&txn->fiber_on_yield);
 	trigger_clear(&txn->fiber_on_stop);
+}
+
+static int
+memtx_engine_prepare(struct engine *engine, struct txn *txn)
+{
+	(void)engine;
+	memtx_engine_clear_txn_triggers(txn);
+	if (txn->engine_tx != NULL)
+		return memtx_tx_prepare(txn->engine_tx);
 	return 0;
 }
 
 static int
 memtx_engine_begin(struct engine *engine, struct txn *txn)
 {
-	(void)engine;
+	struct memtx_engine *memtx = (struct memtx_engine *)engine;
+	memtx->txn_count++;
+	if (memtx_tx_manager_use_mvcc_engine) {
+		txn->engine_tx = memtx_tx_begin(txn);
+		if (txn->engine_tx == NULL)
+			return -1;
+	}
 	/*
 	 * Register a trigger to rollback transaction on yield.
 	 * This must be done in begin(), since it's
@@ -347,11 +780,13 @@ memtx_engine_begin(struct engine *engine, struct txn *txn)
 		trigger_create(&txn->fiber_on_stop, txn_on_yield_or_stop,
 				NULL, NULL);
 		/*
-		 * Memtx doesn't allow yields between statements of
-		 * a transaction. Set a trigger which would roll
-		 * back the transaction if there is a yield.
+		 * Without the transaction manager memtx doesn't
+		 * allow yields between statements of a transaction.
+		 * Set a trigger which would roll back the
+		 * transaction if there is a yield.
 		 */
-		trigger_add(&fiber()->on_yield, &txn->fiber_on_yield);
+		if (txn->engine_tx == NULL)
+			trigger_add(&fiber()->on_yield, &txn->fiber_on_yield);
 		trigger_add(&fiber()->on_stop, &txn->fiber_on_stop);
 	}
 	return 0;
@@ -361,7 +796,15 @@ static int
 memtx_engine_begin_statement(struct engine *engine, struct txn *txn)
 {
 	(void)engine;
-	(void)txn;
+	/*
+	 * Changes of spaces not versioned by the transaction
+	 * manager are visible to others right away, so
+	 * a transaction making them may not yield.
+	 */
+	if (txn->engine_tx != NULL && !txn->is_autocommit &&
+	    rlist_empty(&txn->fiber_on_yield.link) &&
+	    !memtx_space_is_mvcc(txn_current_stmt(txn)->space))
+		trigger_add(&fiber()->on_yield, &txn->fiber_on_yield);
 	return 0;
 }
 
@@ -373,6 +816,10 @@ memtx_engine_rollback_statement(struct engine *engine, struct txn *txn,
 	(void)txn;
 	if (stmt->old_tuple == NULL && stmt->new_tuple == NULL)
 		return;
+	if (memtx_tx_stmt_is_versioned(stmt)) {
+		memtx_tx_history_rollback_stmt(stmt);
+		return;
+	}
 	struct space *space = stmt->space;
 	struct memtx_space *memtx_space = (struct memtx_space *)space;
 	int index_count;
@@ -399,9 +846,12 @@ memtx_engine_rollback_statement(struct engine *engine, struct txn *txn,
 		}
 	}
 	/** Reset to old bsize, if it was changed. */
-	if (stmt->engine_savepoint != NULL)
+	if (stmt->engine_savepoint != NULL) {
 		memtx_space_update_bsize(space, stmt->new_tuple,
 					 stmt->old_tuple);
+		memtx_space_track_change(space, stmt->new_tuple,
+					 stmt->old_tuple);
+	}
 
 	if (stmt->new_tuple)
 		tuple_unref(stmt->new_tuple);
@@ -413,22 +863,31 @@ memtx_engine_rollback_statement(struct engine *engine, struct txn *txn,
 static void
 memtx_engine_rollback(struct engine *engine, struct txn *txn)
 {
-	memtx_engine_prepare(engine, txn);
+	struct memtx_engine *memtx = (struct memtx_engine *)engine;
+	memtx_engine_clear_txn_triggers(txn);
 	struct txn_stmt *stmt;
 	stailq_reverse(&txn->stmts);
 	stailq_foreach_entry(stmt, &txn->stmts, next)
 		memtx_engine_rollback_statement(engine, txn, stmt);
+	if (txn->engine_tx != NULL)
+		memtx_tx_rollback(txn->engine_tx);
+	assert(memtx->txn_count > 0);
+	memtx->txn_count--;
 }
 
 static void
 memtx_engine_commit(struct engine *engine, struct txn *txn)
 {
-	(void)engine;
+	struct memtx_engine *memtx = (struct memtx_engine *)engine;
+	if (txn->engine_tx != NULL)
+		memtx_tx_commit(txn->engine_tx);
 	struct txn_stmt *stmt;
 	stailq_foreach_entry(stmt, &txn->stmts, next) {
 		if (stmt->old_tuple)
 			tuple_unref(stmt->old_tuple);
 	}
+	assert(memtx->txn_count > 0);
+	memtx->txn_count--;
 }
 
 static int
@@ -489,8 +948,12 @@ checkpoint_write_row(struct xlog *l, struct xrow_header *row)
 
 }
 
+/**
+ * Write a request of the given type to a snapshot. @a data is
+ * a tuple unless it is a DELETE, in which case it is a key.
+ */
 static int
-checkpoint_write_tuple(struct xlog *l, uint32_t space_id,
+checkpoint_write_tuple(struct xlog *l, uint16_t type, uint32_t space_id,
 		       const char *data, uint32_t size)
 {
 	struct request_replace_body body;
@@ -498,11 +961,11 @@ checkpoint_write_tuple(struct xlog *l, uint32_t space_id,
 	body.k_space_id = IPROTO_SPACE_ID;
 	body.m_space_id = 0xce; /* uint32 */
 	body.v_space_id = mp_bswap_u32(space_id);
-	body.k_tuple = IPROTO_TUPLE;
+	body.k_tuple = type == IPROTO_DELETE ? IPROTO_KEY : IPROTO_TUPLE;
 
 	struct xrow_header row;
 	memset(&row, 0, sizeof(struct xrow_header));
-	row.type = IPROTO_INSERT;
+	row.type = type;
 
 	row.bodycnt = 2;
 	row.body[0].iov_base = &body;
@@ -515,6 +978,15 @@ checkpoint_write_tuple(struct xlog *l, uint32_t space_id,
 struct checkpoint_entry {
 	struct space *space;
 	struct snapshot_iterator *iterator;
+	/**
+	 * Changes of the space written by an incremental
+	 * checkpoint instead of the read view.
+	 */
+	struct mh_memtx_change_t *changes;
+	/** Copy of the primary key definition, used for changes. */
+	struct key_def *key_def;
+	/** Number of the snapshot part the space is written to. */
+	uint32_t part_no;
 	struct rlist link;
 };
 
@@ -525,6 +997,20 @@ struct checkpoint {
 	 */
 	struct rlist entries;
 	uint64_t snap_io_rate_limit;
+	/**
+	 * Number of files the snapshot is split into. Each part
+	 * is written by a separate thread.
+	 */
+	uint32_t part_count;
+	/** Size of spaces assigned to each part. */
+	size_t part_size[MEMTX_SNAP_PARTS_MAX];
+	/**
+	 * Set if the checkpoint is incremental: only changes
+	 * made since the previous checkpoint are written.
+	 */
+	bool is_delta;
+	/** Signature of the previous checkpoint if is_delta is set. */
+	int64_t prev_signature;
 	struct cord cord;
 	bool waiting_for_snap_thread;
 	/** The vclock of the snapshot file. */
@@ -539,9 +1025,16 @@ struct checkpoint {
 
 static int
 checkpoint_init(struct checkpoint *ckpt, const char *snap_dirname,
-		uint64_t snap_io_rate_limit)
+		uint64_t snap_io_rate_limit, uint32_t part_count,
+		bool is_delta)
 {
+	assert(part_count >= 1 && part_count <= MEMTX_SNAP_PARTS_MAX);
 	rlist_create(&ckpt->entries);
+	/* Incremental snapshots are small, don't split them. */
+	ckpt->part_count = is_delta ? 1 : part_count;
+	memset(ckpt->part_size, 0, sizeof(ckpt->part_size));
+	ckpt->is_delta = is_delta;
+	ckpt->prev_signature = 0;
 	ckpt->waiting_for_snap_thread = false;
 	xdir_create(&ckpt->dir, snap_dirname, SNAP, &INSTANCE_UUID);
 	ckpt->snap_io_rate_limit = snap_io_rate_limit;
@@ -562,7 +1055,11 @@ checkpoint_destroy(struct checkpoint *ckpt)
 {
 	struct checkpoint_entry *entry;
 	rlist_foreach_entry(entry, &ckpt->entries, link) {
-		entry->iterator->free(entry->iterator);
+		if (entry->iterator != NULL)
+			entry->iterator->free(entry->iterator);
+		if (entry->changes != NULL)
+			memtx_change_set_delete(entry->changes);
+		free(entry->key_def);
 	}
 	rlist_create(&ckpt->entries);
 	xdir_destroy(&ckpt->dir);
@@ -581,53 +1078,137 @@ checkpoint_add_space(struct space *sp, void *data)
 	if (!pk)
 		return 0;
 	struct checkpoint *ckpt = (struct checkpoint *)data;
+	struct memtx_space *memtx_space = (struct memtx_space *)sp;
+	struct mh_memtx_change_t *changes = memtx_space->changes;
+	/*
+	 * The space starts tracking changes for the next
+	 * checkpoint from scratch.
+	 */
+	memtx_space->changes = NULL;
+	if (!ckpt->is_delta && changes != NULL) {
+		memtx_change_set_delete(changes);
+		changes = NULL;
+	}
+	if (ckpt->is_delta && changes == NULL)
+		return 0;
+
 	struct checkpoint_entry *entry;
 	entry = region_alloc_object(&fiber()->gc, struct checkpoint_entry);
 	if (entry == NULL) {
 		diag_set(OutOfMemory, sizeof(*entry),
 			 "region", "struct checkpoint_entry");
+		if (changes != NULL)
+			memtx_change_set_delete(changes);
 		return -1;
 	}
 	rlist_add_tail_entry(&ckpt->entries, entry, link);
 
 	entry->space = sp;
+	entry->iterator = NULL;
+	entry->changes = changes;
+	entry->key_def = NULL;
+	entry->part_no = 0;
+	if (ckpt->is_delta) {
+		entry->key_def = key_def_dup(pk->def->key_def);
+		return entry->key_def != NULL ? 0 : -1;
+	}
 	entry->iterator = index_create_snapshot_iterator(pk);
 	if (entry->iterator == NULL)
 		return -1;
-
+	/*
+	 * System spaces must be recovered before other spaces,
+	 * so they always go to the main file. Other spaces are
+	 * assigned to the least loaded part. A space isn't split
+	 * between parts so that its rows are recovered in the
+	 * primary key order.
+	 */
+	uint32_t part_no = 0;
+	if (!space_is_system(sp)) {
+		for (uint32_t i = 1; i < ckpt->part_count; i++) {
+			if (ckpt->part_size[i] < ckpt->part_size[part_no])
+				part_no = i;
+		}
+	}
+	entry->part_no = part_no;
+	ckpt->part_size[part_no] += space_bsize(sp);
 	return 0;
 };
 
+/** Argument of checkpoint_write_change(). */
+struct checkpoint_change_arg {
+	struct xlog *snap;
+	struct checkpoint_entry *entry;
+	/** Reader of compressed tuples. */
+	struct memtx_tuple_reader *reader;
+};
+
+/** Write a change of a space to an incremental snapshot. */
 static int
-checkpoint_f(va_list ap)
+checkpoint_write_change(const struct memtx_change *change, void *arg)
 {
-	struct checkpoint *ckpt = va_arg(ap, struct checkpoint *);
-
-	if (ckpt->touch) {
-		if (xdir_touch_xlog(&ckpt->dir, ckpt->vclock) == 0)
-			return 0;
-		/*
-		 * Failed to touch an existing snapshot, create
-		 * a new one.
-		 */
-		ckpt->touch = false;
+	struct xlog *snap = ((struct checkpoint_change_arg *)arg)->snap;
+	struct checkpoint_entry *entry =
+		((struct checkpoint_change_arg *)arg)->entry;
+	struct memtx_tuple_reader *reader =
+		((struct checkpoint_change_arg *)arg)->reader;
+	uint32_t size;
+	const char *data;
+	if (change->is_deleted) {
+		data = tuple_extract_key(change->tuple, entry->key_def, &size);
+		if (data == NULL)
+			return -1;
+		return checkpoint_write_tuple(snap, IPROTO_DELETE,
+					      space_id(entry->space),
+					      data, size);
 	}
+	data = memtx_tuple_read(reader, change->tuple, &size);
+	if (data == NULL)
+		return -1;
+	return checkpoint_write_tuple(snap, IPROTO_REPLACE,
+				      space_id(entry->space), data, size);
+}
 
+/** Write spaces assigned to a part of a snapshot. */
+static int
+checkpoint_write_part(struct checkpoint *ckpt, uint32_t part_no)
+{
 	struct xlog snap;
-	if (xdir_create_xlog(&ckpt->dir, &snap, ckpt->vclock) != 0)
+	if (xdir_create_xlog_part(&ckpt->dir, &snap, ckpt->vclock,
+				  part_no, ckpt->part_count,
+				  ckpt->prev_signature) != 0)
 		return -1;
 
-	snap.rate_limit = ckpt->snap_io_rate_limit;
+	/* The rate limit is shared by all parts. */
+	snap.rate_limit = ckpt->snap_io_rate_limit / ckpt->part_count;
 
-	say_info("saving snapshot `%s'", snap.filename);
+	say_info("saving %s snapshot `%s'",
+		 ckpt->is_delta ? "incremental" : "full", snap.filename);
 	struct checkpoint_entry *entry;
 	rlist_foreach_entry(entry, &ckpt->entries, link) {
+		if (entry->part_no != part_no)
+			continue;
+		if (entry->changes != NULL) {
+			struct memtx_tuple_reader reader;
+			memtx_tuple_reader_create(&reader);
+			struct checkpoint_change_arg arg = {
+				&snap, entry, &reader
+			};
+			int rc = memtx_change_set_foreach(entry->changes,
+							  checkpoint_write_change,
+							  &arg);
+			memtx_tuple_reader_destroy(&reader);
+			if (rc != 0) {
+				xlog_close(&snap, false);
+				return -1;
+			}
+			continue;
+		}
 		uint32_t size;
 		const char *data;
 		struct snapshot_iterator *it = entry->iterator;
 		for (data = it->next(it, &size); data != NULL;
 		     data = it->next(it, &size)) {
-			if (checkpoint_write_tuple(&snap,
+			if (checkpoint_write_tuple(&snap, IPROTO_INSERT,
 					space_id(entry->space),
 					data, size) != 0) {
 				xlog_close(&snap, false);
@@ -640,14 +1221,83 @@ checkpoint_f(va_list ap)
 		return -1;
 	}
 	xlog_close(&snap, false);
-	say_info("done");
 	return 0;
 }
 
+/** A thread writing a part of a snapshot other than the main file. */
+struct checkpoint_part {
+	struct cord cord;
+	struct checkpoint *ckpt;
+	uint32_t part_no;
+};
+
 static int
-memtx_engine_begin_checkpoint(struct engine *engine)
+checkpoint_part_f(va_list ap)
 {
-	struct memtx_engine *memtx = (struct memtx_engine *)engine;
+	struct checkpoint_part *part = va_arg(ap, struct checkpoint_part *);
+	return checkpoint_write_part(part->ckpt, part->part_no);
+}
+
+static int
+checkpoint_f(va_list ap)
+{
+	struct checkpoint *ckpt = va_arg(ap, struct checkpoint *);
+
+	if (ckpt->touch) {
+		if (xdir_touch_xlog(&ckpt->dir, ckpt->vclock) == 0)
+			return 0;
+		/*
+		 * Failed to touch an existing snapshot, create
+		 * a new one.
+		 */
+		ckpt->touch = false;
+	}
+
+	/*
+	 * Write the main file in this thread and start a thread
+	 * for each other part.
+	 */
+	uint32_t part_count = ckpt->part_count;
+	struct checkpoint_part *parts = NULL;
+	if (part_count > 1) {
+		parts = calloc(part_count - 1, sizeof(*parts));
+		if (parts == NULL) {
+			diag_set(OutOfMemory, (part_count - 1) * sizeof(*parts),
+				 "calloc", "struct checkpoint_part");
+			return -1;
+		}
+	}
+	int rc = 0;
+	uint32_t started = 0;
+	for (; started < part_count - 1; started++) {
+		struct checkpoint_part *part = &parts[started];
+		part->ckpt = ckpt;
+		part->part_no = started + 1;
+		char name[FIBER_NAME_MAX];
+		snprintf(name, sizeof(name), "snapshot.%u",
+			 (unsigned)part->part_no);
+		if (cord_costart(&part->cord, name,
+				 checkpoint_part_f, part) != 0) {
+			rc = -1;
+			break;
+		}
+	}
+	if (rc == 0)
+		rc = checkpoint_write_part(ckpt, 0);
+	for (uint32_t i = 0; i < started; i++) {
+		if (cord_cojoin(&parts[i].cord) != 0)
+			rc = -1;
+	}
+	free(parts);
+	if (rc == 0)
+		say_info("done");
+	return rc;
+}
+
+static int
+memtx_engine_begin_checkpoint(struct engine *engine)
+{
+	struct memtx_engine *memtx = (struct memtx_engine *)engine;
 
 	assert(memtx->checkpoint == NULL);
 	memtx->checkpoint = region_alloc_object(&fiber()->gc, struct checkpoint);
@@ -657,15 +1307,30 @@ memtx_engine_begin_checkpoint(struct engine *engine)
 		return -1;
 	}
 
+	/*
+	 * A checkpoint may be incremental if all changes made
+	 * since the previous one are known. Incremental snapshots
+	 * are never taken against an empty checkpoint, since
+	 * signature 0 marks a full snapshot in the file meta.
+	 */
+	struct vclock last;
+	bool is_delta = memtx->changes_tracked &&
+			memtx->snap_delta_count < memtx->snap_delta_max &&
+			xdir_last_vclock(&memtx->snap_dir, &last) > 0;
+
 	if (checkpoint_init(memtx->checkpoint, memtx->snap_dir.dirname,
-			    memtx->snap_io_rate_limit) != 0)
+			    memtx->snap_io_rate_limit,
+			    memtx->snap_part_count, is_delta) != 0)
 		return -1;
 
 	if (space_foreach(checkpoint_add_space, memtx->checkpoint) != 0) {
 		checkpoint_destroy(memtx->checkpoint);
 		memtx->checkpoint = NULL;
+		memtx->changes_tracked = false;
 		return -1;
 	}
+	/* Change sets were reset by checkpoint_add_space(). */
+	memtx->changes_tracked = memtx->snap_delta_max > 0;
 
 	/* increment snapshot version; set tuple deletion to delayed mode */
 	memtx_tuple_begin_snapshot();
@@ -682,11 +1347,15 @@ memtx_engine_wait_checkpoint(struct engine *engine, struct vclock *vclock)
 	 * If a snapshot already exists, do not create a new one.
 	 */
 	struct vclock last;
-	if (xdir_last_vclock(&memtx->snap_dir, &last) >= 0 &&
-	    vclock_compare(&last, vclock) == 0) {
+	int64_t last_signature = xdir_last_vclock(&memtx->snap_dir, &last);
+	if (last_signature >= 0 && vclock_compare(&last, vclock) == 0) {
 		memtx->checkpoint->touch = true;
 	}
 	vclock_copy(memtx->checkpoint->vclock, vclock);
+	if (memtx->checkpoint->is_delta) {
+		assert(last_signature > 0);
+		memtx->checkpoint->prev_signature = last_signature;
+	}
 
 	if (cord_costart(&memtx->checkpoint->cord, "snapshot",
 			 checkpoint_f, memtx->checkpoint)) {
@@ -719,14 +1388,30 @@ memtx_engine_commit_checkpoint(struct engine *engine, struct vclock *vclock)
 	if (!memtx->checkpoint->touch) {
 		int64_t lsn = vclock_sum(memtx->checkpoint->vclock);
 		struct xdir *dir = &memtx->checkpoint->dir;
-		/* rename snapshot on completion */
-		char to[PATH_MAX];
-		snprintf(to, sizeof(to), "%s",
-			 xdir_format_filename(dir, lsn, NONE));
-		char *from = xdir_format_filename(dir, lsn, INPROGRESS);
-		int rc = coio_rename(from, to);
-		if (rc != 0)
-			panic("can't rename .snap.inprogress");
+		/*
+		 * Rename snapshot on completion. The main file
+		 * goes last so that its presence implies that
+		 * all other parts are complete.
+		 */
+		uint32_t part_no = memtx->checkpoint->part_count;
+		do {
+			part_no--;
+			char to[PATH_MAX];
+			snprintf(to, sizeof(to), "%s",
+				 xdir_format_part_filename(dir, lsn, part_no,
+							   NONE));
+			char *from = xdir_format_part_filename(dir, lsn,
+							       part_no,
+							       INPROGRESS);
+			int rc = coio_rename(from, to);
+			if (rc != 0)
+				panic("can't rename .snap.inprogress");
+		} while (part_no > 0);
+
+		if (memtx->checkpoint->is_delta)
+			memtx->snap_delta_count++;
+		else
+			memtx->snap_delta_count = 0;
 	}
 
 	struct vclock last;
@@ -759,29 +1444,87 @@ memtx_engine_abort_checkpoint(struct engine *engine)
 
 	memtx_tuple_end_snapshot();
 
-	/** Remove garbage .inprogress file. */
-	char *filename =
-		xdir_format_filename(&memtx->checkpoint->dir,
-				     vclock_sum(memtx->checkpoint->vclock),
-				     INPROGRESS);
-	(void) coio_unlink(filename);
+	/*
+	 * Changes written to the aborted snapshot are lost,
+	 * so the next snapshot must be full.
+	 */
+	memtx->changes_tracked = false;
+
+	/** Remove garbage .inprogress files. */
+	for (uint32_t i = 0; i < memtx->checkpoint->part_count; i++) {
+		char *filename =
+			xdir_format_part_filename(&memtx->checkpoint->dir,
+					vclock_sum(memtx->checkpoint->vclock),
+					i, INPROGRESS);
+		(void) coio_unlink(filename);
+	}
 
 	checkpoint_destroy(memtx->checkpoint);
 	memtx->checkpoint = NULL;
 }
 
+/**
+ * Remove parts of a snapshot other than the main file. Parts
+ * are numbered sequentially, so stop at the first missing one.
+ */
+static int
+memtx_engine_remove_snap_parts(struct memtx_engine *memtx,
+			       int64_t signature)
+{
+	for (uint32_t part_no = 1; ; part_no++) {
+		char *filename = xdir_format_part_filename(&memtx->snap_dir,
+							   signature, part_no,
+							   NONE);
+		if (coio_unlink(filename) != 0) {
+			if (errno == ENOENT)
+				return 0;
+			say_syserror("error while removing %s", filename);
+			diag_set(SystemError, "failed to unlink file '%s'",
+				 filename);
+			return -1;
+		}
+		say_info("removed %s", filename);
+	}
+}
+
 static int
 memtx_engine_collect_garbage(struct engine *engine, int64_t lsn)
 {
 	struct memtx_engine *memtx = (struct memtx_engine *)engine;
+	/*
+	 * An incremental snapshot can only be recovered along
+	 * with the snapshots it was taken against, so keep all
+	 * snapshots starting from the last full one taken before
+	 * the oldest checkpoint to keep.
+	 */
+	struct vclock *vclock = vclockset_first(&memtx->snap_dir.index);
+	while (vclock != NULL && vclock_sum(vclock) < lsn)
+		vclock = vclockset_next(&memtx->snap_dir.index, vclock);
+	if (vclock != NULL) {
+		uint32_t count;
+		int64_t *chain = memtx_snap_chain(&memtx->snap_dir,
+						  vclock_sum(vclock), &count);
+		if (chain == NULL)
+			return -1;
+		lsn = MIN(lsn, chain[0]);
+		free(chain);
+	}
 	/*
 	 * We recover the checkpoint list by scanning the snapshot
 	 * directory so deletion of an xlog file or a file that
 	 * belongs to another engine without the corresponding snap
 	 * file would result in a corrupted checkpoint on the list.
 	 * That said, we have to abort garbage collection if we
-	 * fail to delete a snap file.
+	 * fail to delete a snap file. For the same reason, parts
+	 * of a snapshot are deleted before the main file.
 	 */
+	for (vclock = vclockset_first(&memtx->snap_dir.index);
+	     vclock != NULL && vclock_sum(vclock) < lsn;
+	     vclock = vclockset_next(&memtx->snap_dir.index, vclock)) {
+		if (memtx_engine_remove_snap_parts(memtx,
+						   vclock_sum(vclock)) != 0)
+			return -1;
+	}
 	if (xdir_collect_garbage(&memtx->snap_dir, lsn, true) != 0)
 		return -1;
 
@@ -793,9 +1536,27 @@ memtx_engine_backup(struct engine *engine, struct vclock *vclock,
 		    engine_backup_cb cb, void *cb_arg)
 {
 	struct memtx_engine *memtx = (struct memtx_engine *)engine;
-	char *filename = xdir_format_filename(&memtx->snap_dir,
-					      vclock_sum(vclock), NONE);
-	return cb(filename, cb_arg);
+	uint32_t count;
+	int64_t *chain = memtx_snap_chain(&memtx->snap_dir,
+					  vclock_sum(vclock), &count);
+	if (chain == NULL)
+		return -1;
+	int rc = 0;
+	for (uint32_t i = 0; rc == 0 && i < count; i++) {
+		char *filename = xdir_format_filename(&memtx->snap_dir,
+						      chain[i], NONE);
+		rc = cb(filename, cb_arg);
+		for (uint32_t part_no = 1; rc == 0; part_no++) {
+			filename = xdir_format_part_filename(&memtx->snap_dir,
+							     chain[i], part_no,
+							     NONE);
+			if (access(filename, F_OK) != 0)
+				break;
+			rc = cb(filename, cb_arg);
+		}
+	}
+	free(chain);
+	return rc;
 }
 
 /** Used to pass arguments to memtx_initial_join_f */
@@ -806,49 +1567,400 @@ struct memtx_join_arg {
 };
 
 /**
- * Invoked from a thread to feed snapshot rows.
+ * A key changed by an incremental snapshot. A replica can
+ * only bulk load inserts on join, so a chain of snapshots
+ * is merged into rows of a single full snapshot.
+ */
+struct memtx_join_key {
+	uint32_t space_id;
+	uint32_t hash;
+	/** Number of the newest snapshot in the chain changing the key. */
+	uint32_t snap_no;
+	/** Primary key definition of the space. */
+	struct key_def *key_def;
+	/** The key, MessagePack array. */
+	char *key;
+};
+
+#define mh_name _memtx_join_key
+#define mh_key_t const struct memtx_join_key *
+#define mh_node_t struct memtx_join_key
+#define mh_arg_t void *
+#define mh_hash(a, arg) ((a)->hash)
+#define mh_hash_key(a, arg) ((a)->hash)
+#define mh_cmp(a, b, arg) ((a)->space_id != (b)->space_id || \
+			   key_compare((a)->key, (b)->key, (a)->key_def) != 0)
+#define mh_cmp_key(a, b, arg) mh_cmp(a, b, arg)
+#define MH_SOURCE 1
+#include <salad/mhash.h>
+
+/**
+ * Decode the space id and the primary key of a snapshot row.
+ * The key is allocated on the fiber region unless the row is
+ * a DELETE. Returns 1 if the space is unknown.
  */
 static int
-memtx_initial_join_f(va_list ap)
+memtx_join_key_decode(struct xrow_header *row, struct mh_i32ptr_t *key_defs,
+		      struct memtx_join_key *key)
 {
-	struct memtx_join_arg *arg = va_arg(ap, struct memtx_join_arg *);
-	const char *snap_dirname = arg->snap_dirname;
-	int64_t checkpoint_lsn = arg->checkpoint_lsn;
-	struct xstream *stream = arg->stream;
+	struct request request;
+	if (xrow_decode_dml(row, &request, dml_request_key_map(row->type)) != 0)
+		return -1;
+	key->space_id = request.space_id;
+	mh_int_t k = mh_i32ptr_find(key_defs, request.space_id, NULL);
+	if (k == mh_end(key_defs))
+		return 1;
+	key->key_def = mh_i32ptr_node(key_defs, k)->val;
+	if (row->type == IPROTO_DELETE) {
+		key->key = (char *)request.key;
+	} else {
+		key->key = tuple_extract_key_raw(request.tuple,
+						 request.tuple_end,
+						 key->key_def, NULL);
+		if (key->key == NULL)
+			return -1;
+	}
+	const char *parts = key->key;
+	mp_decode_array(&parts);
+	key->hash = key->space_id ^ key_hash(parts, key->key_def);
+	return 0;
+}
 
-	struct xdir dir;
-	/*
-	 * snap_dirname and INSTANCE_UUID don't change after start,
-	 * safe to use in another thread.
-	 */
-	xdir_create(&dir, snap_dirname, SNAP, &INSTANCE_UUID);
+/**
+ * Decode the primary key definition of a space from a row of
+ * the _index space and add it to @a key_defs. Secondary keys
+ * are ignored.
+ */
+static int
+memtx_join_decode_key_def(struct xrow_header *row,
+			  struct mh_i32ptr_t *key_defs)
+{
+	struct request request;
+	if (xrow_decode_dml(row, &request, dml_request_key_map(row->type)) != 0)
+		return -1;
+	const char *data = request.tuple;
+	uint32_t field_count = mp_decode_array(&data);
+	if (field_count <= BOX_INDEX_FIELD_PARTS ||
+	    mp_typeof(*data) != MP_UINT)
+		goto error;
+	uint32_t space_id = mp_decode_uint(&data);
+	if (mp_typeof(*data) != MP_UINT)
+		goto error;
+	uint32_t index_id = mp_decode_uint(&data);
+	if (index_id != 0)
+		return 0;
+	for (uint32_t i = BOX_INDEX_FIELD_ID + 1;
+	     i < BOX_INDEX_FIELD_PARTS; i++)
+		mp_next(&data);
+	if (mp_typeof(*data) != MP_ARRAY)
+		goto error;
+	uint32_t part_count = mp_decode_array(&data);
+	struct key_part_def *parts = region_alloc(&fiber()->gc,
+						  sizeof(*parts) * part_count);
+	if (parts == NULL) {
+		diag_set(OutOfMemory, sizeof(*parts) * part_count,
+			 "region", "struct key_part_def");
+		return -1;
+	}
+	if (key_def_decode_parts(parts, part_count, &data, NULL, 0) != 0)
+		return -1;
+	struct key_def *key_def = key_def_new_with_parts(parts, part_count);
+	if (key_def == NULL)
+		return -1;
+	struct mh_i32ptr_node_t node = { space_id, key_def };
+	struct mh_i32ptr_node_t old, *p_old = &old;
+	if (mh_i32ptr_put(key_defs, &node, &p_old, NULL) == mh_end(key_defs)) {
+		free(key_def);
+		diag_set(OutOfMemory, 0, "mh_i32ptr_put", "key_defs");
+		return -1;
+	}
+	if (p_old != NULL)
+		free(old.val);
+	return 0;
+error:
+	diag_set(ClientError, ER_INVALID_MSGPACK, "_index tuple");
+	return -1;
+}
+
+/**
+ * Load primary key definitions of spaces from the _index
+ * rows of a full snapshot. Schema changes always result in
+ * a full snapshot, so these definitions are valid for all
+ * incremental snapshots taken after it, while the current
+ * schema may have changed since the checkpoint.
+ */
+static int
+memtx_join_load_key_defs(struct xdir *dir, int64_t signature,
+			 struct mh_i32ptr_t *key_defs)
+{
 	struct xlog_cursor cursor;
-	int rc = xdir_open_cursor(&dir, checkpoint_lsn, &cursor);
-	xdir_destroy(&dir);
-	if (rc < 0)
+	if (xdir_open_cursor(dir, signature, &cursor) < 0)
 		return -1;
+	int rc;
+	struct xrow_header row;
+	while ((rc = xlog_cursor_next(&cursor, &row, true)) == 0) {
+		struct request request;
+		rc = xrow_decode_dml(&row, &request,
+				     dml_request_key_map(row.type));
+		if (rc != 0)
+			break;
+		/* System spaces are written in the order of ids. */
+		if (request.space_id > BOX_INDEX_ID)
+			break;
+		if (request.space_id != BOX_INDEX_ID)
+			continue;
+		rc = memtx_join_decode_key_def(&row, key_defs);
+		fiber_gc();
+		if (rc != 0)
+			break;
+	}
+	xlog_cursor_close(&cursor, false);
+	return rc < 0 ? -1 : 0;
+}
 
+/** Remember keys changed by an incremental snapshot. */
+static int
+memtx_join_scan_delta(struct xdir *dir, int64_t signature, uint32_t snap_no,
+		      struct mh_i32ptr_t *key_defs,
+		      struct mh_memtx_join_key_t *keys)
+{
+	struct xlog_cursor cursor;
+	if (xdir_open_cursor(dir, signature, &cursor) < 0)
+		return -1;
+	int rc;
 	struct xrow_header row;
 	while ((rc = xlog_cursor_next(&cursor, &row, true)) == 0) {
-		rc = xstream_write(stream, &row);
+		struct memtx_join_key key;
+		rc = memtx_join_key_decode(&row, key_defs, &key);
 		if (rc < 0)
 			break;
+		if (rc > 0) {
+			/*
+			 * The space is unknown to the checkpoint,
+			 * skip the row like memtx_join_send_snapshot()
+			 * does.
+			 */
+			fiber_gc();
+			continue;
+		}
+		if (mh_memtx_join_key_find(keys, &key, NULL) == mh_end(keys)) {
+			const char *key_end = key.key;
+			mp_next(&key_end);
+			size_t size = key_end - key.key;
+			char *copy = malloc(size);
+			if (copy == NULL) {
+				diag_set(OutOfMemory, size, "malloc", "key");
+				rc = -1;
+				break;
+			}
+			memcpy(copy, key.key, size);
+			key.key = copy;
+			key.snap_no = snap_no;
+			if (mh_memtx_join_key_put(keys, &key, NULL,
+						  NULL) == mh_end(keys)) {
+				free(copy);
+				diag_set(OutOfMemory, 0, "mh_memtx_join_key_put",
+					 "key");
+				rc = -1;
+				break;
+			}
+		}
+		fiber_gc();
 	}
 	xlog_cursor_close(&cursor, false);
 	if (rc < 0)
 		return -1;
+	if (!xlog_cursor_is_eof(&cursor))
+		panic("snapshot `%s' has no EOF marker", cursor.name);
+	return 0;
+}
 
-	/**
-	 * We should never try to read snapshots with no EOF
-	 * marker - such snapshots are very likely corrupted and
-	 * should not be trusted.
+/**
+ * Send rows of a full snapshot, skipping keys changed by
+ * incremental snapshots taken after it, if @a keys is set.
+ */
+static int
+memtx_join_send_snapshot(struct xdir *dir, int64_t signature,
+			 struct xstream *stream, struct mh_i32ptr_t *key_defs,
+			 struct mh_memtx_join_key_t *keys)
+{
+	struct xlog_cursor cursor;
+	if (xdir_open_cursor(dir, signature, &cursor) < 0)
+		return -1;
+	/*
+	 * Send the main file first, because it contains
+	 * system spaces, then the rest of the parts.
 	 */
-	/* TODO: replace panic with diag_set() */
+	uint32_t part_count = MAX(cursor.meta.part_count, 1);
+	for (uint32_t part_no = 0; ; ) {
+		int rc;
+		struct xrow_header row;
+		while ((rc = xlog_cursor_next(&cursor, &row, true)) == 0) {
+			if (keys != NULL && mh_size(keys) > 0) {
+				struct memtx_join_key key;
+				rc = memtx_join_key_decode(&row, key_defs,
+							   &key);
+				if (rc < 0)
+					break;
+				bool is_changed = rc == 0 &&
+					mh_memtx_join_key_find(keys, &key,
+							NULL) != mh_end(keys);
+				fiber_gc();
+				if (is_changed)
+					continue;
+			}
+			rc = xstream_write(stream, &row);
+			if (rc < 0)
+				break;
+		}
+		xlog_cursor_close(&cursor, false);
+		if (rc < 0)
+			return -1;
+
+		/**
+		 * We should never try to read snapshots with no EOF
+		 * marker - such snapshots are very likely corrupted and
+		 * should not be trusted.
+		 */
+		/* TODO: replace panic with diag_set() */
+		if (!xlog_cursor_is_eof(&cursor))
+			panic("snapshot `%s' has no EOF marker", cursor.name);
+
+		if (++part_no >= part_count)
+			break;
+		if (xlog_cursor_open(&cursor,
+				xdir_format_part_filename(dir, signature,
+							  part_no, NONE)) < 0)
+			return -1;
+	}
+	return 0;
+}
+
+/**
+ * Send tuples of an incremental snapshot that were not
+ * changed by newer snapshots in the chain.
+ */
+static int
+memtx_join_send_delta(struct xdir *dir, int64_t signature, uint32_t snap_no,
+		      struct xstream *stream, struct mh_i32ptr_t *key_defs,
+		      struct mh_memtx_join_key_t *keys)
+{
+	struct xlog_cursor cursor;
+	if (xdir_open_cursor(dir, signature, &cursor) < 0)
+		return -1;
+	int rc;
+	struct xrow_header row;
+	while ((rc = xlog_cursor_next(&cursor, &row, true)) == 0) {
+		if (row.type == IPROTO_DELETE)
+			continue;
+		struct memtx_join_key key;
+		rc = memtx_join_key_decode(&row, key_defs, &key);
+		if (rc < 0)
+			break;
+		if (rc > 0) {
+			/* Skipped by memtx_join_scan_delta(). */
+			fiber_gc();
+			rc = 0;
+			continue;
+		}
+		mh_int_t k = mh_memtx_join_key_find(keys, &key, NULL);
+		assert(k != mh_end(keys));
+		bool is_newest = mh_memtx_join_key_node(keys, k)->snap_no ==
+				 snap_no;
+		fiber_gc();
+		if (!is_newest)
+			continue;
+		/* The replica bulk loads inserts. */
+		row.type = IPROTO_INSERT;
+		rc = xstream_write(stream, &row);
+		if (rc < 0)
+			break;
+	}
+	xlog_cursor_close(&cursor, false);
+	if (rc < 0)
+		return -1;
 	if (!xlog_cursor_is_eof(&cursor))
 		panic("snapshot `%s' has no EOF marker", cursor.name);
 	return 0;
 }
 
+/**
+ * Invoked from a thread to feed snapshot rows.
+ */
+static int
+memtx_initial_join_f(va_list ap)
+{
+	struct memtx_join_arg *arg = va_arg(ap, struct memtx_join_arg *);
+	const char *snap_dirname = arg->snap_dirname;
+	int64_t checkpoint_lsn = arg->checkpoint_lsn;
+	struct xstream *stream = arg->stream;
+
+	struct xdir dir;
+	/*
+	 * snap_dirname and INSTANCE_UUID don't change after start,
+	 * safe to use in another thread.
+	 */
+	xdir_create(&dir, snap_dirname, SNAP, &INSTANCE_UUID);
+	int rc = -1;
+	uint32_t count = 0;
+	struct mh_i32ptr_t *key_defs = NULL;
+	struct mh_memtx_join_key_t *keys = NULL;
+	int64_t *chain = memtx_snap_chain(&dir, checkpoint_lsn, &count);
+	if (chain == NULL)
+		goto out;
+	if (count > 1) {
+		key_defs = mh_i32ptr_new();
+		if (key_defs == NULL) {
+			diag_set(OutOfMemory, sizeof(*key_defs), "malloc",
+				 "struct mh_i32ptr_t");
+			goto out;
+		}
+		if (memtx_join_load_key_defs(&dir, chain[0], key_defs) != 0)
+			goto out;
+		keys = mh_memtx_join_key_new();
+		if (keys == NULL) {
+			diag_set(OutOfMemory, sizeof(*keys), "malloc",
+				 "struct mh_memtx_join_key_t");
+			goto out;
+		}
+		/*
+		 * Find the newest version of each key changed by
+		 * incremental snapshots, then send the full snapshot
+		 * without these keys followed by the newest versions.
+		 */
+		for (uint32_t i = count - 1; i > 0; i--) {
+			if (memtx_join_scan_delta(&dir, chain[i], i,
+						  key_defs, keys) != 0)
+				goto out;
+		}
+	}
+	if (memtx_join_send_snapshot(&dir, chain[0], stream,
+				     key_defs, keys) != 0)
+		goto out;
+	for (uint32_t i = 1; i < count; i++) {
+		if (memtx_join_send_delta(&dir, chain[i], i, stream,
+					  key_defs, keys) != 0)
+			goto out;
+	}
+	rc = 0;
+out:
+	if (keys != NULL) {
+		mh_int_t k;
+		mh_foreach(keys, k)
+			free(mh_memtx_join_key_node(keys, k)->key);
+		mh_memtx_join_key_delete(keys);
+	}
+	if (key_defs != NULL) {
+		mh_int_t k;
+		mh_foreach(key_defs, k)
+			free(mh_i32ptr_node(key_defs, k)->val);
+		mh_i32ptr_delete(key_defs);
+	}
+	free(chain);
+	xdir_destroy(&dir);
+	return rc;
+}
+
 static int
 memtx_engine_join(struct engine *engine, struct vclock *vclock,
 		  struct xstream *stream)
@@ -893,10 +2005,376 @@ memtx_engine_memory_stat(struct engine *engine, struct engine_memory_stat *stat)
 static int
 memtx_engine_check_space_def(struct space_def *def)
 {
-	(void)def;
+	if (def->opts.defer_deletes) {
+		diag_set(ClientError, ER_ALTER_SPACE,
+			 def->name, "engine does not support defer_deletes flag");
+		return -1;
+	}
+	if (def->opts.compression != SPACE_COMPRESSION_NONE &&
+	    def->id <= BOX_SYSTEM_ID_MAX) {
+		diag_set(ClientError, ER_ALTER_SPACE,
+			 def->name, "system spaces can not be compressed");
+		return -1;
+	}
+	return 0;
+}
+
+/* {{{ Defragmentation ********************************************/
+
+enum {
+	/** Max number of tuples relocated in one defragmentation step. */
+	MEMTX_DEFRAG_BATCH = 256,
+};
+
+/** Pause between two defragmentation steps, in seconds. */
+static const double MEMTX_DEFRAG_STEP_DELAY = 0.01;
+/** How often to check if there is anything to defragment. */
+static const double MEMTX_DEFRAG_CHECK_INTERVAL = 1.0;
+
+/** A size class of the tuple allocator. */
+struct memtx_defrag_class {
+	/** Size of objects allocated from the class. */
+	uint32_t objsize;
+	/** Set if the class is filled less than the threshold. */
+	bool is_sparse;
+};
+
+/** State of a defragmentation pass. */
+struct memtx_defrag {
+	struct memtx_engine *memtx;
+	/** Size classes of the tuple allocator, sorted by size. */
+	struct memtx_defrag_class *classes;
+	uint32_t class_count;
+	uint32_t class_capacity;
+	/** Set if at least one size class is sparse. */
+	bool has_sparse;
+	/** Space being scanned or UINT32_MAX if the pass is over. */
+	uint32_t space_id;
+	/**
+	 * Primary key of the last tuple scanned in the space.
+	 * If key_size is 0, the scan starts from the beginning.
+	 */
+	char *key;
+	uint32_t key_size;
+	uint32_t key_capacity;
+	/**
+	 * Schema version the key was saved at. The key can't be
+	 * used after DDL, since the primary key may have changed.
+	 */
+	uint32_t schema_version;
+	/** Tuples to relocate in the current step, referenced. */
+	struct tuple *batch[MEMTX_DEFRAG_BATCH];
+};
+
+static int
+memtx_defrag_class_cmp(const void *a, const void *b)
+{
+	uint32_t objsize_a = ((const struct memtx_defrag_class *)a)->objsize;
+	uint32_t objsize_b = ((const struct memtx_defrag_class *)b)->objsize;
+	return objsize_a < objsize_b ? -1 : objsize_a > objsize_b;
+}
+
+static int
+memtx_defrag_class_cb(const struct mempool_stats *stats, void *cb_ctx)
+{
+	struct memtx_defrag *defrag = cb_ctx;
+	if (defrag->class_count == defrag->class_capacity) {
+		uint32_t capacity = MAX(defrag->class_capacity * 2, 64);
+		struct memtx_defrag_class *classes = realloc(defrag->classes,
+						capacity * sizeof(*classes));
+		if (classes == NULL) {
+			diag_set(OutOfMemory, capacity * sizeof(*classes),
+				 "realloc", "struct memtx_defrag_class");
+			return -1;
+		}
+		defrag->classes = classes;
+		defrag->class_capacity = capacity;
+	}
+	struct memtx_defrag_class *c = &defrag->classes[defrag->class_count++];
+	c->objsize = stats->objsize;
+	/*
+	 * A class that fits in one slab can't release any memory
+	 * however sparse it is.
+	 */
+	c->is_sparse = stats->slabcount > 1 &&
+		stats->totals.used < stats->totals.total *
+				     defrag->memtx->defrag_threshold;
+	if (c->is_sparse)
+		defrag->has_sparse = true;
+	return 0;
+}
+
+/**
+ * Check if the size class of a tuple is sparse. A tuple is
+ * allocated from the smallest class that fits it.
+ */
+static bool
+memtx_defrag_tuple_is_sparse(struct memtx_defrag *defrag, struct tuple *tuple)
+{
+	size_t size = memtx_tuple_size(tuple);
+	uint32_t begin = 0, end = defrag->class_count;
+	while (begin < end) {
+		uint32_t mid = begin + (end - begin) / 2;
+		if (defrag->classes[mid].objsize < size)
+			begin = mid + 1;
+		else
+			end = mid;
+	}
+	/* Large tuples are allocated with malloc(). */
+	return begin < defrag->class_count && defrag->classes[begin].is_sparse;
+}
+
+/**
+ * Start a new defragmentation pass if there are size classes
+ * filled less than the threshold.
+ */
+static int
+memtx_defrag_begin_pass(struct memtx_defrag *defrag)
+{
+	struct small_stats totals;
+	defrag->class_count = 0;
+	defrag->has_sparse = false;
+	if (small_stats(&memtx_alloc, &totals, memtx_defrag_class_cb,
+			defrag) != 0)
+		return -1;
+	if (!defrag->has_sparse)
+		return 0;
+	qsort(defrag->classes, defrag->class_count,
+	      sizeof(*defrag->classes), memtx_defrag_class_cmp);
+	defrag->space_id = 0;
+	defrag->key_size = 0;
+	defrag->schema_version = schema_version;
 	return 0;
 }
 
+/** Check if the tuples of a space may be relocated. */
+static bool
+memtx_defrag_space_is_eligible(struct memtx_defrag *defrag,
+			       struct space *space)
+{
+	struct memtx_space *memtx_space = (struct memtx_space *)space;
+	/*
+	 * System spaces are small and their tuples may be
+	 * referenced by the schema cache, so skip them.
+	 */
+	return space->engine == &defrag->memtx->base &&
+	       space_id(space) > BOX_SYSTEM_ID_MAX &&
+	       memtx_space->replace == memtx_space_replace_all_keys;
+}
+
+struct memtx_defrag_next_space_arg {
+	struct memtx_defrag *defrag;
+	/** Min id of an eligible space >= defrag->space_id. */
+	uint32_t next_id;
+};
+
+static int
+memtx_defrag_next_space_cb(struct space *space, void *cb_ctx)
+{
+	struct memtx_defrag_next_space_arg *arg = cb_ctx;
+	uint32_t id = space_id(space);
+	if (id >= arg->defrag->space_id && id < arg->next_id &&
+	    memtx_defrag_space_is_eligible(arg->defrag, space))
+		arg->next_id = id;
+	return 0;
+}
+
+/**
+ * Find the space to scan next, starting from defrag->space_id.
+ * Return NULL if there are no spaces left.
+ */
+static struct space *
+memtx_defrag_next_space(struct memtx_defrag *defrag)
+{
+	if (defrag->schema_version != schema_version) {
+		/*
+		 * The space may have been dropped or altered,
+		 * so rescan it from the beginning.
+		 */
+		defrag->schema_version = schema_version;
+		defrag->key_size = 0;
+	}
+	struct space *space = space_by_id(defrag->space_id);
+	if (space != NULL && memtx_defrag_space_is_eligible(defrag, space))
+		return space;
+	/* Spaces are hashed by id, hence no ordered lookup. */
+	struct memtx_defrag_next_space_arg arg = { defrag, UINT32_MAX };
+	if (space_foreach(memtx_defrag_next_space_cb, &arg) != 0) {
+		diag_log();
+		arg.next_id = UINT32_MAX;
+	}
+	defrag->key_size = 0;
+	defrag->space_id = arg.next_id;
+	return space_by_id(arg.next_id);
+}
+
+/**
+ * Relocate a tuple to a new chunk of memory and replace it in
+ * all indexes of the space. The tuple must not be referenced
+ * by anyone but the space and the caller.
+ */
+static int
+memtx_defrag_relocate(struct space *space, struct tuple *old_tuple)
+{
+	struct memtx_space *memtx_space = (struct memtx_space *)space;
+	struct tuple *new_tuple = memtx_tuple_dup(old_tuple);
+	if (new_tuple == NULL)
+		return -1;
+	tuple_ref(new_tuple);
+	struct tuple *result;
+	if (memtx_space->replace(space, old_tuple, new_tuple,
+				 DUP_REPLACE, &result) != 0) {
+		tuple_unref(new_tuple);
+		return -1;
+	}
+	assert(result == old_tuple);
+	/* Drop the reference held by the space. */
+	tuple_unref(old_tuple);
+	return 0;
+}
+
+/**
+ * Scan the next batch of tuples of the current space and
+ * relocate those allocated from sparse size classes. Copies
+ * fill the holes in the slabs the allocator picks, while slabs
+ * left with no tuples are returned to the slab cache and may
+ * be reused by other size classes.
+ */
+static int
+memtx_defrag_step(struct memtx_defrag *defrag)
+{
+	struct space *space = memtx_defrag_next_space(defrag);
+	if (space == NULL) {
+		/* The pass is over. */
+		defrag->space_id = UINT32_MAX;
+		return 0;
+	}
+	struct index *pk = space_index(space, 0);
+	assert(pk != NULL);
+
+	const char *key = NULL;
+	uint32_t part_count = 0;
+	if (defrag->key_size > 0) {
+		key = defrag->key;
+		part_count = mp_decode_array(&key);
+	}
+	struct iterator *it = index_create_iterator(pk, key != NULL ?
+						    ITER_GT : ITER_ALL,
+						    key, part_count);
+	if (it == NULL)
+		return -1;
+	int count = 0;
+	int rc = 0;
+	struct tuple *tuple;
+	while (count < MEMTX_DEFRAG_BATCH &&
+	       (rc = iterator_next(it, &tuple)) == 0 && tuple != NULL) {
+		if (tuple_ref(tuple) != 0) {
+			/* Too many references, skip it. */
+			diag_clear(diag_get());
+			continue;
+		}
+		defrag->batch[count++] = tuple;
+	}
+	iterator_delete(it);
+
+	/* Remember where to continue from. */
+	if (rc == 0 && count == MEMTX_DEFRAG_BATCH) {
+		struct region *region = &fiber()->gc;
+		size_t used = region_used(region);
+		uint32_t key_size;
+		const char *last = tuple_extract_key(defrag->batch[count - 1],
+						     pk->def->key_def,
+						     &key_size);
+		if (last == NULL) {
+			rc = -1;
+		} else if (key_size > defrag->key_capacity) {
+			char *buf = realloc(defrag->key, key_size);
+			if (buf == NULL) {
+				diag_set(OutOfMemory, key_size,
+					 "realloc", "defrag key");
+				rc = -1;
+			} else {
+				defrag->key = buf;
+				defrag->key_capacity = key_size;
+			}
+		}
+		if (rc == 0) {
+			memcpy(defrag->key, last, key_size);
+			defrag->key_size = key_size;
+		}
+		region_truncate(region, used);
+	} else if (rc == 0) {
+		/* The space is over, continue with the next one. */
+		defrag->space_id++;
+		defrag->key_size = 0;
+	}
+
+	for (int i = 0; i < count; i++) {
+		tuple = defrag->batch[i];
+		/*
+		 * Tuples referenced by anyone but the space and
+		 * us (iterators, Lua, change sets) can't be freed,
+		 * nor can versions known to the transaction manager.
+		 */
+		if (rc == 0 && tuple->refs == 2 &&
+		    !memtx_tx_tuple_is_dirty(tuple) &&
+		    memtx_defrag_tuple_is_sparse(defrag, tuple))
+			rc = memtx_defrag_relocate(space, tuple);
+		tuple_unref(tuple);
+	}
+	return rc;
+}
+
+/**
+ * Relocating a tuple is unsafe if it may be referenced without
+ * incrementing its reference counter: by a transaction waiting
+ * for WAL or by a checkpoint read view.
+ */
+static bool
+memtx_defrag_is_possible(struct memtx_engine *memtx)
+{
+	return memtx->defrag_threshold > 0 && memtx->state == MEMTX_OK &&
+	       memtx->checkpoint == NULL && memtx->txn_count == 0;
+}
+
+static int
+memtx_defrag_f(va_list ap)
+{
+	struct memtx_engine *memtx = va_arg(ap, struct memtx_engine *);
+	struct memtx_defrag defrag;
+	memset(&defrag, 0, sizeof(defrag));
+	defrag.memtx = memtx;
+	defrag.space_id = UINT32_MAX;
+
+	while (memtx->defrag_fiber != NULL) {
+		double delay = MEMTX_DEFRAG_CHECK_INTERVAL;
+		if (!memtx_defrag_is_possible(memtx)) {
+			/* Wait for the threshold to be set. */
+			if (memtx->defrag_threshold == 0)
+				delay = TIMEOUT_INFINITY;
+			/* Start over, sizes may have changed. */
+			defrag.space_id = UINT32_MAX;
+		} else if (defrag.space_id == UINT32_MAX) {
+			if (memtx_defrag_begin_pass(&defrag) != 0)
+				diag_log();
+			else if (defrag.has_sparse)
+				delay = 0;
+		} else if (memtx_defrag_step(&defrag) != 0) {
+			say_error("memtx defragmentation failed");
+			diag_log();
+			defrag.space_id = UINT32_MAX;
+		} else {
+			delay = MEMTX_DEFRAG_STEP_DELAY;
+		}
+		fiber_cond_wait_timeout(&memtx->defrag_cond, delay);
+	}
+	free(defrag.classes);
+	free(defrag.key);
+	return 0;
+}
+
+/* }}} Defragmentation */
+
 static const struct engine_vtab memtx_engine_vtab = {
 	/* .shutdown = */ memtx_engine_shutdown,
 	/* .create_space = */ memtx_engine_create_space,
@@ -924,9 +2402,11 @@ static const struct engine_vtab memtx_engine_vtab = {
 struct memtx_engine *
 memtx_engine_new(const char *snap_dirname, bool force_recovery,
 		 uint64_t tuple_arena_max_size, uint32_t objsize_min,
-		 float alloc_factor)
+		 float alloc_factor, enum tuple_arena_pages pages,
+		 int numa_node)
 {
-	memtx_tuple_init(tuple_arena_max_size, objsize_min, alloc_factor);
+	memtx_tuple_init(tuple_arena_max_size, objsize_min, alloc_factor,
+			 pages, numa_node);
 
 	struct memtx_engine *memtx = calloc(1, sizeof(*memtx));
 	if (memtx == NULL) {
@@ -946,6 +2426,32 @@ memtx_engine_new(const char *snap_dirname, bool force_recovery,
 
 	memtx->state = MEMTX_INITIALIZED;
 	memtx->force_recovery = force_recovery;
+	memtx->snap_part_count = 1;
+	memtx->snap_delta_max = 0;
+	memtx->snap_delta_count = 0;
+	memtx->changes_tracked = false;
+
+	if (memtx_compress_init() != 0) {
+		xdir_destroy(&memtx->snap_dir);
+		free(memtx);
+		return NULL;
+	}
+	if (memtx_tx_manager_init(memtx) != 0) {
+		memtx_compress_free();
+		xdir_destroy(&memtx->snap_dir);
+		free(memtx);
+		return NULL;
+	}
+	memtx->defrag_fiber = fiber_new("memtx.defrag", memtx_defrag_f);
+	if (memtx->defrag_fiber == NULL) {
+		memtx_tx_manager_free();
+		memtx_compress_free();
+		xdir_destroy(&memtx->snap_dir);
+		free(memtx);
+		return NULL;
+	}
+	fiber_cond_create(&memtx->defrag_cond);
+	fiber_start(memtx->defrag_fiber, memtx);
 
 	memtx->base.vtab = &memtx_engine_vtab;
 	memtx->base.name = "memtx";
@@ -958,6 +2464,27 @@ memtx_engine_set_snap_io_rate_limit(struct memtx_engine *memtx, double limit)
 	memtx->snap_io_rate_limit = limit * 1024 * 1024;
 }
 
+void
+memtx_engine_set_snap_part_count(struct memtx_engine *memtx,
+				 uint32_t part_count)
+{
+	assert(part_count >= 1 && part_count <= MEMTX_SNAP_PARTS_MAX);
+	memtx->snap_part_count = part_count;
+}
+
+void
+memtx_engine_set_snap_delta_max(struct memtx_engine *memtx, uint32_t delta_max)
+{
+	memtx->snap_delta_max = delta_max;
+	/*
+	 * Changes made while tracking was off are unknown, so
+	 * once enabled, tracking starts after the next full
+	 * snapshot.
+	 */
+	if (delta_max == 0)
+		memtx->changes_tracked = false;
+}
+
 void
 memtx_engine_set_max_tuple_size(struct memtx_engine *memtx, size_t max_size)
 {
@@ -965,6 +2492,15 @@ memtx_engine_set_max_tuple_size(struct memtx_engine *memtx, size_t max_size)
 	memtx_max_tuple_size = max_size;
 }
 
+void
+memtx_engine_set_defrag_threshold(struct memtx_engine *memtx,
+				  double threshold)
+{
+	assert(threshold >= 0 && threshold <= 1);
+	memtx->defrag_threshold = threshold;
+	fiber_cond_signal(&memtx->defrag_cond);
+}
+
 /**
  * Initialize arena for indexes.
  * The arena is used for memtx_index_extent_alloc
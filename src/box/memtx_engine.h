@@ -36,7 +36,9 @@
 #include <small/mempool.h>
 
 #include "engine.h"
+#include "fiber_cond.h"
 #include "xlog.h"
+#include "tuple.h"
 
 #if defined(__cplusplus)
 extern "C" {
@@ -89,8 +91,48 @@ struct memtx_engine {
 	struct xdir snap_dir;
 	/** Limit disk usage of checkpointing (bytes per second). */
 	uint64_t snap_io_rate_limit;
+	/**
+	 * Number of files a snapshot is split into. Each part
+	 * is written and read by a separate thread.
+	 */
+	uint32_t snap_part_count;
+	/**
+	 * Max number of incremental snapshots taken in a row
+	 * before the next full one. 0 disables incremental
+	 * snapshots.
+	 */
+	uint32_t snap_delta_max;
+	/**
+	 * Number of incremental snapshots taken since the last
+	 * full one.
+	 */
+	uint32_t snap_delta_count;
+	/**
+	 * Set if every change of a memtx space made since the
+	 * last checkpoint was started is stored in the change set
+	 * of the space, so the next checkpoint may be incremental.
+	 * Reset on changes of system spaces, which can't be
+	 * replayed by an incremental snapshot, and on errors.
+	 */
+	bool changes_tracked;
 	/** Skip invalid snapshot records if this flag is set. */
 	bool force_recovery;
+	/**
+	 * Size classes of the tuple allocator filled less than
+	 * this ratio are defragmented in background by moving
+	 * their tuples to new memory. 0 disables defragmentation.
+	 */
+	double defrag_threshold;
+	/** Background fiber defragmenting tuple memory. */
+	struct fiber *defrag_fiber;
+	/** Signaled to wake up the defragmentation fiber. */
+	struct fiber_cond defrag_cond;
+	/**
+	 * Number of memtx transactions in progress. Tuples of
+	 * such transactions may be not referenced, so they must
+	 * not be moved by defragmentation.
+	 */
+	uint32_t txn_count;
 	/** Memory pool for tree index iterator. */
 	struct mempool tree_iterator_pool;
 	/** Memory pool for rtree index iterator. */
@@ -99,12 +141,21 @@ struct memtx_engine {
 	struct mempool hash_iterator_pool;
 	/** Memory pool for bitset index iterator. */
 	struct mempool bitset_iterator_pool;
+	/** Memory pool for column index iterator. */
+	struct mempool column_iterator_pool;
 };
 
+/**
+ * Create memtx engine.
+ * @param pages Kind of pages to back tuples and indexes with.
+ * @param numa_node NUMA node to allocate tuples and indexes on
+ *        or -1 to use the default memory policy.
+ */
 struct memtx_engine *
 memtx_engine_new(const char *snap_dirname, bool force_recovery,
 		 uint64_t tuple_arena_max_size,
-		 uint32_t objsize_min, float alloc_factor);
+		 uint32_t objsize_min, float alloc_factor,
+		 enum tuple_arena_pages pages, int numa_node);
 
 int
 memtx_engine_recover_snapshot(struct memtx_engine *memtx,
@@ -113,9 +164,26 @@ memtx_engine_recover_snapshot(struct memtx_engine *memtx,
 void
 memtx_engine_set_snap_io_rate_limit(struct memtx_engine *memtx, double limit);
 
+void
+memtx_engine_set_snap_part_count(struct memtx_engine *memtx,
+				 uint32_t part_count);
+
+void
+memtx_engine_set_snap_delta_max(struct memtx_engine *memtx,
+				uint32_t delta_max);
+
 void
 memtx_engine_set_max_tuple_size(struct memtx_engine *memtx, size_t max_size);
 
+void
+memtx_engine_set_defrag_threshold(struct memtx_engine *memtx,
+				  double threshold);
+
+enum {
+	/** Max number of files a snapshot can be split into. */
+	MEMTX_SNAP_PARTS_MAX = 64,
+};
+
 enum {
 	MEMTX_EXTENT_SIZE = 16 * 1024,
 	MEMTX_SLAB_SIZE = 4 * 1024 * 1024
@@ -157,12 +225,14 @@ memtx_index_extent_reserve(int num);
 static inline struct memtx_engine *
 memtx_engine_new_xc(const char *snap_dirname, bool force_recovery,
 		    uint64_t tuple_arena_max_size,
-		    uint32_t objsize_min, float alloc_factor)
+		    uint32_t objsize_min, float alloc_factor,
+		    enum tuple_arena_pages pages, int numa_node)
 {
 	struct memtx_engine *memtx;
 	memtx = memtx_engine_new(snap_dirname, force_recovery,
 				 tuple_arena_max_size,
-				 objsize_min, alloc_factor);
+				 objsize_min, alloc_factor,
+				 pages, numa_node);
 	if (memtx == NULL)
 		diag_raise();
 	return memtx;
@@ -35,6 +35,8 @@
 #include "tuple_compare.h"
 #include "tuple_hash.h"
 #include "memtx_engine.h"
+#include "memtx_tuple.h"
+#include "memtx_tx.h"
 #include "space.h"
 #include "schema.h" /* space_cache_find() */
 #include "errinj.h"
@@ -90,9 +92,13 @@ hash_iterator_ge(struct iterator *ptr, struct tuple **ret)
 {
 	assert(ptr->free == hash_iterator_free);
 	struct hash_iterator *it = (struct hash_iterator *) ptr;
-	struct tuple **res = light_index_iterator_get_and_next(it->hash_table,
-							       &it->iterator);
-	*ret = res != NULL ? *res : NULL;
+	struct tuple **res;
+	*ret = NULL;
+	/* Skip versions invisible to the current transaction. */
+	while (*ret == NULL &&
+	       (res = light_index_iterator_get_and_next(it->hash_table,
+							&it->iterator)) != NULL)
+		*ret = memtx_tx_tuple_clarify(*res, ptr->index_id);
 	return 0;
 }
 
@@ -104,11 +110,11 @@ hash_iterator_gt(struct iterator *ptr, struct tuple **ret)
 	struct hash_iterator *it = (struct hash_iterator *) ptr;
 	struct tuple **res = light_index_iterator_get_and_next(it->hash_table,
 							       &it->iterator);
-	if (res != NULL)
-		res = light_index_iterator_get_and_next(it->hash_table,
-							&it->iterator);
-	*ret = res != NULL ? *res : NULL;
-	return 0;
+	if (res == NULL) {
+		*ret = NULL;
+		return 0;
+	}
+	return hash_iterator_ge(ptr, ret);
 }
 
 static int
@@ -122,7 +128,12 @@ static int
 hash_iterator_eq(struct iterator *it, struct tuple **ret)
 {
 	it->next = hash_iterator_eq_next;
-	return hash_iterator_ge(it, ret);
+	struct hash_iterator *hash_it = (struct hash_iterator *) it;
+	struct tuple **res = light_index_iterator_get_and_next(
+		hash_it->hash_table, &hash_it->iterator);
+	/* Only one version of a key is stored in the index. */
+	*ret = res != NULL ? memtx_tx_tuple_clarify(*res, it->index_id) : NULL;
+	return 0;
 }
 
 /* }}} */
@@ -167,7 +178,8 @@ memtx_hash_index_random(struct index *base, uint32_t rnd, struct tuple **result)
 		rnd++;
 		rnd %= (hash_table->table_size);
 	}
-	*result = light_index_get(hash_table, rnd);
+	*result = memtx_tx_tuple_clarify(light_index_get(hash_table, rnd),
+					 base->def->iid);
 	return 0;
 }
 
@@ -193,8 +205,11 @@ memtx_hash_index_get(struct index *base, const char *key,
 	*result = NULL;
 	uint32_t h = key_hash(key, base->def->key_def);
 	uint32_t k = light_index_find_key(index->hash_table, h, key);
-	if (k != light_index_end)
-		*result = light_index_get(index->hash_table, k);
+	if (k != light_index_end) {
+		struct tuple *tuple = light_index_get(index->hash_table, k);
+		*result = memtx_tx_tuple_clarify(tuple, base->def->iid);
+	}
+	memtx_tx_track_read(base, *result);
 	return 0;
 }
 
@@ -305,6 +320,7 @@ memtx_hash_index_create_iterator(struct index *base, enum iterator_type type,
 		mempool_free(&memtx->hash_iterator_pool, it);
 		return NULL;
 	}
+	memtx_tx_track_read(base, NULL);
 	return (struct iterator *)it;
 }
 
@@ -312,6 +328,9 @@ struct hash_snapshot_iterator {
 	struct snapshot_iterator base;
 	struct light_index_core *hash_table;
 	struct light_index_iterator iterator;
+	struct memtx_tuple_reader reader;
+	/** Replaces versions not committed yet with older ones. */
+	struct memtx_tx_snapshot_cleaner cleaner;
 };
 
 /**
@@ -326,6 +345,8 @@ hash_snapshot_iterator_free(struct snapshot_iterator *iterator)
 	struct hash_snapshot_iterator *it =
 		(struct hash_snapshot_iterator *) iterator;
 	light_index_iterator_destroy(it->hash_table, &it->iterator);
+	memtx_tuple_reader_destroy(&it->reader);
+	memtx_tx_snapshot_cleaner_destroy(&it->cleaner);
 	free(iterator);
 }
 
@@ -340,11 +361,20 @@ hash_snapshot_iterator_next(struct snapshot_iterator *iterator, uint32_t *size)
 	assert(iterator->free == hash_snapshot_iterator_free);
 	struct hash_snapshot_iterator *it =
 		(struct hash_snapshot_iterator *) iterator;
-	struct tuple **res = light_index_iterator_get_and_next(it->hash_table,
-							       &it->iterator);
-	if (res == NULL)
-		return NULL;
-	return tuple_data_range(*res, size);
+	struct tuple *tuple = NULL;
+	while (tuple == NULL) {
+		struct tuple **res = light_index_iterator_get_and_next(
+			it->hash_table, &it->iterator);
+		if (res == NULL)
+			return NULL;
+		tuple = memtx_tx_snapshot_clarify(&it->cleaner, *res);
+	}
+	const char *data = memtx_tuple_read(&it->reader, tuple, size);
+	if (data == NULL) {
+		diag_log();
+		panic("failed to read tuple");
+	}
+	return data;
 }
 
 /**
@@ -363,12 +393,17 @@ memtx_hash_index_create_snapshot_iterator(struct index *base)
 			 "memtx_hash_index", "iterator");
 		return NULL;
 	}
+	if (memtx_tx_snapshot_cleaner_create(&it->cleaner, base) != 0) {
+		free(it);
+		return NULL;
+	}
 
 	it->base.next = hash_snapshot_iterator_next;
 	it->base.free = hash_snapshot_iterator_free;
 	it->hash_table = index->hash_table;
 	light_index_iterator_begin(it->hash_table, &it->iterator);
 	light_index_iterator_freeze(it->hash_table, &it->iterator);
+	memtx_tuple_reader_create(&it->reader);
 	return (struct snapshot_iterator *) it;
 }
 
@@ -382,6 +417,7 @@ static const struct index_vtab memtx_hash_index_vtab = {
 	/* .max = */ generic_index_max,
 	/* .random = */ memtx_hash_index_random,
 	/* .count = */ memtx_hash_index_count,
+	/* .aggregate = */ generic_index_aggregate,
 	/* .get = */ memtx_hash_index_get,
 	/* .replace = */ memtx_hash_index_replace,
 	/* .create_iterator = */ memtx_hash_index_create_iterator,
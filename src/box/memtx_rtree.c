@@ -40,6 +40,7 @@
 #include "tuple.h"
 #include "space.h"
 #include "memtx_engine.h"
+#include "memtx_tx.h"
 
 /* {{{ Utilities. *************************************************/
 
@@ -138,7 +139,12 @@ static int
 index_rtree_iterator_next(struct iterator *i, struct tuple **ret)
 {
 	struct index_rtree_iterator *itr = (struct index_rtree_iterator *)i;
-	*ret = (struct tuple *)rtree_iterator_next(&itr->impl);
+	struct tuple *tuple;
+	*ret = NULL;
+	/* Skip versions invisible to the current transaction. */
+	while (*ret == NULL &&
+	       (tuple = rtree_iterator_next(&itr->impl)) != NULL)
+		*ret = memtx_tx_tuple_clarify(tuple, i->index_id);
 	return 0;
 }
 
@@ -190,9 +196,14 @@ memtx_rtree_index_get(struct index *base, const char *key,
 		unreachable();
 
 	*result = NULL;
-	if (rtree_search(&index->tree, &rect, SOP_OVERLAPS, &iterator))
-		*result = (struct tuple *)rtree_iterator_next(&iterator);
+	if (rtree_search(&index->tree, &rect, SOP_OVERLAPS, &iterator)) {
+		struct tuple *tuple;
+		while (*result == NULL &&
+		       (tuple = rtree_iterator_next(&iterator)) != NULL)
+			*result = memtx_tx_tuple_clarify(tuple, base->def->iid);
+	}
 	rtree_iterator_destroy(&iterator);
+	memtx_tx_track_read(base, *result);
 	return 0;
 }
 
@@ -282,6 +293,7 @@ memtx_rtree_index_create_iterator(struct index *base,  enum iterator_type type,
 	it->base.free = index_rtree_iterator_free;
 	rtree_iterator_init(&it->impl);
 	rtree_search(&index->tree, &rect, op, &it->impl);
+	memtx_tx_track_read(base, NULL);
 	return (struct iterator *)it;
 }
 
@@ -302,6 +314,7 @@ static const struct index_vtab memtx_rtree_index_vtab = {
 	/* .max = */ generic_index_max,
 	/* .random = */ generic_index_random,
 	/* .count = */ memtx_rtree_index_count,
+	/* .aggregate = */ generic_index_aggregate,
 	/* .get = */ memtx_rtree_index_get,
 	/* .replace = */ memtx_rtree_index_replace,
 	/* .create_iterator = */ memtx_rtree_index_create_iterator,
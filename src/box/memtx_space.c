@@ -29,6 +29,7 @@
  * SUCH DAMAGE.
  */
 #include "memtx_space.h"
+#include "memtx_engine.h"
 #include "space.h"
 #include "iproto_constants.h"
 #include "txn.h"
@@ -39,13 +40,39 @@
 #include "memtx_tree.h"
 #include "memtx_rtree.h"
 #include "memtx_bitset.h"
+#include "memtx_column.h"
 #include "memtx_tuple.h"
+#include "memtx_compress.h"
+#include "memtx_tx.h"
 #include "column_mask.h"
 #include "sequence.h"
+#include "schema.h"
+#include "tuple_hash.h"
+
+/*
+ * Set of changes of a space, keyed by the primary key
+ * definition of the space.
+ */
+#define mh_name _memtx_change
+#define mh_key_t struct tuple *
+#define mh_node_t struct memtx_change
+#define mh_arg_t struct key_def *
+#define mh_hash(a, arg) tuple_hash((a)->tuple, arg)
+#define mh_hash_key(a, arg) tuple_hash(a, arg)
+#define mh_cmp(a, b, arg) (tuple_compare((a)->tuple, (b)->tuple, arg) != 0)
+#define mh_cmp_key(a, b, arg) (tuple_compare(a, (b)->tuple, arg) != 0)
+#define MH_SOURCE 1
+#include <salad/mhash.h>
 
 static void
 memtx_space_destroy(struct space *space)
 {
+	struct memtx_space *memtx_space = (struct memtx_space *)space;
+	memtx_tx_on_space_delete(space);
+	if (memtx_space->changes != NULL)
+		memtx_change_set_delete(memtx_space->changes);
+	if (memtx_space->compressor != NULL)
+		memtx_compressor_unref(memtx_space->compressor);
 	free(space);
 }
 
@@ -64,12 +91,77 @@ memtx_space_update_bsize(struct space *space,
 			 const struct tuple *new_tuple)
 {
 	struct memtx_space *memtx_space = (struct memtx_space *)space;
-	ssize_t old_bsize = old_tuple ? box_tuple_bsize(old_tuple) : 0;
-	ssize_t new_bsize = new_tuple ? box_tuple_bsize(new_tuple) : 0;
+	/* Count the size of compressed tuples as stored. */
+	ssize_t old_bsize = old_tuple ? old_tuple->bsize : 0;
+	ssize_t new_bsize = new_tuple ? new_tuple->bsize : 0;
 	assert((ssize_t)memtx_space->bsize + new_bsize - old_bsize >= 0);
 	memtx_space->bsize += new_bsize - old_bsize;
 }
 
+void
+memtx_space_track_change(struct space *space, struct tuple *old_tuple,
+			 struct tuple *new_tuple)
+{
+	struct memtx_engine *memtx = (struct memtx_engine *)space->engine;
+	struct memtx_space *memtx_space = (struct memtx_space *)space;
+	if (!memtx->changes_tracked || space_is_temporary(space) ||
+	    (old_tuple == NULL && new_tuple == NULL))
+		return;
+	if (space_is_system(space) && space_id(space) != BOX_SEQUENCE_DATA_ID) {
+		/*
+		 * An incremental snapshot can't replay schema
+		 * changes, so fall back on a full snapshot.
+		 */
+		memtx->changes_tracked = false;
+		return;
+	}
+	struct key_def *key_def = space->index[0]->def->key_def;
+	if (memtx_space->changes == NULL) {
+		memtx_space->changes = mh_memtx_change_new();
+		if (memtx_space->changes == NULL)
+			goto fail;
+	}
+	struct memtx_change change;
+	change.tuple = new_tuple != NULL ? new_tuple : old_tuple;
+	change.is_deleted = (new_tuple == NULL);
+	struct memtx_change replaced;
+	struct memtx_change *p_replaced = &replaced;
+	if (mh_memtx_change_put(memtx_space->changes, &change, &p_replaced,
+				key_def) == mh_end(memtx_space->changes))
+		goto fail;
+	tuple_ref(change.tuple);
+	if (p_replaced != NULL)
+		tuple_unref(replaced.tuple);
+	return;
+fail:
+	/* A statement must not fail because of this. */
+	say_warn("failed to track a change of space '%s', "
+		 "the next snapshot will be full", space_name(space));
+	memtx->changes_tracked = false;
+}
+
+int
+memtx_change_set_foreach(struct mh_memtx_change_t *changes,
+			 memtx_change_f func, void *arg)
+{
+	mh_int_t i;
+	mh_foreach(changes, i) {
+		int rc = func(mh_memtx_change_node(changes, i), arg);
+		if (rc != 0)
+			return rc;
+	}
+	return 0;
+}
+
+void
+memtx_change_set_delete(struct mh_memtx_change_t *changes)
+{
+	mh_int_t i;
+	mh_foreach(changes, i)
+		tuple_unref(mh_memtx_change_node(changes, i)->tuple);
+	mh_memtx_change_delete(changes);
+}
+
 /**
  * A version of space_replace for a space which has
  * no indexes (is not yet fully built).
@@ -290,6 +382,19 @@ rollback:
 	return -1;
 }
 
+/** Create a tuple of a space, compressing it if necessary. */
+static inline struct tuple *
+memtx_space_tuple_new(struct space *space, const char *data, const char *end)
+{
+	struct memtx_space *memtx_space = (struct memtx_space *)space;
+	if (memtx_space->compressor != NULL) {
+		return memtx_tuple_new_compressed(space->format, data, end,
+						  memtx_space->compressor,
+						  space_id(space));
+	}
+	return memtx_tuple_new(space->format, data, end);
+}
+
 static inline enum dup_replace_mode
 dup_replace_mode(uint32_t op)
 {
@@ -316,24 +421,60 @@ memtx_space_apply_initial_join_row(struct space *space, struct request *request)
 	return txn_commit_stmt(txn, request);
 }
 
+bool
+memtx_space_is_mvcc(struct space *space)
+{
+	struct memtx_space *memtx_space = (struct memtx_space *)space;
+	return memtx_tx_manager_use_mvcc_engine &&
+	       !memtx_space->is_ephemeral && !space_is_system(space) &&
+	       memtx_space->replace == memtx_space_replace_all_keys;
+}
+
+/**
+ * Apply a change of a statement to the indexes of a space.
+ * In a transaction managed by the memtx transaction manager,
+ * the change is added to the history of tuples instead.
+ */
+static int
+memtx_space_replace_stmt(struct space *space, struct txn *txn,
+			 struct txn_stmt *stmt, enum dup_replace_mode mode)
+{
+	struct memtx_space *memtx_space = (struct memtx_space *)space;
+	struct tuple *old_tuple;
+	if (txn->engine_tx != NULL && memtx_space_is_mvcc(space)) {
+		if (memtx_index_extent_reserve(stmt->new_tuple != NULL ?
+					       RESERVE_EXTENTS_BEFORE_REPLACE :
+					       RESERVE_EXTENTS_BEFORE_DELETE) != 0)
+			return -1;
+		if (memtx_tx_history_add_stmt(txn->engine_tx, stmt,
+					      stmt->old_tuple, stmt->new_tuple,
+					      mode, &old_tuple) != 0)
+			return -1;
+		stmt->old_tuple = old_tuple;
+		return 0;
+	}
+	if (memtx_space->replace(space, stmt->old_tuple, stmt->new_tuple,
+				 mode, &old_tuple) != 0)
+		return -1;
+	stmt->old_tuple = old_tuple;
+	stmt->engine_savepoint = stmt;
+	memtx_space_track_change(space, stmt->old_tuple, stmt->new_tuple);
+	return 0;
+}
+
 static int
 memtx_space_execute_replace(struct space *space, struct txn *txn,
 			    struct request *request, struct tuple **result)
 {
-	struct memtx_space *memtx_space = (struct memtx_space *)space;
 	struct txn_stmt *stmt = txn_current_stmt(txn);
 	enum dup_replace_mode mode = dup_replace_mode(request->type);
-	stmt->new_tuple = memtx_tuple_new(space->format, request->tuple,
-					  request->tuple_end);
+	stmt->new_tuple = memtx_space_tuple_new(space, request->tuple,
+						request->tuple_end);
 	if (stmt->new_tuple == NULL)
 		return -1;
 	tuple_ref(stmt->new_tuple);
-	struct tuple *old_tuple;
-	if (memtx_space->replace(space, stmt->old_tuple, stmt->new_tuple,
-				 mode, &old_tuple) != 0)
+	if (memtx_space_replace_stmt(space, txn, stmt, mode) != 0)
 		return -1;
-	stmt->old_tuple = old_tuple;
-	stmt->engine_savepoint = stmt;
 	/** The new tuple is referenced by the primary key. */
 	*result = stmt->new_tuple;
 	return 0;
@@ -343,7 +484,6 @@ static int
 memtx_space_execute_delete(struct space *space, struct txn *txn,
 			   struct request *request, struct tuple **result)
 {
-	struct memtx_space *memtx_space = (struct memtx_space *)space;
 	struct txn_stmt *stmt = txn_current_stmt(txn);
 	/* Try to find the tuple by unique key. */
 	struct index *pk = index_find_unique(space, request->index_id);
@@ -355,13 +495,10 @@ memtx_space_execute_delete(struct space *space, struct txn *txn,
 		return -1;
 	if (index_get(pk, key, part_count, &stmt->old_tuple) != 0)
 		return -1;
-	struct tuple *old_tuple = NULL;
 	if (stmt->old_tuple != NULL &&
-	    memtx_space->replace(space, stmt->old_tuple, stmt->new_tuple,
-				 DUP_REPLACE_OR_INSERT, &old_tuple) != 0)
+	    memtx_space_replace_stmt(space, txn, stmt,
+				     DUP_REPLACE_OR_INSERT) != 0)
 		return -1;
-	stmt->old_tuple = old_tuple;
-	stmt->engine_savepoint = stmt;
 	*result = stmt->old_tuple;
 	return 0;
 }
@@ -370,7 +507,6 @@ static int
 memtx_space_execute_update(struct space *space, struct txn *txn,
 			   struct request *request, struct tuple **result)
 {
-	struct memtx_space *memtx_space = (struct memtx_space *)space;
 	struct txn_stmt *stmt = txn_current_stmt(txn);
 	/* Try to find the tuple by unique key. */
 	struct index *pk = index_find_unique(space, request->index_id);
@@ -399,18 +535,13 @@ memtx_space_execute_update(struct space *space, struct txn *txn,
 	if (new_data == NULL)
 		return -1;
 
-	stmt->new_tuple = memtx_tuple_new(space->format, new_data,
-					  new_data + new_size);
+	stmt->new_tuple = memtx_space_tuple_new(space, new_data,
+						new_data + new_size);
 	if (stmt->new_tuple == NULL)
 		return -1;
 	tuple_ref(stmt->new_tuple);
-	struct tuple *old_tuple = NULL;
-	if (stmt->old_tuple != NULL &&
-	    memtx_space->replace(space, stmt->old_tuple, stmt->new_tuple,
-				 DUP_REPLACE, &old_tuple) != 0)
+	if (memtx_space_replace_stmt(space, txn, stmt, DUP_REPLACE) != 0)
 		return -1;
-	stmt->old_tuple = old_tuple;
-	stmt->engine_savepoint = stmt;
 	*result = stmt->new_tuple;
 	return 0;
 }
@@ -419,7 +550,6 @@ static int
 memtx_space_execute_upsert(struct space *space, struct txn *txn,
 			   struct request *request)
 {
-	struct memtx_space *memtx_space = (struct memtx_space *)space;
 	struct txn_stmt *stmt = txn_current_stmt(txn);
 	/*
 	 * Check all tuple fields: we should produce an error on
@@ -468,9 +598,8 @@ memtx_space_execute_upsert(struct space *space, struct txn *txn,
 				       request->index_base)) {
 			return -1;
 		}
-		stmt->new_tuple = memtx_tuple_new(space->format,
-						  request->tuple,
-						  request->tuple_end);
+		stmt->new_tuple = memtx_space_tuple_new(space, request->tuple,
+							request->tuple_end);
 		if (stmt->new_tuple == NULL)
 			return -1;
 		tuple_ref(stmt->new_tuple);
@@ -495,8 +624,8 @@ memtx_space_execute_upsert(struct space *space, struct txn *txn,
 		if (new_data == NULL)
 			return -1;
 
-		stmt->new_tuple = memtx_tuple_new(space->format, new_data,
-						  new_data + new_size);
+		stmt->new_tuple = memtx_space_tuple_new(space, new_data,
+							new_data + new_size);
 		if (stmt->new_tuple == NULL)
 			return -1;
 		tuple_ref(stmt->new_tuple);
@@ -521,13 +650,10 @@ memtx_space_execute_upsert(struct space *space, struct txn *txn,
 	 * we checked this case explicitly and skipped the upsert
 	 * above.
 	 */
-	struct tuple *old_tuple = NULL;
 	if (stmt->new_tuple != NULL &&
-	    memtx_space->replace(space, stmt->old_tuple, stmt->new_tuple,
-				 DUP_REPLACE_OR_INSERT, &old_tuple) != 0)
+	    memtx_space_replace_stmt(space, txn, stmt,
+				     DUP_REPLACE_OR_INSERT) != 0)
 		return -1;
-	stmt->old_tuple = old_tuple;
-	stmt->engine_savepoint = stmt;
 	/* Return nothing: UPSERT does not return data. */
 	return 0;
 }
@@ -670,6 +796,32 @@ memtx_space_check_index_def(struct space *space, struct index_def *index_def)
 		}
 		/* no furter checks of parts needed */
 		return 0;
+	case COLUMN:
+		if (index_def->iid == 0) {
+			diag_set(ClientError, ER_MODIFY_INDEX,
+				 index_def->name, space_name(space),
+				 "primary key can not be COLUMN");
+			return -1;
+		}
+		if (index_def->opts.is_unique) {
+			diag_set(ClientError, ER_MODIFY_INDEX,
+				 index_def->name, space_name(space),
+				 "COLUMN index can not be unique");
+			return -1;
+		}
+		for (uint32_t i = 0; i < index_def->key_def->part_count; i++) {
+			enum field_type type =
+				index_def->key_def->parts[i].type;
+			if (type != FIELD_TYPE_UNSIGNED &&
+			    type != FIELD_TYPE_INTEGER) {
+				diag_set(ClientError, ER_MODIFY_INDEX,
+					 index_def->name, space_name(space),
+					 "COLUMN index field type must be "
+					 "UNSIGNED or INTEGER");
+				return -1;
+			}
+		}
+		return 0;
 	default:
 		diag_set(ClientError, ER_INDEX_TYPE,
 			 index_def->name, space_name(space));
@@ -743,6 +895,8 @@ memtx_space_create_index(struct space *space, struct index_def *index_def)
 		return (struct index *)memtx_rtree_index_new(memtx, index_def);
 	case BITSET:
 		return (struct index *)memtx_bitset_index_new(memtx, index_def);
+	case COLUMN:
+		return (struct index *)memtx_column_index_new(memtx, index_def);
 	default:
 		unreachable();
 		return NULL;
@@ -836,6 +990,8 @@ memtx_init_system_space(struct space *space)
 static void
 memtx_init_ephemeral_space(struct space *space)
 {
+	struct memtx_space *memtx_space = (struct memtx_space *)space;
+	memtx_space->is_ephemeral = true;
 	memtx_space_do_add_primary_key(space, MEMTX_OK);
 }
 
@@ -876,10 +1032,29 @@ memtx_space_build_secondary_key(struct space *old_space,
 	 * added to the index (insufficient number of fields,
 	 * etc., the build is aborted.
 	 */
+	/*
+	 * Fields that follow the last indexed one are stored
+	 * compressed, so they can't be indexed without
+	 * recreating compressed tuples.
+	 */
+	uint32_t field_count = 0;
+	const struct key_def *key_def = new_index->def->key_def;
+	for (uint32_t i = 0; i < key_def->part_count; i++)
+		field_count = MAX(field_count, key_def->parts[i].fieldno + 1);
+
 	/* Build the new index. */
 	int rc;
 	struct tuple *tuple;
 	while ((rc = iterator_next(it, &tuple)) == 0 && tuple != NULL) {
+		if (tuple->is_compressed &&
+		    field_count > tuple_format(tuple)->index_field_count) {
+			diag_set(ClientError, ER_ALTER_SPACE,
+				 space_name(new_space),
+				 "can not index compressed fields "
+				 "of a non-empty space");
+			rc = -1;
+			break;
+		}
 		/*
 		 * Check that the tuple is OK according to the
 		 * new format.
@@ -908,6 +1083,8 @@ memtx_space_prepare_truncate(struct space *old_space,
 {
 	struct memtx_space *old_memtx_space = (struct memtx_space *)old_space;
 	struct memtx_space *new_memtx_space = (struct memtx_space *)new_space;
+	if (memtx_tx_on_space_ddl(old_space) != 0)
+		return -1;
 	new_memtx_space->replace = old_memtx_space->replace;
 	return 0;
 }
@@ -955,6 +1132,8 @@ memtx_space_prepare_alter(struct space *old_space, struct space *new_space)
 {
 	struct memtx_space *old_memtx_space = (struct memtx_space *)old_space;
 	struct memtx_space *new_memtx_space = (struct memtx_space *)new_space;
+	if (memtx_tx_on_space_ddl(old_space) != 0)
+		return -1;
 	new_memtx_space->replace = old_memtx_space->replace;
 	bool is_empty = old_space->index_count == 0 ||
 			index_size(old_space->index[0]) == 0;
@@ -973,6 +1152,13 @@ memtx_space_commit_alter(struct space *old_space, struct space *new_space)
 		memtx_space_prune(old_space);
 	else
 		new_memtx_space->bsize = old_memtx_space->bsize;
+
+	/* Keep using the dictionary trained for the old space. */
+	if (new_memtx_space->compressor != NULL &&
+	    old_memtx_space->compressor != NULL) {
+		SWAP(new_memtx_space->compressor,
+		     old_memtx_space->compressor);
+	}
 }
 
 /* }}} DDL */
@@ -1049,5 +1235,17 @@ memtx_space_new(struct memtx_engine *memtx,
 
 	memtx_space->bsize = 0;
 	memtx_space->replace = memtx_space_replace_no_keys;
+	memtx_space->changes = NULL;
+	memtx_space->compressor = NULL;
+	rlist_create(&memtx_space->tx_stories);
+	rlist_create(&memtx_space->tx_readers);
+	memtx_space->is_ephemeral = false;
+	if (def->opts.compression != SPACE_COMPRESSION_NONE) {
+		memtx_space->compressor = memtx_compressor_new();
+		if (memtx_space->compressor == NULL) {
+			space_delete((struct space *)memtx_space);
+			return NULL;
+		}
+	}
 	return (struct space *)memtx_space;
 }
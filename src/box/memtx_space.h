@@ -37,6 +37,22 @@ extern "C" {
 #endif /* defined(__cplusplus) */
 
 struct memtx_engine;
+struct memtx_compressor;
+
+struct mh_memtx_change_t;
+
+/**
+ * The last change of a tuple made since the last checkpoint,
+ * written by the next incremental checkpoint.
+ */
+struct memtx_change {
+	/**
+	 * The new tuple, or the deleted tuple if @is_deleted
+	 * is set. Referenced by the change.
+	 */
+	struct tuple *tuple;
+	bool is_deleted;
+};
 
 struct memtx_space {
 	struct space base;
@@ -48,8 +64,38 @@ struct memtx_space {
 	 */
 	int (*replace)(struct space *, struct tuple *, struct tuple *,
 		       enum dup_replace_mode, struct tuple **);
+	/**
+	 * Changes made since the last checkpoint, or NULL if
+	 * there are none, see memtx_engine::changes_tracked.
+	 */
+	struct mh_memtx_change_t *changes;
+	/**
+	 * Compressor of tuples or NULL if the space isn't
+	 * compressed, see space_opts::compression.
+	 */
+	struct memtx_compressor *compressor;
+	/**
+	 * Stories of tuples of the space kept by the memtx
+	 * transaction manager, see memtx_tx.h.
+	 */
+	struct rlist tx_stories;
+	/**
+	 * Transactions that scanned the space or looked up
+	 * a missing key, see memtx_tx.h.
+	 */
+	struct rlist tx_readers;
+	/** Set if the space is ephemeral. */
+	bool is_ephemeral;
 };
 
+/**
+ * Check if changes of a space are versioned by the memtx
+ * transaction manager. System and ephemeral spaces are
+ * changed in place, as well as spaces being recovered.
+ */
+bool
+memtx_space_is_mvcc(struct space *space);
+
 /**
  * Change binary size of a space subtracting old tuple's size and
  * adding new tuple's size. Used also for rollback by swaping old
@@ -64,6 +110,31 @@ memtx_space_update_bsize(struct space *space,
 			 const struct tuple *old_tuple,
 			 const struct tuple *new_tuple);
 
+/**
+ * Remember a change of a space for the next incremental
+ * checkpoint. Used also for rollback by swapping old and
+ * new tuple.
+ */
+void
+memtx_space_track_change(struct space *space, struct tuple *old_tuple,
+			 struct tuple *new_tuple);
+
+typedef int
+(*memtx_change_f)(const struct memtx_change *change, void *arg);
+
+/**
+ * Call @a func for each change of a set, see memtx_space::changes,
+ * until it returns non-zero. Doesn't modify the set, so may be
+ * used by a thread other than tx.
+ */
+int
+memtx_change_set_foreach(struct mh_memtx_change_t *changes,
+			 memtx_change_f func, void *arg);
+
+/** Delete a set of changes and unreference its tuples. */
+void
+memtx_change_set_delete(struct mh_memtx_change_t *changes);
+
 int
 memtx_space_replace_no_keys(struct space *, struct tuple *, struct tuple *,
 			    enum dup_replace_mode, struct tuple **);
@@ -30,6 +30,8 @@
  */
 #include "memtx_tree.h"
 #include "memtx_engine.h"
+#include "memtx_tuple.h"
+#include "memtx_tx.h"
 #include "space.h"
 #include "schema.h" /* space_cache_find() */
 #include "errinj.h"
@@ -88,7 +90,7 @@ tree_iterator_dummie(struct iterator *iterator, struct tuple **ret)
 }
 
 static int
-tree_iterator_next(struct iterator *iterator, struct tuple **ret)
+tree_iterator_next_base(struct iterator *iterator, struct tuple **ret)
 {
 	struct tuple **res;
 	struct tree_iterator *it = tree_iterator(iterator);
@@ -114,7 +116,7 @@ tree_iterator_next(struct iterator *iterator, struct tuple **ret)
 }
 
 static int
-tree_iterator_prev(struct iterator *iterator, struct tuple **ret)
+tree_iterator_prev_base(struct iterator *iterator, struct tuple **ret)
 {
 	struct tree_iterator *it = tree_iterator(iterator);
 	assert(it->current_tuple != NULL);
@@ -138,7 +140,7 @@ tree_iterator_prev(struct iterator *iterator, struct tuple **ret)
 }
 
 static int
-tree_iterator_next_equal(struct iterator *iterator, struct tuple **ret)
+tree_iterator_next_equal_base(struct iterator *iterator, struct tuple **ret)
 {
 	struct tree_iterator *it = tree_iterator(iterator);
 	assert(it->current_tuple != NULL);
@@ -167,7 +169,7 @@ tree_iterator_next_equal(struct iterator *iterator, struct tuple **ret)
 }
 
 static int
-tree_iterator_prev_equal(struct iterator *iterator, struct tuple **ret)
+tree_iterator_prev_equal_base(struct iterator *iterator, struct tuple **ret)
 {
 	struct tree_iterator *it = tree_iterator(iterator);
 	assert(it->current_tuple != NULL);
@@ -194,6 +196,32 @@ tree_iterator_prev_equal(struct iterator *iterator, struct tuple **ret)
 	return 0;
 }
 
+/**
+ * Wrap an iterator method so that it skips tuple versions
+ * invisible to the current transaction. The iterator still
+ * positions itself by the tuple stored in the tree.
+ */
+#define WRAP_ITERATOR_METHOD(name)						\
+static int									\
+name(struct iterator *iterator, struct tuple **ret)				\
+{										\
+	uint32_t iid = tree_iterator(iterator)->index_def->iid;			\
+	do {									\
+		int rc = name##_base(iterator, ret);				\
+		if (rc != 0 || *ret == NULL)					\
+			return rc;						\
+		*ret = memtx_tx_tuple_clarify(*ret, iid);			\
+	} while (*ret == NULL);							\
+	return 0;								\
+}
+
+WRAP_ITERATOR_METHOD(tree_iterator_next)
+WRAP_ITERATOR_METHOD(tree_iterator_prev)
+WRAP_ITERATOR_METHOD(tree_iterator_next_equal)
+WRAP_ITERATOR_METHOD(tree_iterator_prev_equal)
+
+#undef WRAP_ITERATOR_METHOD
+
 static void
 tree_iterator_set_next_method(struct tree_iterator *it)
 {
@@ -272,9 +300,13 @@ tree_iterator_start(struct iterator *iterator, struct tuple **ret)
 						&it->tree_iterator);
 	if (!res)
 		return 0;
-	*ret = it->current_tuple = *res;
+	it->current_tuple = *res;
 	tuple_ref(it->current_tuple);
 	tree_iterator_set_next_method(it);
+	*ret = memtx_tx_tuple_clarify(*res, it->index_def->iid);
+	/* Skip versions invisible to the current transaction. */
+	if (*ret == NULL)
+		return iterator->next(iterator, ret);
 	return 0;
 }
 
@@ -327,7 +359,8 @@ memtx_tree_index_random(struct index *base, uint32_t rnd, struct tuple **result)
 {
 	struct memtx_tree_index *index = (struct memtx_tree_index *)base;
 	struct tuple **res = memtx_tree_random(&index->tree, rnd);
-	*result = res != NULL ? *res : NULL;
+	*result = res != NULL ?
+		  memtx_tx_tuple_clarify(*res, base->def->iid) : NULL;
 	return 0;
 }
 
@@ -351,7 +384,9 @@ memtx_tree_index_get(struct index *base, const char *key,
 	key_data.key = key;
 	key_data.part_count = part_count;
 	struct tuple **res = memtx_tree_find(&index->tree, &key_data);
-	*result = res != NULL ? *res : NULL;
+	*result = res != NULL ?
+		  memtx_tx_tuple_clarify(*res, base->def->iid) : NULL;
+	memtx_tx_track_read(base, *result);
 	return 0;
 }
 
@@ -437,6 +472,7 @@ memtx_tree_index_create_iterator(struct index *base, enum iterator_type type,
 	it->tree = &index->tree;
 	it->tree_iterator = memtx_tree_invalid_iterator();
 	it->current_tuple = NULL;
+	memtx_tx_track_read(base, NULL);
 	return (struct iterator *)it;
 }
 
@@ -519,6 +555,9 @@ struct tree_snapshot_iterator {
 	struct snapshot_iterator base;
 	struct memtx_tree *tree;
 	struct memtx_tree_iterator tree_iterator;
+	struct memtx_tuple_reader reader;
+	/** Replaces versions not committed yet with older ones. */
+	struct memtx_tx_snapshot_cleaner cleaner;
 };
 
 static void
@@ -529,6 +568,8 @@ tree_snapshot_iterator_free(struct snapshot_iterator *iterator)
 		(struct tree_snapshot_iterator *)iterator;
 	struct memtx_tree *tree = (struct memtx_tree *)it->tree;
 	memtx_tree_iterator_destroy(tree, &it->tree_iterator);
+	memtx_tuple_reader_destroy(&it->reader);
+	memtx_tx_snapshot_cleaner_destroy(&it->cleaner);
 	free(iterator);
 }
 
@@ -538,12 +579,21 @@ tree_snapshot_iterator_next(struct snapshot_iterator *iterator, uint32_t *size)
 	assert(iterator->free == tree_snapshot_iterator_free);
 	struct tree_snapshot_iterator *it =
 		(struct tree_snapshot_iterator *)iterator;
-	struct tuple **res = memtx_tree_iterator_get_elem(it->tree,
-						&it->tree_iterator);
-	if (res == NULL)
-		return NULL;
-	memtx_tree_iterator_next(it->tree, &it->tree_iterator);
-	return tuple_data_range(*res, size);
+	struct tuple *tuple = NULL;
+	while (tuple == NULL) {
+		struct tuple **res = memtx_tree_iterator_get_elem(it->tree,
+							&it->tree_iterator);
+		if (res == NULL)
+			return NULL;
+		memtx_tree_iterator_next(it->tree, &it->tree_iterator);
+		tuple = memtx_tx_snapshot_clarify(&it->cleaner, *res);
+	}
+	const char *data = memtx_tuple_read(&it->reader, tuple, size);
+	if (data == NULL) {
+		diag_log();
+		panic("failed to read tuple");
+	}
+	return data;
 }
 
 /**
@@ -562,11 +612,16 @@ memtx_tree_index_create_snapshot_iterator(struct index *base)
 			 "memtx_tree_index", "create_snapshot_iterator");
 		return NULL;
 	}
+	if (memtx_tx_snapshot_cleaner_create(&it->cleaner, base) != 0) {
+		free(it);
+		return NULL;
+	}
 
 	it->base.free = tree_snapshot_iterator_free;
 	it->base.next = tree_snapshot_iterator_next;
 	it->tree = &index->tree;
 	it->tree_iterator = memtx_tree_iterator_first(&index->tree);
+	memtx_tuple_reader_create(&it->reader);
 	memtx_tree_iterator_freeze(&index->tree, &it->tree_iterator);
 	return (struct snapshot_iterator *) it;
 }
@@ -581,6 +636,7 @@ static const struct index_vtab memtx_tree_index_vtab = {
 	/* .max = */ generic_index_max,
 	/* .random = */ memtx_tree_index_random,
 	/* .count = */ memtx_tree_index_count,
+	/* .aggregate = */ generic_index_aggregate,
 	/* .get = */ memtx_tree_index_get,
 	/* .replace = */ memtx_tree_index_replace,
 	/* .create_iterator = */ memtx_tree_index_create_iterator,
@@ -36,6 +36,8 @@
 #include "small/quota.h"
 #include "fiber.h"
 #include "box.h"
+#include "schema.h"
+#include "index.h"
 
 struct memtx_tuple {
 	/*
@@ -60,6 +62,10 @@ struct small_alloc memtx_alloc; /* used box box.slab.info() */
 /* The maximal allowed tuple size, box.cfg.memtx_max_tuple_size */
 size_t memtx_max_tuple_size = 1 * 1024 * 1024; /* set dynamically */
 uint32_t snapshot_version;
+/** Kind of pages backing memtx_arena, see tuple_arena_create(). */
+enum tuple_arena_pages memtx_arena_pages;
+/** NUMA node memtx_arena is bound to or -1. */
+int memtx_arena_numa_node;
 
 enum {
 	/** Lowest allowed slab_alloc_minimal */
@@ -69,15 +75,18 @@ enum {
 
 void
 memtx_tuple_init(uint64_t tuple_arena_max_size, uint32_t objsize_min,
-		 float alloc_factor)
+		 float alloc_factor, enum tuple_arena_pages pages,
+		 int numa_node)
 {
 	/* Apply lowest allowed objsize bounds */
 	if (objsize_min < OBJSIZE_MIN)
 		objsize_min = OBJSIZE_MIN;
 	/** Preallocate entire quota. */
 	quota_init(&memtx_quota, tuple_arena_max_size);
-	tuple_arena_create(&memtx_arena, &memtx_quota, tuple_arena_max_size,
-			   SLAB_SIZE, "memtx");
+	memtx_arena_pages = tuple_arena_create(&memtx_arena, &memtx_quota,
+					       tuple_arena_max_size, SLAB_SIZE,
+					       pages, numa_node, "memtx");
+	memtx_arena_numa_node = numa_node;
 	slab_cache_create(&memtx_slab_cache, &memtx_arena);
 	small_alloc_create(&memtx_alloc, &memtx_slab_cache,
 			   objsize_min, alloc_factor);
@@ -88,17 +97,83 @@ memtx_tuple_free(void)
 {
 }
 
+static const char *
+memtx_tuple_decompress(struct tuple_format *format, const struct tuple *tuple,
+		       uint32_t *p_size);
+
 struct tuple_format_vtab memtx_tuple_format_vtab = {
 	memtx_tuple_delete,
+	memtx_tuple_decompress,
 };
 
-struct tuple *
-memtx_tuple_new(struct tuple_format *format, const char *data, const char *end)
+/**
+ * Header of a compressed tuple. Stored between struct tuple
+ * and the tuple meta, so it is covered by tuple::data_offset.
+ * The data of a compressed tuple consists of the uncompressed
+ * prefix holding the MessagePack array header and all indexed
+ * fields followed by the rest of the fields compressed with
+ * zstd, see memtx_tuple_new_compressed().
+ */
+struct PACKED memtx_zheader {
+	/** Dictionary the tuple was compressed with or NULL. */
+	struct memtx_zdict *dict;
+	/**
+	 * Decompressed MessagePack or NULL. Once materialized,
+	 * it is kept until the tuple is only referenced by its
+	 * space, see memtx_tuple_release_bodies().
+	 */
+	char *body;
+	/** Position of the tuple in memtx_body_cache. */
+	uint32_t cache_slot;
+	/** Size of the decompressed MessagePack. */
+	uint32_t body_size;
+	/** Size of the uncompressed prefix. */
+	uint32_t prefix_size;
+	/** Id of the space the tuple was created for. */
+	uint32_t space_id;
+};
+
+enum {
+	/** Don't compress tuples with shorter non-indexed data. */
+	MEMTX_TUPLE_COMPRESS_MIN = 64,
+	/** Number of tuples checked by one body release step. */
+	MEMTX_BODY_RELEASE_BATCH = 1024,
+};
+
+/** Compressed tuples with materialized bodies. */
+static struct tuple **memtx_body_cache;
+static uint32_t memtx_body_cache_size;
+static uint32_t memtx_body_cache_capacity;
+
+static inline struct memtx_zheader *
+memtx_tuple_zheader(const struct tuple *tuple)
+{
+	assert(tuple->is_compressed);
+	return (struct memtx_zheader *)((char *)tuple + sizeof(struct tuple));
+}
+
+/** Size of the memory chunk allocated for a tuple. */
+static inline size_t
+memtx_tuple_alloc_size(const struct tuple *tuple)
+{
+	return sizeof(struct memtx_tuple) - sizeof(struct tuple) +
+	       tuple_size(tuple);
+}
+
+/**
+ * Allocate a tuple and initialize its header.
+ * @param format Tuple format.
+ * @param header_size Size of an extra header stored between
+ *                    struct tuple and the tuple meta.
+ * @param data_size Size of the tuple data.
+ */
+static struct tuple *
+memtx_tuple_alloc(struct tuple_format *format, size_t header_size,
+		  size_t data_size)
 {
-	assert(mp_typeof(*data) == MP_ARRAY);
-	size_t tuple_len = end - data;
 	size_t meta_size = tuple_format_meta_size(format);
-	size_t total = sizeof(struct memtx_tuple) + meta_size + tuple_len;
+	size_t total = sizeof(struct memtx_tuple) + header_size + meta_size +
+		       data_size;
 
 	ERROR_INJECT(ERRINJ_TUPLE_ALLOC,
 		     do { diag_set(OutOfMemory, (unsigned) total,
@@ -129,8 +204,8 @@ memtx_tuple_new(struct tuple_format *format, const char *data, const char *end)
 	struct tuple *tuple = &memtx_tuple->base;
 	tuple->refs = 0;
 	memtx_tuple->version = snapshot_version;
-	assert(tuple_len <= UINT32_MAX); /* bsize is UINT32_MAX */
-	tuple->bsize = tuple_len;
+	assert(data_size <= UINT32_MAX); /* bsize is UINT32_MAX */
+	tuple->bsize = data_size;
 	tuple->format_id = tuple_format_id(format);
 	tuple_format_ref(format);
 	/*
@@ -138,7 +213,19 @@ memtx_tuple_new(struct tuple_format *format, const char *data, const char *end)
 	 * tuple base, not from memtx_tuple, because the struct
 	 * tuple is not the first field of the memtx_tuple.
 	 */
-	tuple->data_offset = sizeof(struct tuple) + meta_size;
+	tuple->data_offset = sizeof(struct tuple) + header_size + meta_size;
+	tuple->is_compressed = false;
+	return tuple;
+}
+
+struct tuple *
+memtx_tuple_new(struct tuple_format *format, const char *data, const char *end)
+{
+	assert(mp_typeof(*data) == MP_ARRAY);
+	size_t tuple_len = end - data;
+	struct tuple *tuple = memtx_tuple_alloc(format, 0, tuple_len);
+	if (tuple == NULL)
+		return NULL;
 	char *raw = (char *) tuple + tuple->data_offset;
 	uint32_t *field_map = (uint32_t *) raw;
 	memcpy(raw, data, tuple_len);
@@ -146,17 +233,239 @@ memtx_tuple_new(struct tuple_format *format, const char *data, const char *end)
 		memtx_tuple_delete(format, tuple);
 		return NULL;
 	}
-	say_debug("%s(%zu) = %p", __func__, tuple_len, memtx_tuple);
+	say_debug("%s(%zu) = %p", __func__, tuple_len, tuple);
+	return tuple;
+}
+
+struct tuple *
+memtx_tuple_new_compressed(struct tuple_format *format, const char *data,
+			   const char *end, struct memtx_compressor *compressor,
+			   uint32_t space_id)
+{
+	assert(mp_typeof(*data) == MP_ARRAY);
+	const char *prefix_end = data;
+	uint32_t field_count = mp_decode_array(&prefix_end);
+	field_count = MIN(field_count, format->index_field_count);
+	for (uint32_t i = 0; i < field_count; i++)
+		mp_next(&prefix_end);
+	size_t prefix_size = prefix_end - data;
+	size_t tail_size = end - prefix_end;
+	if (tail_size < MEMTX_TUPLE_COMPRESS_MIN)
+		return memtx_tuple_new(format, data, end);
+
+	struct region *region = &fiber()->gc;
+	size_t region_svp = region_used(region);
+	char *buf = (char *) region_alloc(region, tail_size);
+	if (buf == NULL) {
+		diag_set(OutOfMemory, tail_size, "region", "compressed tuple");
+		return NULL;
+	}
+	/* Store the tuple compressed only if it saves memory. */
+	struct memtx_zdict *dict;
+	ssize_t compressed_size = memtx_compressor_compress(compressor,
+			prefix_end, tail_size, buf,
+			tail_size - sizeof(struct memtx_zheader), &dict);
+	if (compressed_size < 0) {
+		region_truncate(region, region_svp);
+		return memtx_tuple_new(format, data, end);
+	}
+	struct tuple *tuple = memtx_tuple_alloc(format,
+				sizeof(struct memtx_zheader),
+				prefix_size + compressed_size);
+	if (tuple == NULL) {
+		if (dict != NULL)
+			memtx_zdict_unref(dict);
+		region_truncate(region, region_svp);
+		return NULL;
+	}
+	tuple->is_compressed = true;
+	struct memtx_zheader *zheader = memtx_tuple_zheader(tuple);
+	zheader->dict = dict;
+	zheader->body = NULL;
+	zheader->cache_slot = 0;
+	zheader->body_size = end - data;
+	zheader->prefix_size = prefix_size;
+	zheader->space_id = space_id;
+	char *raw = (char *) tuple + tuple->data_offset;
+	memcpy(raw, data, prefix_size);
+	memcpy(raw + prefix_size, buf, compressed_size);
+	region_truncate(region, region_svp);
+	/*
+	 * Validate the original data: non-indexed fields
+	 * may be typed, too. Offsets of indexed fields are
+	 * the same, because the prefix is stored as is.
+	 */
+	if (tuple_init_field_map(format, (uint32_t *) raw, data)) {
+		memtx_tuple_delete(format, tuple);
+		return NULL;
+	}
+	say_debug("%s(%zu) = %p", __func__, (size_t)(end - data), tuple);
 	return tuple;
 }
 
+struct tuple *
+memtx_tuple_dup(struct tuple *tuple)
+{
+	struct tuple_format *format = tuple_format(tuple);
+	size_t header_size = tuple->data_offset - sizeof(struct tuple) -
+			     tuple_format_meta_size(format);
+	struct tuple *res = memtx_tuple_alloc(format, header_size,
+					      tuple->bsize);
+	if (res == NULL)
+		return NULL;
+	assert(tuple_size(res) == tuple_size(tuple));
+	memcpy((char *) res + sizeof(struct tuple),
+	       (char *) tuple + sizeof(struct tuple),
+	       tuple_size(tuple) - sizeof(struct tuple));
+	if (tuple->is_compressed) {
+		res->is_compressed = true;
+		struct memtx_zheader *zheader = memtx_tuple_zheader(res);
+		/* The decompressed data is not copied. */
+		zheader->body = NULL;
+		if (zheader->dict != NULL)
+			memtx_zdict_ref(zheader->dict);
+	}
+	return res;
+}
+
+size_t
+memtx_tuple_size(struct tuple *tuple)
+{
+	return memtx_tuple_alloc_size(tuple);
+}
+
+/**
+ * Decompress a tuple to a buffer of zheader->body_size bytes.
+ */
+static int
+memtx_tuple_unpack(const struct tuple *tuple, ZSTD_DCtx *dctx, char *buf)
+{
+	struct memtx_zheader *zheader = memtx_tuple_zheader(tuple);
+	const char *data = tuple_key_data(tuple);
+	uint32_t prefix_size = zheader->prefix_size;
+	memcpy(buf, data, prefix_size);
+	return memtx_zdict_decompress(zheader->dict, dctx,
+				      data + prefix_size,
+				      tuple->bsize - prefix_size,
+				      buf + prefix_size,
+				      zheader->body_size - prefix_size);
+}
+
+static const char *
+memtx_tuple_decompress(struct tuple_format *format, const struct tuple *tuple,
+		       uint32_t *p_size)
+{
+	(void) format;
+	struct memtx_zheader *zheader = memtx_tuple_zheader(tuple);
+	*p_size = zheader->body_size;
+	if (zheader->body != NULL)
+		return zheader->body;
+	/*
+	 * Callers of tuple_data() don't expect it to fail,
+	 * so we have no choice but panic on error.
+	 */
+	if (memtx_body_cache_size == memtx_body_cache_capacity) {
+		uint32_t capacity = MAX(memtx_body_cache_capacity * 2, 1024);
+		struct tuple **cache = (struct tuple **)
+			realloc(memtx_body_cache, capacity * sizeof(*cache));
+		if (cache == NULL)
+			panic("failed to allocate tuple body cache");
+		memtx_body_cache = cache;
+		memtx_body_cache_capacity = capacity;
+	}
+	char *body = (char *) malloc(zheader->body_size);
+	if (body == NULL)
+		panic("failed to allocate %u bytes for tuple body",
+		      (unsigned) zheader->body_size);
+	if (memtx_tuple_unpack(tuple, NULL, body) != 0) {
+		diag_log();
+		panic("failed to decompress tuple");
+	}
+	zheader->body = body;
+	zheader->cache_slot = memtx_body_cache_size;
+	memtx_body_cache[memtx_body_cache_size++] = (struct tuple *) tuple;
+	return body;
+}
+
+/** Free the decompressed data of a tuple. */
+static void
+memtx_tuple_release_body(struct tuple *tuple)
+{
+	struct memtx_zheader *zheader = memtx_tuple_zheader(tuple);
+	assert(zheader->body != NULL);
+	assert(memtx_body_cache[zheader->cache_slot] == tuple);
+	struct tuple *last = memtx_body_cache[--memtx_body_cache_size];
+	memtx_body_cache[zheader->cache_slot] = last;
+	memtx_tuple_zheader(last)->cache_slot = zheader->cache_slot;
+	free(zheader->body);
+	zheader->body = NULL;
+}
+
+/**
+ * Check if the decompressed data of a tuple can be freed.
+ * It can if the tuple is referenced only by the primary key
+ * of its space: anyone who could store a pointer to the data
+ * would hold a reference to the tuple.
+ */
+static bool
+memtx_tuple_body_is_unused(struct tuple *tuple)
+{
+	if (tuple->refs != 1)
+		return false;
+	struct space *space = space_by_id(memtx_tuple_zheader(tuple)->space_id);
+	if (space == NULL)
+		return false;
+	struct index *pk = space_index(space, 0);
+	if (pk == NULL)
+		return false;
+	const char *key = tuple_extract_key(tuple, pk->def->key_def, NULL);
+	if (key == NULL) {
+		diag_clear(diag_get());
+		return false;
+	}
+	mp_decode_array(&key);
+	struct tuple *found;
+	if (index_get(pk, key, pk->def->key_def->part_count, &found) != 0) {
+		diag_clear(diag_get());
+		return false;
+	}
+	return found == tuple;
+}
+
+void
+memtx_tuple_release_bodies(void)
+{
+	struct region *region = &fiber()->gc;
+	uint32_t i = 0;
+	uint32_t checked = 0;
+	while (i < memtx_body_cache_size) {
+		size_t region_svp = region_used(region);
+		struct tuple *tuple = memtx_body_cache[i];
+		if (memtx_tuple_body_is_unused(tuple)) {
+			/* The last tuple takes the vacant slot. */
+			memtx_tuple_release_body(tuple);
+		} else {
+			i++;
+		}
+		region_truncate(region, region_svp);
+		if (++checked % MEMTX_BODY_RELEASE_BATCH == 0)
+			fiber_sleep(0);
+	}
+}
+
 void
 memtx_tuple_delete(struct tuple_format *format, struct tuple *tuple)
 {
 	say_debug("%s(%p)", __func__, tuple);
 	assert(tuple->refs == 0);
-	size_t total = sizeof(struct memtx_tuple) +
-		       tuple_format_meta_size(format) + tuple->bsize;
+	size_t total = memtx_tuple_alloc_size(tuple);
+	if (tuple->is_compressed) {
+		struct memtx_zheader *zheader = memtx_tuple_zheader(tuple);
+		if (zheader->body != NULL)
+			memtx_tuple_release_body(tuple);
+		if (zheader->dict != NULL)
+			memtx_zdict_unref(zheader->dict);
+	}
 	tuple_format_unref(format);
 	struct memtx_tuple *memtx_tuple =
 		container_of(tuple, struct memtx_tuple, base);
@@ -167,15 +476,62 @@ memtx_tuple_delete(struct tuple_format *format, struct tuple *tuple)
 		smfree_delayed(&memtx_alloc, memtx_tuple, total);
 }
 
+void
+memtx_tuple_reader_create(struct memtx_tuple_reader *reader)
+{
+	memset(reader, 0, sizeof(*reader));
+}
+
+void
+memtx_tuple_reader_destroy(struct memtx_tuple_reader *reader)
+{
+	ZSTD_freeDCtx(reader->dctx);
+	free(reader->buf);
+}
+
+const char *
+memtx_tuple_read(struct memtx_tuple_reader *reader, struct tuple *tuple,
+		 uint32_t *p_size)
+{
+	if (!tuple->is_compressed) {
+		*p_size = tuple->bsize;
+		return tuple_key_data(tuple);
+	}
+	struct memtx_zheader *zheader = memtx_tuple_zheader(tuple);
+	if (reader->dctx == NULL) {
+		reader->dctx = ZSTD_createDCtx();
+		if (reader->dctx == NULL) {
+			diag_set(OutOfMemory, 0, "ZSTD_createDCtx", "dctx");
+			return NULL;
+		}
+	}
+	if (reader->capacity < zheader->body_size) {
+		char *buf = (char *) realloc(reader->buf, zheader->body_size);
+		if (buf == NULL) {
+			diag_set(OutOfMemory, zheader->body_size,
+				 "realloc", "tuple body");
+			return NULL;
+		}
+		reader->buf = buf;
+		reader->capacity = zheader->body_size;
+	}
+	if (memtx_tuple_unpack(tuple, reader->dctx, reader->buf) != 0)
+		return NULL;
+	*p_size = zheader->body_size;
+	return reader->buf;
+}
+
 void
 memtx_tuple_begin_snapshot()
 {
 	snapshot_version++;
 	small_alloc_setopt(&memtx_alloc, SMALL_DELAYED_FREE_MODE, true);
+	memtx_zdict_delay_gc(true);
 }
 
 void
 memtx_tuple_end_snapshot()
 {
 	small_alloc_setopt(&memtx_alloc, SMALL_DELAYED_FREE_MODE, false);
+	memtx_zdict_delay_gc(false);
 }
@@ -34,6 +34,7 @@
 #include "diag.h"
 #include "tuple_format.h"
 #include "tuple.h"
+#include "memtx_compress.h"
 
 #if defined(__cplusplus)
 extern "C" {
@@ -41,13 +42,20 @@ extern "C" {
 
 /** Memtx tuple allocator, available to statistics.  */
 extern struct small_alloc memtx_alloc;
+/** Kind of pages backing memtx tuples and indexes. */
+extern enum tuple_arena_pages memtx_arena_pages;
+/** NUMA node memtx memory is bound to or -1. */
+extern int memtx_arena_numa_node;
 
 /**
  * Initialize memtx_tuple library
+ * @param pages Kind of pages to back memtx memory with.
+ * @param numa_node NUMA node to bind memtx memory to or -1.
  */
 void
 memtx_tuple_init(uint64_t tuple_arena_max_size, uint32_t objsize_min,
-		 float alloc_factor);
+		 float alloc_factor, enum tuple_arena_pages pages,
+		 int numa_node);
 
 /**
  * Cleanup memtx_tuple library
@@ -59,6 +67,32 @@ memtx_tuple_free(void);
 struct tuple *
 memtx_tuple_new(struct tuple_format *format, const char *data, const char *end);
 
+/**
+ * Create a compressed tuple. Fields following the last indexed
+ * one are compressed, unless it doesn't save memory, in which
+ * case an uncompressed tuple is created. @sa memtx_tuple_new().
+ * @param compressor Compressor of the space.
+ * @param space_id Id of the space the tuple is created for.
+ */
+struct tuple *
+memtx_tuple_new_compressed(struct tuple_format *format, const char *data,
+			   const char *end, struct memtx_compressor *compressor,
+			   uint32_t space_id);
+
+/**
+ * Create a copy of a tuple, compressed if the original tuple
+ * is compressed.
+ */
+struct tuple *
+memtx_tuple_dup(struct tuple *tuple);
+
+/**
+ * Free the decompressed data of compressed tuples that are
+ * referenced only by their spaces. May yield.
+ */
+void
+memtx_tuple_release_bodies(void);
+
 /**
  * Free the tuple of a memtx space.
  * @pre tuple->refs  == 0
@@ -66,12 +100,48 @@ memtx_tuple_new(struct tuple_format *format, const char *data, const char *end);
 void
 memtx_tuple_delete(struct tuple_format *format, struct tuple *tuple);
 
+/**
+ * Size of the memory chunk allocated for a memtx tuple,
+ * including the header.
+ */
+size_t
+memtx_tuple_size(struct tuple *tuple);
+
 /** Maximal allowed tuple size (box.cfg.memtx_max_tuple_size) */
 extern size_t memtx_max_tuple_size;
 
 /** tuple format vtab for memtx engine. */
 extern struct tuple_format_vtab memtx_tuple_format_vtab;
 
+/**
+ * Reader of tuple data for threads other than tx, which must
+ * not use tuple_data() on compressed tuples. Owns a buffer for
+ * decompressed data.
+ */
+struct memtx_tuple_reader {
+	/** Decompression context. */
+	ZSTD_DCtx *dctx;
+	/** Buffer for the last decompressed tuple. */
+	char *buf;
+	/** Size of @buf. */
+	size_t capacity;
+};
+
+void
+memtx_tuple_reader_create(struct memtx_tuple_reader *reader);
+
+void
+memtx_tuple_reader_destroy(struct memtx_tuple_reader *reader);
+
+/**
+ * Get the MessagePack of a tuple, decompressing it if necessary.
+ * The returned data is valid until the next call.
+ * @return Data of the tuple or NULL on error.
+ */
+const char *
+memtx_tuple_read(struct memtx_tuple_reader *reader, struct tuple *tuple,
+		 uint32_t *p_size);
+
 void
 memtx_tuple_begin_snapshot();
 
@@ -0,0 +1,1153 @@
+/*
+ * Copyright 2010-2016, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "memtx_tx.h"
+
+#include <small/mempool.h>
+#include <small/region.h>
+#include <small/rlist.h>
+
+#include "assoc.h"
+#include "fiber.h"
+#include "memtx_engine.h"
+#include "memtx_space.h"
+#include "schema.h"
+#include "space.h"
+#include "tuple_compare.h"
+
+bool memtx_tx_manager_use_mvcc_engine = false;
+size_t memtx_tx_story_count = 0;
+
+enum {
+	/**
+	 * Min number of stories checked by garbage collection
+	 * when a transaction ends.
+	 */
+	MEMTX_TX_GC_STEPS = 16,
+	/**
+	 * Number of index extents to reserve before removing
+	 * an old version from an index, see memtx_space.c.
+	 */
+	MEMTX_TX_RESERVE_EXTENTS = 8,
+};
+
+struct memtx_story;
+
+/** Position of a tuple version in the chain of an index. */
+struct memtx_story_link {
+	/** Next newer version with the same key or NULL. */
+	struct memtx_story *newer;
+	/** Next older version with the same key or NULL. */
+	struct memtx_story *older;
+};
+
+/** A statement executed by the transaction manager. */
+struct memtx_tx_stmt {
+	/** Transaction the statement belongs to. */
+	struct memtx_tx *tx;
+	struct txn_stmt *stmt;
+	/** Story of the inserted tuple or NULL. */
+	struct memtx_story *add_story;
+	/**
+	 * Story of the deleted tuple or NULL. May differ from
+	 * the old tuple of the statement if the statement
+	 * overwrites a tuple blindly and another transaction
+	 * overwrites the same tuple first.
+	 */
+	struct memtx_story *del_story;
+	/** Link in the list of statements deleting a story. */
+	struct memtx_tx_stmt *next_in_del_list;
+	/** Set for INSERT, which must fail on a duplicate. */
+	bool is_insert;
+};
+
+/** History of a tuple. */
+struct memtx_story {
+	struct tuple *tuple;
+	/** Space the tuple belongs to. */
+	struct space *space;
+	/**
+	 * Statement that inserted the tuple or NULL if the
+	 * statement has been committed.
+	 */
+	struct memtx_tx_stmt *add_stmt;
+	/**
+	 * PSN of the transaction that inserted the tuple or 0
+	 * if it isn't prepared yet or the tuple was inserted
+	 * before the story was created.
+	 */
+	int64_t add_psn;
+	/**
+	 * List of not yet committed statements deleting the
+	 * tuple, linked by memtx_tx_stmt::next_in_del_list.
+	 */
+	struct memtx_tx_stmt *del_stmt;
+	/**
+	 * PSN of the transaction that deleted the tuple or 0
+	 * if no deletion has been prepared yet.
+	 */
+	int64_t del_psn;
+	/** Transactions that read the tuple, see memtx_tx_read. */
+	struct rlist readers;
+	/** Link in memtx_space::tx_stories. */
+	struct rlist in_space;
+	/** Link in memtx_tx_manager::stories. */
+	struct rlist in_stories;
+	/** Number of elements in @link, max index id + 1. */
+	uint32_t link_count;
+	/** Chains of versions, indexed by index id. */
+	struct memtx_story_link link[0];
+};
+
+enum memtx_tx_state {
+	/** The transaction may go on. */
+	MEMTX_TX_READY,
+	/** The transaction can't commit. */
+	MEMTX_TX_ABORT,
+};
+
+struct memtx_tx {
+	struct txn *txn;
+	enum memtx_tx_state state;
+	/** PSN assigned on prepare or 0. */
+	int64_t psn;
+	/**
+	 * If the transaction is in a read view, the max PSN of
+	 * changes visible to it, otherwise INT64_MAX.
+	 */
+	int64_t rv_psn;
+	/** Number of statements that changed data. */
+	int write_count;
+	/** Reads tracked for the transaction, see memtx_tx_read. */
+	struct rlist read_set;
+	/** Link in memtx_tx_manager::read_views. */
+	struct rlist in_read_views;
+};
+
+/** A read tracked by the transaction manager. */
+struct memtx_tx_read {
+	struct memtx_tx *tx;
+	/**
+	 * Story of the tuple read or NULL if the transaction
+	 * looked up a missing key or scanned a space.
+	 */
+	struct memtx_story *story;
+	/** Link in memtx_story::readers or memtx_space::tx_readers. */
+	struct rlist in_readers;
+	/** Link in memtx_tx::read_set. */
+	struct rlist in_read_set;
+};
+
+struct memtx_tx_manager {
+	struct memtx_engine *memtx;
+	/** Last assigned PSN. */
+	int64_t psn;
+	/** Tuple -> its story. */
+	struct mh_i64ptr_t *history;
+	/** All stories, in the order of garbage collection. */
+	struct rlist stories;
+	/** Transactions in read views, ordered by rv_psn. */
+	struct rlist read_views;
+	/** Story allocators, indexed by memtx_story::link_count. */
+	struct mempool story_pool[BOX_INDEX_MAX + 1];
+	/** Allocator of memtx_tx_read. */
+	struct mempool read_pool;
+};
+
+static struct memtx_tx_manager txm;
+
+int
+memtx_tx_manager_init(struct memtx_engine *memtx)
+{
+	txm.memtx = memtx;
+	txm.psn = 0;
+	txm.history = mh_i64ptr_new();
+	if (txm.history == NULL) {
+		diag_set(OutOfMemory, sizeof(*txm.history),
+			 "mh_i64ptr_new", "memtx tx history");
+		return -1;
+	}
+	rlist_create(&txm.stories);
+	rlist_create(&txm.read_views);
+	mempool_create(&txm.read_pool, cord_slab_cache(),
+		       sizeof(struct memtx_tx_read));
+	return 0;
+}
+
+void
+memtx_tx_manager_free(void)
+{
+	for (uint32_t i = 0; i < lengthof(txm.story_pool); i++) {
+		if (mempool_is_initialized(&txm.story_pool[i]))
+			mempool_destroy(&txm.story_pool[i]);
+	}
+	mempool_destroy(&txm.read_pool);
+	mh_i64ptr_delete(txm.history);
+}
+
+/** Return the memtx transaction of the current fiber or NULL. */
+static inline struct memtx_tx *
+memtx_tx_current(void)
+{
+	struct txn *txn = in_txn();
+	if (txn == NULL || txn->engine != (struct engine *)txm.memtx)
+		return NULL;
+	return txn->engine_tx;
+}
+
+/* {{{ Visibility */
+
+/** Max PSN of changes visible to a transaction, NULL included. */
+static inline int64_t
+memtx_tx_rv_psn(struct memtx_tx *tx)
+{
+	return tx != NULL ? tx->rv_psn : INT64_MAX;
+}
+
+/** Check if a tuple version is inserted from a transaction's view. */
+static inline bool
+memtx_story_is_added(struct memtx_story *story, struct memtx_tx *tx)
+{
+	if (story->add_stmt != NULL && story->add_stmt->tx == tx)
+		return true;
+	if (story->add_psn == 0)
+		return story->add_stmt == NULL;
+	return story->add_psn <= memtx_tx_rv_psn(tx);
+}
+
+/** Check if a tuple version is deleted from a transaction's view. */
+static inline bool
+memtx_story_is_deleted(struct memtx_story *story, struct memtx_tx *tx)
+{
+	if (story->del_psn != 0 && story->del_psn <= memtx_tx_rv_psn(tx))
+		return true;
+	for (struct memtx_tx_stmt *stmt = story->del_stmt; stmt != NULL;
+	     stmt = stmt->next_in_del_list) {
+		if (stmt->tx == tx)
+			return true;
+	}
+	return false;
+}
+
+/** Check if a tuple version was inserted by an unprepared transaction. */
+static inline bool
+memtx_story_is_in_progress(struct memtx_story *story)
+{
+	return story->add_stmt != NULL && story->add_stmt->tx->psn == 0;
+}
+
+/**
+ * Walk down the chain of versions of an index starting from
+ * @a story and return the version visible to @a tx or NULL.
+ */
+static struct tuple *
+memtx_tx_story_clarify(struct memtx_story *story, struct memtx_tx *tx,
+		       uint32_t index_id)
+{
+	for (; story != NULL; story = story->link[index_id].older) {
+		assert(index_id < story->link_count);
+		if (memtx_story_is_added(story, tx)) {
+			if (memtx_story_is_deleted(story, tx))
+				return NULL;
+			return story->tuple;
+		}
+	}
+	return NULL;
+}
+
+/* }}} */
+
+/* {{{ Stories */
+
+/** Return the story of a tuple or NULL if it has none. */
+static struct memtx_story *
+memtx_tx_story_find(struct tuple *tuple)
+{
+	if (memtx_tx_story_count == 0)
+		return NULL;
+	mh_int_t k = mh_i64ptr_find(txm.history, (uintptr_t)tuple, NULL);
+	if (k == mh_end(txm.history))
+		return NULL;
+	return mh_i64ptr_node(txm.history, k)->val;
+}
+
+static struct memtx_story *
+memtx_tx_story_get(struct tuple *tuple)
+{
+	struct memtx_story *story = memtx_tx_story_find(tuple);
+	assert(story != NULL);
+	return story;
+}
+
+/**
+ * Create a story for a tuple stored in a space. The tuple is
+ * considered inserted long ago until told otherwise.
+ */
+static struct memtx_story *
+memtx_tx_story_new(struct space *space, struct tuple *tuple)
+{
+	assert(memtx_tx_story_find(tuple) == NULL);
+	uint32_t link_count = space->index_id_max + 1;
+	assert(link_count <= BOX_INDEX_MAX);
+	struct mempool *pool = &txm.story_pool[link_count];
+	if (!mempool_is_initialized(pool)) {
+		mempool_create(pool, cord_slab_cache(),
+			       sizeof(struct memtx_story) +
+			       link_count * sizeof(struct memtx_story_link));
+	}
+	struct memtx_story *story = mempool_alloc(pool);
+	if (story == NULL) {
+		diag_set(OutOfMemory, sizeof(*story),
+			 "mempool", "struct memtx_story");
+		return NULL;
+	}
+	struct mh_i64ptr_node_t node = { (uintptr_t)tuple, story };
+	if (mh_i64ptr_put(txm.history, &node, NULL,
+			  NULL) == mh_end(txm.history)) {
+		diag_set(OutOfMemory, sizeof(node),
+			 "mh_i64ptr_put", "memtx tx history");
+		mempool_free(pool, story);
+		return NULL;
+	}
+	struct memtx_space *memtx_space = (struct memtx_space *)space;
+	story->tuple = tuple;
+	story->space = space;
+	story->add_stmt = NULL;
+	story->add_psn = 0;
+	story->del_stmt = NULL;
+	story->del_psn = 0;
+	rlist_create(&story->readers);
+	rlist_add_tail_entry(&memtx_space->tx_stories, story, in_space);
+	rlist_add_tail_entry(&txm.stories, story, in_stories);
+	story->link_count = link_count;
+	memset(story->link, 0, link_count * sizeof(*story->link));
+	memtx_tx_story_count++;
+	return story;
+}
+
+static struct memtx_story *
+memtx_tx_story_get_or_new(struct space *space, struct tuple *tuple)
+{
+	struct memtx_story *story = memtx_tx_story_find(tuple);
+	if (story != NULL)
+		return story;
+	return memtx_tx_story_new(space, tuple);
+}
+
+static void
+memtx_tx_read_delete(struct memtx_tx_read *read)
+{
+	rlist_del_entry(read, in_readers);
+	rlist_del_entry(read, in_read_set);
+	mempool_free(&txm.read_pool, read);
+}
+
+/**
+ * Delete a story and forget its tuple. The story must be
+ * unlinked from chains and have no deleting statements.
+ */
+static void
+memtx_tx_story_delete(struct memtx_story *story)
+{
+	assert(story->del_stmt == NULL);
+	struct memtx_tx_read *read, *tmp;
+	rlist_foreach_entry_safe(read, &story->readers, in_readers, tmp)
+		memtx_tx_read_delete(read);
+	mh_int_t k = mh_i64ptr_find(txm.history, (uintptr_t)story->tuple,
+				    NULL);
+	assert(k != mh_end(txm.history));
+	mh_i64ptr_del(txm.history, k, NULL);
+	rlist_del_entry(story, in_space);
+	rlist_del_entry(story, in_stories);
+	assert(memtx_tx_story_count > 0);
+	memtx_tx_story_count--;
+	mempool_free(&txm.story_pool[story->link_count], story);
+}
+
+/**
+ * Replace a tuple stored in an index with another version
+ * with the same key or delete it if @a new_tuple is NULL.
+ * Replacing an element of a tree or a hash doesn't allocate
+ * memory, and memory for deletion is reserved in advance,
+ * so this function doesn't fail.
+ */
+static void
+memtx_tx_index_swap(struct index *index, struct tuple *old_tuple,
+		    struct tuple *new_tuple)
+{
+	struct tuple *replaced;
+	int rc;
+	if (new_tuple != NULL) {
+		rc = index_replace(index, NULL, new_tuple,
+				   DUP_REPLACE_OR_INSERT, &replaced);
+		assert(rc != 0 || replaced == old_tuple);
+	} else {
+		rc = index_replace(index, old_tuple, NULL,
+				   DUP_INSERT, &replaced);
+	}
+	if (rc != 0) {
+		diag_log();
+		unreachable();
+		panic("failed to replace a tuple version in index");
+	}
+}
+
+/**
+ * Remove a story from the chain of versions of an index.
+ * If the story is stored in the index, the next older
+ * version takes its place.
+ */
+static void
+memtx_tx_story_unlink(struct memtx_story *story, struct index *index)
+{
+	uint32_t iid = index->def->iid;
+	struct memtx_story_link *link = &story->link[iid];
+	if (link->newer == NULL) {
+		memtx_tx_index_swap(index, story->tuple, link->older != NULL ?
+				    link->older->tuple : NULL);
+	} else {
+		link->newer->link[iid].older = link->older;
+	}
+	if (link->older != NULL)
+		link->older->link[iid].newer = link->newer;
+	link->newer = NULL;
+	link->older = NULL;
+}
+
+/** Make a statement delete another story or none. */
+static void
+memtx_tx_stmt_set_del_story(struct memtx_tx_stmt *stmt,
+			    struct memtx_story *story)
+{
+	if (stmt->del_story != NULL) {
+		struct memtx_tx_stmt **pos = &stmt->del_story->del_stmt;
+		while (*pos != stmt)
+			pos = &(*pos)->next_in_del_list;
+		*pos = stmt->next_in_del_list;
+		stmt->next_in_del_list = NULL;
+	}
+	stmt->del_story = story;
+	if (story != NULL) {
+		stmt->next_in_del_list = story->del_stmt;
+		story->del_stmt = stmt;
+	}
+}
+
+/* }}} */
+
+/* {{{ Transactions */
+
+static inline void
+memtx_tx_abort(struct memtx_tx *tx)
+{
+	tx->state = MEMTX_TX_ABORT;
+}
+
+/**
+ * Send a transaction to the read view preceding the changes
+ * of a transaction with the given PSN. The transaction may go
+ * on reading, but can't commit any writes.
+ */
+static void
+memtx_tx_send_to_read_view(struct memtx_tx *tx, int64_t psn)
+{
+	if (tx->state != MEMTX_TX_READY || tx->rv_psn != INT64_MAX)
+		return;
+	tx->rv_psn = psn - 1;
+	rlist_add_tail_entry(&txm.read_views, tx, in_read_views);
+}
+
+/** Send transactions that read from a list to a read view. */
+static void
+memtx_tx_send_readers_to_read_view(struct rlist *readers,
+				   struct memtx_tx *writer)
+{
+	struct memtx_tx_read *read;
+	rlist_foreach_entry(read, readers, in_readers) {
+		if (read->tx != writer)
+			memtx_tx_send_to_read_view(read->tx, writer->psn);
+	}
+}
+
+/** PSN of the oldest read view or INT64_MAX if there are none. */
+static int64_t
+memtx_tx_oldest_rv_psn(void)
+{
+	if (rlist_empty(&txm.read_views))
+		return INT64_MAX;
+	return rlist_first_entry(&txm.read_views, struct memtx_tx,
+				 in_read_views)->rv_psn;
+}
+
+struct memtx_tx *
+memtx_tx_begin(struct txn *txn)
+{
+	struct memtx_tx *tx = region_alloc_object(&fiber()->gc,
+						  struct memtx_tx);
+	if (tx == NULL) {
+		diag_set(OutOfMemory, sizeof(*tx), "region", "struct memtx_tx");
+		return NULL;
+	}
+	tx->txn = txn;
+	tx->state = MEMTX_TX_READY;
+	tx->psn = 0;
+	tx->rv_psn = INT64_MAX;
+	tx->write_count = 0;
+	rlist_create(&tx->read_set);
+	rlist_create(&tx->in_read_views);
+	return tx;
+}
+
+/**
+ * Free a story if no transaction can see the difference.
+ * Return true if the story was freed.
+ */
+static bool
+memtx_tx_story_collect(struct memtx_story *story, int64_t oldest_rv_psn)
+{
+	if (story->add_stmt != NULL || story->del_stmt != NULL)
+		return false;
+	if (story->del_psn != 0) {
+		/* The tuple is deleted, remove it from indexes. */
+		if (story->del_psn > oldest_rv_psn)
+			return false;
+		if (memtx_index_extent_reserve(MEMTX_TX_RESERVE_EXTENTS) != 0) {
+			diag_clear(diag_get());
+			return false;
+		}
+		struct space *space = story->space;
+		for (uint32_t i = 0; i < space->index_count; i++)
+			memtx_tx_story_unlink(story, space->index[i]);
+		struct tuple *tuple = story->tuple;
+		memtx_tx_story_delete(story);
+		/* The reference that was held by the primary key. */
+		tuple_unref(tuple);
+		return true;
+	}
+	if (story->add_psn > oldest_rv_psn || !rlist_empty(&story->readers))
+		return false;
+	for (uint32_t i = 0; i < story->link_count; i++) {
+		if (story->link[i].newer != NULL ||
+		    story->link[i].older != NULL)
+			return false;
+	}
+	memtx_tx_story_delete(story);
+	return true;
+}
+
+/** Check a few stories and free those that aren't needed. */
+static void
+memtx_tx_gc(int steps)
+{
+	int64_t oldest_rv_psn = memtx_tx_oldest_rv_psn();
+	for (int i = 0; i < steps && !rlist_empty(&txm.stories); i++) {
+		struct memtx_story *story =
+			rlist_first_entry(&txm.stories, struct memtx_story,
+					  in_stories);
+		if (!memtx_tx_story_collect(story, oldest_rv_psn))
+			rlist_move_tail_entry(&txm.stories, story, in_stories);
+	}
+}
+
+static void
+memtx_tx_end(struct memtx_tx *tx, int gc_steps)
+{
+	struct memtx_tx_read *read, *tmp;
+	rlist_foreach_entry_safe(read, &tx->read_set, in_read_set, tmp)
+		memtx_tx_read_delete(read);
+	rlist_del_entry(tx, in_read_views);
+	memtx_tx_gc(gc_steps);
+}
+
+/**
+ * Move the story of a tuple inserted by a statement being
+ * prepared below the stories of transactions that are still
+ * in progress, so that prepared versions in a chain are
+ * ordered by PSN.
+ */
+static void
+memtx_tx_story_sink(struct memtx_story *story, struct index *index)
+{
+	uint32_t iid = index->def->iid;
+	struct memtx_story *newer = NULL;
+	struct memtx_story *older = story->link[iid].older;
+	while (older != NULL && memtx_story_is_in_progress(older)) {
+		newer = older;
+		older = older->link[iid].older;
+	}
+	if (newer == NULL)
+		return;
+	memtx_tx_story_unlink(story, index);
+	story->link[iid].newer = newer;
+	story->link[iid].older = older;
+	newer->link[iid].older = story;
+	if (older != NULL)
+		older->link[iid].newer = story;
+}
+
+/**
+ * Resolve conflicts of a prepared statement with statements
+ * of other transactions that inserted tuples with the same key
+ * and are still in progress.
+ */
+static void
+memtx_tx_story_resolve_conflicts(struct memtx_story *story,
+				 struct index *index)
+{
+	uint32_t iid = index->def->iid;
+	struct memtx_tx_stmt *stmt = story->add_stmt;
+	struct key_def *pk_def = story->space->index[0]->def->key_def;
+	for (struct memtx_story *newer = story->link[iid].newer;
+	     newer != NULL; newer = newer->link[iid].newer) {
+		struct memtx_tx_stmt *other = newer->add_stmt;
+		if (other == NULL || other->tx == stmt->tx)
+			continue;
+		if (iid == 0) {
+			if (other->is_insert) {
+				/* Duplicate key. */
+				memtx_tx_abort(other->tx);
+			} else if (other->del_story == stmt->del_story) {
+				/*
+				 * The other statement overwrites
+				 * the tuple blindly, so it overwrites
+				 * the new version now.
+				 */
+				memtx_tx_stmt_set_del_story(other, story);
+			}
+		} else if (index->def->opts.is_unique &&
+			   tuple_compare(newer->tuple, story->tuple,
+					 pk_def) != 0) {
+			/* Duplicate key in a unique secondary index. */
+			memtx_tx_abort(other->tx);
+		}
+	}
+}
+
+static void
+memtx_tx_prepare_stmt(struct memtx_tx_stmt *stmt)
+{
+	struct memtx_tx *tx = stmt->tx;
+	struct memtx_story *add = stmt->add_story;
+	struct memtx_story *del = stmt->del_story;
+	struct space *space = add != NULL ? add->space : del->space;
+	if (add != NULL) {
+		for (uint32_t i = 0; i < space->index_count; i++) {
+			memtx_tx_story_sink(add, space->index[i]);
+			memtx_tx_story_resolve_conflicts(add, space->index[i]);
+		}
+		add->add_psn = tx->psn;
+	} else {
+		/*
+		 * Statements that overwrite the deleted tuple
+		 * blindly turn into inserts.
+		 */
+		struct memtx_tx_stmt *other = del->del_stmt;
+		while (other != NULL) {
+			struct memtx_tx_stmt *next = other->next_in_del_list;
+			if (other->tx != tx && other->add_story != NULL)
+				memtx_tx_stmt_set_del_story(other, NULL);
+			other = next;
+		}
+	}
+	if (del != NULL) {
+		del->del_psn = tx->psn;
+		memtx_tx_send_readers_to_read_view(&del->readers, tx);
+	}
+	struct memtx_space *memtx_space = (struct memtx_space *)space;
+	memtx_tx_send_readers_to_read_view(&memtx_space->tx_readers, tx);
+
+	struct tuple *old_tuple = del != NULL ? del->tuple : NULL;
+	struct tuple *new_tuple = add != NULL ? add->tuple : NULL;
+	memtx_space_update_bsize(space, old_tuple, new_tuple);
+	memtx_space_track_change(space, old_tuple, new_tuple);
+}
+
+int
+memtx_tx_prepare(struct memtx_tx *tx)
+{
+	if (tx->state != MEMTX_TX_READY ||
+	    (tx->write_count > 0 && tx->rv_psn != INT64_MAX)) {
+		diag_set(ClientError, ER_TRANSACTION_CONFLICT);
+		return -1;
+	}
+	if (tx->write_count == 0)
+		return 0;
+	tx->psn = ++txm.psn;
+	struct txn_stmt *stmt;
+	stailq_foreach_entry(stmt, &tx->txn->stmts, next) {
+		if (memtx_tx_stmt_is_versioned(stmt))
+			memtx_tx_prepare_stmt(stmt->engine_savepoint);
+	}
+	return 0;
+}
+
+void
+memtx_tx_commit(struct memtx_tx *tx)
+{
+	struct txn_stmt *stmt;
+	stailq_foreach_entry(stmt, &tx->txn->stmts, next) {
+		if (!memtx_tx_stmt_is_versioned(stmt))
+			continue;
+		struct memtx_tx_stmt *mstmt = stmt->engine_savepoint;
+		if (mstmt->add_story != NULL)
+			mstmt->add_story->add_stmt = NULL;
+		memtx_tx_stmt_set_del_story(mstmt, NULL);
+	}
+	memtx_tx_end(tx, MEMTX_TX_GC_STEPS + 2 * tx->write_count);
+}
+
+void
+memtx_tx_rollback(struct memtx_tx *tx)
+{
+	memtx_tx_end(tx, MEMTX_TX_GC_STEPS);
+}
+
+/* }}} */
+
+/* {{{ Statements */
+
+int
+memtx_tx_history_add_stmt(struct memtx_tx *tx, struct txn_stmt *stmt,
+			  struct tuple *old_tuple, struct tuple *new_tuple,
+			  enum dup_replace_mode mode, struct tuple **result)
+{
+	assert(old_tuple != NULL || new_tuple != NULL);
+	if (tx->state != MEMTX_TX_READY || tx->rv_psn != INT64_MAX) {
+		diag_set(ClientError, ER_TRANSACTION_CONFLICT);
+		return -1;
+	}
+	struct space *space = stmt->space;
+	struct memtx_tx_stmt *mstmt = region_alloc_object(&fiber()->gc,
+							  struct memtx_tx_stmt);
+	if (mstmt == NULL) {
+		diag_set(OutOfMemory, sizeof(*mstmt),
+			 "region", "struct memtx_tx_stmt");
+		return -1;
+	}
+	mstmt->tx = tx;
+	mstmt->stmt = stmt;
+	mstmt->add_story = NULL;
+	mstmt->del_story = NULL;
+	mstmt->next_in_del_list = NULL;
+	mstmt->is_insert = old_tuple == NULL && mode == DUP_INSERT;
+
+	struct memtx_story *add = NULL;
+	struct memtx_story *del = NULL;
+	struct tuple *replaced[BOX_INDEX_MAX];
+	uint32_t i = 0;
+	if (new_tuple != NULL) {
+		add = memtx_tx_story_new(space, new_tuple);
+		if (add == NULL)
+			return -1;
+		/*
+		 * Put the new tuple on top of the versions with
+		 * the same key and check the versions visible to
+		 * the transaction for duplicates, as
+		 * memtx_space_replace_all_keys() does.
+		 */
+		for (; i < space->index_count; i++) {
+			struct index *index = space->index[i];
+			if (index_replace(index, NULL, new_tuple,
+					  DUP_REPLACE_OR_INSERT,
+					  &replaced[i]) != 0)
+				goto rollback;
+			struct tuple *visible = replaced[i];
+			struct memtx_story *story = visible == NULL ? NULL :
+				memtx_tx_story_find(visible);
+			if (story != NULL) {
+				visible = memtx_tx_story_clarify(story, tx,
+							index->def->iid);
+			}
+			uint32_t errcode = replace_check_dup(old_tuple, visible,
+							     i == 0 ? mode :
+							     DUP_INSERT);
+			if (errcode != 0) {
+				i++;
+				diag_set(ClientError, errcode,
+					 index->def->name, space_name(space));
+				goto rollback;
+			}
+			if (i == 0 && old_tuple == NULL)
+				old_tuple = visible;
+		}
+		for (i = 0; i < space->index_count; i++) {
+			if (replaced[i] != NULL &&
+			    memtx_tx_story_get_or_new(space,
+						      replaced[i]) == NULL) {
+				i = space->index_count;
+				goto rollback;
+			}
+		}
+	}
+	if (old_tuple != NULL) {
+		del = memtx_tx_story_get_or_new(space, old_tuple);
+		if (del == NULL) {
+			i = add != NULL ? space->index_count : 0;
+			goto rollback;
+		}
+	}
+	if (add != NULL) {
+		for (i = 0; i < space->index_count; i++) {
+			if (replaced[i] == NULL)
+				continue;
+			uint32_t iid = space->index[i]->def->iid;
+			struct memtx_story *older =
+				memtx_tx_story_get(replaced[i]);
+			assert(older->link[iid].newer == NULL);
+			add->link[iid].older = older;
+			older->link[iid].newer = add;
+		}
+		add->add_stmt = mstmt;
+		mstmt->add_story = add;
+	}
+	if (del != NULL) {
+		memtx_tx_stmt_set_del_story(mstmt, del);
+		/* Released on commit, like the new tuple on rollback. */
+		tuple_ref(old_tuple);
+	}
+	stmt->engine_savepoint = mstmt;
+	tx->write_count++;
+	*result = old_tuple;
+	return 0;
+rollback:
+	while (i-- > 0)
+		memtx_tx_index_swap(space->index[i], new_tuple, replaced[i]);
+	if (add != NULL)
+		memtx_tx_story_delete(add);
+	return -1;
+}
+
+void
+memtx_tx_history_rollback_stmt(struct txn_stmt *stmt)
+{
+	assert(memtx_tx_stmt_is_versioned(stmt));
+	struct memtx_tx_stmt *mstmt = stmt->engine_savepoint;
+	struct memtx_tx *tx = mstmt->tx;
+	struct memtx_story *add = mstmt->add_story;
+	struct memtx_story *del = mstmt->del_story;
+	struct space *space = add != NULL ? add->space :
+			      del != NULL ? del->space : NULL;
+	if (tx->psn != 0 && space != NULL) {
+		/* The statement failed to be written to WAL. */
+		struct tuple *old_tuple = del != NULL ? del->tuple : NULL;
+		struct tuple *new_tuple = add != NULL ? add->tuple : NULL;
+		memtx_space_update_bsize(space, new_tuple, old_tuple);
+		memtx_space_track_change(space, new_tuple, old_tuple);
+		if (del != NULL && del->del_psn == tx->psn)
+			del->del_psn = 0;
+	}
+	if (add != NULL) {
+		for (uint32_t i = 0; i < space->index_count; i++)
+			memtx_tx_story_unlink(add, space->index[i]);
+		/* Those who deleted the tuple delete the older one. */
+		while (add->del_stmt != NULL)
+			memtx_tx_stmt_set_del_story(add->del_stmt, del);
+		/* Those who read the tuple read a phantom. */
+		struct memtx_tx_read *read;
+		rlist_foreach_entry(read, &add->readers, in_readers) {
+			if (read->tx != tx)
+				memtx_tx_abort(read->tx);
+		}
+		memtx_tx_story_delete(add);
+	}
+	memtx_tx_stmt_set_del_story(mstmt, NULL);
+	if (stmt->new_tuple != NULL)
+		tuple_unref(stmt->new_tuple);
+	if (stmt->old_tuple != NULL)
+		tuple_unref(stmt->old_tuple);
+	stmt->old_tuple = NULL;
+	stmt->new_tuple = NULL;
+	stmt->engine_savepoint = NULL;
+	assert(tx->write_count > 0);
+	tx->write_count--;
+}
+
+/* }}} */
+
+/* {{{ Reads */
+
+struct tuple *
+memtx_tx_tuple_clarify_slow(struct tuple *tuple, uint32_t index_id)
+{
+	struct memtx_story *story = memtx_tx_story_find(tuple);
+	if (story == NULL)
+		return tuple;
+	return memtx_tx_story_clarify(story, memtx_tx_current(), index_id);
+}
+
+bool
+memtx_tx_tuple_is_dirty_slow(struct tuple *tuple)
+{
+	return memtx_tx_story_find(tuple) != NULL;
+}
+
+void
+memtx_tx_track_read_slow(struct index *index, struct tuple *tuple)
+{
+	struct txn *txn = in_txn();
+	if (txn == NULL || txn->is_autocommit ||
+	    txn->engine != (struct engine *)txm.memtx)
+		return;
+	struct memtx_tx *tx = txn->engine_tx;
+	/* Reads of a transaction in a read view don't matter. */
+	if (tx == NULL || tx->state != MEMTX_TX_READY ||
+	    tx->rv_psn != INT64_MAX)
+		return;
+	/* The index may belong to a space being altered. */
+	struct space *space = space_by_id(index->def->space_id);
+	if (space == NULL || space_index(space, index->def->iid) != index ||
+	    !memtx_space_is_mvcc(space))
+		return;
+	struct memtx_story *story = NULL;
+	struct rlist *readers;
+	if (tuple != NULL) {
+		story = memtx_tx_story_get_or_new(space, tuple);
+		if (story == NULL)
+			goto fail;
+		readers = &story->readers;
+	} else {
+		readers = &((struct memtx_space *)space)->tx_readers;
+	}
+	struct memtx_tx_read *read;
+	rlist_foreach_entry(read, readers, in_readers) {
+		if (read->tx == tx)
+			return;
+	}
+	read = mempool_alloc(&txm.read_pool);
+	if (read == NULL) {
+		diag_set(OutOfMemory, sizeof(*read),
+			 "mempool", "struct memtx_tx_read");
+		goto fail;
+	}
+	read->tx = tx;
+	read->story = story;
+	rlist_add_tail_entry(readers, read, in_readers);
+	rlist_add_tail_entry(&tx->read_set, read, in_read_set);
+	return;
+fail:
+	/*
+	 * A read can't be tracked, so don't let the transaction
+	 * commit any writes depending on it.
+	 */
+	diag_clear(diag_get());
+	memtx_tx_send_to_read_view(tx, txm.psn + 1);
+}
+
+/* }}} */
+
+/* {{{ DDL */
+
+bool
+memtx_tx_space_has_history(struct space *space)
+{
+	struct memtx_space *memtx_space = (struct memtx_space *)space;
+	return !rlist_empty(&memtx_space->tx_stories);
+}
+
+int
+memtx_tx_on_space_ddl(struct space *space)
+{
+	struct memtx_space *memtx_space = (struct memtx_space *)space;
+	struct memtx_story *story, *next_story;
+	struct memtx_tx_stmt *stmt;
+	struct memtx_tx_read *read, *next_read;
+	/*
+	 * Collect statements of transactions in progress. A
+	 * statement is either the inserter of a story or the
+	 * only deleter of it.
+	 */
+	uint32_t stmt_count = 0;
+	rlist_foreach_entry(story, &memtx_space->tx_stories, in_space) {
+		bool is_prepared = false;
+		if (story->add_stmt != NULL) {
+			stmt_count++;
+			is_prepared = story->add_stmt->tx->psn != 0;
+		}
+		for (stmt = story->del_stmt; stmt != NULL;
+		     stmt = stmt->next_in_del_list) {
+			if (stmt->add_story == NULL)
+				stmt_count++;
+			is_prepared = is_prepared || stmt->tx->psn != 0;
+		}
+		if (is_prepared) {
+			diag_set(ClientError, ER_ALTER_SPACE, space_name(space),
+				 "the space has transactions being committed");
+			return -1;
+		}
+	}
+	struct region *region = &fiber()->gc;
+	size_t region_svp = region_used(region);
+	struct memtx_tx_stmt **stmts = region_alloc(region, stmt_count *
+						    sizeof(*stmts));
+	if (stmts == NULL && stmt_count > 0) {
+		diag_set(OutOfMemory, stmt_count * sizeof(*stmts),
+			 "region", "memtx tx statements");
+		return -1;
+	}
+	uint32_t i = 0;
+	rlist_foreach_entry(story, &memtx_space->tx_stories, in_space) {
+		if (story->add_stmt != NULL)
+			stmts[i++] = story->add_stmt;
+		for (stmt = story->del_stmt; stmt != NULL;
+		     stmt = stmt->next_in_del_list) {
+			if (stmt->add_story == NULL)
+				stmts[i++] = stmt;
+		}
+	}
+	assert(i == stmt_count);
+	for (i = 0; i < stmt_count; i++) {
+		memtx_tx_abort(stmts[i]->tx);
+		memtx_tx_history_rollback_stmt(stmts[i]->stmt);
+	}
+	region_truncate(region, region_svp);
+
+	/* Abort readers, their reads can't be tracked anymore. */
+	rlist_foreach_entry(story, &memtx_space->tx_stories, in_space) {
+		rlist_foreach_entry_safe(read, &story->readers,
+					 in_readers, next_read) {
+			memtx_tx_abort(read->tx);
+			memtx_tx_read_delete(read);
+		}
+	}
+	rlist_foreach_entry_safe(read, &memtx_space->tx_readers,
+				 in_readers, next_read) {
+		memtx_tx_abort(read->tx);
+		memtx_tx_read_delete(read);
+	}
+
+	/* Drop old versions, then forget the rest. */
+	rlist_foreach_entry_safe(story, &memtx_space->tx_stories,
+				 in_space, next_story) {
+		if (story->del_psn != 0 &&
+		    !memtx_tx_story_collect(story, INT64_MAX))
+			return -1;
+	}
+	rlist_foreach_entry_safe(story, &memtx_space->tx_stories,
+				 in_space, next_story) {
+		if (!memtx_tx_story_collect(story, INT64_MAX))
+			unreachable();
+	}
+	assert(rlist_empty(&memtx_space->tx_stories));
+	return 0;
+}
+
+void
+memtx_tx_on_space_delete(struct space *space)
+{
+	struct memtx_space *memtx_space = (struct memtx_space *)space;
+	struct memtx_story *story, *next_story;
+	struct memtx_tx_read *read, *next_read;
+	rlist_foreach_entry_safe(read, &memtx_space->tx_readers,
+				 in_readers, next_read) {
+		memtx_tx_abort(read->tx);
+		memtx_tx_read_delete(read);
+	}
+	/*
+	 * Normally, the history is dropped before DDL. If it
+	 * isn't, the indexes are gone, so just detach statements
+	 * of the space from the history.
+	 */
+	rlist_foreach_entry_safe(story, &memtx_space->tx_stories,
+				 in_space, next_story) {
+		if (story->add_stmt != NULL) {
+			memtx_tx_abort(story->add_stmt->tx);
+			story->add_stmt->add_story = NULL;
+		}
+		while (story->del_stmt != NULL) {
+			memtx_tx_abort(story->del_stmt->tx);
+			memtx_tx_stmt_set_del_story(story->del_stmt, NULL);
+		}
+		memtx_tx_story_delete(story);
+	}
+}
+
+/* }}} */
+
+/* {{{ Snapshot */
+
+int
+memtx_tx_snapshot_cleaner_create(struct memtx_tx_snapshot_cleaner *cleaner,
+				 struct index *index)
+{
+	cleaner->map = NULL;
+	struct space *space = space_by_id(index->def->space_id);
+	if (space == NULL || space_index(space, index->def->iid) != index ||
+	    !memtx_tx_space_has_history(space))
+		return 0;
+	struct mh_i64ptr_t *map = mh_i64ptr_new();
+	if (map == NULL) {
+		diag_set(OutOfMemory, sizeof(*map),
+			 "mh_i64ptr_new", "snapshot cleaner");
+		return -1;
+	}
+	uint32_t iid = index->def->iid;
+	struct memtx_space *memtx_space = (struct memtx_space *)space;
+	struct memtx_story *story;
+	rlist_foreach_entry(story, &memtx_space->tx_stories, in_space) {
+		/* Only the newest version is stored in the index. */
+		if (story->link[iid].newer != NULL)
+			continue;
+		struct tuple *visible = memtx_tx_story_clarify(story, NULL, iid);
+		if (visible == story->tuple)
+			continue;
+		struct mh_i64ptr_node_t node = {
+			(uintptr_t)story->tuple, visible
+		};
+		if (mh_i64ptr_put(map, &node, NULL, NULL) == mh_end(map)) {
+			diag_set(OutOfMemory, sizeof(node),
+				 "mh_i64ptr_put", "snapshot cleaner");
+			mh_i64ptr_delete(map);
+			return -1;
+		}
+	}
+	cleaner->map = map;
+	return 0;
+}
+
+struct tuple *
+memtx_tx_snapshot_clarify(struct memtx_tx_snapshot_cleaner *cleaner,
+			  struct tuple *tuple)
+{
+	if (cleaner->map == NULL)
+		return tuple;
+	mh_int_t k = mh_i64ptr_find(cleaner->map, (uintptr_t)tuple, NULL);
+	if (k == mh_end(cleaner->map))
+		return tuple;
+	return mh_i64ptr_node(cleaner->map, k)->val;
+}
+
+void
+memtx_tx_snapshot_cleaner_destroy(struct memtx_tx_snapshot_cleaner *cleaner)
+{
+	if (cleaner->map != NULL)
+		mh_i64ptr_delete(cleaner->map);
+}
+
+/* }}} */
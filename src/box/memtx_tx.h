@@ -0,0 +1,258 @@
+#ifndef TARANTOOL_BOX_MEMTX_TX_H_INCLUDED
+#define TARANTOOL_BOX_MEMTX_TX_H_INCLUDED
+/*
+ * Copyright 2010-2016, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * Memtx transaction manager. Without it, memtx applies changes
+ * of a transaction to indexes right away and aborts a multi-
+ * statement transaction if it yields, because other fibers
+ * would see its uncommitted changes. The transaction manager
+ * lets transactions yield by keeping a history of versions
+ * (a story) for each tuple touched by a not yet committed
+ * transaction or seen by a read view:
+ *
+ * - An index stores the newest version of each key. Older
+ *   versions with the same key are linked to it in a chain,
+ *   newest first, and are filtered out by index readers
+ *   according to the reader's visibility, see
+ *   memtx_tx_tuple_clarify().
+ *
+ * - Writers are optimistic. On commit, a transaction gets
+ *   a prepare sequence number (PSN). Transactions that read
+ *   tuples it overwrites are sent to a read view as of the
+ *   previous PSN: they may go on reading, but fail to commit
+ *   any writes with ER_TRANSACTION_CONFLICT. Transactions that
+ *   inserted a duplicate of a prepared tuple are aborted.
+ *
+ * - Old versions are collected incrementally once no read
+ *   view can see them.
+ *
+ * Only user spaces are versioned. A transaction that writes to
+ * a system space is still aborted on yield.
+ */
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "index.h"
+#include "tuple.h"
+#include "txn.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+struct memtx_engine;
+struct memtx_tx;
+struct space;
+struct mh_i64ptr_t;
+
+/**
+ * Set if the transaction manager is enabled, see box.cfg
+ * memtx_use_mvcc_engine. Must not change after memtx engine
+ * initialization.
+ */
+extern bool memtx_tx_manager_use_mvcc_engine;
+
+/**
+ * Number of tuples that have a history of versions kept by the
+ * transaction manager. While it is 0, which is always the case
+ * if the manager is disabled, tuples don't need to be looked up
+ * in the history.
+ */
+extern size_t memtx_tx_story_count;
+
+int
+memtx_tx_manager_init(struct memtx_engine *memtx);
+
+void
+memtx_tx_manager_free(void);
+
+/**
+ * Start tracking a memtx transaction. The object is allocated
+ * on the fiber region and is stored in txn::engine_tx.
+ */
+struct memtx_tx *
+memtx_tx_begin(struct txn *txn);
+
+/**
+ * Check a transaction for conflicts and make its changes
+ * visible to other transactions.
+ * @retval -1 The transaction conflicts with another one,
+ *            ER_TRANSACTION_CONFLICT is set.
+ */
+int
+memtx_tx_prepare(struct memtx_tx *tx);
+
+/** Finish a transaction after its changes were written. */
+void
+memtx_tx_commit(struct memtx_tx *tx);
+
+/**
+ * Finish a transaction after all its statements were rolled
+ * back with memtx_tx_history_rollback_stmt().
+ */
+void
+memtx_tx_rollback(struct memtx_tx *tx);
+
+/**
+ * Check if a statement was executed by the transaction
+ * manager. In this case txn_stmt::engine_savepoint points to
+ * the manager's record of the statement rather than to the
+ * statement itself.
+ */
+static inline bool
+memtx_tx_stmt_is_versioned(struct txn_stmt *stmt)
+{
+	return stmt->engine_savepoint != NULL &&
+	       stmt->engine_savepoint != stmt;
+}
+
+/**
+ * Execute a statement of a versioned space: insert the new
+ * tuple into the space indexes on top of the versions already
+ * stored there and mark the old tuple as deleted by the
+ * statement. Arguments are the same as of memtx_space::replace,
+ * but DELETE leaves indexes intact.
+ *
+ * On success, the old tuple is referenced by the statement,
+ * like the new tuple is.
+ */
+int
+memtx_tx_history_add_stmt(struct memtx_tx *tx, struct txn_stmt *stmt,
+			  struct tuple *old_tuple, struct tuple *new_tuple,
+			  enum dup_replace_mode mode, struct tuple **result);
+
+/**
+ * Undo a statement executed by memtx_tx_history_add_stmt()
+ * and release its tuples.
+ */
+void
+memtx_tx_history_rollback_stmt(struct txn_stmt *stmt);
+
+struct tuple *
+memtx_tx_tuple_clarify_slow(struct tuple *tuple, uint32_t index_id);
+
+/**
+ * Given a tuple stored in an index, return its version visible
+ * to the current transaction or NULL if there is no such.
+ */
+static inline struct tuple *
+memtx_tx_tuple_clarify(struct tuple *tuple, uint32_t index_id)
+{
+	if (tuple == NULL || memtx_tx_story_count == 0)
+		return tuple;
+	return memtx_tx_tuple_clarify_slow(tuple, index_id);
+}
+
+bool
+memtx_tx_tuple_is_dirty_slow(struct tuple *tuple);
+
+/**
+ * Return true if a tuple has a history of versions kept by
+ * the transaction manager.
+ */
+static inline bool
+memtx_tx_tuple_is_dirty(struct tuple *tuple)
+{
+	return memtx_tx_story_count > 0 &&
+	       memtx_tx_tuple_is_dirty_slow(tuple);
+}
+
+void
+memtx_tx_track_read_slow(struct index *index, struct tuple *tuple);
+
+/**
+ * Remember that the current transaction read a tuple from
+ * an index, so that it is sent to a read view if the tuple is
+ * overwritten. NULL means that the transaction looked up a key
+ * that was not found or scanned the index.
+ */
+static inline void
+memtx_tx_track_read(struct index *index, struct tuple *tuple)
+{
+	if (memtx_tx_manager_use_mvcc_engine)
+		memtx_tx_track_read_slow(index, tuple);
+}
+
+/**
+ * Return true if some tuples of a space have more than one
+ * version, so that the raw content of the space indexes
+ * can't be used without filtering.
+ */
+bool
+memtx_tx_space_has_history(struct space *space);
+
+/**
+ * Prepare a space for DDL, which can't handle multiple tuple
+ * versions: roll back and abort all transactions that wrote to
+ * the space, abort transactions that read from it and drop
+ * all old versions of its tuples.
+ * @retval -1 A transaction that wrote to the space is being
+ *            committed.
+ */
+int
+memtx_tx_on_space_ddl(struct space *space);
+
+/** Forget all tuple versions of a space being deleted. */
+void
+memtx_tx_on_space_delete(struct space *space);
+
+/**
+ * Map of tuples stored in an index to their versions that must
+ * be written to a snapshot. Created in the tx thread, but may
+ * be used by any thread, since it's read-only.
+ */
+struct memtx_tx_snapshot_cleaner {
+	/** Tuple -> its committed version or NULL. */
+	struct mh_i64ptr_t *map;
+};
+
+int
+memtx_tx_snapshot_cleaner_create(struct memtx_tx_snapshot_cleaner *cleaner,
+				 struct index *index);
+
+/**
+ * Return the version of a tuple stored in an index that must
+ * be written to a snapshot or NULL if the tuple must be skipped.
+ */
+struct tuple *
+memtx_tx_snapshot_clarify(struct memtx_tx_snapshot_cleaner *cleaner,
+			  struct tuple *tuple);
+
+void
+memtx_tx_snapshot_cleaner_destroy(struct memtx_tx_snapshot_cleaner *cleaner);
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif /* defined(__cplusplus) */
+
+#endif /* TARANTOOL_BOX_MEMTX_TX_H_INCLUDED */
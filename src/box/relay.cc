@@ -30,6 +30,10 @@
  */
 #include "relay.h"
 
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <scoped_guard.h>
+
 #include "trivia/config.h"
 #include "trivia/util.h"
 #include "cbus.h"
@@ -199,6 +203,157 @@ relay_initial_join(int fd, uint64_t sync, struct vclock *vclock)
 	relay_destroy(&relay);
 }
 
+/** A checkpoint file sent on file-based join. */
+struct relay_file {
+	/** Path to the file. */
+	char *path;
+	/** Name of the file on the replica, engine/relative path. */
+	char *name;
+};
+
+/** Checkpoint files collected for file-based join. */
+struct relay_file_list {
+	/** Array of files. */
+	struct relay_file *files;
+	/** Number of files in the array. */
+	int count;
+	/** Engine reporting files at the moment. */
+	struct engine *engine;
+	/** Directory of the engine, set by box.cfg.<engine>_dir. */
+	char dir[PATH_MAX];
+};
+
+static void
+relay_file_list_destroy(struct relay_file_list *list)
+{
+	for (int i = 0; i < list->count; i++) {
+		free(list->files[i].path);
+		free(list->files[i].name);
+	}
+	free(list->files);
+}
+
+static int
+relay_file_list_add_cb(const char *path, void *arg)
+{
+	struct relay_file_list *list = (struct relay_file_list *) arg;
+	/*
+	 * Files are sent relative to the engine directory,
+	 * which may differ on the replica.
+	 */
+	size_t dir_len = strlen(list->dir);
+	if (dir_len == 0 || strncmp(path, list->dir, dir_len) != 0 ||
+	    path[dir_len] != '/') {
+		diag_set(ClientError, ER_UNSUPPORTED, "File-based join",
+			 tt_sprintf("file '%s' outside of %s_dir", path,
+				    list->engine->name));
+		return -1;
+	}
+	struct relay_file *files = (struct relay_file *)
+		realloc(list->files, (list->count + 1) * sizeof(*files));
+	if (files == NULL) {
+		diag_set(OutOfMemory, (list->count + 1) * sizeof(*files),
+			 "realloc", "struct relay_file");
+		return -1;
+	}
+	list->files = files;
+	struct relay_file *file = &files[list->count];
+	file->path = strdup(path);
+	file->name = strdup(tt_sprintf("%s/%s", list->engine->name,
+				       path + dir_len + 1));
+	if (file->path == NULL || file->name == NULL) {
+		free(file->path);
+		free(file->name);
+		diag_set(OutOfMemory, strlen(path), "strdup", "path");
+		return -1;
+	}
+	list->count++;
+	return 0;
+}
+
+/** Collect files of the checkpoint from all engines. */
+static int
+relay_file_list_create(struct relay_file_list *list, struct vclock *vclock)
+{
+	memset(list, 0, sizeof(*list));
+	struct engine *engine;
+	engine_foreach(engine) {
+		const char *dir = cfg_gets(tt_sprintf("%s_dir", engine->name));
+		list->engine = engine;
+		snprintf(list->dir, sizeof(list->dir), "%s",
+			 dir != NULL ? dir : "");
+		if (engine->vtab->backup(engine, vclock,
+					 relay_file_list_add_cb, list) != 0) {
+			relay_file_list_destroy(list);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+/** Used to pass arguments to relay_initial_join_files_f(). */
+struct relay_join_files_arg {
+	struct relay *relay;
+	struct relay_file_list *list;
+};
+
+static int
+relay_initial_join_files_f(va_list ap)
+{
+	struct relay_join_files_arg *arg =
+		va_arg(ap, struct relay_join_files_arg *);
+	struct relay *relay = arg->relay;
+	struct relay_file_list *list = arg->list;
+	coio_enable();
+	relay_set_cord_name(relay->io.fd);
+
+	for (int i = 0; i < list->count; i++) {
+		struct relay_file *file = &list->files[i];
+		int fd = open(file->path, O_RDONLY);
+		if (fd < 0)
+			tnt_raise(SystemError, "failed to open '%s'",
+				  file->path);
+		auto fd_guard = make_scoped_guard([=]{ close(fd); });
+		struct stat st;
+		if (fstat(fd, &st) != 0)
+			tnt_raise(SystemError, "failed to stat '%s'",
+				  file->path);
+		struct xrow_header row;
+		xrow_encode_join_file_xc(&row, file->name, st.st_size);
+		relay_send(relay, &row);
+		/* The file body follows the row as is. */
+		coio_sendfile(&relay->io, fd, 0, st.st_size);
+		say_info("sent `%s'", file->path);
+	}
+	return 0;
+}
+
+void
+relay_initial_join_files(int fd, uint64_t sync, struct vclock *vclock)
+{
+	struct relay_file_list list;
+	if (relay_file_list_create(&list, vclock) != 0)
+		diag_raise();
+
+	struct relay relay;
+	relay_create(&relay, fd, sync, relay_send_initial_join_row);
+	/*
+	 * Send files from a separate thread so as not to stall
+	 * tx on disk reads.
+	 */
+	struct relay_join_files_arg arg = { &relay, &list };
+	int rc = cord_costart(&relay.cord, "initial_join",
+			      relay_initial_join_files_f, &arg);
+	if (rc == 0)
+		rc = cord_cojoin(&relay.cord);
+
+	relay_destroy(&relay);
+	relay_file_list_destroy(&list);
+
+	if (rc != 0)
+		diag_raise();
+}
+
 int
 relay_final_join_f(va_list ap)
 {
@@ -64,6 +64,17 @@ relay_vclock(const struct relay *relay);
 void
 relay_initial_join(int fd, uint64_t sync, struct vclock *vclock);
 
+/**
+ * Send files of the last checkpoint to the replica instead
+ * of initial JOIN rows.
+ *
+ * @param fd        client connection
+ * @param sync      sync from incoming JOIN request
+ * @param vclock    vclock of the last checkpoint
+ */
+void
+relay_initial_join_files(int fd, uint64_t sync, struct vclock *vclock);
+
 /**
  * Send final JOIN rows to the replica.
  *
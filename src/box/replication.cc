@@ -52,6 +52,7 @@ uint32_t instance_id = REPLICA_ID_NIL;
 struct tt_uuid REPLICASET_UUID;
 
 double replication_timeout = 1.0; /* seconds */
+bool replication_file_join = false;
 
 typedef rb_tree(struct replica) replicaset_t;
 rb_proto(, replicaset_, replicaset_t, struct replica)
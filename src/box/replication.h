@@ -96,6 +96,13 @@ struct gc_consumer;
  */
 extern double replication_timeout;
 
+/**
+ * Bootstrap a new replica by copying checkpoint files of the
+ * master rather than replaying its rows. Set by
+ * box.cfg.replication_file_join.
+ */
+extern bool replication_file_join;
+
 /**
  * Wait for the given period of time before trying to reconnect
  * to a master.
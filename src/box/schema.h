@@ -80,6 +80,10 @@ space_cache_find(uint32_t id)
 struct func *
 func_by_name(const char *name, uint32_t name_len);
 
+/** Check if a space is a data dictionary space. */
+bool
+space_is_system(struct space *space);
+
 /** Call a visitor function on every space in the space cache. */
 int
 space_foreach(int (*func)(struct space *sp, void *udata), void *udata);
@@ -116,9 +120,6 @@ space_cache_replace(struct space *space);
 struct space *
 space_cache_delete(uint32_t id);
 
-bool
-space_is_system(struct space *space);
-
 void
 schema_init();
 
@@ -97,6 +97,7 @@ session_create(int fd, enum session_type type)
 	session->sync = 0;
 	session->type = type;
 	session->sql_flags = default_flags;
+	session->prio = FIBER_PRIO_INTERACTIVE;
 
 	/* For on_connect triggers. */
 	credentials_init(&session->credentials, guest_user->auth_token,
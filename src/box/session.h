@@ -100,6 +100,11 @@ struct session {
 	char salt[SESSION_SEED_SIZE];
 	/** Session user id and global grants */
 	struct credentials credentials;
+	/**
+	 * Priority class of fibers serving requests of
+	 * this session.
+	 */
+	enum fiber_prio prio;
 	/** Trigger for fiber on_stop to cleanup created on-demand session */
 	struct trigger fiber_on_stop;
 };
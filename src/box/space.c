@@ -293,6 +293,11 @@ space_def_check_compatibility(const struct space_def *old_def,
 			 "can not switch temporary flag on a non-empty space");
 		return -1;
 	}
+	if (new_def->opts.defer_deletes != old_def->opts.defer_deletes) {
+		diag_set(ClientError, ER_ALTER_SPACE, old_def->name,
+			 "can not switch defer_deletes flag on a non-empty space");
+		return -1;
+	}
 	uint32_t field_count = MIN(new_def->field_count, old_def->field_count);
 	for (uint32_t i = 0; i < field_count; ++i) {
 		enum field_type old_type = old_def->fields[i].type;
@@ -32,13 +32,20 @@
 #include "space_def.h"
 #include "diag.h"
 
+const char *space_compression_strs[] = { "none", "zstd" };
+
 const struct space_opts space_opts_default = {
 	/* .temporary = */ false,
+	/* .defer_deletes = */ false,
+	/* .compression = */ SPACE_COMPRESSION_NONE,
 	/* .sql        = */ NULL,
 };
 
 const struct opt_def space_opts_reg[] = {
 	OPT_DEF("temporary", OPT_BOOL, struct space_opts, temporary),
+	OPT_DEF("defer_deletes", OPT_BOOL, struct space_opts, defer_deletes),
+	OPT_DEF_ENUM("compression", space_compression, struct space_opts,
+		     compression, NULL),
 	OPT_DEF("sql", OPT_STRPTR, struct space_opts, sql),
 	OPT_END,
 };
@@ -40,6 +40,14 @@
 extern "C" {
 #endif /* defined(__cplusplus) */
 
+/** Compression algorithm of tuples of a memtx space. */
+enum space_compression {
+	SPACE_COMPRESSION_NONE,
+	SPACE_COMPRESSION_ZSTD,
+	space_compression_MAX
+};
+extern const char *space_compression_strs[];
+
 /** Space options */
 struct space_opts {
         /**
@@ -49,6 +57,20 @@ struct space_opts {
 	 * - changes are not part of a snapshot
 	 */
 	bool temporary;
+	/**
+	 * Vinyl only: don't look up the old tuple on REPLACE and
+	 * DELETE to delete it from secondary indexes. Instead,
+	 * generate DELETE statements for secondary indexes when
+	 * the overwritten tuple is purged from the primary index
+	 * by dump or compaction.
+	 */
+	bool defer_deletes;
+	/**
+	 * Memtx only: compress tuple fields following the last
+	 * indexed one. Tuples are decompressed on access to
+	 * a non-indexed field.
+	 */
+	enum space_compression compression;
 	/**
 	 * SQL statement that produced this space.
 	 */
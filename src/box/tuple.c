@@ -40,6 +40,16 @@
 #include "tuple_update.h"
 #include "coll_cache.h"
 
+#include <sys/mman.h>
+#include <unistd.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stdio.h>
+#if defined(__linux__)
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+#endif /* defined(__linux__) */
+
 static struct mempool tuple_iterator_pool;
 static struct small_alloc runtime_alloc;
 
@@ -92,6 +102,7 @@ tuple_new(struct tuple_format *format, const char *data, const char *end)
 	tuple->format_id = tuple_format_id(format);
 	tuple_format_ref(format);
 	tuple->data_offset = sizeof(struct tuple) + meta_size;
+	tuple->is_compressed = false;
 	char *raw = (char *) tuple + tuple->data_offset;
 	uint32_t *field_map = (uint32_t *) raw;
 	memcpy(raw, data, data_len);
@@ -160,10 +171,26 @@ tuple_validate_raw(struct tuple_format *format, const char *tuple)
  * to the snapshot file).
  */
 
+const char *
+tuple_decompress(const struct tuple *tuple, uint32_t *p_size)
+{
+	assert(tuple->is_compressed);
+	struct tuple_format *format = tuple_format(tuple);
+	assert(format->vtab.decompress != NULL);
+	return format->vtab.decompress(format, tuple, p_size);
+}
+
 const char *
 tuple_seek(struct tuple_iterator *it, uint32_t fieldno)
 {
-	const char *field = tuple_field(it->tuple, fieldno);
+	/*
+	 * Don't use tuple_field(), because it may return a pointer
+	 * to the key data of a compressed tuple, while the iterator
+	 * walks over the decompressed MessagePack.
+	 */
+	const char *field = tuple_field_raw(tuple_format(it->tuple),
+					    tuple_data(it->tuple),
+					    tuple_field_map(it->tuple), fieldno);
 	if (likely(field != NULL)) {
 		it->pos = field;
 		it->fieldno = fieldno;
@@ -235,7 +262,7 @@ tuple_extract_key_sequential(const struct tuple *tuple,
 			     uint32_t *key_size)
 {
 	assert(key_def_is_sequential(key_def));
-	const char *data = tuple_data(tuple);
+	const char *data = tuple_key_data(tuple);
 	return tuple_extract_key_sequential_raw(data, NULL, key_def, key_size);
 }
 
@@ -247,7 +274,7 @@ static char *
 tuple_extract_key_slowpath(const struct tuple *tuple,
 			   const struct key_def *key_def, uint32_t *key_size)
 {
-	const char *data = tuple_data(tuple);
+	const char *data = tuple_key_data(tuple);
 	uint32_t part_count = key_def->part_count;
 	uint32_t bsize = mp_sizeof_array(part_count);
 	const struct tuple_format *format = tuple_format(tuple);
@@ -411,9 +438,86 @@ tuple_init(field_name_hash_f hash)
 	return 0;
 }
 
-void
+const char *tuple_arena_pages_STRS[] = {
+	"none", "transparent", "2M", "1G", NULL
+};
+
+#if defined(__linux__)
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+/** Flags to map explicit huge pages of each kind. */
+static const int tuple_arena_hugetlb_flags[] = {
+	/* [TUPLE_ARENA_PAGES_2M] = */ MAP_HUGETLB | (21 << MAP_HUGE_SHIFT),
+	/* [TUPLE_ARENA_PAGES_1G] = */ MAP_HUGETLB | (30 << MAP_HUGE_SHIFT),
+};
+#endif /* defined(__linux__) */
+
+/**
+ * Map an arena with explicit huge pages. The kernel reserves
+ * huge pages for a private mapping when it is created, so if
+ * there are not enough of them, the mapping fails right away
+ * rather than on first access.
+ */
+static int
+tuple_arena_create_hugetlb(struct slab_arena *arena, struct quota *quota,
+			   size_t prealloc, uint32_t slab_size,
+			   enum tuple_arena_pages pages)
+{
+	assert(pages == TUPLE_ARENA_PAGES_2M || pages == TUPLE_ARENA_PAGES_1G);
+#if defined(__linux__)
+	/*
+	 * Huge page mappings can only be unmapped in whole
+	 * pages, so the arena must consist of whole pages.
+	 */
+	size_t page_size = pages == TUPLE_ARENA_PAGES_2M ? 1ULL << 21 :
+							   1ULL << 30;
+	prealloc = small_align(prealloc, MAX(page_size, slab_size));
+	int flags = tuple_arena_hugetlb_flags[pages - TUPLE_ARENA_PAGES_2M];
+	return slab_arena_create(arena, quota, prealloc, slab_size,
+				 MAP_PRIVATE | flags);
+#else
+	(void)arena;
+	(void)quota;
+	(void)prealloc;
+	(void)slab_size;
+	(void)pages;
+	errno = ENOTSUP;
+	return -1;
+#endif
+}
+
+/**
+ * Bind memory of an arena to a NUMA node. The preferred
+ * policy is used, not the strict one: when the node runs out
+ * of memory, pages are allocated on other nodes rather than
+ * the process being killed.
+ */
+static int
+tuple_arena_bind(struct slab_arena *arena, int numa_node)
+{
+	assert(numa_node >= 0 && numa_node <= TUPLE_ARENA_NUMA_NODE_MAX);
+#if defined(__linux__) && defined(SYS_mbind)
+	enum { BITS_PER_LONG = CHAR_BIT * sizeof(unsigned long) };
+	unsigned long nodemask[(TUPLE_ARENA_NUMA_NODE_MAX + 1) /
+			       BITS_PER_LONG] = { 0 };
+	nodemask[numa_node / BITS_PER_LONG] |=
+		1UL << (numa_node % BITS_PER_LONG);
+	/* The kernel ignores the last bit of maxnode. */
+	unsigned long maxnode = sizeof(nodemask) * CHAR_BIT + 1;
+	return syscall(SYS_mbind, arena->arena, arena->prealloc,
+		       MPOL_PREFERRED, nodemask, maxnode, 0);
+#else
+	(void)arena;
+	errno = ENOTSUP;
+	return -1;
+#endif
+}
+
+enum tuple_arena_pages
 tuple_arena_create(struct slab_arena *arena, struct quota *quota,
 		   uint64_t arena_max_size, uint32_t slab_size,
+		   enum tuple_arena_pages pages, int numa_node,
 		   const char *arena_name)
 {
 	/*
@@ -425,6 +529,15 @@ tuple_arena_create(struct slab_arena *arena, struct quota *quota,
 	say_info("mapping %zu bytes for %s tuple arena...", prealloc,
 		 arena_name);
 
+	if (pages == TUPLE_ARENA_PAGES_2M || pages == TUPLE_ARENA_PAGES_1G) {
+		if (tuple_arena_create_hugetlb(arena, quota, prealloc,
+					       slab_size, pages) == 0)
+			goto bind;
+		say_syserror("failed to map %s tuple arena with %s huge "
+			     "pages, falling back to transparent huge pages",
+			     arena_name, tuple_arena_pages_STRS[pages]);
+		pages = TUPLE_ARENA_PAGES_TRANSPARENT;
+	}
 	if (slab_arena_create(arena, quota, prealloc, slab_size,
 			      MAP_PRIVATE) != 0) {
 		if (errno == ENOMEM) {
@@ -436,6 +549,30 @@ tuple_arena_create(struct slab_arena *arena, struct quota *quota,
 				       " tuple arena", prealloc, arena_name);
 		}
 	}
+	if (pages == TUPLE_ARENA_PAGES_TRANSPARENT) {
+#if defined(MADV_HUGEPAGE)
+		int rc = madvise(arena->arena, arena->prealloc,
+				 MADV_HUGEPAGE);
+#else
+		int rc = -1;
+		errno = ENOTSUP;
+#endif
+		if (rc != 0) {
+			say_syserror("failed to enable transparent huge "
+				     "pages for %s tuple arena", arena_name);
+			pages = TUPLE_ARENA_PAGES_NONE;
+		}
+	}
+bind:
+	/*
+	 * The memory is not touched yet, so the policy applies
+	 * to all pages of the arena.
+	 */
+	if (numa_node >= 0 && tuple_arena_bind(arena, numa_node) != 0) {
+		say_syserror("failed to bind %s tuple arena to NUMA node %d",
+			     arena_name, numa_node);
+	}
+	return pages;
 }
 
 void
@@ -444,6 +581,57 @@ tuple_arena_destroy(struct slab_arena *arena)
 	slab_arena_destroy(arena);
 }
 
+int
+tuple_arena_stat(struct slab_arena *arena, struct tuple_arena_stat *stat)
+{
+	memset(stat, 0, sizeof(*stat));
+	const char *path = "/proc/self/smaps";
+	FILE *f = fopen(path, "r");
+	if (f == NULL) {
+		diag_set(SystemError, "failed to open '%s'", path);
+		return -1;
+	}
+	uintptr_t arena_start = (uintptr_t)arena->arena;
+	uintptr_t arena_end = arena_start + arena->prealloc;
+	/*
+	 * Each mapping is described by a header line with its
+	 * address range followed by "Name: value kB" lines.
+	 * Sum up the lines of the mappings the arena spans.
+	 */
+	bool in_arena = false;
+	char line[256];
+	while (fgets(line, sizeof(line), f) != NULL) {
+		uintptr_t start, end;
+		if (sscanf(line, "%" SCNxPTR "-%" SCNxPTR " ",
+			   &start, &end) == 2) {
+			in_arena = start < arena_end && end > arena_start;
+			continue;
+		}
+		if (!in_arena)
+			continue;
+		char name[64];
+		size_t value;
+		if (sscanf(line, "%63[^:]: %zu kB", name, &value) != 2)
+			continue;
+		value *= 1024;
+		if (strcmp(name, "KernelPageSize") == 0) {
+			stat->page_size = MAX(stat->page_size, value);
+		} else if (strcmp(name, "Rss") == 0) {
+			stat->resident += value;
+		} else if (strcmp(name, "AnonHugePages") == 0) {
+			/* Accounted in Rss. */
+			stat->huge += value;
+		} else if (strcmp(name, "Private_Hugetlb") == 0 ||
+			   strcmp(name, "Shared_Hugetlb") == 0) {
+			/* Not accounted in Rss. */
+			stat->resident += value;
+			stat->huge += value;
+		}
+	}
+	fclose(f);
+	return 0;
+}
+
 void
 tuple_free(void)
 {
@@ -503,7 +691,9 @@ size_t
 box_tuple_bsize(const box_tuple_t *tuple)
 {
 	assert(tuple != NULL);
-	return tuple->bsize;
+	uint32_t bsize;
+	tuple_data_range(tuple, &bsize);
+	return bsize;
 }
 
 ssize_t
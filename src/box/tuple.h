@@ -52,21 +52,69 @@ tuple_init(field_name_hash_f hash);
 void
 tuple_free(void);
 
+/** Kind of memory pages backing a tuple arena. */
+enum tuple_arena_pages {
+	/** Regular pages. */
+	TUPLE_ARENA_PAGES_NONE,
+	/** Transparent huge pages, see madvise(MADV_HUGEPAGE). */
+	TUPLE_ARENA_PAGES_TRANSPARENT,
+	/** Explicit 2 MB huge pages, see mmap(MAP_HUGETLB). */
+	TUPLE_ARENA_PAGES_2M,
+	/** Explicit 1 GB huge pages. */
+	TUPLE_ARENA_PAGES_1G,
+	TUPLE_ARENA_PAGES_MAX
+};
+
+extern const char *tuple_arena_pages_STRS[];
+
+/** Greatest NUMA node a tuple arena can be bound to. */
+enum { TUPLE_ARENA_NUMA_NODE_MAX = 1023 };
+
 /**
  * Initialize tuples arena.
+ * If explicit huge pages can't be mapped, for example because
+ * the system doesn't have enough of them reserved, the arena
+ * falls back to transparent huge pages. Failure to use huge
+ * pages or to bind the arena to a NUMA node is not fatal and
+ * is only logged.
  * @param arena[out] Arena to initialize.
  * @param quota Arena's quota.
  * @param arena_max_size Maximal size of @arena.
+ * @param pages Kind of pages to back @arena with.
+ * @param numa_node NUMA node to allocate memory of @arena on
+ *        or -1 to use the default memory policy.
  * @param arena_name Name of @arena for logs.
+ * @return Kind of pages the arena is actually backed with.
  */
-void
+enum tuple_arena_pages
 tuple_arena_create(struct slab_arena *arena, struct quota *quota,
 		   uint64_t arena_max_size, uint32_t slab_size,
+		   enum tuple_arena_pages pages, int numa_node,
 		   const char *arena_name);
 
 void
 tuple_arena_destroy(struct slab_arena *arena);
 
+/** Memory usage of a tuple arena, as seen by the kernel. */
+struct tuple_arena_stat {
+	/** Size of the pages backing the arena. */
+	size_t page_size;
+	/** Size of the arena memory resident in RAM. */
+	size_t resident;
+	/** Size of the resident memory backed by huge pages. */
+	size_t huge;
+};
+
+/**
+ * Get memory usage of a tuple arena from /proc/self/smaps.
+ * The cost is proportional to the resident size of the arena,
+ * so the function isn't meant to be called often.
+ * @retval  0 Success.
+ * @retval -1 The statistics are not available, diag is set.
+ */
+int
+tuple_arena_stat(struct slab_arena *arena, struct tuple_arena_stat *stat);
+
 /** \cond public */
 
 typedef struct tuple_format box_tuple_format_t;
@@ -312,6 +360,14 @@ box_tuple_extract_key(const box_tuple_t *tuple, uint32_t space_id,
  *    @sa tuple_format_new()   uint32  ...  uint32
  *
  * Each 'off_i' is the offset to the i-th indexed field.
+ *
+ * If the tuple is compressed, the MessagePack stored in it
+ * consists of the array header and the fields up to the last
+ * indexed one, see tuple_format::index_field_count, followed
+ * by the rest of the fields compressed in an engine specific
+ * way. tuple_data() returns the decompressed MessagePack, while
+ * indexed fields are looked up in the stored prefix, see
+ * tuple_key_data().
  */
 struct PACKED tuple
 {
@@ -327,7 +383,12 @@ struct PACKED tuple
 	/**
 	 * Offset to the MessagePack from the begin of the tuple.
 	 */
-	uint16_t data_offset;
+	uint16_t data_offset : 15;
+	/**
+	 * Set if the MessagePack is stored compressed.
+	 * @sa tuple_format_vtab::decompress.
+	 */
+	uint16_t is_compressed : 1;
 	/**
 	 * Engine specific fields and offsets array concatenated
 	 * with MessagePack fields array.
@@ -335,7 +396,10 @@ struct PACKED tuple
 	 */
 };
 
-/** Size of the tuple including size of struct tuple. */
+/**
+ * Size of the tuple including size of struct tuple.
+ * For a compressed tuple, it's the size of the stored data.
+ */
 static inline size_t
 tuple_size(const struct tuple *tuple)
 {
@@ -343,6 +407,13 @@ tuple_size(const struct tuple *tuple)
 	return tuple->data_offset + tuple->bsize;
 }
 
+/**
+ * Decompress a compressed tuple.
+ * @sa tuple_format_vtab::decompress.
+ */
+const char *
+tuple_decompress(const struct tuple *tuple, uint32_t *p_size);
+
 /**
  * Get pointer to MessagePack data of the tuple.
  * @param tuple tuple.
@@ -350,6 +421,26 @@ tuple_size(const struct tuple *tuple)
  */
 static inline const char *
 tuple_data(const struct tuple *tuple)
+{
+	if (unlikely(tuple->is_compressed)) {
+		uint32_t size;
+		return tuple_decompress(tuple, &size);
+	}
+	return (const char *) tuple + tuple->data_offset;
+}
+
+/**
+ * Get MessagePack data of the tuple to look up indexed fields
+ * in. Unlike tuple_data(), it never decompresses the tuple: the
+ * array header and the fields up to the last indexed one are
+ * always stored as is.
+ * @param tuple tuple.
+ * @return MessagePack array, which is only guaranteed to
+ *         contain the first tuple_format::index_field_count
+ *         fields.
+ */
+static inline const char *
+tuple_key_data(const struct tuple *tuple)
 {
 	return (const char *) tuple + tuple->data_offset;
 }
@@ -372,6 +463,8 @@ tuple_data_or_null(const struct tuple *tuple)
 static inline const char *
 tuple_data_range(const struct tuple *tuple, uint32_t *p_size)
 {
+	if (unlikely(tuple->is_compressed))
+		return tuple_decompress(tuple, p_size);
 	*p_size = tuple->bsize;
 	return (const char *) tuple + tuple->data_offset;
 }
@@ -470,7 +563,7 @@ static inline const char *
 tuple_extra(const struct tuple *tuple)
 {
 	struct tuple_format *format = tuple_format(tuple);
-	return tuple_data(tuple) - tuple_format_meta_size(format);
+	return tuple_key_data(tuple) - tuple_format_meta_size(format);
 }
 
 /**
@@ -547,7 +640,7 @@ tuple_field_map(const struct tuple *tuple)
 static inline uint32_t
 tuple_field_count(const struct tuple *tuple)
 {
-	const char *data = tuple_data(tuple);
+	const char *data = tuple_key_data(tuple);
 	return mp_decode_array(&data);
 }
 
@@ -562,8 +655,10 @@ tuple_field_count(const struct tuple *tuple)
 static inline const char *
 tuple_field(const struct tuple *tuple, uint32_t fieldno)
 {
-	return tuple_field_raw(tuple_format(tuple), tuple_data(tuple),
-			       tuple_field_map(tuple), fieldno);
+	struct tuple_format *format = tuple_format(tuple);
+	const char *data = fieldno < format->index_field_count ?
+			   tuple_key_data(tuple) : tuple_data(tuple);
+	return tuple_field_raw(format, data, tuple_field_map(tuple), fieldno);
 }
 
 /**
@@ -432,8 +432,8 @@ tuple_compare_slowpath(const struct tuple *tuple_a, const struct tuple *tuple_b,
 		       const struct key_def *key_def)
 {
 	const struct key_part *part = key_def->parts;
-	const char *tuple_a_raw = tuple_data(tuple_a);
-	const char *tuple_b_raw = tuple_data(tuple_b);
+	const char *tuple_a_raw = tuple_key_data(tuple_a);
+	const char *tuple_b_raw = tuple_key_data(tuple_b);
 	if (key_def->part_count == 1 && part->fieldno == 0) {
 		mp_decode_array(&tuple_a_raw);
 		mp_decode_array(&tuple_b_raw);
@@ -534,7 +534,7 @@ tuple_compare_with_key_slowpath(const struct tuple *tuple, const char *key,
 	assert(part_count <= key_def->part_count);
 	const struct key_part *part = key_def->parts;
 	const struct tuple_format *format = tuple_format(tuple);
-	const char *tuple_raw = tuple_data(tuple);
+	const char *tuple_raw = tuple_key_data(tuple);
 	const uint32_t *field_map = tuple_field_map(tuple);
 	if (likely(part_count == 1)) {
 		const char *field;
@@ -668,7 +668,7 @@ tuple_compare_with_key_sequential(const struct tuple *tuple,
 	const char *key, uint32_t part_count, const struct key_def *key_def)
 {
 	assert(key_def_is_sequential(key_def));
-	const char *tuple_key = tuple_data(tuple);
+	const char *tuple_key = tuple_key_data(tuple);
 	uint32_t tuple_field_count = mp_decode_array(&tuple_key);
 	assert(tuple_field_count >= key_def->part_count);
 	assert(part_count <= key_def->part_count);
@@ -702,11 +702,11 @@ tuple_compare_sequential(const struct tuple *tuple_a,
 			 const struct key_def *key_def)
 {
 	assert(key_def_is_sequential(key_def));
-	const char *key_a = tuple_data(tuple_a);
+	const char *key_a = tuple_key_data(tuple_a);
 	uint32_t field_count_a = mp_decode_array(&key_a);
 	assert(field_count_a >= key_def->part_count);
 	(void) field_count_a;
-	const char *key_b = tuple_data(tuple_b);
+	const char *key_b = tuple_key_data(tuple_b);
 	uint32_t field_count_b = mp_decode_array(&key_b);
 	assert(field_count_b >= key_def->part_count);
 	(void) field_count_b;
@@ -721,10 +721,10 @@ tuple_compare_sequential_nullable(const struct tuple *tuple_a,
 {
 	assert(key_def->is_nullable);
 	assert(key_def_is_sequential(key_def));
-	const char *key_a = tuple_data(tuple_a);
+	const char *key_a = tuple_key_data(tuple_a);
 	uint32_t field_count = mp_decode_array(&key_a);
 	assert(field_count >= key_def->part_count);
-	const char *key_b = tuple_data(tuple_b);
+	const char *key_b = tuple_key_data(tuple_b);
 	field_count = mp_decode_array(&key_b);
 	assert(field_count >= key_def->part_count);
 	(void) field_count;
@@ -757,6 +757,14 @@ field_compare<FIELD_TYPE_STRING>(const char **field_a, const char **field_b)
 	return r;
 }
 
+template <>
+inline int
+field_compare<FIELD_TYPE_INTEGER>(const char **field_a, const char **field_b)
+{
+	return mp_compare_integer_with_hint(*field_a, mp_typeof(**field_a),
+					    *field_b, mp_typeof(**field_b));
+}
+
 template <int TYPE>
 static inline int
 field_compare_and_next(const char **field_a, const char **field_b);
@@ -815,10 +823,10 @@ struct FieldCompare<IDX, TYPE, IDX2, TYPE2, MORE_TYPES...>
 		} else {
 			if ((r = field_compare<TYPE>(&field_a, &field_b)) != 0)
 				return r;
-			field_a = tuple_field_raw(format_a, tuple_data(tuple_a),
+			field_a = tuple_field_raw(format_a, tuple_key_data(tuple_a),
 						  tuple_field_map(tuple_a),
 						  IDX2);
-			field_b = tuple_field_raw(format_b, tuple_data(tuple_b),
+			field_b = tuple_field_raw(format_b, tuple_key_data(tuple_b),
 						  tuple_field_map(tuple_b),
 						  IDX2);
 		}
@@ -855,9 +863,9 @@ struct TupleCompare
 		struct tuple_format *format_a = tuple_format(tuple_a);
 		struct tuple_format *format_b = tuple_format(tuple_b);
 		const char *field_a, *field_b;
-		field_a = tuple_field_raw(format_a, tuple_data(tuple_a),
+		field_a = tuple_field_raw(format_a, tuple_key_data(tuple_a),
 					  tuple_field_map(tuple_a), IDX);
-		field_b = tuple_field_raw(format_b, tuple_data(tuple_b),
+		field_b = tuple_field_raw(format_b, tuple_key_data(tuple_b),
 					  tuple_field_map(tuple_b), IDX);
 		return FieldCompare<IDX, TYPE, MORE_TYPES...>::
 			compare(tuple_a, tuple_b, format_a,
@@ -873,16 +881,146 @@ struct TupleCompare<0, TYPE, MORE_TYPES...> {
 	{
 		struct tuple_format *format_a = tuple_format(tuple_a);
 		struct tuple_format *format_b = tuple_format(tuple_b);
-		const char *field_a = tuple_data(tuple_a);
-		const char *field_b = tuple_data(tuple_b);
+		const char *field_a = tuple_key_data(tuple_a);
+		const char *field_b = tuple_key_data(tuple_b);
 		mp_decode_array(&field_a);
 		mp_decode_array(&field_b);
 		return FieldCompare<0, TYPE, MORE_TYPES...>::compare(tuple_a, tuple_b,
 					format_a, format_b, field_a, field_b);
 	}
 };
+
+/**
+ * Comparators specialized by the types of up to three key parts.
+ * Unlike TupleCompare, field numbers are not compile-time
+ * constants and are taken from the key definition, so these
+ * cover any field layout, e.g. secondary keys over arbitrary
+ * fields, while still avoiding the per-part type switch of
+ * tuple_compare_slowpath().
+ */
+template <int TYPE, int ...MORE_TYPES> struct TypedFieldCompare { };
+
+template <int TYPE, int TYPE2, int ...MORE_TYPES>
+struct TypedFieldCompare<TYPE, TYPE2, MORE_TYPES...>
+{
+	inline static int compare(const struct tuple *tuple_a,
+				  const struct tuple *tuple_b,
+				  const struct tuple_format *format_a,
+				  const struct tuple_format *format_b,
+				  const struct key_part *part)
+	{
+		int r = TypedFieldCompare<TYPE>::compare(tuple_a, tuple_b,
+							 format_a, format_b,
+							 part);
+		if (r != 0)
+			return r;
+		return TypedFieldCompare<TYPE2, MORE_TYPES...>::
+			compare(tuple_a, tuple_b, format_a, format_b,
+				part + 1);
+	}
+};
+
+template <int TYPE>
+struct TypedFieldCompare<TYPE>
+{
+	inline static int compare(const struct tuple *tuple_a,
+				  const struct tuple *tuple_b,
+				  const struct tuple_format *format_a,
+				  const struct tuple_format *format_b,
+				  const struct key_part *part)
+	{
+		const char *field_a, *field_b;
+		field_a = tuple_field_raw(format_a, tuple_key_data(tuple_a),
+					  tuple_field_map(tuple_a),
+					  part->fieldno);
+		field_b = tuple_field_raw(format_b, tuple_key_data(tuple_b),
+					  tuple_field_map(tuple_b),
+					  part->fieldno);
+		return field_compare<TYPE>(&field_a, &field_b);
+	}
+};
+
+template <int ...TYPES>
+struct TupleCompareTyped
+{
+	static int compare(const struct tuple *tuple_a,
+			   const struct tuple *tuple_b,
+			   const struct key_def *key_def)
+	{
+		return TypedFieldCompare<TYPES...>::
+			compare(tuple_a, tuple_b, tuple_format(tuple_a),
+				tuple_format(tuple_b), key_def->parts);
+	}
+};
 } /* end of anonymous namespace */
 
+/**
+ * Generate all combinations of the field types supported by
+ * typed comparators for 1, 2 and 3 parts, in the order
+ * expected by typed_comparator_index().
+ */
+#define TYPED_COMPARATOR(cmp, ...) cmp<__VA_ARGS__>::compare,
+#define TYPED_COMPARATOR_1(cmp, ...) \
+	TYPED_COMPARATOR(cmp, ##__VA_ARGS__, FIELD_TYPE_UNSIGNED) \
+	TYPED_COMPARATOR(cmp, ##__VA_ARGS__, FIELD_TYPE_STRING) \
+	TYPED_COMPARATOR(cmp, ##__VA_ARGS__, FIELD_TYPE_INTEGER)
+#define TYPED_COMPARATOR_2(cmp, ...) \
+	TYPED_COMPARATOR_1(cmp, ##__VA_ARGS__, FIELD_TYPE_UNSIGNED) \
+	TYPED_COMPARATOR_1(cmp, ##__VA_ARGS__, FIELD_TYPE_STRING) \
+	TYPED_COMPARATOR_1(cmp, ##__VA_ARGS__, FIELD_TYPE_INTEGER)
+#define TYPED_COMPARATOR_3(cmp) \
+	TYPED_COMPARATOR_2(cmp, FIELD_TYPE_UNSIGNED) \
+	TYPED_COMPARATOR_2(cmp, FIELD_TYPE_STRING) \
+	TYPED_COMPARATOR_2(cmp, FIELD_TYPE_INTEGER)
+#define TYPED_COMPARATORS(cmp) \
+	TYPED_COMPARATOR_1(cmp) \
+	TYPED_COMPARATOR_2(cmp) \
+	TYPED_COMPARATOR_3(cmp)
+
+/** Max number of parts covered by typed comparators. */
+enum { TYPED_COMPARATOR_PART_MAX = 3 };
+
+/**
+ * Find the position of a typed comparator for the given key
+ * definition in a table generated by TYPED_COMPARATORS().
+ * Return -1 if there is no suitable typed comparator.
+ */
+static int
+typed_comparator_index(const struct key_def *def)
+{
+	if (def->part_count == 0 ||
+	    def->part_count > TYPED_COMPARATOR_PART_MAX ||
+	    def->is_nullable || key_def_has_collation(def))
+		return -1;
+	/* Number of combinations for fewer parts: 0, 3, 3 + 9. */
+	int offset = 0, count = 1;
+	int index = 0;
+	for (uint32_t i = 0; i < def->part_count; i++) {
+		offset += count;
+		count *= 3;
+		int type_index;
+		switch (def->parts[i].type) {
+		case FIELD_TYPE_UNSIGNED:
+			type_index = 0;
+			break;
+		case FIELD_TYPE_STRING:
+			type_index = 1;
+			break;
+		case FIELD_TYPE_INTEGER:
+			type_index = 2;
+			break;
+		default:
+			return -1;
+		}
+		index = index * 3 + type_index;
+	}
+	return offset - 1 + index;
+}
+
+static const tuple_compare_t cmp_typed_arr[] = {
+	TYPED_COMPARATORS(TupleCompareTyped)
+};
+
 struct comparator_signature {
 	tuple_compare_t f;
 	uint32_t p[64];
@@ -935,6 +1073,9 @@ tuple_compare_create(const struct key_def *def) {
 				return cmp_arr[k].f;
 		}
 	}
+	int typed = typed_comparator_index(def);
+	if (typed >= 0)
+		return cmp_typed_arr[typed];
 	if (key_def_is_sequential(def))
 		return tuple_compare_sequential;
 	return tuple_compare_slowpath<false>;
@@ -967,6 +1108,14 @@ field_compare_with_key<FIELD_TYPE_STRING>(const char **field, const char **key)
 	return r;
 }
 
+template <>
+inline int
+field_compare_with_key<FIELD_TYPE_INTEGER>(const char **field, const char **key)
+{
+	return mp_compare_integer_with_hint(*field, mp_typeof(**field),
+					    *key, mp_typeof(**key));
+}
+
 template <int TYPE>
 static inline int
 field_compare_with_key_and_next(const char **field_a, const char **field_b);
@@ -1024,7 +1173,7 @@ struct FieldCompareWithKey<FLD_ID, IDX, TYPE, IDX2, TYPE2, MORE_TYPES...>
 			r = field_compare_with_key<TYPE>(&field, &key);
 			if (r || part_count == FLD_ID + 1)
 				return r;
-			field = tuple_field_raw(format, tuple_data(tuple),
+			field = tuple_field_raw(format, tuple_key_data(tuple),
 						tuple_field_map(tuple), IDX2);
 			mp_next(&key);
 		}
@@ -1061,7 +1210,7 @@ struct TupleCompareWithKey
 		if (part_count == 0)
 			return 0;
 		struct tuple_format *format = tuple_format(tuple);
-		const char *field = tuple_field_raw(format, tuple_data(tuple),
+		const char *field = tuple_field_raw(format, tuple_key_data(tuple),
 						    tuple_field_map(tuple),
 						    IDX);
 		return FieldCompareWithKey<FLD_ID, IDX, TYPE, MORE_TYPES...>::
@@ -1082,7 +1231,7 @@ struct TupleCompareWithKey<0, 0, TYPE, MORE_TYPES...>
 		if (part_count == 0)
 			return 0;
 		struct tuple_format *format = tuple_format(tuple);
-		const char *field = tuple_data(tuple);
+		const char *field = tuple_key_data(tuple);
 		mp_decode_array(&field);
 		return FieldCompareWithKey<0, 0, TYPE, MORE_TYPES...>::
 			compare(tuple, key, part_count,
@@ -1090,8 +1239,72 @@ struct TupleCompareWithKey<0, 0, TYPE, MORE_TYPES...>
 	}
 };
 
+/**
+ * Tuple with key comparators specialized by the types of up
+ * to three key parts. @sa TupleCompareTyped.
+ */
+template <int TYPE, int ...MORE_TYPES> struct TypedFieldCompareWithKey { };
+
+template <int TYPE, int TYPE2, int ...MORE_TYPES>
+struct TypedFieldCompareWithKey<TYPE, TYPE2, MORE_TYPES...>
+{
+	inline static int
+	compare(const struct tuple *tuple, const char *key,
+		uint32_t part_count, const struct tuple_format *format,
+		const struct key_part *part)
+	{
+		int r = TypedFieldCompareWithKey<TYPE>::
+			compare(tuple, key, part_count, format, part);
+		if (r != 0 || part_count == 1)
+			return r;
+		mp_next(&key);
+		return TypedFieldCompareWithKey<TYPE2, MORE_TYPES...>::
+			compare(tuple, key, part_count - 1, format, part + 1);
+	}
+};
+
+template <int TYPE>
+struct TypedFieldCompareWithKey<TYPE>
+{
+	inline static int
+	compare(const struct tuple *tuple, const char *key, uint32_t,
+		const struct tuple_format *format, const struct key_part *part)
+	{
+		const char *field = tuple_field_raw(format, tuple_key_data(tuple),
+						    tuple_field_map(tuple),
+						    part->fieldno);
+		return field_compare_with_key<TYPE>(&field, &key);
+	}
+};
+
+template <int ...TYPES>
+struct TupleCompareWithKeyTyped
+{
+	static int
+	compare(const struct tuple *tuple, const char *key,
+		uint32_t part_count, const struct key_def *key_def)
+	{
+		/* Part count can be 0 in wildcard searches. */
+		if (part_count == 0)
+			return 0;
+		return TypedFieldCompareWithKey<TYPES...>::
+			compare(tuple, key, part_count, tuple_format(tuple),
+				key_def->parts);
+	}
+};
+
 } /* end of anonymous namespace */
 
+static const tuple_compare_with_key_t cmp_wk_typed_arr[] = {
+	TYPED_COMPARATORS(TupleCompareWithKeyTyped)
+};
+
+#undef TYPED_COMPARATORS
+#undef TYPED_COMPARATOR_3
+#undef TYPED_COMPARATOR_2
+#undef TYPED_COMPARATOR_1
+#undef TYPED_COMPARATOR
+
 struct comparator_with_key_signature
 {
 	tuple_compare_with_key_t f;
@@ -1146,6 +1359,9 @@ tuple_compare_with_key_create(const struct key_def *def)
 				return cmp_wk_arr[k].f;
 		}
 	}
+	int typed = typed_comparator_index(def);
+	if (typed >= 0)
+		return cmp_wk_typed_arr[typed];
 	if (key_def_is_sequential(def))
 		return tuple_compare_with_key_sequential<false>;
 	return tuple_compare_with_key_slowpath<false>;
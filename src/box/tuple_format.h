@@ -60,6 +60,12 @@ enum { TUPLE_INDEX_BASE = 1 };
  * an offset for a field_id.
  */
 enum { TUPLE_OFFSET_SLOT_NIL = INT32_MAX };
+/*
+ * Max size of the tuple meta (extra data and field map).
+ * tuple::data_offset is 15 bits and also covers the tuple
+ * header, which may be extended by an engine.
+ */
+enum { TUPLE_META_SIZE_MAX = INT16_MAX - 256 };
 
 struct tuple;
 struct tuple_format;
@@ -69,6 +75,15 @@ struct tuple_format_vtab {
 	/** Free allocated tuple using engine-specific memory allocator. */
 	void
 	(*destroy)(struct tuple_format *format, struct tuple *tuple);
+	/**
+	 * Return decompressed MessagePack of a tuple with
+	 * tuple::is_compressed set. The returned data must stay
+	 * valid while the tuple is referenced. May be NULL if
+	 * the engine never compresses tuples.
+	 */
+	const char *
+	(*decompress)(struct tuple_format *format, const struct tuple *tuple,
+		      uint32_t *p_size);
 };
 
 /** Tuple field meta information for tuple_format. */
@@ -1183,6 +1183,152 @@ update_finish(struct tuple_update *update, uint32_t *p_tuple_len)
 	return buffer;
 }
 
+/** Max number of operations handled by update_patch(). */
+enum { UPDATE_PATCH_OP_MAX = 8 };
+
+/**
+ * A fast path for an update which changes a few existing fields
+ * without changing their size, e.g. increments a counter.
+ * Instead of building a rope over the old tuple and writing the
+ * new tuple field by field, copy the old tuple as is and
+ * overwrite the changed fields in the copy.
+ *
+ * Update operations are not modified, so if the fast path is
+ * not applicable, the update can be executed by update_do_ops().
+ *
+ * @param update Update meta with operations read.
+ * @param old_data MessagePack array of tuple fields with the
+ *        array header.
+ * @param old_data_end End of the @old_data.
+ * @param field_count Field count in the @old_data.
+ * @param[out] p_tuple_len Length of the new tuple.
+ *
+ * @retval not NULL The new tuple.
+ * @retval NULL The fast path is not applicable or an operation
+ *         failed. The slow path reports the error in the latter
+ *         case.
+ */
+static const char *
+update_patch(struct tuple_update *update, const char *old_data,
+	     const char *old_data_end, uint32_t field_count,
+	     uint32_t *p_tuple_len)
+{
+	if (update->op_count == 0 || update->op_count > UPDATE_PATCH_OP_MAX)
+		return NULL;
+	int32_t field_no[UPDATE_PATCH_OP_MAX];
+	const char *field[UPDATE_PATCH_OP_MAX];
+	uint32_t field_len[UPDATE_PATCH_OP_MAX];
+	union update_op_arg result[UPDATE_PATCH_OP_MAX];
+	int32_t field_no_max = -1;
+	for (uint32_t i = 0; i < update->op_count; i++) {
+		struct update_op *op = &update->ops[i];
+		switch (op->opcode) {
+		case '=':
+		case '+':
+		case '-':
+		case '&':
+		case '|':
+		case '^':
+			break;
+		default:
+			/* Changes the field count or the field size. */
+			return NULL;
+		}
+		int32_t no = op->field_no;
+		if (no < 0)
+			no += field_count;
+		if (no < 0 || no >= (int32_t) field_count)
+			return NULL;
+		/* Several operations on the same field. */
+		for (uint32_t j = 0; j < i; j++) {
+			if (field_no[j] == no)
+				return NULL;
+		}
+		field_no[i] = no;
+		field_no_max = MAX(field_no_max, no);
+	}
+	/* Find the changed fields in the old tuple. */
+	const char *pos = old_data;
+	mp_decode_array(&pos);
+	for (int32_t no = 0; no <= field_no_max; no++) {
+		const char *next = pos;
+		mp_next(&next);
+		for (uint32_t i = 0; i < update->op_count; i++) {
+			if (field_no[i] == no) {
+				field[i] = pos;
+				field_len[i] = next - pos;
+			}
+		}
+		pos = next;
+	}
+	/* Calculate new values and check their size. */
+	for (uint32_t i = 0; i < update->op_count; i++) {
+		struct update_op *op = &update->ops[i];
+		const char *old = field[i];
+		uint32_t new_field_len;
+		switch (op->opcode) {
+		case '=':
+			new_field_len = op->arg.set.length;
+			break;
+		case '+':
+		case '-': {
+			struct op_arith_arg left_arg;
+			if (mp_read_arith_arg(update->index_base, op, &old,
+					      &left_arg) != 0 ||
+			    make_arith_operation(left_arg, op->arg.arith,
+						 op->opcode,
+						 update->index_base +
+						 field_no[i],
+						 &result[i].arith) != 0)
+				return NULL;
+			new_field_len = mp_sizeof_op_arith_arg(result[i].arith);
+			break;
+		}
+		default: {
+			uint64_t val;
+			if (mp_read_uint(update->index_base, op, &old,
+					 &val) != 0)
+				return NULL;
+			result[i].bit.val = op->arg.bit.val;
+			if (op->opcode == '&')
+				result[i].bit.val &= val;
+			else if (op->opcode == '^')
+				result[i].bit.val ^= val;
+			else
+				result[i].bit.val |= val;
+			new_field_len = mp_sizeof_uint(result[i].bit.val);
+			break;
+		}
+		}
+		if (new_field_len != field_len[i])
+			return NULL;
+	}
+	/* Copy the old tuple and patch the changed fields. */
+	uint32_t tuple_len = old_data_end - old_data;
+	char *buffer = (char *) update->alloc(update->alloc_ctx, tuple_len);
+	if (buffer == NULL)
+		return NULL;
+	memcpy(buffer, old_data, tuple_len);
+	for (uint32_t i = 0; i < update->op_count; i++) {
+		struct update_op *op = &update->ops[i];
+		char *out = buffer + (field[i] - old_data);
+		switch (op->opcode) {
+		case '=':
+			memcpy(out, op->arg.set.value, op->arg.set.length);
+			break;
+		case '+':
+		case '-':
+			store_op_arith(&result[i].arith, field[i], out);
+			break;
+		default:
+			store_op_bit(&result[i].bit, field[i], out);
+			break;
+		}
+	}
+	*p_tuple_len = tuple_len;
+	return buffer;
+}
+
 int
 tuple_update_check_ops(tuple_update_alloc_func alloc, void *alloc_ctx,
 		       const char *expr, const char *expr_end, int index_base)
@@ -1201,14 +1347,19 @@ tuple_update_execute(tuple_update_alloc_func alloc, void *alloc_ctx,
 {
 	struct tuple_update update;
 	update_init(&update, alloc, alloc_ctx, index_base);
+	const char *old_tuple = old_data;
 	uint32_t field_count = mp_decode_array(&old_data);
 
 	if (update_read_ops(&update, expr, expr_end, field_count) != 0)
 		return NULL;
-	if (update_do_ops(&update, old_data, old_data_end, field_count))
-		return NULL;
 	if (column_mask)
 		*column_mask = update.column_mask;
+	const char *new_data = update_patch(&update, old_tuple, old_data_end,
+					    field_count, p_tuple_len);
+	if (new_data != NULL)
+		return new_data;
+	if (update_do_ops(&update, old_data, old_data_end, field_count))
+		return NULL;
 
 	return update_finish(&update, p_tuple_len);
 }
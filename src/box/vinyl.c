@@ -49,6 +49,7 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <unistd.h>
 
 #include <small/lsregion.h>
 #include <small/region.h>
@@ -70,6 +71,7 @@
 #include "column_mask.h"
 #include "trigger.h"
 #include "checkpoint.h"
+#include "schema.h" /* schema_version, space_by_id() */
 #include "wal.h" /* wal_mode() */
 
 /**
@@ -226,6 +228,15 @@ static void
 vy_gc(struct vy_env *env, struct vy_recovery *recovery,
       unsigned int gc_mask, int64_t gc_lsn);
 
+enum {
+	/**
+	 * Max number of secondary index entries a vinyl iterator
+	 * reads ahead to look up full tuples in the primary index
+	 * concurrently.
+	 */
+	VY_ITERATOR_BATCH_MAX = 16,
+};
+
 struct vinyl_iterator {
 	struct iterator base;
 	/** Vinyl environment. */
@@ -253,6 +264,23 @@ struct vinyl_iterator {
 	struct vy_read_view *rv_autocommit;
 	/** Trigger invoked when tx ends to close the iterator. */
 	struct trigger on_tx_destroy;
+	/**
+	 * Full tuples looked up in the primary index in advance,
+	 * see vinyl_iterator_fill_batch(). Referenced, NULL if
+	 * not found.
+	 */
+	struct tuple *batch[VY_ITERATOR_BATCH_MAX];
+	/** Number of tuples in the batch. */
+	int batch_size;
+	/** Position of the next tuple to return from the batch. */
+	int batch_pos;
+	/**
+	 * Number of entries to read ahead next time. Doubles
+	 * with each batch up to VY_ITERATOR_BATCH_MAX so that
+	 * short scans don't read more than necessary. 0 if
+	 * reading ahead is disabled.
+	 */
+	int batch_max;
 };
 
 static const struct engine_vtab vinyl_engine_vtab;
@@ -305,6 +333,10 @@ vy_info_append_quota(struct vy_env *env, struct info_handler *h)
 	info_append_int(h, "watermark", q->watermark);
 	info_append_int(h, "use_rate", env->quota_use_rate);
 	info_append_int(h, "dump_bandwidth", vy_dump_bandwidth(env));
+	info_append_int(h, "rate_limit", q->rate_limit != SIZE_MAX ?
+			q->rate_limit : 0);
+	info_append_int(h, "throttled", q->throttle_count);
+	info_append_double(h, "throttle_time", q->throttle_time);
 	info_table_end(h);
 }
 
@@ -398,6 +430,32 @@ vy_info_append_compact_stat(struct info_handler *h, const char *name,
 	info_table_end(h);
 }
 
+/**
+ * Append statistics of blob files of an index, see
+ * index_opts::blob_threshold. A blob file shared by a few
+ * runs is accounted once per run.
+ */
+static void
+vinyl_index_info_blob(struct vy_index *index, struct info_handler *h)
+{
+	int64_t files = 0, size = 0, live = 0;
+	struct vy_run *run;
+	rlist_foreach_entry(run, &index->runs, in_index) {
+		files += run->info.blob_count;
+		for (uint32_t i = 0; i < run->info.blob_count; i++) {
+			size += run->info.blobs[i].size;
+			live += run->info.blobs[i].live;
+		}
+	}
+	if (files == 0 && index->opts.blob_threshold == 0)
+		return;
+	info_table_begin(h, "blob");
+	info_append_int(h, "files", files);
+	info_append_int(h, "bytes", live);
+	info_append_int(h, "garbage", size - live);
+	info_table_end(h);
+}
+
 static void
 vinyl_index_info(struct index *base, struct info_handler *h)
 {
@@ -443,6 +501,7 @@ vinyl_index_info(struct index *base, struct info_handler *h)
 	info_table_end(h);
 	vy_info_append_compact_stat(h, "dump", &stat->disk.dump);
 	vy_info_append_compact_stat(h, "compact", &stat->disk.compact);
+	vinyl_index_info_blob(index, h);
 	info_table_end(h);
 
 	info_table_begin(h, "cache");
@@ -452,6 +511,14 @@ vinyl_index_info(struct index *base, struct info_handler *h)
 	vy_info_append_stmt_counter(h, "put", &cache_stat->put);
 	vy_info_append_stmt_counter(h, "invalidate", &cache_stat->invalidate);
 	vy_info_append_stmt_counter(h, "evict", &cache_stat->evict);
+	info_table_begin(h, "point");
+	info_append_int(h, "lookup", cache_stat->point.lookup);
+	info_append_int(h, "hit", cache_stat->point.hit);
+	info_table_end(h);
+	info_table_begin(h, "range");
+	info_append_int(h, "lookup", cache_stat->range.lookup);
+	info_append_int(h, "hit", cache_stat->range.hit);
+	info_table_end(h);
 	info_table_end(h);
 
 	info_table_begin(h, "txw");
@@ -552,6 +619,11 @@ vinyl_engine_check_space_def(struct space_def *def)
 			 def->name, "engine does not support temporary flag");
 		return -1;
 	}
+	if (def->opts.compression != SPACE_COMPRESSION_NONE) {
+		diag_set(ClientError, ER_ALTER_SPACE,
+			 def->name, "engine does not support compression");
+		return -1;
+	}
 	return 0;
 }
 
@@ -621,6 +693,12 @@ vinyl_space_check_index_def(struct space *space, struct index_def *index_def)
 		diag_set(ClientError, ER_NULLABLE_PRIMARY, space_name(space));
 		return -1;
 	}
+	if (index_def->opts.ttl > 0 && index_def->iid != 0) {
+		diag_set(ClientError, ER_MODIFY_INDEX,
+			 index_def->name, space_name(space),
+			 "ttl can only be set for the primary index");
+		return -1;
+	}
 	/* Check that there are no ANY, ARRAY, MAP parts */
 	for (uint32_t i = 0; i < index_def->key_def->part_count; i++) {
 		struct key_part *part = &index_def->key_def->parts[i];
@@ -936,6 +1014,29 @@ vinyl_space_prepare_truncate(struct space *old_space, struct space *new_space)
 	return 0;
 }
 
+/**
+ * Update vy_index::defer_deletes of the primary index of
+ * the space after its definition or set of indexes changed.
+ */
+static void
+vy_space_update_defer_deletes(struct space *space)
+{
+	struct vy_index *pk = vy_index(space->index[0]);
+	pk->defer_deletes = false;
+	if (!space->def->opts.defer_deletes || space->index_count < 2)
+		return;
+	for (uint32_t i = 1; i < space->index_count; i++) {
+		/*
+		 * A unique secondary index must have the old tuple
+		 * deleted before the new one is inserted, otherwise
+		 * we would get a false duplicate error.
+		 */
+		if (vy_index(space->index[i])->opts.is_unique)
+			return;
+	}
+	pk->defer_deletes = true;
+}
+
 static void
 vinyl_space_commit_truncate(struct space *old_space, struct space *new_space)
 {
@@ -946,6 +1047,8 @@ vinyl_space_commit_truncate(struct space *old_space, struct space *new_space)
 	if (index_count == 0)
 		return;
 
+	vy_space_update_defer_deletes(new_space);
+
 	struct vy_index *pk = vy_index(old_space->index[0]);
 
 	/*
@@ -1146,6 +1249,7 @@ vinyl_space_commit_alter(struct space *old_space, struct space *new_space)
 		tuple_format_ref(index->upsert_format);
 		vy_index_validate_formats(index);
 	}
+	vy_space_update_defer_deletes(new_space);
 	return;
 fail:
 	/* FIXME: space_vtab::commit_alter() must not fail. */
@@ -1286,12 +1390,50 @@ vy_index_get(struct vy_index *index, struct vy_tx *tx,
 	struct vy_read_iterator itr;
 	vy_read_iterator_open(&itr, index, tx, ITER_EQ, key, rv);
 	int rc = vy_read_iterator_next(&itr, result);
-	if (*result != NULL)
-		tuple_ref(*result);
+	if (*result != NULL) {
+		if (vy_index_is_expired(index, *result))
+			*result = NULL;
+		else
+			tuple_ref(*result);
+	}
 	vy_read_iterator_close(&itr);
 	return rc;
 }
 
+/**
+ * Get the full tuple from the primary index by an entry of
+ * a secondary index. The entry may be stale, i.e. the tuple
+ * it was inserted for may have been overwritten while the
+ * DELETE for the secondary index hasn't been generated yet,
+ * see vy_index::defer_deletes. In this case, the full tuple
+ * doesn't match the entry and NULL is returned.
+ *
+ * @param index       Secondary index.
+ * @param tx          Current transaction.
+ * @param rv          Read view.
+ * @param entry       Secondary index entry.
+ * @param[out] result The found tuple is stored here. Must be
+ *                    unreferenced after usage.
+ *
+ * @param  0 Success.
+ * @param -1 Memory error or read error.
+ */
+static int
+vy_index_get_by_secondary(struct vy_index *index, struct vy_tx *tx,
+			  const struct vy_read_view **rv,
+			  struct tuple *entry, struct tuple **result)
+{
+	assert(index->id > 0);
+	if (vy_index_get(index->pk, tx, rv, entry, result) != 0)
+		return -1;
+	if (*result != NULL &&
+	    vy_tuple_compare(*result, entry, index->cmp_def) != 0) {
+		tuple_unref(*result);
+		*result = NULL;
+	}
+	return 0;
+}
+
 /**
  * Check if the index contains the key. If true, then set
  * a duplicate key error in the diagnostics area.
@@ -1318,6 +1460,19 @@ vy_check_dup_key(struct vy_env *env, struct vy_tx *tx, struct space *space,
 	if (vy_index_get(index, tx, vy_tx_read_view(tx), key, &found))
 		return -1;
 
+	if (found != NULL && index->id > 0 && index->pk->opts.ttl > 0) {
+		/*
+		 * The entry may have been left from an expired
+		 * tuple, check the primary index.
+		 */
+		struct tuple *entry = found;
+		int rc = vy_index_get_by_secondary(index, tx,
+						   vy_tx_read_view(tx),
+						   entry, &found);
+		tuple_unref(entry);
+		if (rc != 0)
+			return -1;
+	}
 	if (found) {
 		tuple_unref(found);
 		diag_set(ClientError, ER_TUPLE_FOUND,
@@ -1447,6 +1602,18 @@ error_unref:
 	return -1;
 }
 
+/**
+ * Return true if REPLACE and DELETE in the space may skip looking
+ * up the old tuple and leave it in secondary indexes until it is
+ * purged from the primary index, see vy_index::defer_deletes.
+ * The old tuple is still needed for on_replace triggers.
+ */
+static inline bool
+vy_space_defers_deletes(struct space *space, struct vy_index *pk)
+{
+	return pk->defer_deletes && rlist_empty(&space->on_replace);
+}
+
 /**
  * Execute REPLACE in a space with multiple indexes and lookup for
  * an old tuple, that should has been set in \p stmt->old_tuple if
@@ -1484,17 +1651,21 @@ vy_replace_impl(struct vy_env *env, struct vy_tx *tx, struct space *space,
 	if (new_stmt == NULL)
 		return -1;
 
-	/* Get full tuple from the primary index. */
-	if (vy_index_get(pk, tx, vy_tx_read_view(tx),
-			 new_stmt, &old_stmt) != 0)
-		goto error;
-
-	if (old_stmt == NULL) {
-		/*
-		 * We can turn REPLACE into INSERT if the new key
-		 * does not have history.
-		 */
-		vy_stmt_set_type(new_stmt, IPROTO_INSERT);
+	/*
+	 * Get full tuple from the primary index unless deletion
+	 * of the old tuple from secondary indexes is deferred.
+	 */
+	if (!vy_space_defers_deletes(space, pk)) {
+		if (vy_index_get(pk, tx, vy_tx_read_view(tx),
+				 new_stmt, &old_stmt) != 0)
+			goto error;
+		if (old_stmt == NULL) {
+			/*
+			 * We can turn REPLACE into INSERT if the
+			 * new key does not have history.
+			 */
+			vy_stmt_set_type(new_stmt, IPROTO_INSERT);
+		}
 	}
 
 	/*
@@ -1620,7 +1791,7 @@ vy_index_full_by_key(struct vy_index *index, struct vy_tx *tx,
 		*result = found;
 		return 0;
 	}
-	rc = vy_index_get(index->pk, tx, rv, found, result);
+	rc = vy_index_get_by_secondary(index, tx, rv, found, result);
 	tuple_unref(found);
 	return rc;
 }
@@ -1707,7 +1878,14 @@ vy_delete(struct vy_env *env, struct vy_tx *tx, struct txn_stmt *stmt,
 	 *   we need to extract secondary keys from the old tuple
 	 *   and pass them to indexes for deletion.
 	 */
-	if (has_secondary || !rlist_empty(&space->on_replace)) {
+	if (vy_space_defers_deletes(space, pk)) {
+		/*
+		 * Secondary indexes are cleaned up when the old
+		 * tuple is purged from the primary index.
+		 */
+		assert(index->id == 0);
+		has_secondary = false;
+	} else if (has_secondary || !rlist_empty(&space->on_replace)) {
 		if (vy_index_full_by_key(index, tx, vy_tx_read_view(tx),
 				key, part_count, &stmt->old_tuple) != 0)
 			return -1;
@@ -2475,6 +2653,33 @@ vinyl_engine_rollback_statement(struct engine *engine, struct txn *txn,
 
 /** {{{ Environment */
 
+/**
+ * Throttle transactions once the quota watermark is exceeded
+ * instead of letting them run at full speed until they hit the
+ * limit and stall until the dump completes. The rate is chosen
+ * so that the remaining quota lasts until all memory is dumped:
+ *
+ *      limit - used          used
+ *   ----------------- = --------------
+ *      rate_limit       dump_bandwidth
+ *
+ * Once the limit is reached, transactions wait for the dump to
+ * free memory in vy_quota_use(), so the rate limit is lifted.
+ */
+static void
+vy_env_update_rate_limit(struct vy_env *e)
+{
+	struct vy_quota *q = &e->quota;
+	if (q->used < q->watermark || q->used >= q->limit ||
+	    q->limit == SIZE_MAX) {
+		vy_quota_set_rate_limit(q, SIZE_MAX);
+		return;
+	}
+	double rate_limit = (double)(q->limit - q->used) *
+			    vy_dump_bandwidth(e) / (q->used + 1);
+	vy_quota_set_rate_limit(q, rate_limit);
+}
+
 static void
 vy_env_quota_timer_cb(ev_loop *loop, ev_timer *timer, int events)
 {
@@ -2508,6 +2713,7 @@ vy_env_quota_timer_cb(ev_loop *loop, ev_timer *timer, int events)
 			    (dump_bandwidth + e->quota_use_rate + 1));
 
 	vy_quota_set_watermark(&e->quota, watermark);
+	vy_env_update_rate_limit(e);
 }
 
 static void
@@ -2530,6 +2736,8 @@ vy_env_quota_exceeded_cb(struct vy_quota *quota)
 	assert(env->status != VINYL_INITIAL_RECOVERY_LOCAL &&
 	       env->status != VINYL_FINAL_RECOVERY_LOCAL);
 
+	vy_env_update_rate_limit(env);
+
 	if (lsregion_used(&env->mem_env.allocator) == 0) {
 		/*
 		 * The memory limit has been exceeded, but there's
@@ -2557,6 +2765,7 @@ vy_env_dump_complete_cb(struct vy_scheduler *scheduler,
 	assert(mem_used_after <= mem_used_before);
 	size_t mem_dumped = mem_used_before - mem_used_after;
 	vy_quota_release(quota, mem_dumped);
+	vy_env_update_rate_limit(env);
 
 	say_info("dumped %zu bytes in %.1f sec", mem_dumped, dump_duration);
 
@@ -2566,6 +2775,68 @@ vy_env_dump_complete_cb(struct vy_scheduler *scheduler,
 				  mem_dumped / dump_duration);
 }
 
+/**
+ * Delete a tuple purged from a primary index from secondary
+ * indexes of the space, see vy_index::defer_deletes. DELETEs
+ * are inserted directly into in-memory trees, bypassing WAL.
+ * If we fail or the DELETEs are lost on restart, stale entries
+ * remain in secondary indexes, but they are skipped on read.
+ */
+static void
+vy_env_deferred_delete_cb(struct vy_scheduler *scheduler,
+			  struct vy_index *pk, struct tuple *old_stmt,
+			  struct tuple *new_stmt, int64_t lsn)
+{
+	struct vy_env *env = container_of(scheduler, struct vy_env, scheduler);
+	if (pk->is_dropped)
+		return;
+	struct space *space = space_by_id(pk->space_id);
+	if (space == NULL || space->index_count == 0 ||
+	    vy_index(space->index[0]) != pk)
+		return;
+
+	struct tuple *delete = NULL;
+	for (uint32_t i = 1; i < space->index_count; i++) {
+		struct vy_index *index = vy_index(space->index[i]);
+		/* Nothing to do if the secondary key didn't change. */
+		if (new_stmt != NULL &&
+		    vy_tuple_compare(old_stmt, new_stmt, index->key_def) == 0)
+			continue;
+		if (delete == NULL) {
+			delete = vy_stmt_new_surrogate_delete(pk->mem_format,
+							      old_stmt);
+			if (delete == NULL)
+				goto fail;
+			vy_stmt_set_lsn(delete, lsn);
+		}
+		/* See the comment in vy_tx_write_prepare(). */
+		if ((index->mem->schema_version != schema_version ||
+		     index->mem->generation != scheduler->generation) &&
+		    vy_index_rotate_mem(index) != 0)
+			goto fail;
+		struct vy_mem *mem = index->mem;
+		size_t mem_used_before = lsregion_used(&env->mem_env.allocator);
+		const struct tuple *region_stmt = NULL;
+		int rc = vy_index_set(index, mem, delete, &region_stmt);
+		size_t mem_used_after = lsregion_used(&env->mem_env.allocator);
+		assert(mem_used_after >= mem_used_before);
+		if (rc != 0)
+			goto fail;
+		vy_index_commit_stmt(index, mem, region_stmt);
+		vy_quota_force_use(&env->quota,
+				   mem_used_after - mem_used_before);
+	}
+	if (delete != NULL)
+		tuple_unref(delete);
+	return;
+fail:
+	diag_log();
+	say_error("%s: failed to generate deferred DELETE",
+		  vy_index_name(pk));
+	if (delete != NULL)
+		tuple_unref(delete);
+}
+
 static struct vy_squash_queue *
 vy_squash_queue_new(void);
 static void
@@ -2635,6 +2906,7 @@ vy_env_new(const char *path, size_t memory, size_t cache,
 	vy_mem_env_create(&e->mem_env, e->memory);
 	vy_scheduler_create(&e->scheduler, e->write_threads,
 			    vy_env_dump_complete_cb,
+			    vy_env_deferred_delete_cb,
 			    &e->run_env, &e->xm->read_views);
 
 	if (vy_index_env_create(&e->index_env, e->path,
@@ -2735,6 +3007,13 @@ vinyl_engine_set_timeout(struct vinyl_engine *vinyl, double timeout)
 	vinyl->env->timeout = timeout;
 }
 
+void
+vinyl_engine_set_parallel_lookup(struct vinyl_engine *vinyl,
+				 bool parallel_lookup)
+{
+	vinyl->env->index_env.parallel_lookup = parallel_lookup;
+}
+
 void
 vinyl_engine_set_too_long_threshold(struct vinyl_engine *vinyl,
 				    double too_long_threshold)
@@ -2989,7 +3268,7 @@ vy_send_range(struct vy_join_ctx *ctx)
 	rlist_create(&fake_read_views);
 	ctx->wi = vy_write_iterator_new(ctx->key_def,
 					ctx->format, ctx->upsert_format,
-					true, true, &fake_read_views);
+					true, true, &fake_read_views, NULL);
 	if (ctx->wi == NULL)
 		goto out;
 
@@ -3330,6 +3609,25 @@ vy_gc_cb(const struct vy_log_record *record, void *cb_arg)
 			forget = false;
 		}
 	}
+	/*
+	 * Blob files are numbered sequentially. A blob file
+	 * may be linked to a newer run so unlinking it here
+	 * doesn't necessarily free the space.
+	 */
+	for (uint32_t blob_no = 0; forget; blob_no++) {
+		vy_blob_snprint_path(path, sizeof(path), arg->env->path,
+				     arg->space_id, arg->index_id,
+				     record->run_id, blob_no);
+		if (coio_unlink(path) == 0) {
+			say_info("removed %s", path);
+			continue;
+		}
+		if (errno != ENOENT) {
+			say_syserror("error while removing %s", path);
+			forget = false;
+		}
+		break;
+	}
 
 	if (!forget)
 		goto out;
@@ -3427,6 +3725,15 @@ vy_backup_cb(const struct vy_log_record *record, void *cb_arg)
 		if (arg->cb(path, arg->cb_arg) != 0)
 			return -1;
 	}
+	for (uint32_t blob_no = 0; ; blob_no++) {
+		vy_blob_snprint_path(path, sizeof(path), arg->env->path,
+				     arg->space_id, arg->index_id,
+				     record->run_id, blob_no);
+		if (access(path, F_OK) != 0)
+			break;
+		if (arg->cb(path, arg->cb_arg) != 0)
+			return -1;
+	}
 out:
 	if (++arg->loops % VY_YIELD_LOOPS == 0)
 		fiber_sleep(0);
@@ -3793,6 +4100,11 @@ vinyl_iterator_last(struct iterator *base, struct tuple **ret)
 static void
 vinyl_iterator_close(struct vinyl_iterator *it)
 {
+	for (int i = it->batch_pos; i < it->batch_size; i++) {
+		if (it->batch[i] != NULL)
+			tuple_unref(it->batch[i]);
+	}
+	it->batch_pos = it->batch_size = 0;
 	vy_read_iterator_close(&it->iterator);
 	vy_index_unref(it->index);
 	it->index = NULL;
@@ -3806,6 +4118,113 @@ vinyl_iterator_close(struct vinyl_iterator *it)
 	it->base.next = vinyl_iterator_last;
 }
 
+static int
+vinyl_iterator_lookup_f(va_list ap)
+{
+	struct vinyl_iterator *it = va_arg(ap, struct vinyl_iterator *);
+	struct tuple *key = va_arg(ap, struct tuple *);
+	struct tuple **result = va_arg(ap, struct tuple **);
+	return vy_index_get_by_secondary(it->index, it->tx, it->rv,
+					 key, result);
+}
+
+/**
+ * Read ahead a batch of secondary index entries and look up
+ * the corresponding full tuples in the primary index. Each
+ * lookup but the last one is done in a separate fiber, so if
+ * lookups have to read pages from disk, the reads are spread
+ * over all vinyl reader threads at once rather than issued one
+ * after another.
+ *
+ * Reading ahead is only safe if the iterator uses a read view
+ * which can't change under it, i.e. in autocommit mode: in a
+ * transaction, statements the transaction makes between two
+ * next() calls must be visible to the iterator.
+ */
+static int
+vinyl_iterator_fill_batch(struct vinyl_iterator *it)
+{
+	assert(it->index->id > 0 && it->tx == NULL);
+	assert(it->batch_max > 0);
+	assert(it->batch_pos == it->batch_size);
+	it->batch_pos = it->batch_size = 0;
+
+	struct tuple *keys[VY_ITERATOR_BATCH_MAX];
+	int count = 0;
+	int rc = 0;
+	while (count < it->batch_max) {
+		struct tuple *key;
+		rc = vy_read_iterator_next(&it->iterator, &key);
+		if (rc != 0 || key == NULL)
+			break;
+		tuple_ref(key);
+		keys[count++] = key;
+	}
+	it->batch_max = MIN(it->batch_max * 2, VY_ITERATOR_BATCH_MAX);
+
+	struct fiber *fibers[VY_ITERATOR_BATCH_MAX];
+	for (int i = 0; i < count; i++) {
+		it->batch[i] = NULL;
+		fibers[i] = NULL;
+		if (rc != 0 || i == count - 1)
+			continue;
+		struct fiber *f = fiber_new("vinyl.lookup",
+					    vinyl_iterator_lookup_f);
+		if (f == NULL) {
+			/* Fall back on lookup in this fiber. */
+			diag_clear(diag_get());
+			continue;
+		}
+		fiber_set_joinable(f, true);
+		fiber_start(f, it, keys[i], &it->batch[i]);
+		fibers[i] = f;
+	}
+	for (int i = 0; i < count; i++) {
+		if (rc == 0 && fibers[i] == NULL &&
+		    vy_index_get_by_secondary(it->index, it->tx, it->rv,
+					      keys[i], &it->batch[i]) != 0)
+			rc = -1;
+	}
+	for (int i = 0; i < count; i++) {
+		if (fibers[i] != NULL && fiber_join(fibers[i]) != 0)
+			rc = -1;
+		tuple_unref(keys[i]);
+	}
+	if (rc != 0) {
+		for (int i = 0; i < count; i++) {
+			if (it->batch[i] != NULL)
+				tuple_unref(it->batch[i]);
+		}
+		return -1;
+	}
+	it->batch_size = count;
+	return 0;
+}
+
+/**
+ * Return the next full tuple of a secondary index iterator
+ * working in autocommit mode. The tuple is referenced.
+ */
+static int
+vinyl_iterator_batch_next(struct vinyl_iterator *it, struct tuple **ret)
+{
+	while (true) {
+		while (it->batch_pos < it->batch_size) {
+			struct tuple *tuple = it->batch[it->batch_pos++];
+			if (tuple != NULL) {
+				*ret = tuple;
+				return 0;
+			}
+		}
+		if (vinyl_iterator_fill_batch(it) != 0)
+			return -1;
+		if (it->batch_size == 0) {
+			*ret = NULL;
+			return 0;
+		}
+	}
+}
+
 static int
 vinyl_iterator_next(struct iterator *base, struct tuple **ret)
 {
@@ -3818,8 +4237,14 @@ vinyl_iterator_next(struct iterator *base, struct tuple **ret)
 		goto fail;
 	}
 
-	if (vy_read_iterator_next(&it->iterator, &tuple) != 0)
+next:
+	if (it->batch_max > 0) {
+		/* Get full tuples from the primary index in batches. */
+		if (vinyl_iterator_batch_next(it, &tuple) != 0)
+			goto fail;
+	} else if (vy_read_iterator_next(&it->iterator, &tuple) != 0) {
 		goto fail;
+	}
 
 	if (tuple == NULL) {
 		/* EOF. Close the iterator immediately. */
@@ -3828,11 +4253,19 @@ vinyl_iterator_next(struct iterator *base, struct tuple **ret)
 		return 0;
 	}
 
-	if (it->index->id > 0) {
+	if (it->batch_max > 0) {
+		/* The tuple is already referenced. */
+	} else if (it->index->id > 0) {
 		/* Get the full tuple from the primary index. */
-		if (vy_index_get(it->index->pk, it->tx, it->rv,
-				 tuple, &tuple) != 0)
+		if (vy_index_get_by_secondary(it->index, it->tx, it->rv,
+					      tuple, &tuple) != 0)
 			goto fail;
+		if (tuple == NULL) {
+			/* Skip a stale secondary index entry. */
+			goto next;
+		}
+	} else if (vy_index_is_expired(it->index, tuple)) {
+		goto next;
 	} else {
 		tuple_ref(tuple);
 	}
@@ -3908,6 +4341,7 @@ vinyl_index_create_iterator(struct index *base, enum iterator_type type,
 	vy_index_ref(index);
 
 	it->rv_autocommit = NULL;
+	it->batch_size = it->batch_pos = 0;
 	trigger_create(&it->on_tx_destroy,
 		       vinyl_iterator_on_tx_destroy, NULL, NULL);
 
@@ -3929,6 +4363,7 @@ vinyl_index_create_iterator(struct index *base, enum iterator_type type,
 	}
 	it->tx = tx;
 	it->rv = rv;
+	it->batch_max = (index->id > 0 && tx == NULL) ? 1 : 0;
 
 	vy_read_iterator_open(&it->iterator, index, tx, type, it->key, rv);
 	return (struct iterator *)it;
@@ -4028,6 +4463,7 @@ static const struct index_vtab vinyl_index_vtab = {
 	/* .max = */ generic_index_max,
 	/* .random = */ generic_index_random,
 	/* .count = */ generic_index_count,
+	/* .aggregate = */ generic_index_aggregate,
 	/* .get = */ vinyl_index_get,
 	/* .replace = */ generic_index_replace,
 	/* .create_iterator = */ vinyl_index_create_iterator,
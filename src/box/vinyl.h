@@ -63,6 +63,13 @@ vinyl_engine_set_max_tuple_size(struct vinyl_engine *vinyl, size_t max_size);
 void
 vinyl_engine_set_timeout(struct vinyl_engine *vinyl, double timeout);
 
+/**
+ * Enable or disable parallel reads of runs in point lookups.
+ */
+void
+vinyl_engine_set_parallel_lookup(struct vinyl_engine *vinyl,
+				 bool parallel_lookup);
+
 /**
  * Update too_long_threshold.
  */
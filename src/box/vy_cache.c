@@ -48,14 +48,19 @@ enum {
 	/* Max number of deletes that are made by cleanup action per one
 	 * cache operation */
 	VY_CACHE_CLEANUP_MAX_STEPS = 10,
+	/* Max share of the cache quota that can be occupied by entries
+	 * of the hot segment, in percent */
+	VY_CACHE_HOT_PCT = 80,
 };
 
 void
 vy_cache_env_create(struct vy_cache_env *e, struct slab_cache *slab_cache,
 		    size_t mem_quota)
 {
-	rlist_create(&e->cache_lru);
+	rlist_create(&e->cold_lru);
+	rlist_create(&e->hot_lru);
 	e->mem_used = 0;
+	e->hot_used = 0;
 	e->mem_quota = mem_quota;
 	mempool_create(&e->cache_entry_mempool, slab_cache,
 		       sizeof(struct vy_cache_entry));
@@ -87,8 +92,11 @@ vy_cache_entry_new(struct vy_cache_env *env, struct vy_cache *cache,
 	entry->flags = 0;
 	entry->left_boundary_level = cache->cmp_def->part_count;
 	entry->right_boundary_level = cache->cmp_def->part_count;
-	rlist_add(&env->cache_lru, &entry->in_lru);
+	entry->is_hot = false;
+	rlist_add(&env->cold_lru, &entry->in_lru);
+	rlist_add(&cache->lru, &entry->in_cache_lru);
 	env->mem_used += vy_cache_entry_size(entry);
+	cache->mem_used += vy_cache_entry_size(entry);
 	vy_stmt_counter_acct_tuple(&cache->stat.count, stmt);
 	return entry;
 }
@@ -96,15 +104,50 @@ vy_cache_entry_new(struct vy_cache_env *env, struct vy_cache *cache,
 static void
 vy_cache_entry_delete(struct vy_cache_env *env, struct vy_cache_entry *entry)
 {
-	vy_stmt_counter_unacct_tuple(&entry->cache->stat.count, entry->stmt);
-	assert(env->mem_used >= vy_cache_entry_size(entry));
-	env->mem_used -= vy_cache_entry_size(entry);
+	struct vy_cache *cache = entry->cache;
+	size_t size = vy_cache_entry_size(entry);
+	vy_stmt_counter_unacct_tuple(&cache->stat.count, entry->stmt);
+	assert(env->mem_used >= size);
+	env->mem_used -= size;
+	assert(cache->mem_used >= size);
+	cache->mem_used -= size;
+	if (entry->is_hot) {
+		assert(env->hot_used >= size);
+		env->hot_used -= size;
+	}
 	tuple_unref(entry->stmt);
 	rlist_del(&entry->in_lru);
+	rlist_del(&entry->in_cache_lru);
 	TRASH(entry);
 	mempool_free(&env->cache_entry_mempool, entry);
 }
 
+/**
+ * Called when a cached statement is read again. Moves the entry
+ * to the head of the hot segment. If the hot segment exceeds its
+ * share of the quota, moves its oldest entries to the cold one.
+ */
+static void
+vy_cache_entry_touch(struct vy_cache_env *env, struct vy_cache_entry *entry)
+{
+	rlist_move(&entry->cache->lru, &entry->in_cache_lru);
+	if (!entry->is_hot) {
+		entry->is_hot = true;
+		env->hot_used += vy_cache_entry_size(entry);
+	}
+	rlist_move(&env->hot_lru, &entry->in_lru);
+
+	size_t hot_quota = env->mem_quota / 100 * VY_CACHE_HOT_PCT;
+	while (env->hot_used > hot_quota) {
+		struct vy_cache_entry *last = rlist_last_entry(&env->hot_lru,
+						struct vy_cache_entry, in_lru);
+		assert(last->is_hot);
+		last->is_hot = false;
+		env->hot_used -= vy_cache_entry_size(last);
+		rlist_move(&env->cold_lru, &last->in_lru);
+	}
+}
+
 static void *
 vy_cache_tree_page_alloc(void *ctx)
 {
@@ -127,11 +170,14 @@ vy_cache_tree_page_free(void *ctx, void *p)
 
 void
 vy_cache_create(struct vy_cache *cache, struct vy_cache_env *env,
-		struct key_def *cmp_def)
+		struct key_def *cmp_def, size_t mem_quota)
 {
 	cache->env = env;
 	cache->cmp_def = cmp_def;
 	cache->version = 1;
+	rlist_create(&cache->lru);
+	cache->mem_used = 0;
+	cache->mem_quota = mem_quota;
 	vy_cache_tree_create(&cache->cache_tree, cmp_def,
 			     vy_cache_tree_page_alloc,
 			     vy_cache_tree_page_free, env);
@@ -154,11 +200,8 @@ vy_cache_destroy(struct vy_cache *cache)
 }
 
 static void
-vy_cache_gc_step(struct vy_cache_env *env)
+vy_cache_gc_step(struct vy_cache_entry *entry)
 {
-	struct rlist *lru = &env->cache_lru;
-	struct vy_cache_entry *entry =
-	rlist_last_entry(lru, struct vy_cache_entry, in_lru);
 	struct vy_cache *cache = entry->cache;
 	struct vy_cache_tree *tree = &cache->cache_tree;
 	if (entry->flags & (VY_CACHE_LEFT_LINKED |
@@ -192,13 +235,29 @@ vy_cache_gc_step(struct vy_cache_env *env)
 	vy_cache_entry_delete(cache->env, entry);
 }
 
+/**
+ * Evict the oldest entries of a cache if it exceeds its own
+ * quota, then evict the oldest entries of the cold segment,
+ * or the hot segment if the cold one is empty, if the common
+ * quota is exceeded.
+ */
 static void
-vy_cache_gc(struct vy_cache_env *env)
+vy_cache_gc(struct vy_cache *cache)
 {
+	struct vy_cache_env *env = cache->env;
+	for (uint32_t i = 0;
+	     cache->mem_used > cache->mem_quota &&
+	     i < VY_CACHE_CLEANUP_MAX_STEPS; i++) {
+		vy_cache_gc_step(rlist_last_entry(&cache->lru,
+				struct vy_cache_entry, in_cache_lru));
+	}
 	for (uint32_t i = 0;
 	     env->mem_used > env->mem_quota && i < VY_CACHE_CLEANUP_MAX_STEPS;
 	     i++) {
-		vy_cache_gc_step(env);
+		struct rlist *lru = !rlist_empty(&env->cold_lru) ?
+				    &env->cold_lru : &env->hot_lru;
+		vy_cache_gc_step(rlist_last_entry(lru,
+				struct vy_cache_entry, in_lru));
 	}
 }
 
@@ -208,7 +267,7 @@ vy_cache_add(struct vy_cache *cache, struct tuple *stmt,
 	     enum iterator_type order)
 {
 	/* Delete some entries if quota overused */
-	vy_cache_gc(cache->env);
+	vy_cache_gc(cache);
 
 	if (stmt != NULL && vy_stmt_lsn(stmt) == INT64_MAX) {
 		/* Do not store a statement from write set of a tx */
@@ -292,6 +351,8 @@ vy_cache_add(struct vy_cache *cache, struct tuple *stmt,
 		entry->left_boundary_level = replaced->left_boundary_level;
 		entry->right_boundary_level = replaced->right_boundary_level;
 		vy_cache_entry_delete(cache->env, replaced);
+		/* The statement was read again, promote it. */
+		vy_cache_entry_touch(cache->env, entry);
 	}
 	if (direction > 0 && boundary_level < entry->left_boundary_level)
 		entry->left_boundary_level = boundary_level;
@@ -378,7 +439,11 @@ vy_cache_add(struct vy_cache *cache, struct tuple *stmt,
 		prev_entry->flags = replaced->flags;
 		prev_entry->left_boundary_level = replaced->left_boundary_level;
 		prev_entry->right_boundary_level = replaced->right_boundary_level;
+		bool is_hot = replaced->is_hot;
 		vy_cache_entry_delete(cache->env, replaced);
+		/* Keep the entry in the hot segment if it was there. */
+		if (is_hot)
+			vy_cache_entry_touch(cache->env, prev_entry);
 	}
 
 	/* Set proper flags */
@@ -395,6 +460,7 @@ vy_cache_get(struct vy_cache *cache, const struct tuple *key)
 		vy_cache_tree_find(&cache->cache_tree, key);
 	if (entry == NULL)
 		return NULL;
+	vy_cache_entry_touch(cache->env, *entry);
 	return (*entry)->stmt;
 }
 
@@ -402,7 +468,7 @@ void
 vy_cache_on_write(struct vy_cache *cache, const struct tuple *stmt,
 		  struct tuple **deleted)
 {
-	vy_cache_gc(cache->env);
+	vy_cache_gc(cache);
 	bool exact = false;
 	struct vy_cache_tree_iterator itr;
 	itr = vy_cache_tree_lower_bound(&cache->cache_tree, stmt, &exact);
@@ -614,6 +680,7 @@ vy_cache_iterator_seek(struct vy_cache_iterator *itr,
 
 	*entry = NULL;
 	itr->cache->stat.lookup++;
+	itr->cache->stat.range.lookup++;
 
 	if (tuple_field_count(key) > 0) {
 		bool exact;
@@ -637,6 +704,7 @@ vy_cache_iterator_seek(struct vy_cache_iterator *itr,
 		return;
 
 	*entry = *vy_cache_tree_iterator_get_elem(tree, &itr->curr_pos);
+	itr->cache->stat.range.hit++;
 }
 
 void
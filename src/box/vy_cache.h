@@ -54,8 +54,10 @@ struct vy_cache_entry {
 	struct vy_cache *cache;
 	/* Statement in cache */
 	struct tuple *stmt;
-	/* Link in LRU list */
+	/* Link in vy_cache_env::cold_lru or vy_cache_env::hot_lru */
 	struct rlist in_lru;
+	/* Link in vy_cache::lru */
+	struct rlist in_cache_lru;
 	/* VY_CACHE_LEFT_LINKED and/or VY_CACHE_RIGHT_LINKED, see
 	 * description of them for more information */
 	uint32_t flags;
@@ -63,6 +65,8 @@ struct vy_cache_entry {
 	uint8_t left_boundary_level;
 	/* Number of parts in key when the value was the last in EQ search */
 	uint8_t right_boundary_level;
+	/* Set if the entry is in the hot segment, see vy_cache_env */
+	bool is_hot;
 };
 
 /**
@@ -111,14 +115,32 @@ vy_cache_tree_key_cmp(struct vy_cache_entry *a,
 
 /**
  * Environment of the cache
+ *
+ * Cache entries are evicted in segmented LRU order so that
+ * a scan doesn't flush the working set: a statement is added
+ * to the cold segment and is moved to the hot segment only
+ * when it is read from the cache again. Entries are evicted
+ * from the cold segment first. When the hot segment grows
+ * beyond VY_CACHE_HOT_PCT of the quota, its least recently
+ * used entries are moved back to the cold segment.
  */
 struct vy_cache_env {
-	/** Common LRU list of read cache. The first element is the newest */
-	struct rlist cache_lru;
+	/**
+	 * LRU list of entries that have been read only once
+	 * since they were cached. The first element is the newest.
+	 */
+	struct rlist cold_lru;
+	/**
+	 * LRU list of entries that have been read from the cache.
+	 * The first element is the newest.
+	 */
+	struct rlist hot_lru;
 	/** Common mempool for vy_cache_entry struct */
 	struct mempool cache_entry_mempool;
 	/** Size of memory occupied by cached tuples */
 	size_t mem_used;
+	/** Size of memory occupied by entries of the hot segment */
+	size_t hot_used;
 	/** Max memory size that can be used for cache */
 	size_t mem_quota;
 };
@@ -155,6 +177,12 @@ struct vy_cache {
 	uint32_t version;
 	/* Saved pointer to common cache environment */
 	struct vy_cache_env *env;
+	/* LRU list of entries of this cache. The first one is the newest */
+	struct rlist lru;
+	/* Size of memory occupied by entries of this cache */
+	size_t mem_used;
+	/* Max memory size that can be used by this cache */
+	size_t mem_quota;
 	/* Cache statistics. */
 	struct vy_cache_stat stat;
 };
@@ -163,10 +191,12 @@ struct vy_cache {
  * Allocate and initialize tuple cache.
  * @param env - pointer to common cache environment.
  * @param cmp_def - key definition for tuple comparison.
+ * @param mem_quota - memory limit for this cache, in addition
+ *  to the common limit of the environment.
  */
 void
 vy_cache_create(struct vy_cache *cache, struct vy_cache_env *env,
-		struct key_def *cmp_def);
+		struct key_def *cmp_def, size_t mem_quota);
 
 /**
  * Destroy and deallocate tuple cache.
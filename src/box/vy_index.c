@@ -39,6 +39,8 @@
 #include "assoc.h"
 #include "diag.h"
 #include "errcode.h"
+#include "errinj.h"
+#include "fiber.h"
 #include "histogram.h"
 #include "index_def.h"
 #include "say.h"
@@ -100,6 +102,7 @@ vy_index_env_create(struct vy_index_env *env, const char *path,
 	env->upsert_thresh_cb = upsert_thresh_cb;
 	env->upsert_thresh_arg = upsert_thresh_arg;
 	env->too_long_threshold = TIMEOUT_INFINITY;
+	env->parallel_lookup = false;
 	env->index_count = 0;
 	return 0;
 }
@@ -214,7 +217,9 @@ vy_index_new(struct vy_index_env *index_env, struct vy_cache_env *cache_env,
 	index->refs = 1;
 	index->commit_lsn = -1;
 	index->dump_lsn = -1;
-	vy_cache_create(&index->cache, cache_env, cmp_def);
+	vy_cache_create(&index->cache, cache_env, cmp_def,
+			index_def->opts.cache_size > 0 ?
+			index_def->opts.cache_size : SIZE_MAX);
 	rlist_create(&index->sealed);
 	vy_range_tree_new(index->tree);
 	vy_range_heap_create(&index->range_heap);
@@ -727,16 +732,80 @@ vy_index_remove_range(struct vy_index *index, struct vy_range *range)
 	index->range_count--;
 }
 
+/**
+ * Return the current time used for decaying range heat.
+ * Tests may freeze it with ERRINJ_VY_RANGE_HEAT_TIME.
+ */
+static double
+vy_index_heat_now(void)
+{
+	struct errinj *inj = errinj(ERRINJ_VY_RANGE_HEAT_TIME, ERRINJ_DOUBLE);
+	if (inj != NULL && inj->dparam > 0)
+		return inj->dparam;
+	return ev_monotonic_now(loop());
+}
+
 void
 vy_index_acct_range(struct vy_index *index, struct vy_range *range)
 {
+	double now = vy_index_heat_now();
 	histogram_collect(index->run_hist, range->slice_count);
+	vy_range_heat_add(&index->range_heat,
+			  vy_range_heat(range, now), now);
 }
 
 void
 vy_index_unacct_range(struct vy_index *index, struct vy_range *range)
 {
+	double now = vy_index_heat_now();
 	histogram_discard(index->run_hist, range->slice_count);
+	vy_range_heat_add(&index->range_heat,
+			  -vy_range_heat(range, now), now);
+}
+
+void
+vy_index_acct_range_read(struct vy_index *index, struct vy_range *range)
+{
+	double now = vy_index_heat_now();
+	vy_range_heat_add(&range->read_heat, 1, now);
+	vy_range_heat_add(&index->range_heat, 1, now);
+}
+
+void
+vy_index_acct_range_write(struct vy_index *index, struct vy_range *range,
+			  int64_t rows)
+{
+	double now = vy_index_heat_now();
+	vy_range_heat_add(&range->write_heat, rows, now);
+	vy_range_heat_add(&index->range_heat, rows, now);
+}
+
+/**
+ * A range is considered hot if its heat is greater than the
+ * average heat of ranges of the same index multiplied by this
+ * factor, and cold if it is less than the average divided by it.
+ */
+#define VY_RANGE_HEAT_FACTOR 2
+
+/**
+ * Return the size a range should be kept at. Hot ranges are
+ * kept smaller than index_opts::range_size so that compaction
+ * of frequently accessed keys doesn't rewrite cold data along
+ * with them, while cold ranges are allowed to grow bigger.
+ */
+static int64_t
+vy_index_range_size(struct vy_index *index, struct vy_range *range,
+		    double now)
+{
+	int64_t range_size = index->opts.range_size;
+	double avg_heat = vy_range_heat_get(&index->range_heat, now) /
+			  index->range_count;
+	double heat = vy_range_heat(range, now);
+	if (heat > avg_heat * VY_RANGE_HEAT_FACTOR)
+		return range_size / VY_RANGE_HEAT_FACTOR;
+	if (heat < avg_heat / VY_RANGE_HEAT_FACTOR)
+		return range_size * VY_RANGE_HEAT_FACTOR;
+	return range_size;
 }
 
 int
@@ -768,6 +837,19 @@ vy_index_delete_mem(struct vy_index *index, struct vy_mem *mem)
 	index->mem_list_version++;
 }
 
+bool
+vy_index_mem_has_key(struct vy_index *index, const struct tuple *stmt)
+{
+	if (vy_mem_has_key(index->mem, stmt))
+		return true;
+	struct vy_mem *mem;
+	rlist_foreach_entry(mem, &index->sealed, in_sealed) {
+		if (vy_mem_has_key(mem, stmt))
+			return true;
+	}
+	return false;
+}
+
 int
 vy_index_set(struct vy_index *index, struct vy_mem *mem,
 	     const struct tuple *stmt, const struct tuple **region_stmt)
@@ -885,8 +967,9 @@ vy_index_commit_upsert(struct vy_index *index, struct vy_mem *mem,
 	    index->run_count == 0) {
 		older = vy_mem_older_lsn(mem, stmt);
 		assert(older == NULL || vy_stmt_type(older) != IPROTO_UPSERT);
+		const struct tuple *base = vy_index_upsert_base(index, older);
 		struct tuple *upserted =
-			vy_apply_upsert(stmt, older, index->cmp_def,
+			vy_apply_upsert(stmt, base, index->cmp_def,
 					index->mem_format,
 					index->upsert_format, false);
 		index->stat.upsert.applied++;
@@ -967,8 +1050,10 @@ vy_index_split_range(struct vy_index *index, struct vy_range *range)
 {
 	struct tuple_format *key_format = index->env->key_format;
 
+	double now = vy_index_heat_now();
+	int64_t range_size = vy_index_range_size(index, range, now);
 	const char *split_key_raw;
-	if (!vy_range_needs_split(range, &index->opts, &split_key_raw))
+	if (!vy_range_needs_split(range, range_size, &split_key_raw))
 		return false;
 
 	/* Split a range in two parts. */
@@ -1013,6 +1098,16 @@ vy_index_split_range(struct vy_index *index, struct vy_range *range)
 				vy_range_add_slice(part, new_slice);
 		}
 		part->compact_priority = range->compact_priority;
+		/*
+		 * We don't know how accesses are distributed
+		 * within the range, so split its heat evenly.
+		 */
+		part->read_heat.value = vy_range_heat_get(&range->read_heat,
+							  now) / n_parts;
+		part->read_heat.time = now;
+		part->write_heat.value = vy_range_heat_get(&range->write_heat,
+							   now) / n_parts;
+		part->write_heat.time = now;
 	}
 
 	/*
@@ -1073,9 +1168,13 @@ fail:
 bool
 vy_index_coalesce_range(struct vy_index *index, struct vy_range *range)
 {
+	double now = vy_index_heat_now();
+	double max_heat = vy_range_heat_get(&index->range_heat, now) /
+			  index->range_count * VY_RANGE_HEAT_FACTOR;
+	int64_t range_size = vy_index_range_size(index, range, now);
 	struct vy_range *first, *last;
-	if (!vy_range_needs_coalesce(range, index->tree, &index->opts,
-				     &first, &last))
+	if (!vy_range_needs_coalesce(range, index->tree, range_size,
+				     max_heat, now, &first, &last))
 		return false;
 
 	struct vy_range *result = vy_range_new(vy_log_next_id(),
@@ -1119,6 +1218,10 @@ vy_index_coalesce_range(struct vy_index *index, struct vy_range *range)
 		rlist_splice(&result->slices, &it->slices);
 		result->slice_count += it->slice_count;
 		vy_disk_stmt_counter_add(&result->count, &it->count);
+		vy_range_heat_add(&result->read_heat,
+				  vy_range_heat_get(&it->read_heat, now), now);
+		vy_range_heat_add(&result->write_heat,
+				  vy_range_heat_get(&it->write_heat, now), now);
 		vy_range_delete(it);
 		it = next;
 	}
@@ -37,6 +37,7 @@
 
 #include <small/rlist.h>
 
+#include "fiber.h"
 #include "index_def.h"
 #define HEAP_FORWARD_DECLARATION
 #include "salad/heap.h"
@@ -44,6 +45,7 @@
 #include "vy_range.h"
 #include "vy_stat.h"
 #include "vy_read_set.h"
+#include "vy_stmt.h"
 
 #if defined(__cplusplus)
 extern "C" {
@@ -77,6 +79,12 @@ struct vy_index_env {
 	 * the given value, warn about it in the log.
 	 */
 	double too_long_threshold;
+	/**
+	 * If set, a point lookup reads all slices of a range
+	 * that may store the key in parallel rather than one
+	 * by one, see vy_point_lookup().
+	 */
+	bool parallel_lookup;
 	/**
 	 * Callback invoked when the number of upserts for
 	 * the same key exceeds VY_UPSERT_THRESHOLD.
@@ -215,6 +223,12 @@ struct vy_index {
 	int range_count;
 	/** Heap of ranges, prioritized by compact_priority. */
 	heap_t range_heap;
+	/**
+	 * Sum of read and write heat of all ranges of this index,
+	 * see vy_range::read_heat. Used to tell hot ranges from
+	 * cold ones.
+	 */
+	struct vy_range_heat range_heat;
 	/**
 	 * List of all runs created for this index,
 	 * linked by vy_run->in_index.
@@ -269,6 +283,14 @@ struct vy_index {
 	int pin_count;
 	/** Set if the index is currently being dumped. */
 	bool is_dumping;
+	/**
+	 * Primary index only: set if REPLACE and DELETE don't
+	 * delete old tuples from secondary indexes. Instead,
+	 * DELETE statements are generated for secondary indexes
+	 * when overwritten tuples are purged from the primary
+	 * index by dump or compaction, see space_opts::defer_deletes.
+	 */
+	bool defer_deletes;
 	/** Link in vy_scheduler->dump_heap. */
 	struct heap_node in_dump;
 	/** Link in vy_scheduler->compact_heap. */
@@ -328,6 +350,36 @@ vy_index_unref(struct vy_index *index)
 		vy_index_delete(index);
 }
 
+/**
+ * Check if a tuple read from a primary index has expired and
+ * hence must be hidden from the user, see index_opts::ttl.
+ */
+static inline bool
+vy_index_is_expired(struct vy_index *index, const struct tuple *tuple)
+{
+	if (index->id > 0 || index->opts.ttl == 0)
+		return false;
+	return vy_tuple_is_expired(tuple, index->opts.ttl_field - 1,
+				   index->opts.ttl, fiber_time());
+}
+
+/**
+ * Return the statement an UPSERT should be applied to: @a stmt
+ * itself or NULL if it is a tuple that has expired. Compaction
+ * purges expired tuples, so an UPSERT must not see them either,
+ * otherwise its result would depend on whether the tuple has
+ * been compacted yet.
+ */
+static inline const struct tuple *
+vy_index_upsert_base(struct vy_index *index, const struct tuple *stmt)
+{
+	if (stmt != NULL && (vy_stmt_type(stmt) == IPROTO_REPLACE ||
+			     vy_stmt_type(stmt) == IPROTO_INSERT) &&
+	    vy_index_is_expired(index, stmt))
+		return NULL;
+	return stmt;
+}
+
 /**
  * Swap disk contents (ranges, runs, and corresponding stats)
  * between two indexes. Used only on recovery, to skip reloading
@@ -409,14 +461,23 @@ vy_index_add_range(struct vy_index *index, struct vy_range *range);
 void
 vy_index_remove_range(struct vy_index *index, struct vy_range *range);
 
-/** Account a range to the run histogram of an index. */
+/** Account a range to the run histogram and heat of an index. */
 void
 vy_index_acct_range(struct vy_index *index, struct vy_range *range);
 
-/** Unaccount a range from the run histogram of an index. */
+/** Unaccount a range from the run histogram and heat of an index. */
 void
 vy_index_unacct_range(struct vy_index *index, struct vy_range *range);
 
+/** Account a lookup in a range to its read heat. */
+void
+vy_index_acct_range_read(struct vy_index *index, struct vy_range *range);
+
+/** Account statements dumped to a range to its write heat. */
+void
+vy_index_acct_range_write(struct vy_index *index, struct vy_range *range,
+			  int64_t rows);
+
 /**
  * Allocate a new active in-memory index for an index while moving
  * the old one to the sealed list. Used by the dump task in order
@@ -433,6 +494,14 @@ vy_index_rotate_mem(struct vy_index *index);
 void
 vy_index_delete_mem(struct vy_index *index, struct vy_mem *mem);
 
+/**
+ * Return true if any in-memory tree of a vinyl index,
+ * active or sealed, has a statement for the key of
+ * the given statement.
+ */
+bool
+vy_index_mem_has_key(struct vy_index *index, const struct tuple *stmt);
+
 /**
  * Split a range if it has grown too big, return true if the range
  * was split. Splitting is done by making slices of the runs used
@@ -53,7 +53,7 @@ vy_mem_env_create(struct vy_mem_env *env, size_t memory)
 	/* Vinyl memory is limited by vy_quota. */
 	quota_init(&env->quota, QUOTA_MAX);
 	tuple_arena_create(&env->arena, &env->quota, memory,
-			   SLAB_SIZE, "vinyl");
+			   SLAB_SIZE, TUPLE_ARENA_PAGES_NONE, -1, "vinyl");
 	lsregion_create(&env->allocator, &env->arena);
 	env->tree_extent_size = 0;
 }
@@ -175,6 +175,22 @@ vy_mem_older_lsn(struct vy_mem *mem, const struct tuple *stmt)
 	return result;
 }
 
+bool
+vy_mem_has_key(struct vy_mem *mem, const struct tuple *stmt)
+{
+	struct tree_mem_key tree_key;
+	tree_key.stmt = stmt;
+	tree_key.lsn = INT64_MAX;
+	bool exact = false;
+	struct vy_mem_tree_iterator itr =
+		vy_mem_tree_lower_bound(&mem->tree, &tree_key, &exact);
+	if (vy_mem_tree_iterator_is_invalid(&itr))
+		return false;
+	const struct tuple *result;
+	result = *vy_mem_tree_iterator_get_elem(&mem->tree, &itr);
+	return vy_tuple_compare(result, stmt, mem->cmp_def) == 0;
+}
+
 int
 vy_mem_insert_upsert(struct vy_mem *mem, const struct tuple *stmt)
 {
@@ -264,9 +280,15 @@ vy_mem_commit_stmt(struct vy_mem *mem, const struct tuple *stmt)
 	/* The statement must be from a lsregion. */
 	assert(!vy_stmt_is_refable(stmt));
 	int64_t lsn = vy_stmt_lsn(stmt);
-	if (mem->min_lsn == INT64_MAX)
+	/*
+	 * Statements are usually committed in the LSN order,
+	 * but deferred DELETEs generated for secondary indexes
+	 * by primary index dump or compaction are older than
+	 * statements already stored in the tree, see
+	 * vy_index::defer_deletes.
+	 */
+	if (mem->min_lsn > lsn)
 		mem->min_lsn = lsn;
-	assert(mem->min_lsn <= lsn);
 	if (mem->max_lsn < lsn)
 		mem->max_lsn = lsn;
 }
@@ -648,7 +670,9 @@ vy_mem_stream_next(struct vy_stmt_stream *virt_stream, struct tuple **ret)
 	struct tuple **res = (struct tuple **)
 		vy_mem_tree_iterator_get_elem(&stream->mem->tree,
 					      &stream->curr_pos);
-	if (res == NULL) {
+	if (res == NULL || (stream->end != NULL &&
+			    vy_stmt_compare(*res, stream->end,
+					    stream->mem->cmp_def) >= 0)) {
 		*ret = NULL;
 	} else {
 		*ret = *res;
@@ -666,11 +690,22 @@ static const struct vy_stmt_stream_iface vy_mem_stream_iface = {
 };
 
 void
-vy_mem_stream_open(struct vy_mem_stream *stream, struct vy_mem *mem)
+vy_mem_stream_open(struct vy_mem_stream *stream, struct vy_mem *mem,
+		   const struct tuple *begin, const struct tuple *end)
 {
 	stream->base.iface = &vy_mem_stream_iface;
 	stream->mem = mem;
-	stream->curr_pos = vy_mem_tree_iterator_first(&mem->tree);
+	stream->end = end;
+	if (begin == NULL) {
+		stream->curr_pos = vy_mem_tree_iterator_first(&mem->tree);
+	} else {
+		struct tree_mem_key tree_key;
+		tree_key.stmt = begin;
+		tree_key.lsn = INT64_MAX - 1;
+		bool exact;
+		stream->curr_pos = vy_mem_tree_lower_bound(&mem->tree,
+							   &tree_key, &exact);
+	}
 }
 
 /* }}} vy_mem_iterator API implementation */
@@ -272,6 +272,13 @@ vy_mem_delete(struct vy_mem *index);
 const struct tuple *
 vy_mem_older_lsn(struct vy_mem *mem, const struct tuple *stmt);
 
+/**
+ * Return true if the in-memory tree has a statement for
+ * the key of the given statement.
+ */
+bool
+vy_mem_has_key(struct vy_mem *mem, const struct tuple *stmt);
+
 /**
  * Insert a statement into the in-memory level.
  * @param mem        vy_mem.
@@ -425,13 +432,21 @@ struct vy_mem_stream {
 	struct vy_mem *mem;
 	/** Current position */
 	struct vy_mem_tree_iterator curr_pos;
+	/**
+	 * Statements greater than or equal to this key are
+	 * not returned by the stream. NULL if unbounded.
+	 */
+	const struct tuple *end;
 };
 
 /**
  * Open a mem stream. Use vy_stmt_stream api for further work.
+ * If @begin or @end is not NULL, only statements in the key
+ * range [@begin, @end) are returned.
  */
 void
-vy_mem_stream_open(struct vy_mem_stream *stream, struct vy_mem *mem);
+vy_mem_stream_open(struct vy_mem_stream *stream, struct vy_mem *mem,
+		   const struct tuple *begin, const struct tuple *end);
 
 #if defined(__cplusplus)
 } /* extern "C" */
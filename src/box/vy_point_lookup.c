@@ -30,6 +30,7 @@
  */
 #include "vy_point_lookup.h"
 
+#include <stdarg.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
@@ -72,13 +73,12 @@ struct vy_stmt_history_node {
 };
 
 /**
- * Allocate (region) new history node.
+ * Allocate new history node on the given region.
  * @return new node or NULL on memory error (diag is set).
  */
 static struct vy_stmt_history_node *
-vy_stmt_history_node_new(void)
+vy_stmt_history_node_new(struct region *region)
 {
-	struct region *region = &fiber()->gc;
 	struct vy_stmt_history_node *node = region_alloc(region, sizeof(*node));
 	if (node == NULL)
 		diag_set(OutOfMemory, sizeof(*node), "region",
@@ -136,7 +136,8 @@ vy_point_lookup_scan_txw(struct vy_index *index, struct vy_tx *tx,
 		return 0;
 	vy_stmt_counter_acct_tuple(&index->stat.txw.iterator.get,
 				   txv->stmt);
-	struct vy_stmt_history_node *node = vy_stmt_history_node_new();
+	struct vy_stmt_history_node *node =
+		vy_stmt_history_node_new(&fiber()->gc);
 	if (node == NULL)
 		return -1;
 	node->src_type = ITER_SRC_TXW;
@@ -155,13 +156,16 @@ vy_point_lookup_scan_cache(struct vy_index *index,
 			   struct tuple *key, struct rlist *history)
 {
 	index->cache.stat.lookup++;
+	index->cache.stat.point.lookup++;
 	struct tuple *stmt = vy_cache_get(&index->cache, key);
 
 	if (stmt == NULL || vy_stmt_lsn(stmt) > (*rv)->vlsn)
 		return 0;
 
+	index->cache.stat.point.hit++;
 	vy_stmt_counter_acct_tuple(&index->cache.stat.get, stmt);
-	struct vy_stmt_history_node *node = vy_stmt_history_node_new();
+	struct vy_stmt_history_node *node =
+		vy_stmt_history_node_new(&fiber()->gc);
 	if (node == NULL)
 		return -1;
 
@@ -198,7 +202,8 @@ vy_point_lookup_scan_mem(struct vy_index *index, struct vy_mem *mem,
 		return 0;
 
 	while (true) {
-		struct vy_stmt_history_node *node = vy_stmt_history_node_new();
+		struct vy_stmt_history_node *node =
+			vy_stmt_history_node_new(&fiber()->gc);
 		if (node == NULL)
 			return -1;
 
@@ -249,13 +254,15 @@ vy_point_lookup_scan_mems(struct vy_index *index,
 /**
  * Scan one particular slice.
  * Add found statements to the history list up to terminal statement.
+ * History nodes are allocated on the given region.
  * Set *terminal_found to true if the terminal statement (DELETE or REPLACE)
  * was found.
  */
 static int
 vy_point_lookup_scan_slice(struct vy_index *index, struct vy_slice *slice,
 			   const struct vy_read_view **rv, struct tuple *key,
-			   struct rlist *history, bool *terminal_found)
+			   struct region *region, struct rlist *history,
+			   bool *terminal_found)
 {
 	int rc = 0;
 	/*
@@ -271,7 +278,8 @@ vy_point_lookup_scan_slice(struct vy_index *index, struct vy_slice *slice,
 	struct tuple *stmt;
 	rc = vy_run_iterator_next_key(&run_itr, &stmt);
 	while (rc == 0 && stmt != NULL) {
-		struct vy_stmt_history_node *node = vy_stmt_history_node_new();
+		struct vy_stmt_history_node *node =
+			vy_stmt_history_node_new(region);
 		if (node == NULL) {
 			rc = -1;
 			break;
@@ -290,6 +298,103 @@ vy_point_lookup_scan_slice(struct vy_index *index, struct vy_slice *slice,
 	return rc;
 }
 
+static int
+vy_point_lookup_scan_slice_f(va_list ap)
+{
+	struct vy_index *index = va_arg(ap, struct vy_index *);
+	struct vy_slice *slice = va_arg(ap, struct vy_slice *);
+	const struct vy_read_view **rv =
+		va_arg(ap, const struct vy_read_view **);
+	struct tuple *key = va_arg(ap, struct tuple *);
+	struct region *region = va_arg(ap, struct region *);
+	struct rlist *history = va_arg(ap, struct rlist *);
+	bool *terminal_found = va_arg(ap, bool *);
+	return vy_point_lookup_scan_slice(index, slice, rv, key, region,
+					  history, terminal_found);
+}
+
+/**
+ * Scan the given slices at once. Each slice but the last one is
+ * scanned in a separate fiber, so if the key has to be read from
+ * disk, reads of all runs are spread over vinyl reader threads
+ * rather than issued one after another. This pays off if the
+ * newest runs don't have the key despite the bloom filter or
+ * the key history consists of UPSERTs.
+ *
+ * Since slices are sorted from newest to oldest and don't
+ * overlap by LSN, histories found in slices are concatenated
+ * in the same order up to the first terminal statement.
+ */
+static int
+vy_point_lookup_scan_slices_parallel(struct vy_index *index,
+				     struct vy_slice **slices, int slice_count,
+				     const struct vy_read_view **rv,
+				     struct tuple *key, struct rlist *history)
+{
+	struct region *region = &fiber()->gc;
+	size_t size = slice_count * (sizeof(struct rlist) +
+				     sizeof(struct fiber *) + sizeof(bool));
+	struct rlist *histories = region_alloc(region, size);
+	if (histories == NULL) {
+		diag_set(OutOfMemory, size, "region", "slice histories");
+		return -1;
+	}
+	struct fiber **fibers = (struct fiber **)(histories + slice_count);
+	bool *terminal_found = (bool *)(fibers + slice_count);
+
+	int i, rc = 0;
+	for (i = 0; i < slice_count; i++) {
+		rlist_create(&histories[i]);
+		terminal_found[i] = false;
+		fibers[i] = NULL;
+		if (i == slice_count - 1)
+			continue;
+		struct fiber *f = fiber_new("vinyl.lookup",
+					    vy_point_lookup_scan_slice_f);
+		if (f == NULL) {
+			/* Fall back on scan in this fiber. */
+			diag_clear(diag_get());
+			continue;
+		}
+		fiber_set_joinable(f, true);
+		fiber_start(f, index, slices[i], rv, key, region,
+			    &histories[i], &terminal_found[i]);
+		fibers[i] = f;
+	}
+	for (i = 0; i < slice_count; i++) {
+		if (rc == 0 && fibers[i] == NULL &&
+		    vy_point_lookup_scan_slice(index, slices[i], rv, key,
+					       region, &histories[i],
+					       &terminal_found[i]) != 0)
+			rc = -1;
+	}
+	for (i = 0; i < slice_count; i++) {
+		if (fibers[i] != NULL && fiber_join(fibers[i]) != 0)
+			rc = -1;
+	}
+
+	bool done = false;
+	for (i = 0; i < slice_count; i++) {
+		struct vy_stmt_history_node *node, *tmp;
+		rlist_foreach_entry_safe(node, &histories[i], link, tmp) {
+			if (done && rc == 0) {
+				/* Older than the terminal statement. */
+				tuple_unref(node->stmt);
+				continue;
+			}
+			/*
+			 * On error, move all statements to the
+			 * history so that the caller unreferences
+			 * them.
+			 */
+			rlist_move_tail_entry(history, node, link);
+		}
+		if (terminal_found[i])
+			done = true;
+	}
+	return rc;
+}
+
 /**
  * Find a range and scan all slices that belongs to the range.
  * Add found statements to the history list up to terminal statement.
@@ -304,6 +409,7 @@ vy_point_lookup_scan_slices(struct vy_index *index,
 	struct vy_range *range = vy_range_tree_find_by_key(index->tree,
 							   ITER_EQ, key);
 	assert(range != NULL);
+	vy_index_acct_range_read(index, range);
 	int slice_count = range->slice_count;
 	struct vy_slice **slices = (struct vy_slice **)
 		region_alloc(&fiber()->gc, slice_count * sizeof(*slices));
@@ -320,13 +426,18 @@ vy_point_lookup_scan_slices(struct vy_index *index,
 	}
 	assert(i == slice_count);
 	int rc = 0;
-	bool terminal_found = false;
-	for (i = 0; i < slice_count; i++) {
-		if (rc == 0 && !terminal_found)
+	if (index->env->parallel_lookup && slice_count > 1) {
+		rc = vy_point_lookup_scan_slices_parallel(index, slices,
+					slice_count, rv, key, history);
+	} else {
+		bool terminal_found = false;
+		for (i = 0; i < slice_count && rc == 0 && !terminal_found; i++)
 			rc = vy_point_lookup_scan_slice(index, slices[i],
-					rv, key, history, &terminal_found);
-		vy_slice_unpin(slices[i]);
+					rv, key, &fiber()->gc, history,
+					&terminal_found);
 	}
+	for (i = 0; i < slice_count; i++)
+		vy_slice_unpin(slices[i]);
 	return rc;
 }
 
@@ -347,8 +458,9 @@ vy_point_lookup_apply_history(struct vy_index *index,
 	struct vy_stmt_history_node *node =
 		rlist_last_entry(history, struct vy_stmt_history_node, link);
 	if (vy_stmt_history_is_terminal(history)) {
-		if (vy_stmt_type(node->stmt) == IPROTO_DELETE) {
-			/* Ignore terminal delete */
+		if (vy_stmt_type(node->stmt) == IPROTO_DELETE ||
+		    vy_index_upsert_base(index, node->stmt) == NULL) {
+			/* Ignore terminal delete and expired tuple */
 		} else if (node->src_type == ITER_SRC_MEM) {
 			curr_stmt = vy_stmt_dup(node->stmt,
 						tuple_format(node->stmt));
@@ -39,8 +39,9 @@
  * (txw, cache, mems, runs) that consists of some number of sequential upserts
  * and possibly one terminal statement (replace or delete). The iterator
  * sequentially scans txw, cache, mems and runs until a terminal statement is
- * met. After reading the slices the iterator checks that the list of mems
- * hasn't been changed and restarts if it is the case.
+ * met. If vinyl_parallel_lookup is set, all slices of the range are read
+ * at once instead. After reading the slices the iterator checks that the
+ * list of mems hasn't been changed and restarts if it is the case.
  * After the history is collected the iterator calculates resultant statement
  * and, if the result is the latest version of the key, adds it to cache.
  */
@@ -65,6 +65,24 @@ struct vy_quota {
 	size_t watermark;
 	/** Current memory consumption. */
 	size_t used;
+	/**
+	 * Max rate at which memory may be consumed, in bytes
+	 * per second, or SIZE_MAX if unlimited. Used to slow
+	 * down consumers gradually once the watermark has been
+	 * exceeded so that they don't stall on hitting the limit.
+	 */
+	size_t rate_limit;
+	/**
+	 * Amount of memory that may be consumed without waiting.
+	 * Replenished at rate_limit, may be negative.
+	 */
+	double rate_budget;
+	/** Time when rate_budget was last replenished. */
+	double rate_timestamp;
+	/** Number of times consumers were throttled. */
+	int64_t throttle_count;
+	/** Total time consumers spent throttled, in seconds. */
+	double throttle_time;
 	/**
 	 * Condition variable used for throttling consumers when
 	 * there is no quota left.
@@ -83,6 +101,11 @@ vy_quota_create(struct vy_quota *q, vy_quota_exceeded_f quota_exceeded_cb)
 	q->limit = SIZE_MAX;
 	q->watermark = SIZE_MAX;
 	q->used = 0;
+	q->rate_limit = SIZE_MAX;
+	q->rate_budget = 0;
+	q->rate_timestamp = 0;
+	q->throttle_count = 0;
+	q->throttle_time = 0;
 	q->quota_exceeded_cb = quota_exceeded_cb;
 	fiber_cond_create(&q->cond);
 }
@@ -117,6 +140,42 @@ vy_quota_set_watermark(struct vy_quota *q, size_t watermark)
 		q->quota_exceeded_cb(q);
 }
 
+/**
+ * Replenish the amount of memory that may be consumed without
+ * waiting according to the rate limit. The budget is capped by
+ * the amount of memory that may be consumed in a second so that
+ * consumers can't accumulate a burst while idle.
+ */
+static inline void
+vy_quota_refill(struct vy_quota *q)
+{
+	double now = ev_monotonic_now(loop());
+	if (q->rate_limit != SIZE_MAX) {
+		q->rate_budget += (now - q->rate_timestamp) * q->rate_limit;
+		if (q->rate_budget > q->rate_limit)
+			q->rate_budget = q->rate_limit;
+	}
+	q->rate_timestamp = now;
+}
+
+/**
+ * Set the max rate at which memory may be consumed, in bytes
+ * per second. Pass SIZE_MAX to disable rate limiting.
+ */
+static inline void
+vy_quota_set_rate_limit(struct vy_quota *q, size_t rate_limit)
+{
+	if (q->rate_limit == rate_limit)
+		return;
+	vy_quota_refill(q);
+	if (q->rate_limit == SIZE_MAX)
+		q->rate_budget = 0;
+	bool wakeup = rate_limit > q->rate_limit;
+	q->rate_limit = rate_limit > 0 ? rate_limit : 1;
+	if (wakeup)
+		fiber_cond_broadcast(&q->cond);
+}
+
 /**
  * Consume @size bytes of memory. In contrast to vy_quota_use()
  * this function does not throttle the caller.
@@ -140,15 +199,47 @@ vy_quota_release(struct vy_quota *q, size_t size)
 	fiber_cond_broadcast(&q->cond);
 }
 
+/**
+ * Throttle the caller until the rate limit allows to consume
+ * more memory. If the rate limit wouldn't allow it before
+ * @deadline, don't wait at all: sleeping until the deadline
+ * is pointless, the caller is only constrained by the hard
+ * limit then.
+ */
+static inline void
+vy_quota_throttle(struct vy_quota *q, double deadline)
+{
+	double start = ev_monotonic_now(loop());
+	bool throttled = false;
+	while (q->rate_limit != SIZE_MAX) {
+		vy_quota_refill(q);
+		if (q->rate_budget >= 0)
+			break;
+		double now = ev_monotonic_now(loop());
+		double delay = -q->rate_budget / q->rate_limit;
+		if (now + delay >= deadline)
+			break;
+		throttled = true;
+		fiber_cond_wait_deadline(&q->cond, now + delay);
+	}
+	if (throttled) {
+		q->throttle_count++;
+		q->throttle_time += ev_monotonic_now(loop()) - start;
+	}
+}
+
 /**
  * Try to consume @size bytes of memory, throttle the caller
- * if the limit is exceeded. @timeout specifies the maximal
- * time to wait. Return 0 on success, -1 on timeout.
+ * if the limit or the rate limit is exceeded. @timeout specifies
+ * the maximal time to wait. Return 0 on success, -1 on timeout.
+ * Note, running out of time while being throttled by the rate
+ * limit is not an error.
  */
 static inline int
 vy_quota_use(struct vy_quota *q, size_t size, double timeout)
 {
 	double deadline = ev_monotonic_now(loop()) + timeout;
+	vy_quota_throttle(q, deadline);
 	while (q->used + size > q->limit && timeout > 0) {
 		q->quota_exceeded_cb(q);
 		if (fiber_cond_wait_deadline(&q->cond, deadline) != 0)
@@ -157,6 +248,8 @@ vy_quota_use(struct vy_quota *q, size_t size, double timeout)
 	if (q->used + size > q->limit)
 		return -1;
 	q->used += size;
+	if (q->rate_limit != SIZE_MAX)
+		q->rate_budget -= size;
 	if (q->used >= q->watermark)
 		q->quota_exceeded_cb(q);
 	return 0;
@@ -379,7 +379,7 @@ vy_range_update_compact_priority(struct vy_range *range,
  *   4/3 * range_size.
  */
 bool
-vy_range_needs_split(struct vy_range *range, const struct index_opts *opts,
+vy_range_needs_split(struct vy_range *range, int64_t range_size,
 		     const char **p_split_key)
 {
 	struct vy_slice *slice;
@@ -393,7 +393,7 @@ vy_range_needs_split(struct vy_range *range, const struct index_opts *opts,
 	slice = rlist_last_entry(&range->slices, struct vy_slice, in_range);
 
 	/* The range is too small to be split. */
-	if (slice->count.bytes_compressed < opts->range_size * 4 / 3)
+	if (slice->count.bytes_compressed < range_size * 4 / 3)
 		return false;
 
 	/* Find the median key in the oldest run (approximately). */
@@ -446,10 +446,12 @@ vy_range_needs_split(struct vy_range *range, const struct index_opts *opts,
  *
  * We coalesce ranges together when they become too small, less than
  * half the target range size to avoid split-coalesce oscillations.
+ * Hot ranges are never coalesced, because they would have to be
+ * split back soon.
  */
 bool
 vy_range_needs_coalesce(struct vy_range *range, vy_range_tree_t *tree,
-			const struct index_opts *opts,
+			int64_t range_size, double max_heat, double now,
 			struct vy_range **p_first, struct vy_range **p_last)
 {
 	struct vy_range *it;
@@ -457,7 +459,7 @@ vy_range_needs_coalesce(struct vy_range *range, vy_range_tree_t *tree,
 	/* Size of the coalesced range. */
 	uint64_t total_size = range->count.bytes_compressed;
 	/* Coalesce ranges until total_size > max_size. */
-	uint64_t max_size = opts->range_size / 2;
+	uint64_t max_size = range_size / 2;
 
 	/*
 	 * We can't coalesce a range that was scheduled for dump
@@ -467,11 +469,14 @@ vy_range_needs_coalesce(struct vy_range *range, vy_range_tree_t *tree,
 	assert(!vy_range_is_scheduled(range));
 
 	*p_first = *p_last = range;
+	if (vy_range_heat(range, now) > max_heat)
+		return false;
 	for (it = vy_range_tree_next(tree, range);
 	     it != NULL && !vy_range_is_scheduled(it);
 	     it = vy_range_tree_next(tree, it)) {
 		uint64_t size = it->count.bytes_compressed;
-		if (total_size + size > max_size)
+		if (total_size + size > max_size ||
+		    vy_range_heat(it, now) > max_heat)
 			break;
 		total_size += size;
 		*p_last = it;
@@ -480,7 +485,8 @@ vy_range_needs_coalesce(struct vy_range *range, vy_range_tree_t *tree,
 	     it != NULL && !vy_range_is_scheduled(it);
 	     it = vy_range_tree_prev(tree, it)) {
 		uint64_t size = it->count.bytes_compressed;
-		if (total_size + size > max_size)
+		if (total_size + size > max_size ||
+		    vy_range_heat(it, now) > max_heat)
 			break;
 		total_size += size;
 		*p_first = it;
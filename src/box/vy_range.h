@@ -31,6 +31,7 @@
  * SUCH DAMAGE.
  */
 
+#include <math.h>
 #include <stdbool.h>
 #include <stdint.h>
 
@@ -53,6 +54,44 @@ struct key_def;
 struct tuple;
 struct vy_slice;
 
+enum {
+	/** Time, in seconds, it takes range heat to halve. */
+	VY_RANGE_HEAT_HALF_LIFE = 60,
+};
+
+/**
+ * Exponentially decaying counter of accesses to a key range.
+ * Since the decay is linear, the heat of a set of ranges can
+ * be tracked with a single counter.
+ */
+struct vy_range_heat {
+	/** Value of the counter at @time. */
+	double value;
+	/** Time of the last update, see ev_monotonic_now(). */
+	double time;
+};
+
+/** Return the value of a heat counter at time @now. */
+static inline double
+vy_range_heat_get(struct vy_range_heat *heat, double now)
+{
+	if (now > heat->time) {
+		heat->value *= exp2((heat->time - now) /
+				    VY_RANGE_HEAT_HALF_LIFE);
+		heat->time = now;
+	}
+	return heat->value;
+}
+
+/** Add @delta to a heat counter at time @now. */
+static inline void
+vy_range_heat_add(struct vy_range_heat *heat, double delta, double now)
+{
+	heat->value = vy_range_heat_get(heat, now) + delta;
+	if (heat->value < 0)
+		heat->value = 0;
+}
+
 /**
  * Range of keys in an index stored on disk.
  */
@@ -108,6 +147,15 @@ struct vy_range {
 	int compact_priority;
 	/** Number of times the range was compacted. */
 	int n_compactions;
+	/**
+	 * Number of lookups in this range, decaying with time.
+	 * Along with @write_heat, used to keep hot key ranges
+	 * small and to coalesce cold ones, so that compaction
+	 * work follows the access pattern.
+	 */
+	struct vy_range_heat read_heat;
+	/** Number of statements dumped to this range, decaying. */
+	struct vy_range_heat write_heat;
 	/** Link in vy_index->tree. */
 	rb_node(struct vy_range) tree_node;
 	/** Link in vy_index->range_heap. */
@@ -222,6 +270,14 @@ vy_range_add_slice_before(struct vy_range *range, struct vy_slice *slice,
 void
 vy_range_remove_slice(struct vy_range *range, struct vy_slice *slice);
 
+/** Return the sum of read and write heat of a range at @now. */
+static inline double
+vy_range_heat(struct vy_range *range, double now)
+{
+	return vy_range_heat_get(&range->read_heat, now) +
+	       vy_range_heat_get(&range->write_heat, now);
+}
+
 /**
  * Update compaction priority of a range.
  *
@@ -236,13 +292,13 @@ vy_range_update_compact_priority(struct vy_range *range,
  * Check if a range needs to be split in two.
  *
  * @param range             The range.
- * @param opts              Index options.
+ * @param range_size        Target range size.
  * @param[out] p_split_key  Key to split the range by.
  *
  * @retval true             If the range needs to be split.
  */
 bool
-vy_range_needs_split(struct vy_range *range, const struct index_opts *opts,
+vy_range_needs_split(struct vy_range *range, int64_t range_size,
 		     const char **p_split_key);
 
 /**
@@ -251,7 +307,9 @@ vy_range_needs_split(struct vy_range *range, const struct index_opts *opts,
  *
  * @param range         The range.
  * @param tree          The range tree.
- * @param opts          Index options.
+ * @param range_size    Target range size.
+ * @param max_heat      Ranges hotter than that are not coalesced.
+ * @param now           Current time, see ev_monotonic_now().
  * @param[out] p_first  The first range in the tree to coalesce.
  * @param[out] p_last   The last range in the tree to coalesce.
  *
@@ -259,7 +317,7 @@ vy_range_needs_split(struct vy_range *range, const struct index_opts *opts,
  */
 bool
 vy_range_needs_coalesce(struct vy_range *range, vy_range_tree_t *tree,
-			const struct index_opts *opts,
+			int64_t range_size, double max_heat, double now,
 			struct vy_range **p_first, struct vy_range **p_last);
 
 #if defined(__cplusplus)
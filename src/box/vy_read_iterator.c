@@ -650,7 +650,8 @@ vy_read_iterator_squash_upsert(struct vy_read_iterator *itr,
 			tuple_unref(t);
 			return rc;
 		}
-		struct tuple *applied = vy_apply_upsert(t, next,
+		struct tuple *applied = vy_apply_upsert(t,
+				vy_index_upsert_base(index, next),
 				index->cmp_def, index->mem_format,
 				index->upsert_format, true);
 		index->stat.upsert.applied++;
@@ -722,6 +723,7 @@ vy_read_iterator_add_disk(struct vy_read_iterator *itr)
 					    itr->iterator_type : ITER_LE);
 	struct vy_index *index = itr->index;
 	struct vy_slice *slice;
+	vy_index_acct_range_read(index, itr->curr_range);
 	/*
 	 * The format of the statement must be exactly the space
 	 * format with the same identifier to fully match the
@@ -737,8 +739,12 @@ vy_read_iterator_add_disk(struct vy_read_iterator *itr)
 		 * Since index->dump_lsn is bumped after deletion
 		 * of dumped in-memory trees, we can filter out
 		 * the run slice containing duplicates by LSN.
+		 * Note, we can't use the min LSN of the run for
+		 * this, because deferred DELETEs stored in a run
+		 * of a secondary index may be older than the last
+		 * dump, see vy_index::defer_deletes.
 		 */
-		if (slice->run->info.min_lsn > index->dump_lsn)
+		if (slice->run->dump_lsn > index->dump_lsn)
 			continue;
 		assert(slice->run->info.max_lsn <= index->dump_lsn);
 		struct vy_read_src *sub_src = vy_read_iterator_add_src(itr);
@@ -32,10 +32,14 @@
 
 #include <zstd.h>
 
+#include <fcntl.h>
+#include <sys/stat.h>
+
 #include "fiber.h"
 #include "fiber_cond.h"
 #include "fio.h"
 #include "cbus.h"
+#include "coio_file.h"
 #include "memory.h"
 
 #include "replication.h"
@@ -58,6 +62,17 @@ static const uint64_t vy_run_info_key_map = (1 << VY_RUN_INFO_MIN_KEY) |
 
 enum { VY_BLOOM_VERSION = 0 };
 
+enum {
+	/**
+	 * Number of pages a run iterator has to load in a row,
+	 * each following the previous one in the iteration
+	 * direction, to start reading pages ahead.
+	 */
+	VY_RUN_READ_AHEAD_SEQ_MIN = 2,
+	/** Max number of pages read ahead by a run iterator. */
+	VY_RUN_READ_AHEAD_MAX = 4,
+};
+
 /** xlog meta type for .run files */
 #define XLOG_META_TYPE_RUN "RUN"
 
@@ -94,6 +109,39 @@ struct vy_page_read_task {
 	struct vy_page *page;
 };
 
+/**
+ * Cbus message for reading a page ahead. Unlike vy_page_read_task,
+ * the iterator doesn't wait for the page to be read after sending
+ * the message. It may even drop the iterator, in which case the
+ * message is freed as soon as it returns to tx.
+ */
+struct vy_page_read_ahead {
+	/** parent */
+	struct cmsg base;
+	/** Read the page in a reader thread, then return to tx. */
+	struct cmsg_hop route[2];
+	/** Link in vy_run_iterator::read_ahead. */
+	struct rlist in_read_ahead;
+	/** vy_run with fd - referenced by the message */
+	struct vy_run *run;
+	/** vinyl page metadata */
+	struct vy_page_info page_info;
+	/** Number of the page in the run. */
+	uint32_t page_no;
+	/** [out] resulting vinyl page */
+	struct vy_page *page;
+	/** [out] return code of vy_page_read() */
+	int rc;
+	/** [out] error if rc != 0 */
+	struct diag diag;
+	/** Set when the message returns to tx. */
+	bool is_complete;
+	/** Set if the iterator doesn't need the page anymore. */
+	bool is_abandoned;
+	/** Fiber waiting for the page to be read or NULL. */
+	struct fiber *waiter;
+};
+
 /** Destructor for env->zdctx_key thread-local variable */
 static void
 vy_free_zdctx(void *arg)
@@ -259,6 +307,17 @@ vy_run_clear(struct vy_run *run)
 	run->info.min_key = NULL;
 	free(run->info.max_key);
 	run->info.max_key = NULL;
+	if (run->blob_fd != NULL) {
+		for (uint32_t i = 0; i < run->info.blob_count; i++) {
+			if (run->blob_fd[i] >= 0 && close(run->blob_fd[i]) < 0)
+				say_syserror("close failed");
+		}
+		free(run->blob_fd);
+	}
+	run->blob_fd = NULL;
+	free(run->info.blobs);
+	run->info.blobs = NULL;
+	run->info.blob_count = 0;
 }
 
 void
@@ -578,6 +637,52 @@ vy_run_bloom_decode(struct bloom *bloom, const char **buffer,
 	return 0;
 }
 
+/**
+ * Read the blob file metadata of a run from given buffer.
+ * @param run_info - the run information to fill.
+ * @param buffer[in/out] - a buffer to read from.
+ *  The pointer is incremented on the number of bytes read.
+ * @param filename Filename for error reporting.
+ * @return - 0 on success or -1 on format/memory error
+ */
+static int
+vy_run_blobs_decode(struct vy_run_info *run_info, const char **buffer,
+		    const char *filename)
+{
+	const char **pos = buffer;
+	uint32_t blob_count = mp_decode_array(pos);
+	if (blob_count > VY_RUN_BLOB_COUNT_MAX) {
+		diag_set(ClientError, ER_INVALID_INDEX_FILE, filename,
+			 tt_sprintf("Can't decode blob meta: "
+				    "too many blob files (%u)",
+				    (unsigned)blob_count));
+		return -1;
+	}
+	size_t size = blob_count * sizeof(*run_info->blobs);
+	run_info->blobs = malloc(size);
+	if (run_info->blobs == NULL) {
+		diag_set(OutOfMemory, size, "malloc",
+			 "struct vy_run_blob_info");
+		return -1;
+	}
+	run_info->blob_count = blob_count;
+	for (uint32_t i = 0; i < blob_count; i++) {
+		struct vy_run_blob_info *blob = &run_info->blobs[i];
+		uint32_t array_size = mp_decode_array(pos);
+		if (array_size != 2) {
+			diag_set(ClientError, ER_INVALID_INDEX_FILE, filename,
+				 tt_sprintf("Can't decode blob meta: "
+					    "wrong array size "
+					    "(expected %d, got %u)",
+					    2, (unsigned)array_size));
+			return -1;
+		}
+		blob->size = mp_decode_uint(pos);
+		blob->live = mp_decode_uint(pos);
+	}
+	return 0;
+}
+
 /**
  * Decode the run metadata from xrow.
  *
@@ -636,6 +741,11 @@ vy_run_info_decode(struct vy_run_info *run_info,
 			else
 				return -1;
 			break;
+		case VY_RUN_INFO_BLOBS:
+			if (vy_run_blobs_decode(run_info, &pos,
+						filename) != 0)
+				return -1;
+			break;
 		default:
 			diag_set(ClientError, ER_INVALID_INDEX_FILE, filename,
 				"Can't decode run info: unknown key %u",
@@ -713,8 +823,40 @@ vy_page_xrow(struct vy_page *page, uint32_t stmt_no,
 
 /* {{{ vy_run_iterator vy_run_iterator support functions */
 
+/**
+ * Decode a statement read from a run file.
+ *
+ * If the statement body is stored in a blob file, return
+ * a surrogate statement that has only key parts and, unless
+ * @blob is NULL, store the location of the body in it,
+ * otherwise set blob->size to 0.
+ */
+static struct tuple *
+vy_run_decode_stmt(struct vy_run *run, struct xrow_header *xrow,
+		   const struct key_def *cmp_def, struct tuple_format *format,
+		   struct tuple_format *upsert_format, bool is_primary,
+		   struct vy_blob_ref *blob)
+{
+	if (xrow->type != VY_RUN_BLOB_REF) {
+		if (blob != NULL)
+			blob->size = 0;
+		return vy_stmt_decode(xrow, cmp_def, format,
+				      upsert_format, is_primary);
+	}
+	struct vy_blob_ref ref;
+	struct tuple *stmt = vy_stmt_decode_blob_ref(xrow, cmp_def,
+						     format, &ref);
+	if (stmt == NULL)
+		return NULL;
+	ref.run_id = run->id;
+	if (blob != NULL)
+		*blob = ref;
+	return stmt;
+}
+
 /**
  * Read raw stmt data from the page
+ * @param run           Run the page belongs to.
  * @param page          Page.
  * @param stmt_no       Statement position in the page.
  * @param cmp_def       Key definition of an index, including
@@ -722,19 +864,24 @@ vy_page_xrow(struct vy_page *page, uint32_t stmt_no,
  * @param format        Format for REPLACE/DELETE tuples.
  * @param upsert_format Format for UPSERT tuples.
  * @param is_primary    True if the index is primary.
+ * @param[out] blob     Location of the statement body if it is
+ *                      stored in a blob file, see
+ *                      vy_run_decode_stmt(). May be NULL.
  *
  * @retval not NULL Statement read from page.
  * @retval     NULL Memory error.
  */
 static struct tuple *
-vy_page_stmt(struct vy_page *page, uint32_t stmt_no,
+vy_page_stmt(struct vy_run *run, struct vy_page *page, uint32_t stmt_no,
 	     const struct key_def *cmp_def, struct tuple_format *format,
-	     struct tuple_format *upsert_format, bool is_primary)
+	     struct tuple_format *upsert_format, bool is_primary,
+	     struct vy_blob_ref *blob)
 {
 	struct xrow_header xrow;
 	if (vy_page_xrow(page, stmt_no, &xrow) != 0)
 		return NULL;
-	return vy_stmt_decode(&xrow, cmp_def, format, upsert_format, is_primary);
+	return vy_run_decode_stmt(run, &xrow, cmp_def, format,
+				  upsert_format, is_primary, blob);
 }
 
 /**
@@ -916,6 +1063,107 @@ error:
 	return -1;
 }
 
+/**
+ * Open the blob files of a run for reading.
+ * @retval 0 on success
+ * @retval -1 on error, check diag
+ */
+static int
+vy_run_open_blobs(struct vy_run *run, const char *dir,
+		  uint32_t space_id, uint32_t iid)
+{
+	assert(run->blob_fd == NULL);
+	if (run->info.blob_count == 0)
+		return 0;
+	size_t size = run->info.blob_count * sizeof(*run->blob_fd);
+	run->blob_fd = malloc(size);
+	if (run->blob_fd == NULL) {
+		diag_set(OutOfMemory, size, "malloc", "blob fd");
+		return -1;
+	}
+	for (uint32_t i = 0; i < run->info.blob_count; i++)
+		run->blob_fd[i] = -1;
+	char path[PATH_MAX];
+	for (uint32_t i = 0; i < run->info.blob_count; i++) {
+		vy_blob_snprint_path(path, sizeof(path), dir,
+				     space_id, iid, run->id, i);
+		run->blob_fd[i] = open(path, O_RDONLY);
+		if (run->blob_fd[i] < 0) {
+			diag_set(SystemError, "failed to open file '%s'",
+				 path);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+/**
+ * Read the body of a statement stored in a blob file of a run.
+ *
+ * @param run       The run.
+ * @param ref       Location of the body.
+ * @param key       Surrogate statement decoded from the run file,
+ *                  used for the type and LSN of the result.
+ * @param format    Format of the result.
+ * @param use_coio  Read the file in a coio thread.
+ * @param keep_ref  Remember @ref in the result so that the body
+ *                  can be referenced by a new run rather than
+ *                  copied, see vy_stmt_blob_ref().
+ *
+ * @retval not NULL Full statement.
+ * @retval     NULL Read or memory error.
+ */
+static struct tuple *
+vy_run_read_blob(struct vy_run *run, const struct vy_blob_ref *ref,
+		 const struct tuple *key, struct tuple_format *format,
+		 bool use_coio, bool keep_ref)
+{
+	struct region *region = &fiber()->gc;
+	size_t region_svp = region_used(region);
+	struct tuple *stmt = NULL;
+	if (ref->blob_no >= run->info.blob_count) {
+		diag_set(ClientError, ER_INVALID_RUN_FILE,
+			 tt_sprintf("Invalid blob file number %u",
+				    (unsigned)ref->blob_no));
+		goto out;
+	}
+	char *data = region_alloc(region, ref->size);
+	if (data == NULL) {
+		diag_set(OutOfMemory, ref->size, "region", "blob");
+		goto out;
+	}
+	int fd = run->blob_fd[ref->blob_no];
+	ssize_t readen = use_coio ?
+		coio_preadn(fd, data, ref->size, ref->offset) :
+		fio_pread(fd, data, ref->size, ref->offset);
+	if (readen < 0) {
+		diag_set(SystemError, "failed to read from file");
+		goto out;
+	}
+	const char *pos = data;
+	const char *end = data + ref->size;
+	if (readen != (ssize_t)ref->size || mp_typeof(*pos) != MP_ARRAY ||
+	    mp_check(&pos, end) != 0 || pos != end) {
+		diag_set(ClientError, ER_INVALID_RUN_FILE,
+			 "Invalid blob");
+		goto out;
+	}
+	stmt = vy_stmt_new_from_blob(format, data, end, vy_stmt_type(key),
+				     keep_ref ? ref : NULL);
+	if (stmt != NULL)
+		vy_stmt_set_lsn(stmt, vy_stmt_lsn(key));
+out:
+	region_truncate(region, region_svp);
+	if (stmt == NULL) {
+		diag_log();
+		say_error("error reading blob %u of %s@%llu:%u",
+			  (unsigned)ref->blob_no, vy_run_filename(run),
+			  (unsigned long long)ref->offset,
+			  (unsigned)ref->size);
+	}
+	return stmt;
+}
+
 /**
  * Get thread local zstd decompression context
  */
@@ -960,6 +1208,185 @@ vy_page_read_cb_free(struct cbus_call_msg *base)
 	return 0;
 }
 
+/** Free a read ahead message along with the page it holds. */
+static void
+vy_page_read_ahead_delete(struct vy_page_read_ahead *task)
+{
+	if (task->page != NULL)
+		vy_page_delete(task->page);
+	diag_destroy(&task->diag);
+	vy_run_unref(task->run);
+	free(task);
+}
+
+/** Read a page ahead, called in a reader thread. */
+static void
+vy_page_read_ahead_f(struct cmsg *base)
+{
+	struct vy_page_read_ahead *task = (struct vy_page_read_ahead *)base;
+	ZSTD_DStream *zdctx = vy_env_get_zdctx(task->run->env);
+	if (zdctx != NULL)
+		task->rc = vy_page_read(task->page, &task->page_info,
+					task->run, zdctx);
+	else
+		task->rc = -1;
+	if (task->rc != 0)
+		diag_move(diag_get(), &task->diag);
+}
+
+/** Called in tx when a page has been read ahead. */
+static void
+vy_page_read_ahead_done(struct cmsg *base)
+{
+	struct vy_page_read_ahead *task = (struct vy_page_read_ahead *)base;
+	task->is_complete = true;
+	if (task->is_abandoned)
+		vy_page_read_ahead_delete(task);
+	else if (task->waiter != NULL)
+		fiber_wakeup(task->waiter);
+}
+
+/**
+ * Send a message to a reader thread to read a page ahead and
+ * append it to the iterator read ahead list. Reading ahead is
+ * an optimization so errors are silently ignored.
+ */
+static void
+vy_run_iterator_read_ahead(struct vy_run_iterator *itr, uint32_t page_no)
+{
+	struct vy_run *run = itr->slice->run;
+	struct vy_run_env *env = run->env;
+	assert(env->reader_pool != NULL);
+
+	struct vy_page_read_ahead *task = malloc(sizeof(*task));
+	if (task == NULL)
+		return;
+	struct vy_page_info *page_info = vy_run_page_info(run, page_no);
+	task->page = vy_page_new(page_info);
+	if (task->page == NULL) {
+		free(task);
+		return;
+	}
+	vy_run_ref(run);
+	task->run = run;
+	task->page_info = *page_info;
+	task->page_no = page_no;
+	task->rc = 0;
+	diag_create(&task->diag);
+	task->is_complete = false;
+	task->is_abandoned = false;
+	task->waiter = NULL;
+
+	/* Pick a reader thread. */
+	struct vy_run_reader *reader;
+	reader = &env->reader_pool[env->next_reader++];
+	env->next_reader %= env->reader_pool_size;
+
+	task->route[0].f = vy_page_read_ahead_f;
+	task->route[0].pipe = &reader->tx_pipe;
+	task->route[1].f = vy_page_read_ahead_done;
+	task->route[1].pipe = NULL;
+	cmsg_init(&task->base, task->route);
+	cpipe_push(&reader->reader_pipe, &task->base);
+	/* Don't wait for the fiber to yield to send the message. */
+	cpipe_flush_input(&reader->reader_pipe);
+
+	rlist_add_tail_entry(&itr->read_ahead, task, in_read_ahead);
+	itr->read_ahead_count++;
+}
+
+/**
+ * Drop all pages read ahead by an iterator. Messages that
+ * haven't returned yet are freed on return.
+ */
+static void
+vy_run_iterator_abandon_read_ahead(struct vy_run_iterator *itr)
+{
+	struct vy_page_read_ahead *task, *next;
+	rlist_foreach_entry_safe(task, &itr->read_ahead, in_read_ahead, next) {
+		rlist_del_entry(task, in_read_ahead);
+		if (task->is_complete) {
+			vy_page_read_ahead_delete(task);
+		} else {
+			task->is_abandoned = true;
+			task->waiter = NULL;
+		}
+	}
+	itr->read_ahead_count = 0;
+}
+
+/**
+ * Take the first page out of the iterator read ahead list,
+ * waiting for it to be read if necessary.
+ *
+ * @retval 0 success
+ * @retval -1 read error or the fiber was cancelled
+ */
+static int
+vy_run_iterator_wait_read_ahead(struct vy_run_iterator *itr,
+				struct vy_page **result)
+{
+	assert(!rlist_empty(&itr->read_ahead));
+	struct vy_page_read_ahead *task;
+	task = rlist_shift_entry(&itr->read_ahead, struct vy_page_read_ahead,
+				 in_read_ahead);
+	itr->read_ahead_count--;
+	while (!task->is_complete) {
+		task->waiter = fiber();
+		fiber_yield();
+		task->waiter = NULL;
+		if (!task->is_complete && fiber_is_cancelled()) {
+			task->is_abandoned = true;
+			diag_set(FiberIsCancelled);
+			return -1;
+		}
+	}
+	int rc = task->rc;
+	if (rc != 0) {
+		diag_move(&task->diag, diag_get());
+	} else {
+		*result = task->page;
+		task->page = NULL;
+	}
+	vy_page_read_ahead_delete(task);
+	return rc;
+}
+
+/**
+ * Called after a page has been loaded from the disk. If the
+ * iterator seems to be scanning the run, start reading pages
+ * following the loaded one so that the scan doesn't stall on
+ * each page boundary.
+ */
+static void
+vy_run_iterator_update_read_ahead(struct vy_run_iterator *itr,
+				  uint32_t page_no)
+{
+	int dir = iterator_direction(itr->iterator_type);
+	if (itr->last_page_no != UINT32_MAX &&
+	    (int64_t)page_no == (int64_t)itr->last_page_no + dir)
+		itr->seq_page_count++;
+	else
+		itr->seq_page_count = 0;
+	itr->last_page_no = page_no;
+
+	struct vy_slice *slice = itr->slice;
+	if (slice->run->env->reader_pool == NULL ||
+	    itr->seq_page_count < VY_RUN_READ_AHEAD_SEQ_MIN)
+		return;
+	/*
+	 * The read ahead list contains pages following the
+	 * loaded one, in the iteration direction.
+	 */
+	int64_t next_page_no = page_no + dir * (itr->read_ahead_count + 1);
+	while (itr->read_ahead_count < VY_RUN_READ_AHEAD_MAX &&
+	       next_page_no >= slice->first_page_no &&
+	       next_page_no <= slice->last_page_no) {
+		vy_run_iterator_read_ahead(itr, next_page_no);
+		next_page_no += dir;
+	}
+}
+
 /**
  * Get a page by the given number the cache or load it from the disk.
  *
@@ -978,9 +1405,27 @@ vy_run_iterator_load_page(struct vy_run_iterator *itr, uint32_t page_no,
 	if (*result != NULL)
 		return 0;
 
-	/* Allocate buffers */
 	struct vy_page_info *page_info = vy_run_page_info(slice->run, page_no);
-	struct vy_page *page = vy_page_new(page_info);
+	struct vy_page *page = NULL;
+
+	/* Check pages read ahead */
+	if (!rlist_empty(&itr->read_ahead)) {
+		struct vy_page_read_ahead *task;
+		task = rlist_first_entry(&itr->read_ahead,
+					 struct vy_page_read_ahead,
+					 in_read_ahead);
+		if (task->page_no != page_no) {
+			/* The iterator jumped, drop the pages. */
+			vy_run_iterator_abandon_read_ahead(itr);
+		} else if (vy_run_iterator_wait_read_ahead(itr, &page) != 0) {
+			return -1;
+		}
+	}
+	if (page != NULL)
+		goto done;
+
+	/* Allocate buffers */
+	page = vy_page_new(page_info);
 	if (page == NULL)
 		return -1;
 
@@ -1035,7 +1480,7 @@ vy_run_iterator_load_page(struct vy_run_iterator *itr, uint32_t page_no,
 			return -1;
 		}
 	}
-
+done:
 	/* Iterator is never used from multiple fibers */
 	assert(vy_run_iterator_cache_get(itr, page_no) == NULL);
 
@@ -1048,6 +1493,8 @@ vy_run_iterator_load_page(struct vy_run_iterator *itr, uint32_t page_no,
 	itr->stat->read.bytes_compressed += page_info->size;
 	itr->stat->read.pages++;
 
+	vy_run_iterator_update_read_ahead(itr, page_no);
+
 	*result = page;
 	return 0;
 }
@@ -1069,13 +1516,53 @@ vy_run_iterator_read(struct vy_run_iterator *itr,
 	int rc = vy_run_iterator_load_page(itr, pos.page_no, &page);
 	if (rc != 0)
 		return rc;
-	*stmt = vy_page_stmt(page, pos.pos_in_page, itr->cmp_def,
-			     itr->format, itr->upsert_format, itr->is_primary);
+	*stmt = vy_page_stmt(itr->slice->run, page, pos.pos_in_page,
+			     itr->cmp_def, itr->format, itr->upsert_format,
+			     itr->is_primary, NULL);
 	if (*stmt == NULL)
 		return -1;
 	return 0;
 }
 
+/**
+ * Like vy_run_iterator_read(), but if the statement body is
+ * stored in a blob file, read it and return the full statement.
+ *
+ * @retval 0 success
+ * @retval -1 read error or out of memory.
+ */
+static NODISCARD int
+vy_run_iterator_read_full(struct vy_run_iterator *itr,
+			  struct vy_run_iterator_pos pos,
+			  struct tuple **stmt)
+{
+	struct vy_run *run = itr->slice->run;
+	struct vy_page *page;
+	int rc = vy_run_iterator_load_page(itr, pos.page_no, &page);
+	if (rc != 0)
+		return rc;
+	struct vy_blob_ref ref;
+	struct tuple *key = vy_page_stmt(run, page, pos.pos_in_page,
+					 itr->cmp_def, itr->format,
+					 itr->upsert_format, itr->is_primary,
+					 &ref);
+	if (key == NULL)
+		return -1;
+	if (ref.size == 0) {
+		*stmt = key;
+		return 0;
+	}
+	/* Disk reads are handed over to coio in tx. */
+	bool use_coio = cord_is_main() && run->env->reader_pool != NULL;
+	*stmt = vy_run_read_blob(run, &ref, key, itr->format, use_coio, false);
+	tuple_unref(key);
+	if (*stmt == NULL)
+		return -1;
+	itr->stat->read.bytes += ref.size;
+	itr->stat->read.bytes_compressed += ref.size;
+	return 0;
+}
+
 /**
  * Binary search in page
  * In terms of STL, makes lower_bound for EQ,GE,LT and upper_bound for GT,LE
@@ -1096,9 +1583,11 @@ vy_run_iterator_search_in_page(struct vy_run_iterator *itr,
 			iterator_type == ITER_LE ? -1 : 0);
 	while (beg != end) {
 		uint32_t mid = beg + (end - beg) / 2;
-		struct tuple *fnd_key = vy_page_stmt(page, mid, itr->cmp_def,
-						     itr->format, itr->upsert_format,
-						     itr->is_primary);
+		struct tuple *fnd_key = vy_page_stmt(itr->slice->run, page,
+						     mid, itr->cmp_def,
+						     itr->format,
+						     itr->upsert_format,
+						     itr->is_primary, NULL);
 		if (fnd_key == NULL)
 			return end;
 		int cmp = vy_stmt_compare(fnd_key, key, itr->cmp_def);
@@ -1505,6 +1994,10 @@ vy_run_iterator_open(struct vy_run_iterator *itr,
 	itr->curr_stmt_pos.page_no = UINT32_MAX;
 	itr->curr_page = NULL;
 	itr->prev_page = NULL;
+	rlist_create(&itr->read_ahead);
+	itr->read_ahead_count = 0;
+	itr->seq_page_count = 0;
+	itr->last_page_no = UINT32_MAX;
 
 	itr->search_started = false;
 	itr->search_ended = false;
@@ -1534,7 +2027,7 @@ vy_run_iterator_get(struct vy_run_iterator *itr, struct tuple **result)
 		itr->curr_stmt = NULL;
 		itr->curr_stmt_pos.page_no = UINT32_MAX;
 	}
-	int rc = vy_run_iterator_read(itr, itr->curr_pos, result);
+	int rc = vy_run_iterator_read_full(itr, itr->curr_pos, result);
 	if (rc == 0) {
 		itr->curr_stmt_pos = itr->curr_pos;
 		itr->curr_stmt = *result;
@@ -1736,6 +2229,7 @@ vy_run_iterator_skip(struct vy_run_iterator *itr,
 void
 vy_run_iterator_close(struct vy_run_iterator *itr)
 {
+	vy_run_iterator_abandon_read_ahead(itr);
 	vy_run_iterator_cache_clean(itr);
 	TRASH(itr);
 }
@@ -1871,6 +2365,11 @@ vy_run_recover(struct vy_run *run, const char *dir,
 	}
 	run->fd = cursor.fd;
 	xlog_cursor_close(&cursor, true);
+	if (vy_run_open_blobs(run, dir, space_id, iid) != 0) {
+		close(run->fd);
+		run->fd = -1;
+		goto fail;
+	}
 	return 0;
 
 fail_close:
@@ -1882,19 +2381,273 @@ fail:
 	return -1;
 }
 
+/**
+ * Bodies of statements referenced from a blob file of the
+ * source run are copied rather than referenced by the new
+ * run if less than this part of the file is referenced.
+ */
+static const double VY_BLOB_LIVE_RATIO_MIN = 0.5;
+
+/** Size of the blob file write buffer. */
+enum { VY_BLOB_WRITE_BUF_SIZE = 1024 * 1024 };
+
+/**
+ * Helper used for moving bodies of large statements out of
+ * a new run file to blob files, see struct vy_run_blob_info.
+ */
+struct vy_blob_writer {
+	/** Run being written. */
+	struct vy_run *run;
+	/** Path to the vinyl directory. */
+	const char *dirpath;
+	/** Space and index ID, needed for file name formatting. */
+	uint32_t space_id;
+	uint32_t iid;
+	/** Min size of a statement body moved to a blob file. */
+	uint32_t threshold;
+	/**
+	 * Number of the blob file new bodies are appended to or
+	 * UINT32_MAX if it hasn't been created yet.
+	 */
+	uint32_t blob_no;
+	/** Descriptor of that file. */
+	int fd;
+	/** Bodies not written to the file yet. */
+	struct ibuf buf;
+	/**
+	 * Inode of each blob file of the new run, used to avoid
+	 * linking the same file twice.
+	 */
+	ino_t ino[VY_RUN_BLOB_COUNT_MAX];
+};
+
+static void
+vy_blob_writer_create(struct vy_blob_writer *writer, struct vy_run *run,
+		      const char *dirpath, uint32_t space_id, uint32_t iid,
+		      uint32_t threshold)
+{
+	writer->run = run;
+	writer->dirpath = dirpath;
+	writer->space_id = space_id;
+	writer->iid = iid;
+	writer->threshold = threshold;
+	writer->blob_no = UINT32_MAX;
+	writer->fd = -1;
+	ibuf_create(&writer->buf, &cord()->slabc, VY_BLOB_WRITE_BUF_SIZE);
+}
+
+static void
+vy_blob_writer_destroy(struct vy_blob_writer *writer)
+{
+	if (writer->fd >= 0)
+		close(writer->fd);
+	ibuf_destroy(&writer->buf);
+}
+
+/**
+ * Allocate metadata for a new blob file of the run.
+ * Return the number of the new file or -1 if the run
+ * has too many blob files.
+ */
+static int
+vy_blob_writer_add_file(struct vy_blob_writer *writer, ino_t ino)
+{
+	struct vy_run_info *info = &writer->run->info;
+	if (info->blob_count >= VY_RUN_BLOB_COUNT_MAX)
+		return -1;
+	if (info->blobs == NULL) {
+		info->blobs = calloc(VY_RUN_BLOB_COUNT_MAX,
+				     sizeof(*info->blobs));
+		if (info->blobs == NULL) {
+			diag_set(OutOfMemory, VY_RUN_BLOB_COUNT_MAX *
+				 sizeof(*info->blobs), "calloc",
+				 "struct vy_run_blob_info");
+			return -2;
+		}
+	}
+	writer->ino[info->blob_count] = ino;
+	return info->blob_count++;
+}
+
+/**
+ * Link a blob file of a source run to the new run.
+ * @retval  1 success, *blob_no is set to the file number
+ * @retval  0 the new run has too many blob files
+ * @retval -1 error
+ */
+static int
+vy_blob_writer_link(struct vy_blob_writer *writer,
+		    const struct vy_blob_ref *src, uint32_t *blob_no)
+{
+	char src_path[PATH_MAX];
+	vy_blob_snprint_path(src_path, sizeof(src_path), writer->dirpath,
+			     writer->space_id, writer->iid,
+			     src->run_id, src->blob_no);
+	struct stat st;
+	if (stat(src_path, &st) < 0) {
+		diag_set(SystemError, "failed to stat file '%s'", src_path);
+		return -1;
+	}
+	struct vy_run_info *info = &writer->run->info;
+	for (uint32_t i = 0; i < info->blob_count; i++) {
+		if (i != writer->blob_no && writer->ino[i] == st.st_ino) {
+			*blob_no = i;
+			return 1;
+		}
+	}
+	int rc = vy_blob_writer_add_file(writer, st.st_ino);
+	if (rc < 0)
+		return rc == -1 ? 0 : -1;
+	char path[PATH_MAX];
+	vy_blob_snprint_path(path, sizeof(path), writer->dirpath,
+			     writer->space_id, writer->iid,
+			     writer->run->id, rc);
+	if (link(src_path, path) < 0) {
+		diag_set(SystemError, "failed to link file '%s' to '%s'",
+			 src_path, path);
+		info->blob_count--;
+		return -1;
+	}
+	info->blobs[rc].size = st.st_size;
+	info->blobs[rc].live = 0;
+	*blob_no = rc;
+	return 1;
+}
+
+/** Write buffered bodies to the blob file. */
+static int
+vy_blob_writer_flush(struct vy_blob_writer *writer)
+{
+	size_t size = ibuf_used(&writer->buf);
+	if (size == 0)
+		return 0;
+	if (fio_writen(writer->fd, writer->buf.rpos, size) < 0) {
+		diag_set(SystemError, "failed to write blob file");
+		return -1;
+	}
+	ibuf_reset(&writer->buf);
+	return 0;
+}
+
+/**
+ * Append a statement body to the blob file of the new run,
+ * creating the file if necessary, and fill @ref.
+ */
+static int
+vy_blob_writer_append(struct vy_blob_writer *writer,
+		      const struct tuple *stmt, struct vy_blob_ref *ref)
+{
+	struct vy_run_info *info = &writer->run->info;
+	if (writer->blob_no == UINT32_MAX) {
+		int rc = vy_blob_writer_add_file(writer, 0);
+		assert(rc != -1);
+		if (rc < 0)
+			return -1;
+		char path[PATH_MAX];
+		vy_blob_snprint_path(path, sizeof(path), writer->dirpath,
+				     writer->space_id, writer->iid,
+				     writer->run->id, rc);
+		say_info("writing `%s'", path);
+		writer->fd = open(path, O_WRONLY | O_CREAT | O_EXCL, 0644);
+		if (writer->fd < 0) {
+			diag_set(SystemError, "failed to create file '%s'",
+				 path);
+			info->blob_count--;
+			return -1;
+		}
+		writer->blob_no = rc;
+	}
+	uint32_t size;
+	const char *data = tuple_data_range(stmt, &size);
+	if (ibuf_used(&writer->buf) + size > VY_BLOB_WRITE_BUF_SIZE &&
+	    vy_blob_writer_flush(writer) != 0)
+		return -1;
+	char *buf = ibuf_alloc(&writer->buf, size);
+	if (buf == NULL) {
+		diag_set(OutOfMemory, size, "ibuf", "blob");
+		return -1;
+	}
+	memcpy(buf, data, size);
+	struct vy_run_blob_info *blob = &info->blobs[writer->blob_no];
+	ref->blob_no = writer->blob_no;
+	ref->offset = blob->size;
+	ref->size = size;
+	blob->size += size;
+	return 0;
+}
+
+/**
+ * Decide where to store the body of a statement of a new run.
+ * @retval  1 the body is stored in a blob file, @ref is filled
+ * @retval  0 the body must be stored in the run file
+ * @retval -1 error
+ */
+static int
+vy_blob_writer_add(struct vy_blob_writer *writer,
+		   const struct tuple *stmt, struct vy_blob_ref *ref)
+{
+	enum iproto_type type = vy_stmt_type(stmt);
+	if (type != IPROTO_REPLACE && type != IPROTO_INSERT)
+		return 0;
+	struct vy_blob_ref src;
+	if (vy_stmt_blob_ref(stmt, &src)) {
+		/* Reference the body instead of copying it. */
+		int rc = vy_blob_writer_link(writer, &src, &ref->blob_no);
+		if (rc < 0)
+			return -1;
+		if (rc > 0) {
+			ref->offset = src.offset;
+			ref->size = src.size;
+			goto out;
+		}
+	}
+	if (stmt->bsize < writer->threshold)
+		return 0;
+	if (writer->blob_no == UINT32_MAX &&
+	    writer->run->info.blob_count >= VY_RUN_BLOB_COUNT_MAX)
+		return 0; /* too many blob files, store inline */
+	if (vy_blob_writer_append(writer, stmt, ref) != 0)
+		return -1;
+out:
+	writer->run->info.blobs[ref->blob_no].live += ref->size;
+	ref->run_id = writer->run->id;
+	return 1;
+}
+
+/** Flush and sync the blob file written for the new run. */
+static int
+vy_blob_writer_finish(struct vy_blob_writer *writer)
+{
+	if (writer->fd < 0)
+		return 0;
+	if (vy_blob_writer_flush(writer) != 0)
+		return -1;
+	if (fsync(writer->fd) < 0) {
+		diag_set(SystemError, "failed to sync blob file");
+		return -1;
+	}
+	return 0;
+}
+
 /* dump statement to the run page buffers (stmt header and data) */
 static int
 vy_run_dump_stmt(const struct tuple *value, struct xlog *data_xlog,
 		 struct vy_page_info *info, const struct key_def *key_def,
-		 bool is_primary)
+		 bool is_primary, struct vy_blob_writer *blob)
 {
 	struct region *region = &fiber()->gc;
 	size_t used = region_used(region);
 
 	struct xrow_header xrow;
-	int rc = (is_primary ?
-		  vy_stmt_encode_primary(value, key_def, 0, &xrow) :
-		  vy_stmt_encode_secondary(value, key_def, &xrow));
+	struct vy_blob_ref ref;
+	int rc = blob != NULL ? vy_blob_writer_add(blob, value, &ref) : 0;
+	if (rc > 0) {
+		rc = vy_stmt_encode_blob_ref(value, key_def, &ref, &xrow);
+	} else if (rc == 0) {
+		rc = (is_primary ?
+		      vy_stmt_encode_primary(value, key_def, 0, &xrow) :
+		      vy_stmt_encode_secondary(value, key_def, &xrow));
+	}
 	if (rc != 0)
 		return -1;
 
@@ -1979,7 +2732,7 @@ vy_run_write_page(struct vy_run *run, struct xlog *data_xlog,
 		  uint64_t page_size, struct bloom_spectrum *bs,
 		  const struct key_def *cmp_def,
 		  const struct key_def *key_def, bool is_primary,
-		  uint32_t *page_info_capacity)
+		  struct vy_blob_writer *blob, uint32_t *page_info_capacity)
 {
 	assert(curr_stmt != NULL);
 	assert(*curr_stmt != NULL);
@@ -2027,7 +2780,7 @@ vy_run_write_page(struct vy_run *run, struct xlog *data_xlog,
 		*offset = page->unpacked_size;
 
 		if (vy_run_dump_stmt(*curr_stmt, data_xlog, page,
-				     cmp_def, is_primary) != 0)
+				     cmp_def, is_primary, blob) != 0)
 			goto error_rollback;
 
 		bloom_spectrum_add(bs, tuple_hash(*curr_stmt, key_def));
@@ -2124,9 +2877,12 @@ vy_run_write_data(struct vy_run *run, const char *dirpath,
 		  struct vy_stmt_stream *wi, uint64_t page_size,
 		  const struct key_def *cmp_def,
 		  const struct key_def *key_def,
-		  size_t max_output_count, double bloom_fpr)
+		  size_t max_output_count, double bloom_fpr,
+		  uint32_t blob_threshold)
 {
 	struct tuple *stmt;
+	struct vy_blob_writer blob;
+	bool has_blob = (iid == 0 && blob_threshold > 0);
 
 	/* Start iteration. */
 	if (wi->iface->start(wi) != 0)
@@ -2160,6 +2916,11 @@ vy_run_write_data(struct vy_run *run, const char *dirpath,
 	if (xlog_create(&data_xlog, path, 0, &meta) < 0)
 		goto err_free_bloom;
 
+	if (has_blob) {
+		vy_blob_writer_create(&blob, run, dirpath, space_id, iid,
+				      blob_threshold);
+	}
+
 	run->info.min_lsn = INT64_MAX;
 	run->info.max_lsn = -1;
 
@@ -2169,12 +2930,20 @@ vy_run_write_data(struct vy_run *run, const char *dirpath,
 	do {
 		rc = vy_run_write_page(run, &data_xlog, wi, &stmt,
 				       page_size, &bs, cmp_def, key_def,
-				       iid == 0, &page_info_capacity);
+				       iid == 0, has_blob ? &blob : NULL,
+				       &page_info_capacity);
 		if (rc < 0)
 			goto err_close_xlog;
 		fiber_gc();
 	} while (rc == 0);
 
+	/*
+	 * Blob files must hit the disk before the run file
+	 * that references them.
+	 */
+	if (has_blob && vy_blob_writer_finish(&blob) != 0)
+		goto err_close_xlog;
+
 	/* Sync data and link the file to the final name. */
 	if (xlog_sync(&data_xlog) < 0 ||
 	    xlog_rename(&data_xlog) < 0)
@@ -2184,6 +2953,13 @@ vy_run_write_data(struct vy_run *run, const char *dirpath,
 	xlog_close(&data_xlog, true);
 	fiber_gc();
 
+	if (has_blob) {
+		vy_blob_writer_destroy(&blob);
+		has_blob = false;
+		if (vy_run_open_blobs(run, dirpath, space_id, iid) != 0)
+			goto err_free_bloom;
+	}
+
 	bloom_spectrum_choose(&bs, &run->info.bloom);
 	run->info.has_bloom = true;
 	bloom_spectrum_destroy(&bs, runtime.quota);
@@ -2194,6 +2970,8 @@ done:
 err_close_xlog:
 	xlog_close(&data_xlog, false);
 	fiber_gc();
+	if (has_blob)
+		vy_blob_writer_destroy(&blob);
 err_free_bloom:
 	bloom_spectrum_destroy(&bs, runtime.quota);
 err:
@@ -2312,6 +3090,41 @@ vy_run_bloom_encode(const struct bloom *bloom, char *buffer)
 	return pos;
 }
 
+/**
+ * Calculate the size on disk that is needed to store
+ * the blob file metadata of a run.
+ */
+static size_t
+vy_run_blobs_encode_size(const struct vy_run_info *run_info)
+{
+	size_t size = mp_sizeof_array(run_info->blob_count);
+	for (uint32_t i = 0; i < run_info->blob_count; i++) {
+		const struct vy_run_blob_info *blob = &run_info->blobs[i];
+		size += mp_sizeof_array(2);
+		size += mp_sizeof_uint(blob->size);
+		size += mp_sizeof_uint(blob->live);
+	}
+	return size;
+}
+
+/**
+ * Write the blob file metadata of a run to given buffer.
+ * The buffer must have at least vy_run_blobs_encode_size().
+ * @return - buffer + number of bytes written.
+ */
+static char *
+vy_run_blobs_encode(const struct vy_run_info *run_info, char *buffer)
+{
+	char *pos = mp_encode_array(buffer, run_info->blob_count);
+	for (uint32_t i = 0; i < run_info->blob_count; i++) {
+		const struct vy_run_blob_info *blob = &run_info->blobs[i];
+		pos = mp_encode_array(pos, 2);
+		pos = mp_encode_uint(pos, blob->size);
+		pos = mp_encode_uint(pos, blob->live);
+	}
+	return pos;
+}
+
 /**
  * Encode vy_run_info as xrow
  * Allocates using region alloc
@@ -2346,6 +3159,13 @@ vy_run_info_encode(const struct vy_run_info *run_info,
 		mp_sizeof_uint(run_info->page_count);
 	size += mp_sizeof_uint(VY_RUN_INFO_BLOOM) +
 		vy_run_bloom_encode_size(&run_info->bloom);
+	uint32_t map_size = 6;
+	if (run_info->blob_count > 0) {
+		map_size++;
+		size += mp_sizeof_uint(VY_RUN_INFO_BLOBS) +
+			vy_run_blobs_encode_size(run_info);
+	}
+	size += mp_sizeof_map(map_size) - mp_sizeof_map(6);
 
 	char *pos = region_alloc(&fiber()->gc, size);
 	if (pos == NULL) {
@@ -2355,7 +3175,7 @@ vy_run_info_encode(const struct vy_run_info *run_info,
 	memset(xrow, 0, sizeof(*xrow));
 	xrow->body->iov_base = pos;
 	/* encode values */
-	pos = mp_encode_map(pos, 6);
+	pos = mp_encode_map(pos, map_size);
 	pos = mp_encode_uint(pos, VY_RUN_INFO_MIN_KEY);
 	memcpy(pos, run_info->min_key, min_key_size);
 	pos += min_key_size;
@@ -2370,7 +3190,12 @@ vy_run_info_encode(const struct vy_run_info *run_info,
 	pos = mp_encode_uint(pos, run_info->page_count);
 	pos = mp_encode_uint(pos, VY_RUN_INFO_BLOOM);
 	pos = vy_run_bloom_encode(&run_info->bloom, pos);
+	if (run_info->blob_count > 0) {
+		pos = mp_encode_uint(pos, VY_RUN_INFO_BLOBS);
+		pos = vy_run_blobs_encode(run_info, pos);
+	}
 	xrow->body->iov_len = (void *)pos - xrow->body->iov_base;
+	assert(xrow->body->iov_len == size);
 	xrow->bodycnt = 1;
 	xrow->type = VY_INDEX_RUN_INFO;
 	return 0;
@@ -2443,7 +3268,8 @@ vy_run_write(struct vy_run *run, const char *dirpath,
 	     struct vy_stmt_stream *wi, uint64_t page_size,
 	     const struct key_def *cmp_def,
 	     const struct key_def *key_def,
-	     size_t max_output_count, double bloom_fpr)
+	     size_t max_output_count, double bloom_fpr,
+	     uint32_t blob_threshold)
 {
 	ERROR_INJECT(ERRINJ_VY_RUN_WRITE,
 		     {diag_set(ClientError, ER_INJECTION,
@@ -2455,7 +3281,8 @@ vy_run_write(struct vy_run *run, const char *dirpath,
 
 	if (vy_run_write_data(run, dirpath, space_id, iid,
 			      wi, page_size, cmp_def, key_def,
-			      max_output_count, bloom_fpr) != 0)
+			      max_output_count, bloom_fpr,
+			      blob_threshold) != 0)
 		return -1;
 
 	if (vy_run_is_empty(run))
@@ -2467,6 +3294,35 @@ vy_run_write(struct vy_run *run, const char *dirpath,
 	return 0;
 }
 
+/**
+ * Account a blob reference found in a run file to the run
+ * blob info. Used for rebuilding a lost index file.
+ */
+static int
+vy_run_rebuild_blob_info(struct vy_run *run, const struct vy_blob_ref *ref)
+{
+	struct vy_run_info *info = &run->info;
+	if (ref->blob_no >= VY_RUN_BLOB_COUNT_MAX) {
+		diag_set(ClientError, ER_INVALID_RUN_FILE,
+			 tt_sprintf("Invalid blob file number %u",
+				    (unsigned)ref->blob_no));
+		return -1;
+	}
+	if (info->blobs == NULL) {
+		info->blobs = calloc(VY_RUN_BLOB_COUNT_MAX,
+				     sizeof(*info->blobs));
+		if (info->blobs == NULL) {
+			diag_set(OutOfMemory, VY_RUN_BLOB_COUNT_MAX *
+				 sizeof(*info->blobs), "calloc",
+				 "struct vy_run_blob_info");
+			return -1;
+		}
+	}
+	info->blob_count = MAX(info->blob_count, ref->blob_no + 1);
+	info->blobs[ref->blob_no].live += ref->size;
+	return 0;
+}
+
 int
 vy_run_rebuild_index(struct vy_run *run, const char *dir,
 		     uint32_t space_id, uint32_t iid,
@@ -2519,10 +3375,17 @@ vy_run_rebuild_index(struct vy_run *run, const char *dir,
 				continue;
 			}
 			++page_row_count;
-			struct tuple *tuple = vy_stmt_decode(&xrow, cmp_def,
-					mem_format, upsert_format, iid == 0);
+			struct vy_blob_ref ref;
+			struct tuple *tuple = vy_run_decode_stmt(run, &xrow,
+					cmp_def, mem_format, upsert_format,
+					iid == 0, &ref);
 			if (tuple == NULL)
 				goto close_err;
+			if (ref.size != 0 &&
+			    vy_run_rebuild_blob_info(run, &ref) != 0) {
+				tuple_unref(tuple);
+				goto close_err;
+			}
 			key = tuple_extract_key(tuple, cmp_def, NULL);
 			tuple_unref(tuple);
 			if (key == NULL)
@@ -2573,15 +3436,26 @@ vy_run_rebuild_index(struct vy_run *run, const char *dir,
 		if (xrow.type == VY_RUN_ROW_INDEX)
 			continue;
 
-		struct tuple *tuple = vy_stmt_decode(&xrow, cmp_def, mem_format,
-						     upsert_format, iid == 0);
+		struct tuple *tuple = vy_run_decode_stmt(run, &xrow, cmp_def,
+				mem_format, upsert_format, iid == 0, NULL);
 		if (tuple == NULL)
 			goto close_err;
 		bloom_add(&run->info.bloom, tuple_hash(tuple, key_def));
+		tuple_unref(tuple);
 	}
 	run->info.has_bloom = true;
 
 	region_truncate(region, mem_used);
+	if (vy_run_open_blobs(run, dir, space_id, iid) != 0)
+		goto close_err;
+	for (uint32_t i = 0; i < run->info.blob_count; i++) {
+		struct stat st;
+		if (fstat(run->blob_fd[i], &st) < 0) {
+			diag_set(SystemError, "failed to stat blob file");
+			goto close_err;
+		}
+		run->info.blobs[i].size = st.st_size;
+	}
 	run->fd = cursor.fd;
 	xlog_cursor_close(&cursor, true);
 	/* New run index is ready for write, unlink old file if exists */
@@ -2662,9 +3536,10 @@ vy_slice_stream_search(struct vy_stmt_stream *virt_stream)
 	while (beg != end) {
 		uint32_t mid = beg + (end - beg) / 2;
 		struct tuple *fnd_key =
-			vy_page_stmt(stream->page, mid, stream->cmp_def,
-				     stream->format, stream->upsert_format,
-				     stream->is_primary);
+			vy_page_stmt(stream->slice->run, stream->page, mid,
+				     stream->cmp_def, stream->format,
+				     stream->upsert_format,
+				     stream->is_primary, NULL);
 		if (fnd_key == NULL)
 			return -1;
 		int cmp = vy_tuple_compare_with_key(fnd_key,
@@ -2710,10 +3585,12 @@ vy_slice_stream_next(struct vy_stmt_stream *virt_stream, struct tuple **ret)
 		return -1;
 
 	/* Read current tuple from the page */
+	struct vy_run *run = stream->slice->run;
+	struct vy_blob_ref ref;
 	struct tuple *tuple =
-		vy_page_stmt(stream->page, stream->pos_in_page,
+		vy_page_stmt(run, stream->page, stream->pos_in_page,
 			     stream->cmp_def, stream->format,
-			     stream->upsert_format, stream->is_primary);
+			     stream->upsert_format, stream->is_primary, &ref);
 	if (tuple == NULL) /* Read or memory error */
 		return -1;
 
@@ -2721,8 +3598,31 @@ vy_slice_stream_next(struct vy_stmt_stream *virt_stream, struct tuple **ret)
 	if (stream->slice->end != NULL &&
 	    stream->page_no >= stream->slice->last_page_no &&
 	    vy_tuple_compare_with_key(tuple, stream->slice->end,
-				      stream->cmp_def) >= 0)
+				      stream->cmp_def) >= 0) {
+		tuple_unref(tuple);
 		return 0;
+	}
+
+	if (ref.size != 0) {
+		/*
+		 * The body is stored in a blob file. Let the new
+		 * run reference it unless most of the file is
+		 * garbage, in which case the body is relocated.
+		 */
+		bool keep_ref = false;
+		if (ref.blob_no < run->info.blob_count) {
+			struct vy_run_blob_info *blob =
+				&run->info.blobs[ref.blob_no];
+			keep_ref = blob->live >= blob->size *
+						 VY_BLOB_LIVE_RATIO_MIN;
+		}
+		struct tuple *key = tuple;
+		tuple = vy_run_read_blob(run, &ref, key, stream->format,
+					 false, keep_ref);
+		tuple_unref(key);
+		if (tuple == NULL)
+			return -1;
+	}
 
 	/* We definitely has the next non-null tuple. Save it in stream */
 	if (stream->tuple != NULL)
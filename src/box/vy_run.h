@@ -68,6 +68,30 @@ struct vy_run_env {
 	int next_reader;
 };
 
+enum {
+	/** Max number of blob files a run can refer to. */
+	VY_RUN_BLOB_COUNT_MAX = 32,
+};
+
+/**
+ * Blob file metadata, stored in the run index file.
+ *
+ * Bodies of large statements of a primary index may be moved
+ * out of the run file to an append-only blob file, see
+ * index_opts::blob_threshold. Compaction doesn't copy such
+ * bodies - instead it hard-links the blob file to the new run
+ * and writes the same references to it. When the bodies still
+ * referenced from a blob file become a small part of it, they
+ * are copied to a new blob file by the next compaction so that
+ * the old file can be reclaimed.
+ */
+struct vy_run_blob_info {
+	/** Size of the blob file. */
+	uint64_t size;
+	/** Size of statement bodies referenced by the run. */
+	uint64_t live;
+};
+
 /**
  * Run metadata. Is a written to a file as a single chunk.
  */
@@ -86,6 +110,10 @@ struct vy_run_info {
 	bool has_bloom;
 	/** Bloom filter of all tuples in run */
 	struct bloom bloom;
+	/** Number of blob files used by the run. */
+	uint32_t blob_count;
+	/** Metadata of the blob files, indexed by blob number. */
+	struct vy_run_blob_info *blobs;
 };
 
 /**
@@ -118,6 +146,8 @@ struct vy_run {
 	struct vy_page_info *page_info;
 	/** Run data file. */
 	int fd;
+	/** Blob files, info.blob_count descriptors. */
+	int *blob_fd;
 	/** Unique ID of this run. */
 	int64_t id;
 	/** Number of statements in this run. */
@@ -255,6 +285,22 @@ struct vy_run_iterator {
 	/** LRU cache of two active pages (two pages is enough). */
 	struct vy_page *curr_page;
 	struct vy_page *prev_page;
+	/**
+	 * Pages following the last loaded page in the iteration
+	 * direction that are being read in advance by reader
+	 * threads, in the order they are going to be needed.
+	 * See vy_run_iterator_read_ahead().
+	 */
+	struct rlist read_ahead;
+	/** Number of pages in the read_ahead list. */
+	int read_ahead_count;
+	/**
+	 * Number of pages loaded in a row, each following the
+	 * previous one in the iteration direction.
+	 */
+	int seq_page_count;
+	/** Number of the page loaded last, UINT32_MAX if none. */
+	uint32_t last_page_no;
 	/** Is false until first .._get or .._next_.. method is called */
 	bool search_started;
 	/** Search is finished, you will not get more values from iterator */
@@ -403,13 +449,33 @@ vy_run_snprint_path(char *buf, int size, const char *dir,
 	return total;
 }
 
+static inline int
+vy_blob_snprint_path(char *buf, int size, const char *dir,
+		     uint32_t space_id, uint32_t iid,
+		     int64_t run_id, uint32_t blob_no)
+{
+	int total = 0;
+	SNPRINT(total, vy_index_snprint_path, buf, size,
+		dir, (unsigned)space_id, (unsigned)iid);
+	SNPRINT(total, snprintf, buf, size, "/%020lld.%u.blob",
+		(long long)run_id, (unsigned)blob_no);
+	return total;
+}
+
+/**
+ * Write a run. If @blob_threshold is not 0 and the run is for
+ * a primary index, bodies of REPLACE and INSERT statements of
+ * @blob_threshold bytes or larger are moved to blob files, see
+ * struct vy_run_blob_info.
+ */
 int
 vy_run_write(struct vy_run *run, const char *dirpath,
 	     uint32_t space_id, uint32_t iid,
 	     struct vy_stmt_stream *wi, uint64_t page_size,
 	     const struct key_def *cmp_def,
 	     const struct key_def *key_def,
-	     size_t max_output_count, double bloom_fpr);
+	     size_t max_output_count, double bloom_fpr,
+	     uint32_t blob_threshold);
 
 /**
  * Allocate a new run slice.
@@ -54,8 +54,10 @@
 #include "vy_mem.h"
 #include "vy_range.h"
 #include "vy_run.h"
+#include "vy_stmt.h"
 #include "vy_write_iterator.h"
 #include "trivia/util.h"
+#include "third_party/qsort_arg.h"
 #include "tt_pthread.h"
 
 /**
@@ -68,6 +70,27 @@ enum { VY_YIELD_LOOPS = 128 };
 enum { VY_YIELD_LOOPS = 2 };
 #endif
 
+/**
+ * Max size of tuples overwritten in the primary index that
+ * a single task collects to generate deferred DELETEs for
+ * secondary indexes. Tuples that don't fit are left in
+ * secondary indexes and skipped on read.
+ */
+enum { VY_DEFERRED_DELETE_SIZE_MAX = 16 * 1024 * 1024 };
+
+/**
+ * Min amount of data written by each part of a dump task
+ * split to be executed by multiple workers in parallel,
+ * see vy_task_dump_split().
+ */
+enum { VY_DUMP_PART_SIZE_MIN = 16 * 1024 * 1024 };
+
+/**
+ * Number of keys sampled per part to split a dump of an index
+ * that has fewer ranges than parts, see vy_task_dump_split().
+ */
+enum { VY_DUMP_PART_SAMPLES = 16 };
+
 /* Min and max values for vy_scheduler::timeout. */
 #define VY_SCHEDULER_TIMEOUT_MIN	1
 #define VY_SCHEDULER_TIMEOUT_MAX	60
@@ -103,6 +126,25 @@ struct vy_task_ops {
 		      bool in_shutdown);
 };
 
+/**
+ * A tuple overwritten in the primary index, which must be
+ * deleted from secondary indexes, see vy_index::defer_deletes.
+ * Tuples can't be passed between threads, so a worker saves
+ * raw tuple data, which is turned into statements in tx.
+ */
+struct vy_deferred_delete {
+	/** Link in vy_task::deferred_deletes. */
+	struct stailq_entry in_task;
+	/** LSN of the statement that overwrote the tuple. */
+	int64_t lsn;
+	/** Size of the overwritten tuple data. */
+	uint32_t old_size;
+	/** Size of the new tuple data, 0 if the tuple was deleted. */
+	uint32_t new_size;
+	/** Overwritten tuple data followed by new tuple data. */
+	char data[0];
+};
+
 struct vy_task {
 	const struct vy_task_ops *ops;
 	/** Return code of ->execute. */
@@ -143,6 +185,41 @@ struct vy_task {
 	 */
 	double bloom_fpr;
 	int64_t page_size;
+	uint32_t blob_threshold;
+	/**
+	 * Handler of tuples purged from the primary index by
+	 * the write iterator. Only used if the index has
+	 * vy_index::defer_deletes set.
+	 */
+	struct vy_deferred_delete_handler deferred_delete_handler;
+	/** List of vy_deferred_delete collected by the handler. */
+	struct stailq deferred_deletes;
+	/** Total size of vy_task::deferred_deletes. */
+	size_t deferred_delete_size;
+	/**
+	 * A dump of a large index is split by range boundaries
+	 * into parts that are written to separate runs by
+	 * different workers, see vy_task_dump_split(). The dump
+	 * task writes the first part itself and links auxiliary
+	 * tasks writing the other parts to @parts, along with
+	 * itself. Auxiliary tasks point back to it with @parent.
+	 */
+	struct vy_task *parent;
+	struct stailq parts;
+	/** Link in vy_task::parts. */
+	struct stailq_entry in_parent;
+	/** Number of auxiliary tasks that are still executed. */
+	int parts_pending;
+	/** Set once a worker is done with the task. */
+	bool is_executed;
+	/** Key range written by the task, NULL if unbounded. */
+	struct tuple *begin, *end;
+};
+
+/** A slice of a dumped run to be added to a range. */
+struct vy_dump_slice {
+	struct vy_range *range;
+	struct vy_slice *slice;
 };
 
 /**
@@ -167,6 +244,38 @@ vy_task_new(struct mempool *pool, struct vy_index *index,
 	task->index = index;
 	vy_index_ref(index);
 	diag_create(&task->diag);
+	stailq_create(&task->deferred_deletes);
+	stailq_create(&task->parts);
+	return task;
+}
+
+/**
+ * Called when a worker is done with a task. Return the task
+ * that is ready to be completed, i.e. the task itself or, if
+ * the task is a part of a dump, the dump task once all its
+ * parts have been written. Return NULL if there is nothing
+ * to complete yet.
+ */
+static struct vy_task *
+vy_task_finish_execute(struct vy_task *task)
+{
+	if (task->parent != NULL) {
+		task = task->parent;
+		assert(task->parts_pending > 0);
+		task->parts_pending--;
+	} else {
+		task->is_executed = true;
+	}
+	if (task->parts_pending > 0 || !task->is_executed)
+		return NULL;
+	/* Fail the dump if any of its parts failed. */
+	struct vy_task *part;
+	stailq_foreach_entry(part, &task->parts, in_parent) {
+		if (part->status != 0 && task->status == 0) {
+			task->status = part->status;
+			diag_move(&part->diag, &task->diag);
+		}
+	}
 	return task;
 }
 
@@ -174,6 +283,19 @@ vy_task_new(struct mempool *pool, struct vy_index *index,
 static void
 vy_task_delete(struct mempool *pool, struct vy_task *task)
 {
+	struct vy_deferred_delete *delete, *next;
+	stailq_foreach_entry_safe(delete, next, &task->deferred_deletes,
+				  in_task)
+		free(delete);
+	struct vy_task *part, *next_part;
+	stailq_foreach_entry_safe(part, next_part, &task->parts, in_parent) {
+		if (part != task)
+			vy_task_delete(pool, part);
+	}
+	if (task->begin != NULL)
+		tuple_unref(task->begin);
+	if (task->end != NULL)
+		tuple_unref(task->end);
 	vy_index_unref(task->index);
 	diag_destroy(&task->diag);
 	TRASH(task);
@@ -300,6 +422,10 @@ vy_scheduler_stop_workers(struct vy_scheduler *scheduler)
 	struct vy_task *task, *next;
 	stailq_concat(&task_queue, &scheduler->output_queue);
 	stailq_foreach_entry_safe(task, next, &task_queue, link) {
+		/* Parts of a dump are aborted along with the dump. */
+		task = vy_task_finish_execute(task);
+		if (task == NULL)
+			continue;
 		if (task->ops->abort != NULL)
 			task->ops->abort(scheduler, task, true);
 		vy_task_delete(&scheduler->task_pool, task);
@@ -309,11 +435,13 @@ vy_scheduler_stop_workers(struct vy_scheduler *scheduler)
 void
 vy_scheduler_create(struct vy_scheduler *scheduler, int write_threads,
 		    vy_scheduler_dump_complete_f dump_complete_cb,
+		    vy_scheduler_deferred_delete_f deferred_delete_cb,
 		    struct vy_run_env *run_env, struct rlist *read_views)
 {
 	memset(scheduler, 0, sizeof(*scheduler));
 
 	scheduler->dump_complete_cb = dump_complete_cb;
+	scheduler->deferred_delete_cb = deferred_delete_cb;
 	scheduler->read_views = read_views;
 	scheduler->run_env = run_env;
 
@@ -621,6 +749,122 @@ vy_run_discard(struct vy_run *run)
 	vy_log_tx_try_commit();
 }
 
+/**
+ * Called by the write iterator in a worker thread for each
+ * tuple purged from the primary index, because it was
+ * overwritten. Save the tuple so that it can be deleted
+ * from secondary indexes upon task completion.
+ */
+static int
+vy_task_deferred_delete_process(struct vy_deferred_delete_handler *handler,
+				struct tuple *old_stmt, struct tuple *new_stmt)
+{
+	struct vy_task *task = container_of(handler, struct vy_task,
+					    deferred_delete_handler);
+	enum iproto_type type = vy_stmt_type(new_stmt);
+	if (type != IPROTO_REPLACE && type != IPROTO_INSERT &&
+	    type != IPROTO_DELETE) {
+		/*
+		 * The new tuple is unknown until the UPSERT
+		 * is applied. Leave the old tuple in secondary
+		 * indexes, it will be skipped on read.
+		 */
+		return 0;
+	}
+	uint32_t old_size, new_size = 0;
+	const char *old_data = tuple_data_range(old_stmt, &old_size);
+	const char *new_data = NULL;
+	if (type != IPROTO_DELETE)
+		new_data = tuple_data_range(new_stmt, &new_size);
+	size_t size = sizeof(struct vy_deferred_delete) + old_size + new_size;
+	if (task->deferred_delete_size + size > VY_DEFERRED_DELETE_SIZE_MAX)
+		return 0;
+	struct vy_deferred_delete *delete = malloc(size);
+	if (delete == NULL) {
+		/*
+		 * Not critical: the old tuple will be skipped
+		 * on read.
+		 */
+		return 0;
+	}
+	delete->lsn = vy_stmt_lsn(new_stmt);
+	delete->old_size = old_size;
+	delete->new_size = new_size;
+	memcpy(delete->data, old_data, old_size);
+	if (new_size > 0)
+		memcpy(delete->data + old_size, new_data, new_size);
+	stailq_add_tail_entry(&task->deferred_deletes, delete, in_task);
+	task->deferred_delete_size += size;
+	return 0;
+}
+
+static const struct vy_deferred_delete_handler_iface
+vy_task_deferred_delete_iface = {
+	.process = vy_task_deferred_delete_process,
+};
+
+/**
+ * Return the deferred DELETE handler to pass to the write
+ * iterator of a task for the given index or NULL if the
+ * index doesn't need one.
+ */
+static struct vy_deferred_delete_handler *
+vy_task_deletes_handler(struct vy_task *task, struct vy_index *index)
+{
+	if (index->id != 0 || !index->defer_deletes)
+		return NULL;
+	task->deferred_delete_handler.iface = &vy_task_deferred_delete_iface;
+	return &task->deferred_delete_handler;
+}
+
+/**
+ * Generate DELETE statements for secondary indexes for tuples
+ * purged from the primary index by a task. Must be called after
+ * the task output was installed and without yielding, so that
+ * no newer statement can appear on disk for any of the keys.
+ *
+ * A tuple is skipped if the key has a statement in memory,
+ * because it could be newer than a statement for the same
+ * secondary key already dumped to disk, which the DELETE
+ * would shadow. The tuple is skipped on read then.
+ */
+static void
+vy_task_process_deferred_deletes(struct vy_scheduler *scheduler,
+				 struct vy_task *task)
+{
+	struct vy_index *pk = task->index;
+	struct vy_deferred_delete *delete;
+	stailq_foreach_entry(delete, &task->deferred_deletes, in_task) {
+		const char *data = delete->data;
+		struct tuple *old_stmt = vy_stmt_new_replace(pk->mem_format,
+					data, data + delete->old_size);
+		if (old_stmt == NULL) {
+			diag_log();
+			continue;
+		}
+		if (vy_index_mem_has_key(pk, old_stmt)) {
+			tuple_unref(old_stmt);
+			continue;
+		}
+		struct tuple *new_stmt = NULL;
+		if (delete->new_size > 0) {
+			data += delete->old_size;
+			new_stmt = vy_stmt_new_replace(pk->mem_format, data,
+						data + delete->new_size);
+			if (new_stmt == NULL) {
+				diag_log();
+				tuple_unref(old_stmt);
+				continue;
+			}
+		}
+		scheduler->deferred_delete_cb(scheduler, pk, old_stmt,
+					      new_stmt, delete->lsn);
+		tuple_unref(old_stmt);
+		if (new_stmt != NULL)
+			tuple_unref(new_stmt);
+	}
+}
+
 static int
 vy_task_dump_execute(struct vy_task *task)
 {
@@ -630,99 +874,128 @@ vy_task_dump_execute(struct vy_task *task)
 			    index->space_id, index->id, task->wi,
 			    task->page_size, index->cmp_def,
 			    index->key_def, task->max_output_count,
-			    task->bloom_fpr);
+			    task->bloom_fpr, task->blob_threshold);
 }
 
 static int
 vy_task_dump_complete(struct vy_scheduler *scheduler, struct vy_task *task)
 {
 	struct vy_index *index = task->index;
-	struct vy_run *new_run = task->new_run;
-	int64_t dump_lsn = new_run->dump_lsn;
+	int64_t dump_lsn = task->new_run->dump_lsn;
 	struct tuple_format *key_format = index->env->key_format;
 	struct vy_mem *mem, *next_mem;
-	struct vy_slice **new_slices, *slice;
+	struct vy_task *part;
+	struct vy_run *new_run;
+	struct vy_dump_slice *new_slices = NULL;
+	struct vy_slice *slice;
 	struct vy_range *range, *begin_range, *end_range;
 	struct tuple *min_key, *max_key;
-	int i, loops = 0;
+	int i, run_count = 0, slice_count = 0, slice_max, loops = 0;
 
 	assert(index->is_dumping);
 
-	if (vy_run_is_empty(new_run)) {
-		/*
-		 * In case the run is empty, we can discard the run
-		 * and delete dumped in-memory trees right away w/o
-		 * inserting slices into ranges. However, we need
-		 * to log index dump anyway.
-		 */
+	/*
+	 * Empty runs can be discarded right away. In case all runs
+	 * are empty, we can delete dumped in-memory trees w/o
+	 * inserting slices into ranges. However, we need to log
+	 * index dump anyway.
+	 */
+	stailq_foreach_entry(part, &task->parts, in_parent) {
+		if (!vy_run_is_empty(part->new_run)) {
+			run_count++;
+			continue;
+		}
+		vy_run_discard(part->new_run);
+		part->new_run = NULL;
+	}
+	if (run_count == 0) {
 		vy_log_tx_begin();
 		vy_log_dump_index(index->commit_lsn, dump_lsn);
 		if (vy_log_tx_commit() < 0)
 			goto fail;
-		vy_run_discard(new_run);
 		goto delete_mems;
 	}
 
-	assert(new_run->info.min_lsn > index->dump_lsn);
-	assert(new_run->info.max_lsn <= dump_lsn);
-
-	/*
-	 * Figure out which ranges intersect the new run.
-	 * @begin_range is the first range intersecting the run.
-	 * @end_range is the range following the last range
-	 * intersecting the run or NULL if the run itersects all
-	 * ranges.
-	 */
-	min_key = vy_key_from_msgpack(key_format, new_run->info.min_key);
-	if (min_key == NULL)
-		goto fail;
-	max_key = vy_key_from_msgpack(key_format, new_run->info.max_key);
-	if (max_key == NULL) {
-		tuple_unref(min_key);
-		goto fail;
-	}
-	begin_range = vy_range_tree_psearch(index->tree, min_key);
-	end_range = vy_range_tree_nsearch(index->tree, max_key);
-	tuple_unref(min_key);
-	tuple_unref(max_key);
-
 	/*
-	 * For each intersected range allocate a slice of the new run.
+	 * For each range intersecting a new run allocate a slice
+	 * of the run. Parts of a dump cover disjoint key ranges
+	 * aligned by range boundaries, but a range coalesced while
+	 * the dump was in progress may intersect a few of them.
 	 */
-	new_slices = calloc(index->range_count, sizeof(*new_slices));
+	slice_max = index->range_count + run_count;
+	new_slices = calloc(slice_max, sizeof(*new_slices));
 	if (new_slices == NULL) {
-		diag_set(OutOfMemory, index->range_count * sizeof(*new_slices),
-			 "malloc", "struct vy_slice *");
+		diag_set(OutOfMemory, slice_max * sizeof(*new_slices),
+			 "malloc", "struct vy_dump_slice");
 		goto fail;
 	}
-	for (range = begin_range, i = 0; range != end_range;
-	     range = vy_range_tree_next(index->tree, range), i++) {
-		slice = vy_slice_new(vy_log_next_id(), new_run,
-				     range->begin, range->end, index->cmp_def);
-		if (slice == NULL)
-			goto fail_free_slices;
-
-		assert(i < index->range_count);
-		new_slices[i] = slice;
+	stailq_foreach_entry(part, &task->parts, in_parent) {
+		new_run = part->new_run;
+		if (new_run == NULL)
+			continue;
 		/*
-		 * It's OK to yield here for the range tree can only
-		 * be changed from the scheduler fiber.
+		 * Note, deferred DELETEs for secondary indexes may be
+		 * older than index->dump_lsn, see vy_index::defer_deletes.
 		 */
-		if (++loops % VY_YIELD_LOOPS == 0)
-			fiber_sleep(0);
+		assert(index->id > 0 ||
+		       new_run->info.min_lsn > index->dump_lsn);
+		assert(new_run->info.max_lsn <= dump_lsn);
+		/*
+		 * Figure out which ranges intersect the new run.
+		 * @begin_range is the first range intersecting the run.
+		 * @end_range is the range following the last range
+		 * intersecting the run or NULL if the run itersects all
+		 * ranges.
+		 */
+		min_key = vy_key_from_msgpack(key_format,
+					      new_run->info.min_key);
+		if (min_key == NULL)
+			goto fail_free_slices;
+		max_key = vy_key_from_msgpack(key_format,
+					      new_run->info.max_key);
+		if (max_key == NULL) {
+			tuple_unref(min_key);
+			goto fail_free_slices;
+		}
+		begin_range = vy_range_tree_psearch(index->tree, min_key);
+		end_range = vy_range_tree_nsearch(index->tree, max_key);
+		tuple_unref(min_key);
+		tuple_unref(max_key);
+
+		for (range = begin_range; range != end_range;
+		     range = vy_range_tree_next(index->tree, range)) {
+			slice = vy_slice_new(vy_log_next_id(), new_run,
+					     range->begin, range->end,
+					     index->cmp_def);
+			if (slice == NULL)
+				goto fail_free_slices;
+
+			assert(slice_count < slice_max);
+			new_slices[slice_count].range = range;
+			new_slices[slice_count].slice = slice;
+			slice_count++;
+			/*
+			 * It's OK to yield here for the range tree can
+			 * only be changed from the scheduler fiber.
+			 */
+			if (++loops % VY_YIELD_LOOPS == 0)
+				fiber_sleep(0);
+		}
 	}
 
 	/*
 	 * Log change in metadata.
 	 */
 	vy_log_tx_begin();
-	vy_log_create_run(index->commit_lsn, new_run->id, dump_lsn);
-	for (range = begin_range, i = 0; range != end_range;
-	     range = vy_range_tree_next(index->tree, range), i++) {
-		assert(i < index->range_count);
-		slice = new_slices[i];
-		vy_log_insert_slice(range->id, new_run->id, slice->id,
-				    tuple_data_or_null(slice->begin),
+	stailq_foreach_entry(part, &task->parts, in_parent) {
+		if (part->new_run != NULL)
+			vy_log_create_run(index->commit_lsn,
+					  part->new_run->id, dump_lsn);
+	}
+	for (i = 0; i < slice_count; i++) {
+		slice = new_slices[i].slice;
+		vy_log_insert_slice(new_slices[i].range->id, slice->run->id,
+				    slice->id, tuple_data_or_null(slice->begin),
 				    tuple_data_or_null(slice->end));
 
 		if (++loops % VY_YIELD_LOOPS == 0)
@@ -733,24 +1006,30 @@ vy_task_dump_complete(struct vy_scheduler *scheduler, struct vy_task *task)
 		goto fail_free_slices;
 
 	/*
-	 * Account the new run.
+	 * Account the new runs.
 	 */
-	vy_index_add_run(index, new_run);
-	vy_stmt_counter_add_disk(&index->stat.disk.dump.out, &new_run->count);
-
-	/* Drop the reference held by the task. */
-	vy_run_unref(new_run);
+	stailq_foreach_entry(part, &task->parts, in_parent) {
+		new_run = part->new_run;
+		if (new_run == NULL)
+			continue;
+		vy_index_add_run(index, new_run);
+		vy_stmt_counter_add_disk(&index->stat.disk.dump.out,
+					 &new_run->count);
+		/* Drop the reference held by the task. */
+		vy_run_unref(new_run);
+		part->new_run = NULL;
+	}
 
 	/*
 	 * Add new slices to ranges.
 	 */
-	for (range = begin_range, i = 0; range != end_range;
-	     range = vy_range_tree_next(index->tree, range), i++) {
-		assert(i < index->range_count);
-		slice = new_slices[i];
+	for (i = 0; i < slice_count; i++) {
+		range = new_slices[i].range;
+		slice = new_slices[i].slice;
 		vy_index_unacct_range(index, range);
 		vy_range_add_slice(range, slice);
 		vy_index_acct_range(index, range);
+		vy_index_acct_range_write(index, range, slice->count.rows);
 		vy_range_update_compact_priority(range, &index->opts);
 		if (!vy_range_is_scheduled(range))
 			vy_range_heap_update(&index->range_heap,
@@ -783,8 +1062,11 @@ delete_mems:
 	index->dump_lsn = dump_lsn;
 	index->stat.disk.dump.count++;
 
-	/* The iterator has been cleaned up in a worker thread. */
-	task->wi->iface->close(task->wi);
+	stailq_foreach_entry(part, &task->parts, in_parent) {
+		vy_task_process_deferred_deletes(scheduler, part);
+		/* The iterator has been cleaned up in a worker thread. */
+		part->wi->iface->close(part->wi);
+	}
 
 	index->is_dumping = false;
 	vy_scheduler_update_index(scheduler, index);
@@ -801,10 +1083,8 @@ delete_mems:
 	return 0;
 
 fail_free_slices:
-	for (i = 0; i < index->range_count; i++) {
-		slice = new_slices[i];
-		if (slice != NULL)
-			vy_slice_delete(slice);
+	for (i = 0; i < slice_count; i++) {
+		vy_slice_delete(new_slices[i].slice);
 		if (++loops % VY_YIELD_LOOPS == 0)
 			fiber_sleep(0);
 	}
@@ -818,12 +1098,10 @@ vy_task_dump_abort(struct vy_scheduler *scheduler, struct vy_task *task,
 		   bool in_shutdown)
 {
 	struct vy_index *index = task->index;
+	struct vy_task *part;
 
 	assert(index->is_dumping);
 
-	/* The iterator has been cleaned up in a worker thread. */
-	task->wi->iface->close(task->wi);
-
 	/*
 	 * It's no use alerting the user if the server is
 	 * shutting down or the index was dropped.
@@ -834,11 +1112,18 @@ vy_task_dump_abort(struct vy_scheduler *scheduler, struct vy_task *task,
 		say_error("%s: dump failed", vy_index_name(index));
 	}
 
-	/* The metadata log is unavailable on shutdown. */
-	if (!in_shutdown)
-		vy_run_discard(task->new_run);
-	else
-		vy_run_unref(task->new_run);
+	stailq_foreach_entry(part, &task->parts, in_parent) {
+		/* The iterator has been cleaned up in a worker thread. */
+		part->wi->iface->close(part->wi);
+		if (part->new_run == NULL)
+			continue;
+		/* The metadata log is unavailable on shutdown. */
+		if (!in_shutdown)
+			vy_run_discard(part->new_run);
+		else
+			vy_run_unref(part->new_run);
+		part->new_run = NULL;
+	}
 
 	index->is_dumping = false;
 	vy_scheduler_update_index(scheduler, index);
@@ -862,6 +1147,219 @@ vy_task_dump_abort(struct vy_scheduler *scheduler, struct vy_task *task,
 		vy_scheduler_complete_dump(scheduler);
 }
 
+/**
+ * Add a part writing statements with keys >= @begin to a dump
+ * task. The previous part, @prev, is limited by @begin.
+ */
+static struct vy_task *
+vy_task_dump_add_part(struct vy_scheduler *scheduler, struct vy_task *task,
+		      struct vy_task *prev, struct tuple *begin)
+{
+	static struct vy_task_ops dump_part_ops = {
+		.execute = vy_task_dump_execute,
+		.complete = NULL,
+		.abort = NULL,
+	};
+
+	struct vy_task *part = vy_task_new(&scheduler->task_pool,
+					   task->index, &dump_part_ops);
+	if (part == NULL)
+		return NULL;
+	part->parent = task;
+	stailq_add_tail_entry(&task->parts, part, in_parent);
+	task->parts_pending++;
+	tuple_ref(begin);
+	prev->end = begin;
+	tuple_ref(begin);
+	part->begin = begin;
+	return part;
+}
+
+static int
+vy_dump_key_cmp(const void *a, const void *b, void *arg)
+{
+	return vy_key_compare(*(struct tuple **)a, *(struct tuple **)b,
+			      (const struct key_def *)arg);
+}
+
+/**
+ * Sample keys from the largest in-memory tree to dump and pick
+ * up to @part_count - 1 distinct keys splitting the statements
+ * into parts of about the same size. The keys are stored in
+ * @keys in ascending order and must be unreferenced by the
+ * caller. Return the number of keys or -1 on memory error.
+ */
+static int
+vy_task_dump_sample_keys(struct vy_scheduler *scheduler,
+			 struct vy_index *index, size_t part_count,
+			 struct tuple **keys)
+{
+	struct vy_mem *mem, *largest = NULL;
+	rlist_foreach_entry(mem, &index->sealed, in_sealed) {
+		if (mem->generation > scheduler->dump_generation)
+			continue;
+		if (largest == NULL || mem->tree.size > largest->tree.size)
+			largest = mem;
+	}
+	assert(largest != NULL && largest->tree.size > 0);
+
+	size_t sample_count = part_count * VY_DUMP_PART_SAMPLES;
+	struct tuple **samples = calloc(sample_count, sizeof(*samples));
+	if (samples == NULL) {
+		diag_set(OutOfMemory, sample_count * sizeof(*samples),
+			 "calloc", "struct tuple *");
+		return -1;
+	}
+	int key_count = -1;
+	for (size_t i = 0; i < sample_count; i++) {
+		const struct tuple **stmt = vy_mem_tree_random(&largest->tree,
+							       rand());
+		assert(stmt != NULL);
+		samples[i] = vy_stmt_extract_key(*stmt, index->cmp_def,
+						 index->env->key_format);
+		if (samples[i] == NULL)
+			goto out;
+	}
+	qsort_arg(samples, sample_count, sizeof(*samples),
+		  vy_dump_key_cmp, (void *)index->cmp_def);
+	key_count = 0;
+	for (size_t i = 1; i < part_count; i++) {
+		struct tuple *key = samples[i * sample_count / part_count];
+		if (key_count > 0 && vy_key_compare(keys[key_count - 1], key,
+						    index->cmp_def) >= 0)
+			continue;
+		tuple_ref(key);
+		keys[key_count++] = key;
+	}
+out:
+	for (size_t i = 0; i < sample_count; i++) {
+		if (samples[i] != NULL)
+			tuple_unref(samples[i]);
+	}
+	free(samples);
+	return key_count;
+}
+
+/**
+ * Split a dump task into parts so that the parts can be written
+ * by different workers in parallel.
+ *
+ * If the index has enough ranges, the parts are split by range
+ * boundaries. Ranges are split and coalesced to keep their size
+ * close to range_size so we expect parts spanning the same number
+ * of ranges to have about the same amount of data. Otherwise,
+ * e.g. on the first dump of an index, which has only one range,
+ * the parts are split by keys sampled from in-memory trees.
+ *
+ * The number of parts is limited by the number of idle workers
+ * and the amount of data to dump, see VY_DUMP_PART_SIZE_MIN.
+ */
+static int
+vy_task_dump_split(struct vy_scheduler *scheduler, struct vy_task *task,
+		   size_t dump_size)
+{
+	struct vy_index *index = task->index;
+	size_t part_size_min = VY_DUMP_PART_SIZE_MIN;
+	struct errinj *inj = errinj(ERRINJ_VY_DUMP_PART_SIZE, ERRINJ_INT);
+	if (inj != NULL && inj->iparam > 0)
+		part_size_min = inj->iparam;
+	size_t part_count = dump_size / part_size_min;
+	part_count = MIN(part_count, (size_t)scheduler->workers_available);
+	if (part_count <= 1)
+		return 0;
+
+	struct vy_task *prev = task;
+	if ((size_t)index->range_count < part_count) {
+		struct tuple **keys = calloc(part_count - 1, sizeof(*keys));
+		if (keys == NULL) {
+			diag_set(OutOfMemory, (part_count - 1) * sizeof(*keys),
+				 "calloc", "struct tuple *");
+			return -1;
+		}
+		int key_count = vy_task_dump_sample_keys(scheduler, index,
+							 part_count, keys);
+		for (int i = 0; i < key_count; i++) {
+			if (prev != NULL)
+				prev = vy_task_dump_add_part(scheduler, task,
+							     prev, keys[i]);
+			tuple_unref(keys[i]);
+		}
+		free(keys);
+		return key_count >= 0 && prev != NULL ? 0 : -1;
+	}
+
+	struct vy_range *range = vy_range_tree_first(index->tree);
+	for (size_t i = 0, part_no = 1; part_no < part_count;
+	     range = vy_range_tree_next(index->tree, range), i++) {
+		assert(range != NULL);
+		if (i < part_no * index->range_count / part_count)
+			continue;
+		assert(range->begin != NULL);
+		prev = vy_task_dump_add_part(scheduler, task, prev,
+					     range->begin);
+		if (prev == NULL)
+			return -1;
+		part_no++;
+	}
+	return 0;
+}
+
+/**
+ * Create a run and a write iterator for a dump task or
+ * a part of it.
+ */
+static int
+vy_task_dump_prepare(struct vy_scheduler *scheduler, struct vy_task *task,
+		     int64_t dump_lsn, size_t max_output_count)
+{
+	struct vy_index *index = task->index;
+	struct vy_run *new_run = vy_run_prepare(scheduler->run_env, index);
+	if (new_run == NULL)
+		return -1;
+
+	assert(dump_lsn >= 0);
+	new_run->dump_lsn = dump_lsn;
+
+	struct vy_stmt_stream *wi;
+	bool is_last_level = (index->run_count == 0);
+	wi = vy_write_iterator_new(index->cmp_def, index->disk_format,
+				   index->upsert_format, index->id == 0,
+				   is_last_level, scheduler->read_views,
+				   vy_task_deletes_handler(task, index));
+	if (wi == NULL)
+		goto err_wi;
+	if (index->id == 0 && index->opts.ttl > 0)
+		vy_write_iterator_set_ttl(wi, index->opts.ttl_field - 1,
+					  index->opts.ttl, fiber_time());
+	struct vy_mem *mem;
+	rlist_foreach_entry(mem, &index->sealed, in_sealed) {
+		if (mem->generation > scheduler->dump_generation)
+			continue;
+		if (vy_write_iterator_new_mem(wi, mem, task->begin,
+					      task->end) != 0)
+			goto err_wi_sub;
+	}
+
+	task->new_run = new_run;
+	task->wi = wi;
+	/*
+	 * We don't know how statements are distributed among
+	 * parts so size bloom filters of all parts for the worst
+	 * case.
+	 */
+	task->max_output_count = max_output_count;
+	task->bloom_fpr = index->opts.bloom_fpr;
+	task->blob_threshold = MIN(index->opts.blob_threshold, UINT32_MAX);
+	task->page_size = index->opts.page_size;
+	return 0;
+
+err_wi_sub:
+	wi->iface->close(wi);
+err_wi:
+	vy_run_discard(new_run);
+	return -1;
+}
+
 /**
  * Create a task to dump an index.
  *
@@ -901,6 +1399,7 @@ vy_task_dump_new(struct vy_scheduler *scheduler, struct vy_index *index,
 	 */
 	int64_t dump_lsn = -1;
 	size_t max_output_count = 0;
+	size_t dump_size = 0;
 	struct vy_mem *mem, *next_mem;
 	rlist_foreach_entry_safe(mem, &index->sealed, in_sealed, next_mem) {
 		if (mem->generation > scheduler->dump_generation)
@@ -916,7 +1415,14 @@ vy_task_dump_new(struct vy_scheduler *scheduler, struct vy_index *index,
 		}
 		dump_lsn = MAX(dump_lsn, mem->max_lsn);
 		max_output_count += mem->tree.size;
+		dump_size += mem->count.bytes;
 	}
+	/*
+	 * A secondary index mem may contain only deferred DELETEs,
+	 * which are older than the last dump, but dump_lsn must
+	 * never go backwards.
+	 */
+	dump_lsn = MAX(dump_lsn, index->dump_lsn);
 
 	if (max_output_count == 0) {
 		/* Nothing to do, pick another index. */
@@ -930,33 +1436,17 @@ vy_task_dump_new(struct vy_scheduler *scheduler, struct vy_index *index,
 	if (task == NULL)
 		goto err;
 
-	struct vy_run *new_run = vy_run_prepare(scheduler->run_env, index);
-	if (new_run == NULL)
-		goto err_run;
-
-	assert(dump_lsn >= 0);
-	new_run->dump_lsn = dump_lsn;
+	stailq_add_tail_entry(&task->parts, task, in_parent);
+	if (vy_task_dump_split(scheduler, task, dump_size) != 0)
+		goto err_parts;
 
-	struct vy_stmt_stream *wi;
-	bool is_last_level = (index->run_count == 0);
-	wi = vy_write_iterator_new(index->cmp_def, index->disk_format,
-				   index->upsert_format, index->id == 0,
-				   is_last_level, scheduler->read_views);
-	if (wi == NULL)
-		goto err_wi;
-	rlist_foreach_entry(mem, &index->sealed, in_sealed) {
-		if (mem->generation > scheduler->dump_generation)
-			continue;
-		if (vy_write_iterator_new_mem(wi, mem) != 0)
-			goto err_wi_sub;
+	struct vy_task *part;
+	stailq_foreach_entry(part, &task->parts, in_parent) {
+		if (vy_task_dump_prepare(scheduler, part, dump_lsn,
+					 max_output_count) != 0)
+			goto err_parts;
 	}
 
-	task->new_run = new_run;
-	task->wi = wi;
-	task->max_output_count = max_output_count;
-	task->bloom_fpr = index->opts.bloom_fpr;
-	task->page_size = index->opts.page_size;
-
 	index->is_dumping = true;
 	vy_scheduler_update_index(scheduler, index);
 
@@ -974,15 +1464,22 @@ vy_task_dump_new(struct vy_scheduler *scheduler, struct vy_index *index,
 
 	scheduler->dump_task_count++;
 
-	say_info("%s: dump started", vy_index_name(index));
+	if (task->parts_pending > 0) {
+		say_info("%s: dump started in %d parts",
+			 vy_index_name(index), task->parts_pending + 1);
+	} else {
+		say_info("%s: dump started", vy_index_name(index));
+	}
 	*p_task = task;
 	return 0;
 
-err_wi_sub:
-	task->wi->iface->close(wi);
-err_wi:
-	vy_run_discard(new_run);
-err_run:
+err_parts:
+	stailq_foreach_entry(part, &task->parts, in_parent) {
+		if (part->new_run == NULL)
+			continue;
+		part->wi->iface->close(part->wi);
+		vy_run_discard(part->new_run);
+	}
 	vy_task_delete(&scheduler->task_pool, task);
 err:
 	diag_log();
@@ -999,7 +1496,7 @@ vy_task_compact_execute(struct vy_task *task)
 			    index->space_id, index->id, task->wi,
 			    task->page_size, index->cmp_def,
 			    index->key_def, task->max_output_count,
-			    task->bloom_fpr);
+			    task->bloom_fpr, task->blob_threshold);
 }
 
 static int
@@ -1093,6 +1590,8 @@ vy_task_compact_complete(struct vy_scheduler *scheduler, struct vy_task *task)
 	 * the compacted slices were.
 	 */
 	RLIST_HEAD(compacted_slices);
+	bool is_newest = rlist_first_entry(&range->slices, struct vy_slice,
+					   in_range) == first_slice;
 	vy_index_unacct_range(index, range);
 	if (new_slice != NULL)
 		vy_range_add_slice_before(range, new_slice, first_slice);
@@ -1111,6 +1610,14 @@ vy_task_compact_complete(struct vy_scheduler *scheduler, struct vy_task *task)
 	vy_range_update_compact_priority(range, &index->opts);
 	index->stat.disk.compact.count++;
 
+	/*
+	 * If a slice was dumped to the range while compaction was
+	 * in progress, the compacted tuples may have been
+	 * overwritten on disk, see vy_task_process_deferred_deletes().
+	 */
+	if (is_newest)
+		vy_task_process_deferred_deletes(scheduler, task);
+
 	/*
 	 * Unaccount unused runs and delete compacted slices.
 	 */
@@ -1205,9 +1712,13 @@ vy_task_compact_new(struct vy_scheduler *scheduler, struct vy_index *index,
 	bool is_last_level = (range->compact_priority == range->slice_count);
 	wi = vy_write_iterator_new(index->cmp_def, index->disk_format,
 				   index->upsert_format, index->id == 0,
-				   is_last_level, scheduler->read_views);
+				   is_last_level, scheduler->read_views,
+				   vy_task_deletes_handler(task, index));
 	if (wi == NULL)
 		goto err_wi;
+	if (index->id == 0 && index->opts.ttl > 0)
+		vy_write_iterator_set_ttl(wi, index->opts.ttl_field - 1,
+					  index->opts.ttl, fiber_time());
 
 	struct vy_slice *slice;
 	int n = range->compact_priority;
@@ -1234,6 +1745,7 @@ vy_task_compact_new(struct vy_scheduler *scheduler, struct vy_index *index,
 	task->new_run = new_run;
 	task->wi = wi;
 	task->bloom_fpr = index->opts.bloom_fpr;
+	task->blob_threshold = MIN(index->opts.blob_threshold, UINT32_MAX);
 	task->page_size = index->opts.page_size;
 
 	/*
@@ -1450,7 +1962,7 @@ vy_scheduler_f(va_list va)
 
 	while (scheduler->scheduler_fiber != NULL) {
 		struct stailq output_queue;
-		struct vy_task *task, *next;
+		struct vy_task *task, *next, *part;
 		int tasks_failed = 0, tasks_done = 0;
 		bool was_empty;
 
@@ -1462,14 +1974,18 @@ vy_scheduler_f(va_list va)
 
 		/* Complete and delete all processed tasks. */
 		stailq_foreach_entry_safe(task, next, &output_queue, link) {
+			scheduler->workers_available++;
+			assert(scheduler->workers_available <=
+			       scheduler->worker_pool_size);
+			/* Wait for all parts of a dump to be written. */
+			task = vy_task_finish_execute(task);
+			if (task == NULL)
+				continue;
 			if (vy_scheduler_complete_task(scheduler, task) != 0)
 				tasks_failed++;
 			else
 				tasks_done++;
 			vy_task_delete(&scheduler->task_pool, task);
-			scheduler->workers_available++;
-			assert(scheduler->workers_available <=
-			       scheduler->worker_pool_size);
 		}
 		/*
 		 * Reset the timeout if we managed to successfully
@@ -1500,15 +2016,26 @@ vy_scheduler_f(va_list va)
 		if (task == NULL)
 			goto wait;
 
-		/* Queue the task and notify workers if necessary. */
+		/*
+		 * Queue the task, along with its parts if it is
+		 * a split dump, and notify workers if necessary.
+		 */
 		tt_pthread_mutex_lock(&scheduler->mutex);
 		was_empty = stailq_empty(&scheduler->input_queue);
 		stailq_add_tail_entry(&scheduler->input_queue, task, link);
-		if (was_empty)
+		stailq_foreach_entry(part, &task->parts, in_parent) {
+			if (part != task)
+				stailq_add_tail_entry(&scheduler->input_queue,
+						      part, link);
+		}
+		if (task->parts_pending > 0)
+			tt_pthread_cond_broadcast(&scheduler->worker_cond);
+		else if (was_empty)
 			tt_pthread_cond_signal(&scheduler->worker_cond);
 		tt_pthread_mutex_unlock(&scheduler->mutex);
 
-		scheduler->workers_available--;
+		scheduler->workers_available -= task->parts_pending + 1;
+		assert(scheduler->workers_available >= 0);
 		fiber_reschedule();
 		continue;
 error:
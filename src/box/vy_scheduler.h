@@ -50,6 +50,7 @@ extern "C" {
 
 struct cord;
 struct fiber;
+struct tuple;
 struct vy_index;
 struct vy_run_env;
 struct vy_scheduler;
@@ -58,6 +59,11 @@ typedef void
 (*vy_scheduler_dump_complete_f)(struct vy_scheduler *scheduler,
 				int64_t dump_generation, double dump_duration);
 
+typedef void
+(*vy_scheduler_deferred_delete_f)(struct vy_scheduler *scheduler,
+				  struct vy_index *pk, struct tuple *old_stmt,
+				  struct tuple *new_stmt, int64_t lsn);
+
 struct vy_scheduler {
 	/** Scheduler fiber. */
 	struct fiber *scheduler_fiber;
@@ -163,6 +169,14 @@ struct vy_scheduler {
 	 * by the dump.
 	 */
 	vy_scheduler_dump_complete_f dump_complete_cb;
+	/**
+	 * Function called by the scheduler for each tuple purged
+	 * from a primary index with vy_index::defer_deletes set.
+	 * It is supposed to delete @old_stmt from secondary
+	 * indexes. @new_stmt is the tuple that overwrote it at
+	 * @lsn or NULL if it was deleted.
+	 */
+	vy_scheduler_deferred_delete_f deferred_delete_cb;
 	/** List of read views, see tx_manager::read_views. */
 	struct rlist *read_views;
 	/** Context needed for writing runs. */
@@ -175,6 +189,7 @@ struct vy_scheduler {
 void
 vy_scheduler_create(struct vy_scheduler *scheduler, int write_threads,
 		    vy_scheduler_dump_complete_f dump_complete_cb,
+		    vy_scheduler_deferred_delete_f deferred_delete_cb,
 		    struct vy_run_env *run_env, struct rlist *read_views);
 
 /**
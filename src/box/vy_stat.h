@@ -154,12 +154,24 @@ struct vy_index_stat {
 	} txw;
 };
 
+/** Hit statistics of a particular kind of cache lookups. */
+struct vy_cache_lookup_stat {
+	/** Number of lookups. */
+	int64_t lookup;
+	/** Number of lookups that found a statement in the cache. */
+	int64_t hit;
+};
+
 /** Tuple cache statistics. */
 struct vy_cache_stat {
 	/** Number of statements in the cache. */
 	struct vy_stmt_counter count;
 	/** Number of lookups in the cache. */
 	int64_t lookup;
+	/** Lookups of a statement by a full key. */
+	struct vy_cache_lookup_stat point;
+	/** Positioning of range iterators. */
+	struct vy_cache_lookup_stat range;
 	/** Number of reads from the cache. */
 	struct vy_stmt_counter get;
 	/** Number of writes to the cache. */
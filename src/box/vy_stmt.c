@@ -103,8 +103,10 @@ vy_stmt_alloc(struct tuple_format *format, uint32_t bsize)
 		tuple_format_ref(format);
 	tuple->bsize = bsize;
 	tuple->data_offset = sizeof(struct vy_stmt) + meta_size;;
+	tuple->is_compressed = false;
 	vy_stmt_set_lsn(tuple, 0);
 	vy_stmt_set_type(tuple, 0);
+	((struct vy_stmt *) tuple)->has_blob_ref = false;
 	return tuple;
 }
 
@@ -126,6 +128,8 @@ vy_stmt_dup(const struct tuple *stmt, struct tuple_format *format)
 	memcpy(res, stmt, tuple_size(stmt));
 	res->refs = 1;
 	res->format_id = tuple_format_id(format);
+	/* The blob location isn't copied. */
+	((struct vy_stmt *) res)->has_blob_ref = false;
 	assert(tuple_size(res) == tuple_size(stmt));
 	return res;
 }
@@ -142,6 +146,7 @@ vy_stmt_dup_lsregion(const struct tuple *stmt, struct lsregion *lsregion,
 		return NULL;
 	}
 	memcpy(mem_stmt, stmt, size);
+	((struct vy_stmt *) mem_stmt)->has_blob_ref = false;
 	/*
 	 * Region allocated statements can't be referenced or unreferenced
 	 * because they are located in monolithic memory region. Referencing has
@@ -288,6 +293,34 @@ vy_stmt_new_replace(struct tuple_format *format, const char *tuple_begin,
 				    NULL, 0, IPROTO_REPLACE);
 }
 
+struct tuple *
+vy_stmt_new_from_blob(struct tuple_format *format, const char *tuple_begin,
+		      const char *tuple_end, enum iproto_type type,
+		      const struct vy_blob_ref *ref)
+{
+	assert(type == IPROTO_REPLACE || type == IPROTO_INSERT);
+	assert(format->extra_size != sizeof(uint8_t));
+	struct tuple *stmt = vy_stmt_new_with_ops(format, tuple_begin,
+						  tuple_end, NULL, 0, type);
+	if (stmt == NULL || ref == NULL)
+		return stmt;
+	/*
+	 * The statement hasn't been shared yet so we can
+	 * reallocate it to append the blob location.
+	 */
+	size_t size = tuple_size(stmt);
+	struct tuple *res = realloc(stmt, size + sizeof(*ref));
+	if (res == NULL) {
+		diag_set(OutOfMemory, size + sizeof(*ref),
+			 "realloc", "struct vy_stmt");
+		tuple_unref(stmt);
+		return NULL;
+	}
+	memcpy((char *) res + size, ref, sizeof(*ref));
+	((struct vy_stmt *) res)->has_blob_ref = true;
+	return res;
+}
+
 struct tuple *
 vy_stmt_new_insert(struct tuple_format *format, const char *tuple_begin,
 		   const char *tuple_end)
@@ -569,6 +602,129 @@ vy_stmt_encode_secondary(const struct tuple *value,
 		return 0;
 }
 
+int
+vy_stmt_encode_blob_ref(const struct tuple *value,
+			const struct key_def *cmp_def,
+			const struct vy_blob_ref *ref,
+			struct xrow_header *xrow)
+{
+	enum iproto_type type = vy_stmt_type(value);
+	assert(type == IPROTO_REPLACE || type == IPROTO_INSERT);
+	memset(xrow, 0, sizeof(*xrow));
+	xrow->type = VY_RUN_BLOB_REF;
+	xrow->lsn = vy_stmt_lsn(value);
+
+	uint32_t key_size;
+	const char *key = tuple_extract_key(value, cmp_def, &key_size);
+	if (key == NULL)
+		return -1;
+	size_t size = mp_sizeof_map(5) +
+		mp_sizeof_uint(VY_BLOB_REF_TYPE) + mp_sizeof_uint(type) +
+		mp_sizeof_uint(VY_BLOB_REF_KEY) + key_size +
+		mp_sizeof_uint(VY_BLOB_REF_FILE) + mp_sizeof_uint(ref->blob_no) +
+		mp_sizeof_uint(VY_BLOB_REF_OFFSET) + mp_sizeof_uint(ref->offset) +
+		mp_sizeof_uint(VY_BLOB_REF_SIZE) + mp_sizeof_uint(ref->size);
+	char *pos = region_alloc(&fiber()->gc, size);
+	if (pos == NULL) {
+		diag_set(OutOfMemory, size, "region", "blob ref");
+		return -1;
+	}
+	xrow->body->iov_base = pos;
+	pos = mp_encode_map(pos, 5);
+	pos = mp_encode_uint(pos, VY_BLOB_REF_TYPE);
+	pos = mp_encode_uint(pos, type);
+	pos = mp_encode_uint(pos, VY_BLOB_REF_KEY);
+	memcpy(pos, key, key_size);
+	pos += key_size;
+	pos = mp_encode_uint(pos, VY_BLOB_REF_FILE);
+	pos = mp_encode_uint(pos, ref->blob_no);
+	pos = mp_encode_uint(pos, VY_BLOB_REF_OFFSET);
+	pos = mp_encode_uint(pos, ref->offset);
+	pos = mp_encode_uint(pos, VY_BLOB_REF_SIZE);
+	pos = mp_encode_uint(pos, ref->size);
+	xrow->body->iov_len = pos - (char *) xrow->body->iov_base;
+	assert(xrow->body->iov_len == size);
+	xrow->bodycnt = 1;
+	return 0;
+}
+
+struct tuple *
+vy_stmt_decode_blob_ref(struct xrow_header *xrow,
+			const struct key_def *cmp_def,
+			struct tuple_format *format,
+			struct vy_blob_ref *ref)
+{
+	assert(xrow->type == VY_RUN_BLOB_REF);
+	uint64_t key_map = (1ULL << VY_BLOB_REF_TYPE) |
+			   (1ULL << VY_BLOB_REF_KEY) |
+			   (1ULL << VY_BLOB_REF_FILE) |
+			   (1ULL << VY_BLOB_REF_OFFSET) |
+			   (1ULL << VY_BLOB_REF_SIZE);
+	uint32_t type = 0;
+	const char *key = NULL;
+	const char *pos, *end, *parts;
+	uint32_t map_size;
+	struct tuple *stmt;
+	memset(ref, 0, sizeof(*ref));
+	if (xrow->bodycnt == 0)
+		goto error;
+	pos = xrow->body->iov_base;
+	end = pos + xrow->body->iov_len;
+	if (mp_typeof(*pos) != MP_MAP || mp_check_map(pos, end) > 0)
+		goto error;
+	map_size = mp_decode_map(&pos);
+	for (uint32_t i = 0; i < map_size; i++) {
+		if (mp_typeof(*pos) != MP_UINT)
+			goto error;
+		uint64_t k = mp_decode_uint(&pos);
+		const char *value = pos;
+		if (mp_check(&pos, end) != 0)
+			goto error;
+		if (k != VY_BLOB_REF_KEY && k < VY_BLOB_REF_KEY_MAX &&
+		    mp_typeof(*value) != MP_UINT)
+			goto error;
+		switch (k) {
+		case VY_BLOB_REF_TYPE:
+			type = mp_decode_uint(&value);
+			break;
+		case VY_BLOB_REF_KEY:
+			if (mp_typeof(*value) != MP_ARRAY)
+				goto error;
+			key = value;
+			break;
+		case VY_BLOB_REF_FILE:
+			ref->blob_no = mp_decode_uint(&value);
+			break;
+		case VY_BLOB_REF_OFFSET:
+			ref->offset = mp_decode_uint(&value);
+			break;
+		case VY_BLOB_REF_SIZE:
+			ref->size = mp_decode_uint(&value);
+			break;
+		default:
+			continue;
+		}
+		key_map &= ~(1ULL << k);
+	}
+	if (key_map != 0 || ref->size == 0 ||
+	    (type != IPROTO_REPLACE && type != IPROTO_INSERT))
+		goto error;
+	parts = key;
+	if (mp_decode_array(&parts) != cmp_def->part_count)
+		goto error;
+
+	stmt = vy_stmt_new_surrogate_from_key(key, type, cmp_def, format);
+	if (stmt == NULL)
+		return NULL;
+	vy_stmt_set_lsn(stmt, xrow->lsn);
+	return stmt;
+error:
+	/* TODO: report filename. */
+	diag_set(ClientError, ER_INVALID_RUN_FILE,
+		 "Can't decode statement: invalid blob reference");
+	return NULL;
+}
+
 struct tuple *
 vy_stmt_decode(struct xrow_header *xrow, const struct key_def *key_def,
 	       struct tuple_format *format,
@@ -34,6 +34,7 @@
 #include <trivia/util.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <string.h>
 #include <stdbool.h>
 #include <assert.h>
 #include <msgpuck.h>
@@ -104,6 +105,14 @@ struct vy_stmt {
 	struct tuple base;
 	int64_t lsn;
 	uint8_t  type; /* IPROTO_SELECT/REPLACE/UPSERT/DELETE */
+	/**
+	 * Set if the statement body was read from a blob file
+	 * and can be referenced rather than copied when written
+	 * to a new run. The location of the body, struct
+	 * vy_blob_ref, is stored right after the statement data,
+	 * see vy_stmt_blob_ref().
+	 */
+	bool has_blob_ref;
 	/**
 	 * Number of UPSERT statements for the same key preceding
 	 * this statement. Used to trigger upsert squashing in the
@@ -147,6 +156,34 @@ vy_stmt_set_type(struct tuple *stmt, enum iproto_type type)
 	((struct vy_stmt *) stmt)->type = type;
 }
 
+/**
+ * Location of a statement body moved out of a run file to
+ * a blob file, see index_opts::blob_threshold.
+ */
+struct vy_blob_ref {
+	/** ID of the run the blob file belongs to. */
+	int64_t run_id;
+	/** Offset of the statement body in the blob file. */
+	uint64_t offset;
+	/** Number of the blob file in the run. */
+	uint32_t blob_no;
+	/** Size of the statement body. */
+	uint32_t size;
+};
+
+/**
+ * Get the location of the blob the statement body was read from.
+ * Return false if the statement doesn't have it.
+ */
+static inline bool
+vy_stmt_blob_ref(const struct tuple *stmt, struct vy_blob_ref *ref)
+{
+	if (!((const struct vy_stmt *) stmt)->has_blob_ref)
+		return false;
+	memcpy(ref, (const char *) stmt + tuple_size(stmt), sizeof(*ref));
+	return true;
+}
+
 /** Get upserts count of the vinyl statement. */
 static inline uint8_t
 vy_stmt_n_upserts(const struct tuple *stmt)
@@ -473,6 +510,25 @@ struct tuple *
 vy_stmt_new_replace(struct tuple_format *format, const char *tuple,
                     const char *tuple_end);
 
+/**
+ * Create a REPLACE or INSERT statement from a body read from
+ * a blob file and remember the blob location in it, see
+ * vy_stmt_blob_ref().
+ * @param format Format of a tuple for offsets generating.
+ * @param tuple_begin MessagePack data that contain an array of fields WITH the
+ *                    array header.
+ * @param tuple_end End of the array that begins from @param tuple_begin.
+ * @param type Statement type.
+ * @param ref Location of the body or NULL.
+ *
+ * @retval NULL     Memory allocation error.
+ * @retval not NULL Success.
+ */
+struct tuple *
+vy_stmt_new_from_blob(struct tuple_format *format, const char *tuple_begin,
+		      const char *tuple_end, enum iproto_type type,
+		      const struct vy_blob_ref *ref);
+
 /**
  * Create the INSERT statement from raw MessagePack data.
  * @param format Format of a tuple for offsets generating.
@@ -627,6 +683,40 @@ vy_stmt_encode_secondary(const struct tuple *value,
 			 const struct key_def *cmp_def,
 			 struct xrow_header *xrow);
 
+/**
+ * Encode a REPLACE or INSERT of a primary index whose body is
+ * stored in a blob file as xrow_header. Only the key parts of
+ * the statement are stored in the xrow.
+ *
+ * @param value statement to encode
+ * @param cmp_def key definition
+ * @param ref location of the statement body
+ * @param xrow[out] xrow to fill
+ *
+ * @retval 0 if OK
+ * @retval -1 if error
+ */
+int
+vy_stmt_encode_blob_ref(const struct tuple *value,
+			const struct key_def *cmp_def,
+			const struct vy_blob_ref *ref,
+			struct xrow_header *xrow);
+
+/**
+ * Decode a statement encoded with vy_stmt_encode_blob_ref().
+ * Return a surrogate statement that has only key parts and
+ * store the location of its body in @a ref. The caller is
+ * supposed to fill ref->run_id.
+ *
+ * @retval stmt on success
+ * @retval NULL on error
+ */
+struct tuple *
+vy_stmt_decode_blob_ref(struct xrow_header *xrow,
+			const struct key_def *cmp_def,
+			struct tuple_format *format,
+			struct vy_blob_ref *ref);
+
 /**
  * Reconstruct vinyl tuple info and data from xrow
  *
@@ -694,6 +784,44 @@ vy_tuple_key_contains_null(const struct tuple *tuple, const struct key_def *def)
 	return false;
 }
 
+/**
+ * Check if a tuple has expired, see index_opts::ttl.
+ * @param tuple Tuple to check.
+ * @param fieldno Number of the field storing the time the
+ *                tuple was created at, in seconds since
+ *                the Epoch.
+ * @param ttl Time to live, in seconds.
+ * @param now Current time, in seconds since the Epoch.
+ * @retval Has the tuple expired or not? A tuple with a missing
+ *         or non-numeric field never expires.
+ */
+static inline bool
+vy_tuple_is_expired(const struct tuple *tuple, uint32_t fieldno,
+		    int64_t ttl, double now)
+{
+	const char *field = tuple_field(tuple, fieldno);
+	if (field == NULL)
+		return false;
+	double created;
+	switch (mp_typeof(*field)) {
+	case MP_UINT:
+		created = mp_decode_uint(&field);
+		break;
+	case MP_INT:
+		created = mp_decode_int(&field);
+		break;
+	case MP_FLOAT:
+		created = mp_decode_float(&field);
+		break;
+	case MP_DOUBLE:
+		created = mp_decode_double(&field);
+		break;
+	default:
+		return false;
+	}
+	return created + ttl <= now;
+}
+
 #if defined(__cplusplus)
 } /* extern "C" */
 #endif /* defined(__cplusplus) */
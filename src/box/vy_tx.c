@@ -460,8 +460,10 @@ vy_tx_write(struct vy_index *index, struct vy_mem *mem,
 		/* Invalidate cache element. */
 		vy_cache_on_write(&index->cache, stmt, &deleted);
 		if (deleted != NULL) {
+			const struct tuple *base =
+				vy_index_upsert_base(index, deleted);
 			struct tuple *applied =
-				vy_apply_upsert(stmt, deleted, mem->cmp_def,
+				vy_apply_upsert(stmt, base, mem->cmp_def,
 						mem->format, mem->upsert_format,
 						false);
 			tuple_unref(deleted);
@@ -824,7 +826,9 @@ vy_tx_set(struct vy_tx *tx, struct vy_index *index, struct tuple *stmt)
 		       old_type == IPROTO_DELETE);
 		(void) old_type;
 
-		applied = vy_apply_upsert(stmt, old->stmt, index->cmp_def,
+		const struct tuple *base =
+			vy_index_upsert_base(index, old->stmt);
+		applied = vy_apply_upsert(stmt, base, index->cmp_def,
 					  index->mem_format,
 					  index->upsert_format, true);
 		index->stat.upsert.applied++;
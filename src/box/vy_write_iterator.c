@@ -181,6 +181,20 @@ struct vy_write_iterator {
 	 * key and its tuple format is different.
 	 */
 	bool is_primary;
+	/**
+	 * Handler of REPLACE and INSERT statements purged
+	 * because they were overwritten, may be NULL.
+	 */
+	struct vy_deferred_delete_handler *deferred_delete_handler;
+	/**
+	 * Time to live of tuples, in seconds, or 0 if tuples
+	 * never expire. See vy_write_iterator_set_ttl.
+	 */
+	int64_t ttl;
+	/** Number of the field storing tuple creation time. */
+	uint32_t ttl_fieldno;
+	/** Time against which tuple expiration is checked. */
+	double now;
 
 	/** Length of the @read_views. */
 	int rv_count;
@@ -332,8 +346,10 @@ static const struct vy_stmt_stream_iface vy_slice_stream_iface;
 struct vy_stmt_stream *
 vy_write_iterator_new(const struct key_def *cmp_def, struct tuple_format *format,
 		      struct tuple_format *upsert_format, bool is_primary,
-		      bool is_last_level, struct rlist *read_views)
+		      bool is_last_level, struct rlist *read_views,
+		      struct vy_deferred_delete_handler *handler)
 {
+	assert(handler == NULL || is_primary);
 	/*
 	 * One is reserved for INT64_MAX - maximal read view.
 	 */
@@ -369,9 +385,22 @@ vy_write_iterator_new(const struct key_def *cmp_def, struct tuple_format *format
 	tuple_format_ref(stream->upsert_format);
 	stream->is_primary = is_primary;
 	stream->is_last_level = is_last_level;
+	stream->deferred_delete_handler = handler;
 	return &stream->base;
 }
 
+void
+vy_write_iterator_set_ttl(struct vy_stmt_stream *vstream, uint32_t fieldno,
+			  int64_t ttl, double now)
+{
+	assert(vstream->iface == &vy_slice_stream_iface);
+	struct vy_write_iterator *stream = (struct vy_write_iterator *)vstream;
+	assert(stream->is_primary);
+	stream->ttl = ttl;
+	stream->ttl_fieldno = fieldno;
+	stream->now = now;
+}
+
 /**
  * Start the search. Must be called after *new* methods and
  * before *next* method.
@@ -424,13 +453,14 @@ vy_write_iterator_close(struct vy_stmt_stream *vstream)
  * @return 0 on success or -1 on error (diag is set).
  */
 NODISCARD int
-vy_write_iterator_new_mem(struct vy_stmt_stream *vstream, struct vy_mem *mem)
+vy_write_iterator_new_mem(struct vy_stmt_stream *vstream, struct vy_mem *mem,
+			  const struct tuple *begin, const struct tuple *end)
 {
 	struct vy_write_iterator *stream = (struct vy_write_iterator *)vstream;
 	struct vy_write_src *src = vy_write_iterator_new_src(stream);
 	if (src == NULL)
 		return -1;
-	vy_mem_stream_open(&src->mem_stream, mem);
+	vy_mem_stream_open(&src->mem_stream, mem, begin, end);
 	return 0;
 }
 
@@ -640,6 +670,21 @@ vy_write_iterator_build_history(struct region *region,
 			 * view but older than the previous read view,
 			 * which is already fully built.
 			 */
+			if (stream->deferred_delete_handler != NULL &&
+			    (vy_stmt_type(src->tuple) == IPROTO_REPLACE ||
+			     vy_stmt_type(src->tuple) == IPROTO_INSERT)) {
+				/*
+				 * The tuple was overwritten. Let the
+				 * handler delete it from secondary
+				 * indexes.
+				 */
+				struct vy_deferred_delete_handler *handler =
+					stream->deferred_delete_handler;
+				rc = handler->iface->process(handler,
+						src->tuple, end_of_key_src.tuple);
+				if (rc != 0)
+					break;
+			}
 			goto next_lsn;
 		}
 		while (vy_stmt_lsn(src->tuple) <= merge_until_lsn) {
@@ -753,6 +798,24 @@ vy_read_view_merge(struct vy_write_iterator *stream, struct tuple *hint,
 		rv->history = NULL;
 		return 0;
 	}
+	if (stream->ttl > 0 && h->next != NULL &&
+	    (vy_stmt_type(h->tuple) == IPROTO_REPLACE ||
+	     vy_stmt_type(h->tuple) == IPROTO_INSERT) &&
+	    vy_tuple_is_expired(h->tuple, stream->ttl_fieldno,
+				stream->ttl, stream->now)) {
+		/*
+		 * UPSERTs are applied to an expired tuple as if
+		 * it had been purged, the same way they are on
+		 * read, see vy_index_upsert_base().
+		 */
+		struct tuple *deleted =
+			vy_stmt_new_surrogate_delete(stream->format, h->tuple);
+		if (deleted == NULL)
+			return -1;
+		vy_stmt_set_lsn(deleted, vy_stmt_lsn(h->tuple));
+		vy_stmt_unref_if_possible(h->tuple);
+		h->tuple = deleted;
+	}
 	/*
 	 * Two possible hints to remove the current UPSERT.
 	 * 1. If the stream is working on the last level, we
@@ -803,6 +866,32 @@ vy_read_view_merge(struct vy_write_iterator *stream, struct tuple *hint,
 	rv->history = NULL;
 	result->tuple = NULL;
 	assert(result->next == NULL);
+	if (stream->ttl > 0 &&
+	    (vy_stmt_type(rv->tuple) == IPROTO_REPLACE ||
+	     vy_stmt_type(rv->tuple) == IPROTO_INSERT) &&
+	    vy_tuple_is_expired(rv->tuple, stream->ttl_fieldno,
+				stream->ttl, stream->now)) {
+		/*
+		 * Purge an expired tuple. If there is nothing
+		 * older for this key, simply drop it, otherwise
+		 * turn it into a DELETE so that it overwrites the
+		 * older statements. The DELETE is dropped by
+		 * optimization #6 if possible.
+		 */
+		struct tuple *tuple = rv->tuple;
+		if (hint == NULL && stream->is_last_level) {
+			vy_stmt_unref_if_possible(tuple);
+			rv->tuple = NULL;
+			return 0;
+		}
+		struct tuple *deleted =
+			vy_stmt_new_surrogate_delete(stream->format, tuple);
+		if (deleted == NULL)
+			return -1;
+		vy_stmt_set_lsn(deleted, vy_stmt_lsn(tuple));
+		vy_stmt_unref_if_possible(tuple);
+		rv->tuple = deleted;
+	}
 	if (hint != NULL) {
 		/* Not the first statement. */
 		return 0;
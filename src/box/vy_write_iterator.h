@@ -210,6 +210,14 @@
  * also turn the first INSERT in the resulting key's history to a
  * REPLACE in case the oldest statement among all sources is not
  * an INSERT.
+ *
+ * ---------------------------------------------------------------
+ * Expiration: if the iterator is given a time to live (see
+ * vy_write_iterator_set_ttl), a REPLACE or INSERT that has
+ * expired by the time the iterator was opened is converted to
+ * a DELETE. If it is the oldest statement for the key and the
+ * stream is working on the last level, it is dropped altogether,
+ * as is the DELETE discarded by optimization #6.
  */
 
 struct vy_write_iterator;
@@ -218,6 +226,36 @@ struct tuple_format;
 struct tuple;
 struct vy_mem;
 struct vy_slice;
+struct vy_deferred_delete_handler;
+
+struct vy_deferred_delete_handler_iface {
+	/**
+	 * Process a REPLACE or INSERT statement purged by
+	 * a primary index write iterator, because it was
+	 * overwritten by a newer statement for the same key.
+	 * Called from the thread running the iterator.
+	 *
+	 * @param handler Deferred DELETE handler.
+	 * @param old_stmt Purged statement.
+	 * @param new_stmt The newest statement for the same key
+	 *                 among all sources of the iterator.
+	 *
+	 * @retval  0 Success.
+	 * @retval -1 Error (diag is set).
+	 */
+	int (*process)(struct vy_deferred_delete_handler *handler,
+		       struct tuple *old_stmt, struct tuple *new_stmt);
+};
+
+/**
+ * Callback used by the write iterator of a primary index to
+ * let the caller generate DELETE statements for secondary
+ * indexes of a space that doesn't delete overwritten tuples
+ * from them on REPLACE (see space_opts::defer_deletes).
+ */
+struct vy_deferred_delete_handler {
+	const struct vy_deferred_delete_handler_iface *iface;
+};
 
 /**
  * Open an empty write iterator. To add sources to the iterator
@@ -228,19 +266,37 @@ struct vy_slice;
  * @param LSM tree is_primary - set if this iterator is for a primary index.
  * @param is_last_level - there is no older level than the one we're writing to.
  * @param read_views - Opened read views.
+ * @param handler - Handler of purged overwritten statements or NULL.
+ *                  Only applicable to a primary index.
  * @return the iterator or NULL on error (diag is set).
  */
 struct vy_stmt_stream *
 vy_write_iterator_new(const struct key_def *cmp_def, struct tuple_format *format,
 		      struct tuple_format *upsert_format, bool is_primary,
-		      bool is_last_level, struct rlist *read_views);
+		      bool is_last_level, struct rlist *read_views,
+		      struct vy_deferred_delete_handler *handler);
+
+/**
+ * Make the iterator purge tuples that have expired by @now,
+ * see index_opts::ttl. Only applicable to a primary index.
+ * @param fieldno - number of the field storing tuple creation
+ *                  time, from 0.
+ * @param ttl - time to live, in seconds.
+ * @param now - current time, in seconds since the Epoch.
+ */
+void
+vy_write_iterator_set_ttl(struct vy_stmt_stream *stream, uint32_t fieldno,
+			  int64_t ttl, double now);
 
 /**
- * Add a mem as a source to the iterator.
+ * Add a mem as a source to the iterator. If @begin or @end is
+ * not NULL, only statements in the key range [@begin, @end)
+ * are taken from the mem.
  * @return 0 on success, -1 on error (diag is set).
  */
 NODISCARD int
-vy_write_iterator_new_mem(struct vy_stmt_stream *stream, struct vy_mem *mem);
+vy_write_iterator_new_mem(struct vy_stmt_stream *stream, struct vy_mem *mem,
+			  const struct tuple *begin, const struct tuple *end);
 
 /**
  * Add a run slice as a source to the iterator.
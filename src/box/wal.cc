@@ -206,11 +206,13 @@ tx_schedule_queue(struct stailq *queue)
 {
 	/*
 	 * fiber_wakeup() is faster than fiber_call() when there
-	 * are many ready fibers.
+	 * are many ready fibers. Use the system priority class
+	 * so that the fair scheduler does not reorder commits
+	 * of fibers of different classes.
 	 */
 	struct journal_entry *req;
 	stailq_foreach_entry(req, queue, fifo)
-		fiber_wakeup(req->fiber);
+		fiber_wakeup_prio(req->fiber, FIBER_PRIO_SYSTEM);
 }
 
 /**
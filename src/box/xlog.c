@@ -81,19 +81,12 @@ enum {
 
 /* {{{ struct xlog_meta */
 
-enum {
-	/*
-	 * The maximum length of xlog meta
-	 *
-	 * @sa xlog_meta_parse()
-	 */
-	XLOG_META_LEN_MAX = 1024 + VCLOCK_STR_LEN_MAX
-};
-
 #define INSTANCE_UUID_KEY "Instance"
 #define INSTANCE_UUID_KEY_V12 "Server"
 #define VCLOCK_KEY "VClock"
 #define VERSION_KEY "Version"
+#define PART_COUNT_KEY "Parts"
+#define PREV_SIGNATURE_KEY "Prev"
 
 static const char v13[] = "0.13";
 static const char v12[] = "0.12";
@@ -117,18 +110,73 @@ xlog_meta_format(const struct xlog_meta *meta, char *buf, int size)
 	if (vstr == NULL)
 		return -1;
 	char *instance_uuid = tt_uuid_str(&meta->instance_uuid);
+	char part_count[32] = "";
+	if (meta->part_count > 1) {
+		snprintf(part_count, sizeof(part_count),
+			 PART_COUNT_KEY ": %u\n", (unsigned)meta->part_count);
+	}
+	char prev_signature[48] = "";
+	if (meta->prev_signature > 0) {
+		snprintf(prev_signature, sizeof(prev_signature),
+			 PREV_SIGNATURE_KEY ": %lld\n",
+			 (long long)meta->prev_signature);
+	}
 	int total = snprintf(buf, size,
 		"%s\n"
 		"%s\n"
 		VERSION_KEY ": %s\n"
 		INSTANCE_UUID_KEY ": %s\n"
-		VCLOCK_KEY ": %s\n\n",
-		meta->filetype, v13, PACKAGE_VERSION, instance_uuid, vstr);
+		VCLOCK_KEY ": %s\n"
+		"%s%s\n",
+		meta->filetype, v13, PACKAGE_VERSION, instance_uuid, vstr,
+		part_count, prev_signature);
 	assert(total > 0);
 	free(vstr);
 	return total;
 }
 
+int
+xlog_meta_set_instance_uuid(char *buf, size_t size,
+			    const struct tt_uuid *instance_uuid)
+{
+	/*
+	 * A log file starts with a filetype line, i.e. "SNAP",
+	 * followed by a format version line, i.e. "0.13".
+	 * Leave anything else intact.
+	 */
+	const char *eol = (const char *) memchr(buf, '\n', size);
+	if (eol == NULL || eol == buf ||
+	    eol - buf >= (ptrdiff_t) sizeof(((struct xlog_meta *)0)->filetype))
+		return 1;
+	const char *version = eol + 1;
+	const size_t version_len = sizeof(v13) - 1;
+	assert(sizeof(v12) - 1 == version_len);
+	if ((size_t) (buf + size - version) <= version_len ||
+	    version[version_len] != '\n' ||
+	    (memcmp(version, v12, version_len) != 0 &&
+	     memcmp(version, v13, version_len) != 0))
+		return 1;
+
+	const char *keys[] = {
+		"\n" INSTANCE_UUID_KEY ": ", "\n" INSTANCE_UUID_KEY_V12 ": ",
+	};
+	/* The meta ends with an empty line. */
+	char *end = (char *) memmem(buf, size, "\n\n", 2);
+	for (size_t i = 0; end != NULL && i < lengthof(keys); i++) {
+		size_t key_len = strlen(keys[i]);
+		char *pos = (char *) memmem(buf, end - buf, keys[i], key_len);
+		if (pos == NULL)
+			continue;
+		pos += key_len;
+		if (end - pos < UUID_STR_LEN)
+			break;
+		memcpy(pos, tt_uuid_str(instance_uuid), UUID_STR_LEN);
+		return 0;
+	}
+	diag_set(XlogError, "failed to parse xlog meta");
+	return -1;
+}
+
 /**
  * Parse xlog meta from buffer, update buffer read
  * position in case of success
@@ -239,6 +287,29 @@ xlog_meta_parse(struct xlog_meta *meta, const char **data,
 					  "offset %zd", off);
 				return -1;
 			}
+		} else if (memcmp(key, PART_COUNT_KEY, key_end - key) == 0) {
+			/*
+			 * Parts: <count>
+			 */
+			char *val_parsed;
+			unsigned long count = strtoul(val, &val_parsed, 10);
+			if (val_parsed != val_end || count > UINT32_MAX) {
+				diag_set(XlogError, "can't parse part count");
+				return -1;
+			}
+			meta->part_count = count;
+		} else if (memcmp(key, PREV_SIGNATURE_KEY, key_end - key) == 0) {
+			/*
+			 * Prev: <signature>
+			 */
+			char *val_parsed;
+			long long signature = strtoll(val, &val_parsed, 10);
+			if (val_parsed != val_end || signature <= 0) {
+				diag_set(XlogError, "can't parse previous "
+					 "signature");
+				return -1;
+			}
+			meta->prev_signature = signature;
 		} else if (memcmp(key, VERSION_KEY, key_end - key) == 0) {
 			/* Ignore Version: for now */
 		} else {
@@ -597,6 +668,21 @@ xdir_format_filename(struct xdir *dir, int64_t signature,
 	return filename;
 }
 
+char *
+xdir_format_part_filename(struct xdir *dir, int64_t signature,
+			  uint32_t part_no, enum log_suffix suffix)
+{
+	if (part_no == 0)
+		return xdir_format_filename(dir, signature, suffix);
+	static __thread char filename[PATH_MAX + 1];
+	const char *suffix_str = (suffix == INPROGRESS ?
+				  inprogress_suffix : "");
+	snprintf(filename, PATH_MAX, "%s/%020lld%s.%u%s",
+		 dir->dirname, (long long) signature,
+		 dir->filename_ext, (unsigned)part_no, suffix_str);
+	return filename;
+}
+
 int
 xdir_collect_garbage(struct xdir *dir, int64_t signature, bool use_coio)
 {
@@ -848,23 +934,35 @@ xdir_touch_xlog(struct xdir *dir, const struct vclock *vclock)
 int
 xdir_create_xlog(struct xdir *dir, struct xlog *xlog,
 		 const struct vclock *vclock)
+{
+	return xdir_create_xlog_part(dir, xlog, vclock, 0, 0, 0);
+}
+
+int
+xdir_create_xlog_part(struct xdir *dir, struct xlog *xlog,
+		      const struct vclock *vclock,
+		      uint32_t part_no, uint32_t part_count,
+		      int64_t prev_signature)
 {
 	char *filename;
 	int64_t signature = vclock_sum(vclock);
 	struct xlog_meta meta;
 	assert(signature >= 0);
 	assert(!tt_uuid_is_nil(dir->instance_uuid));
+	assert(part_no == 0 || part_no < part_count);
 
 	/*
 	* Check whether a file with this name already exists.
 	* We don't overwrite existing files.
 	*/
-	filename = xdir_format_filename(dir, signature, NONE);
+	filename = xdir_format_part_filename(dir, signature, part_no, NONE);
 
 	/* Setup inherited values */
 	snprintf(meta.filetype, sizeof(meta.filetype), "%s", dir->filetype);
 	meta.instance_uuid = *dir->instance_uuid;
 	vclock_copy(&meta.vclock, vclock);
+	meta.part_count = part_no == 0 ? part_count : 0;
+	meta.prev_signature = part_no == 0 ? prev_signature : 0;
 
 	if (xlog_create(xlog, filename, dir->open_wflags, &meta) != 0)
 		return -1;
@@ -173,6 +173,14 @@ char *
 xdir_format_filename(struct xdir *dir, int64_t signature,
 		     enum log_suffix suffix);
 
+/**
+ * Return a file name of a part of a log split into several
+ * files, see xdir_create_xlog_part().
+ */
+char *
+xdir_format_part_filename(struct xdir *dir, int64_t signature,
+			  uint32_t part_no, enum log_suffix suffix);
+
 /**
  * Remove files whose signature is less than specified.
  * If @use_coio is set, files are deleted by coio threads.
@@ -229,8 +237,48 @@ struct xlog_meta {
 	 * is vector clock *at the time the snapshot is taken*.
 	 */
 	struct vclock vclock;
+	/**
+	 * Text file header: number of files the log is split
+	 * into, see xdir_create_xlog_part(). 0 or 1 if the log
+	 * consists of a single file.
+	 */
+	uint32_t part_count;
+	/**
+	 * Text file header: signature of the previous snapshot
+	 * if this one only stores changes made since it was taken.
+	 * 0 for a full snapshot: an incremental snapshot is never
+	 * taken against an empty checkpoint.
+	 */
+	int64_t prev_signature;
 };
 
+enum {
+	/*
+	 * The maximum length of xlog meta
+	 *
+	 * @sa xlog_meta_parse()
+	 */
+	XLOG_META_LEN_MAX = 1024 + VCLOCK_STR_LEN_MAX
+};
+
+/**
+ * Replace the instance uuid in the text meta of a log file.
+ * The meta length doesn't change, so a copy of a file can be
+ * patched on the fly, without rewriting the rest of it.
+ *
+ * @param buf beginning of the file, must contain the whole meta
+ * @param size size of the buffer
+ * @param instance_uuid new instance uuid
+ *
+ * @retval 0 success
+ * @retval 1 the buffer doesn't start with a log header,
+ *           i.e. it isn't a log file, left intact
+ * @retval -1 the log meta is malformed, diag is set
+ */
+int
+xlog_meta_set_instance_uuid(char *buf, size_t size,
+			    const struct tt_uuid *instance_uuid);
+
 /* }}} */
 
 /**
@@ -344,6 +392,29 @@ int
 xdir_create_xlog(struct xdir *dir, struct xlog *xlog,
 		 const struct vclock *vclock);
 
+/**
+ * Create a part of a log split into @part_count files, so that
+ * the parts can be written and read in parallel.
+ *
+ * Part 0 is the main file: it is named and indexed like
+ * a regular log and its meta stores the number of parts.
+ * Part N > 0 is named <signature><ext>.<N>, so it is ignored
+ * by xdir_scan() and garbage collection, and must be looked
+ * up by the main file.
+ *
+ * If @prev_signature is not 0, the log is an incremental
+ * snapshot storing only changes made since the log with
+ * this signature was created.
+ *
+ * @retval 0 if OK
+ * @retval -1 if error
+ */
+int
+xdir_create_xlog_part(struct xdir *dir, struct xlog *xlog,
+		      const struct vclock *vclock,
+		      uint32_t part_no, uint32_t part_count,
+		      int64_t prev_signature);
+
 /**
  * Create new xlog writer based on fd.
  * @param fd            file descriptor
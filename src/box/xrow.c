@@ -949,7 +949,8 @@ xrow_decode_subscribe(struct xrow_header *row, struct tt_uuid *replicaset_uuid,
 }
 
 int
-xrow_encode_join(struct xrow_header *row, const struct tt_uuid *instance_uuid)
+xrow_encode_join(struct xrow_header *row, const struct tt_uuid *instance_uuid,
+		 bool file_join)
 {
 	memset(row, 0, sizeof(*row));
 
@@ -960,10 +961,14 @@ xrow_encode_join(struct xrow_header *row, const struct tt_uuid *instance_uuid)
 		return -1;
 	}
 	char *data = buf;
-	data = mp_encode_map(data, 1);
+	data = mp_encode_map(data, file_join ? 2 : 1);
 	data = mp_encode_uint(data, IPROTO_INSTANCE_UUID);
 	/* Greet the remote replica with our replica UUID */
 	data = xrow_encode_uuid(data, instance_uuid);
+	if (file_join) {
+		data = mp_encode_uint(data, IPROTO_FILE_JOIN);
+		data = mp_encode_bool(data, true);
+	}
 	assert(data <= buf + size);
 
 	row->body[0].iov_base = buf;
@@ -973,14 +978,54 @@ xrow_encode_join(struct xrow_header *row, const struct tt_uuid *instance_uuid)
 	return 0;
 }
 
+/**
+ * Look up IPROTO_FILE_JOIN flag in the body of JOIN command
+ * or a response to it. The body must have been checked.
+ */
+static int
+xrow_decode_file_join(struct xrow_header *row, bool *file_join)
+{
+	*file_join = false;
+	const char *d = (const char *) row->body[0].iov_base;
+	uint32_t map_size = mp_decode_map(&d);
+	for (uint32_t i = 0; i < map_size; i++) {
+		if (mp_typeof(*d) != MP_UINT ||
+		    mp_decode_uint(&d) != IPROTO_FILE_JOIN) {
+			mp_next(&d); /* value */
+			continue;
+		}
+		if (mp_typeof(*d) != MP_BOOL) {
+			diag_set(ClientError, ER_INVALID_MSGPACK,
+				 "invalid FILE_JOIN");
+			return -1;
+		}
+		*file_join = mp_decode_bool(&d);
+	}
+	return 0;
+}
+
 int
-xrow_encode_vclock(struct xrow_header *row, const struct vclock *vclock)
+xrow_decode_join(struct xrow_header *row, struct tt_uuid *instance_uuid,
+		 bool *file_join)
+{
+	if (xrow_decode_subscribe(row, NULL, instance_uuid, NULL, NULL) != 0)
+		return -1;
+	return xrow_decode_file_join(row, file_join);
+}
+
+/**
+ * Encode IPROTO_OK with the given vclock, optionally flagged
+ * with IPROTO_FILE_JOIN.
+ */
+static int
+xrow_encode_vclock_body(struct xrow_header *row, const struct vclock *vclock,
+			bool file_join)
 {
 	memset(row, 0, sizeof(*row));
 
 	/* Add vclock to response body */
 	uint32_t replicaset_size = vclock_size(vclock);
-	size_t size = 8 + replicaset_size *
+	size_t size = 16 + replicaset_size *
 		(mp_sizeof_uint(UINT32_MAX) + mp_sizeof_uint(UINT64_MAX));
 	char *buf = (char *) region_alloc(&fiber()->gc, size);
 	if (buf == NULL) {
@@ -988,7 +1033,7 @@ xrow_encode_vclock(struct xrow_header *row, const struct vclock *vclock)
 		return -1;
 	}
 	char *data = buf;
-	data = mp_encode_map(data, 1);
+	data = mp_encode_map(data, file_join ? 2 : 1);
 	data = mp_encode_uint(data, IPROTO_VCLOCK);
 	data = mp_encode_map(data, replicaset_size);
 	struct vclock_iterator it;
@@ -997,6 +1042,10 @@ xrow_encode_vclock(struct xrow_header *row, const struct vclock *vclock)
 		data = mp_encode_uint(data, replica.id);
 		data = mp_encode_uint(data, replica.lsn);
 	}
+	if (file_join) {
+		data = mp_encode_uint(data, IPROTO_FILE_JOIN);
+		data = mp_encode_bool(data, true);
+	}
 	assert(data <= buf + size);
 	row->body[0].iov_base = buf;
 	row->body[0].iov_len = (data - buf);
@@ -1005,6 +1054,103 @@ xrow_encode_vclock(struct xrow_header *row, const struct vclock *vclock)
 	return 0;
 }
 
+int
+xrow_encode_vclock(struct xrow_header *row, const struct vclock *vclock)
+{
+	return xrow_encode_vclock_body(row, vclock, false);
+}
+
+int
+xrow_encode_join_response(struct xrow_header *row, const struct vclock *vclock,
+			  bool file_join)
+{
+	return xrow_encode_vclock_body(row, vclock, file_join);
+}
+
+int
+xrow_decode_join_response(struct xrow_header *row, struct vclock *vclock,
+			  bool *file_join)
+{
+	if (xrow_decode_subscribe(row, NULL, NULL, vclock, NULL) != 0)
+		return -1;
+	return xrow_decode_file_join(row, file_join);
+}
+
+int
+xrow_encode_join_file(struct xrow_header *row, const char *name,
+		      uint64_t size)
+{
+	memset(row, 0, sizeof(*row));
+	uint32_t name_len = strlen(name);
+	size_t buf_size = mp_sizeof_map(2) +
+		mp_sizeof_uint(IPROTO_FILE_NAME) + mp_sizeof_str(name_len) +
+		mp_sizeof_uint(IPROTO_FILE_SIZE) + mp_sizeof_uint(size);
+	char *buf = (char *) region_alloc(&fiber()->gc, buf_size);
+	if (buf == NULL) {
+		diag_set(OutOfMemory, buf_size, "region_alloc", "buf");
+		return -1;
+	}
+	char *data = buf;
+	data = mp_encode_map(data, 2);
+	data = mp_encode_uint(data, IPROTO_FILE_NAME);
+	data = mp_encode_str(data, name, name_len);
+	data = mp_encode_uint(data, IPROTO_FILE_SIZE);
+	data = mp_encode_uint(data, size);
+	assert(data == buf + buf_size);
+	row->body[0].iov_base = buf;
+	row->body[0].iov_len = buf_size;
+	row->bodycnt = 1;
+	row->type = IPROTO_JOIN_FILE;
+	return 0;
+}
+
+int
+xrow_decode_join_file(struct xrow_header *row, const char **name,
+		      uint32_t *name_len, uint64_t *size)
+{
+	if (row->bodycnt == 0)
+		goto error;
+	assert(row->bodycnt == 1);
+	const char *data = (const char *) row->body[0].iov_base;
+	const char *end = data + row->body[0].iov_len;
+	const char *d = data;
+	if (mp_check(&d, end) != 0 || mp_typeof(*data) != MP_MAP)
+		goto error;
+
+	*name = NULL;
+	*size = 0;
+	d = data;
+	uint32_t map_size = mp_decode_map(&d);
+	for (uint32_t i = 0; i < map_size; i++) {
+		if (mp_typeof(*d) != MP_UINT) {
+			mp_next(&d); /* key */
+			mp_next(&d); /* value */
+			continue;
+		}
+		uint64_t key = mp_decode_uint(&d);
+		switch (key) {
+		case IPROTO_FILE_NAME:
+			if (mp_typeof(*d) != MP_STR)
+				goto error;
+			*name = mp_decode_str(&d, name_len);
+			break;
+		case IPROTO_FILE_SIZE:
+			if (mp_typeof(*d) != MP_UINT)
+				goto error;
+			*size = mp_decode_uint(&d);
+			break;
+		default:
+			mp_next(&d); /* value */
+		}
+	}
+	if (*name == NULL)
+		goto error;
+	return 0;
+error:
+	diag_set(ClientError, ER_INVALID_MSGPACK, "join file");
+	return -1;
+}
+
 void
 xrow_encode_timestamp(struct xrow_header *row, uint32_t replica_id, double tm)
 {
@@ -269,12 +269,84 @@ xrow_decode_subscribe(struct xrow_header *row, struct tt_uuid *replicaset_uuid,
  * Encode JOIN command.
  * @param[out] row Row to encode into.
  * @param instance_uuid.
+ * @param file_join Request checkpoint files instead of rows.
  *
  * @retval  0 Success.
  * @retval -1 Memory error.
  */
 int
-xrow_encode_join(struct xrow_header *row, const struct tt_uuid *instance_uuid);
+xrow_encode_join(struct xrow_header *row, const struct tt_uuid *instance_uuid,
+		 bool file_join);
+
+/**
+ * Decode JOIN command.
+ * @param row Row to decode.
+ * @param[out] instance_uuid.
+ * @param[out] file_join Set if checkpoint files are requested.
+ *
+ * @retval  0 Success.
+ * @retval -1 Memory or format error.
+ */
+int
+xrow_decode_join(struct xrow_header *row, struct tt_uuid *instance_uuid,
+		 bool *file_join);
+
+/**
+ * Encode a response to JOIN command.
+ * @param[out] row Row to encode into.
+ * @param vclock Vclock of the checkpoint sent to the replica.
+ * @param file_join Set if checkpoint files are sent instead
+ * of rows.
+ *
+ * @retval  0 Success.
+ * @retval -1 Memory error.
+ */
+int
+xrow_encode_join_response(struct xrow_header *row, const struct vclock *vclock,
+			  bool file_join);
+
+/**
+ * Decode a response to JOIN command.
+ * @param row Row to decode.
+ * @param[out] vclock.
+ * @param[out] file_join.
+ *
+ * @retval  0 Success.
+ * @retval -1 Memory or format error.
+ */
+int
+xrow_decode_join_response(struct xrow_header *row, struct vclock *vclock,
+			  bool *file_join);
+
+/**
+ * Encode the header of a checkpoint file sent on file-based
+ * join (IPROTO_JOIN_FILE).
+ * @param[out] row Row to encode into.
+ * @param name Name of the file, relative to the engine's
+ * directory and prefixed with the engine name.
+ * @param size Size of the file.
+ *
+ * @retval  0 Success.
+ * @retval -1 Memory error.
+ */
+int
+xrow_encode_join_file(struct xrow_header *row, const char *name,
+		      uint64_t size);
+
+/**
+ * Decode the header of a checkpoint file sent on file-based
+ * join. @a name points to the row body, not zero-terminated.
+ * @param row Row to decode.
+ * @param[out] name.
+ * @param[out] name_len.
+ * @param[out] size.
+ *
+ * @retval  0 Success.
+ * @retval -1 Format error.
+ */
+int
+xrow_decode_join_file(struct xrow_header *row, const char **name,
+		      uint32_t *name_len, uint64_t *size);
 
 /**
  * Encode end of stream command (a response to JOIN command).
@@ -573,21 +645,55 @@ xrow_decode_subscribe_xc(struct xrow_header *row,
 /** @copydoc xrow_encode_join. */
 static inline void
 xrow_encode_join_xc(struct xrow_header *row,
-		    const struct tt_uuid *instance_uuid)
+		    const struct tt_uuid *instance_uuid, bool file_join)
 {
-	if (xrow_encode_join(row, instance_uuid) != 0)
+	if (xrow_encode_join(row, instance_uuid, file_join) != 0)
 		diag_raise();
 }
 
-/**
- * \brief Decode JOIN command
- * \param row
- * \param[out] instance_uuid
-*/
+/** @copydoc xrow_decode_join. */
+static inline void
+xrow_decode_join_xc(struct xrow_header *row, struct tt_uuid *instance_uuid,
+		    bool *file_join)
+{
+	if (xrow_decode_join(row, instance_uuid, file_join) != 0)
+		diag_raise();
+}
+
+/** @copydoc xrow_encode_join_response. */
 static inline void
-xrow_decode_join(struct xrow_header *row, struct tt_uuid *instance_uuid)
+xrow_encode_join_response_xc(struct xrow_header *row,
+			     const struct vclock *vclock, bool file_join)
 {
-	xrow_decode_subscribe_xc(row, NULL, instance_uuid, NULL, NULL);
+	if (xrow_encode_join_response(row, vclock, file_join) != 0)
+		diag_raise();
+}
+
+/** @copydoc xrow_decode_join_response. */
+static inline void
+xrow_decode_join_response_xc(struct xrow_header *row, struct vclock *vclock,
+			     bool *file_join)
+{
+	if (xrow_decode_join_response(row, vclock, file_join) != 0)
+		diag_raise();
+}
+
+/** @copydoc xrow_encode_join_file. */
+static inline void
+xrow_encode_join_file_xc(struct xrow_header *row, const char *name,
+			 uint64_t size)
+{
+	if (xrow_encode_join_file(row, name, size) != 0)
+		diag_raise();
+}
+
+/** @copydoc xrow_decode_join_file. */
+static inline void
+xrow_decode_join_file_xc(struct xrow_header *row, const char **name,
+			 uint32_t *name_len, uint64_t *size)
+{
+	if (xrow_decode_join_file(row, name, name_len, size) != 0)
+		diag_raise();
 }
 
 /** @copydoc xrow_encode_vclock. */
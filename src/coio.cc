@@ -495,6 +495,49 @@ coio_writev_timeout(struct ev_io *coio, struct iovec *iov, int iovcnt,
 	return total;
 }
 
+/**
+ * Send sz bytes of a file starting at the given offset to
+ * the socket, bypassing user space where the platform allows.
+ * @retval the number of bytes sent. Can be less than
+ * requested only in case of timeout.
+ */
+ssize_t
+coio_sendfile_timeout(struct ev_io *coio, int file_fd, off_t offset,
+		      size_t sz, ev_tstamp timeout)
+{
+	size_t tosend = sz;
+	ev_tstamp start, delay;
+	coio_timeout_init(&start, &delay, timeout);
+
+	CoioGuard coio_guard(coio);
+
+	while (true) {
+		ssize_t nwr = sio_sendfile(coio->fd, file_fd, &offset,
+					   tosend);
+		if (nwr == 0) {
+			tnt_raise(SocketError, coio->fd,
+				  "sendfile: unexpected end of file");
+		}
+		if (nwr > 0) {
+			if ((size_t)nwr >= tosend)
+				return sz;
+			tosend -= nwr;
+		}
+		if (! ev_is_active(coio)) {
+			ev_io_set(coio, coio->fd, EV_WRITE);
+			ev_io_start(loop(), coio);
+		}
+		/* Yield control to other fibers. */
+		fiber_testcancel();
+		bool is_timedout = coio_fiber_yield_timeout(coio, delay);
+		fiber_testcancel();
+
+		if (is_timedout)
+			tnt_raise(TimedOut);
+		coio_timeout_update(start, &delay);
+	}
+}
+
 /**
  * Send up to sz bytes to a UDP socket.
  * Return the number of bytes sent.
@@ -143,6 +143,17 @@ ssize_t
 coio_writev_timeout(struct ev_io *coio, struct iovec *iov, int iovcnt,
 		    size_t size, ev_tstamp timeout);
 
+ssize_t
+coio_sendfile_timeout(struct ev_io *coio, int file_fd, off_t offset,
+		      size_t sz, ev_tstamp timeout);
+
+static inline ssize_t
+coio_sendfile(struct ev_io *coio, int file_fd, off_t offset, size_t sz)
+{
+	return coio_sendfile_timeout(coio, file_fd, offset, sz,
+				     TIMEOUT_INFINITY);
+}
+
 static inline ssize_t
 coio_writev(struct ev_io *coio, struct iovec *iov, int iovcnt, size_t size)
 {
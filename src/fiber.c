@@ -36,11 +36,13 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <pmatomic.h>
 
 #include "assoc.h"
 #include "memory.h"
 #include "trigger.h"
+#include "clock.h"
 
 #include "third_party/valgrind/memcheck.h"
 
@@ -86,11 +88,21 @@ pthread_t main_thread_id;
 static size_t page_size;
 static int stack_direction;
 
-enum {
-	/* The minimum allowable fiber stack size in bytes */
-	FIBER_STACK_SIZE_MINIMAL = 16384,
-	/* Default fiber stack size in bytes */
-	FIBER_STACK_SIZE_DEFAULT = 65536
+const char *fiber_prio_STRS[] = {
+	"system", "replication", "interactive", "batch", NULL
+};
+
+/**
+ * Weights of priority classes other than FIBER_PRIO_SYSTEM,
+ * which always goes first. Fibers of a class woken up along
+ * with fibers of other classes get a share of turns to run
+ * proportional to the class weight.
+ */
+static const double fiber_prio_weight[] = {
+	/* [FIBER_PRIO_SYSTEM] = */ 0,
+	/* [FIBER_PRIO_REPLICATION] = */ 8,
+	/* [FIBER_PRIO_INTERACTIVE] = */ 4,
+	/* [FIBER_PRIO_BATCH] = */ 1,
 };
 
 /** Default fiber attributes */
@@ -154,6 +166,24 @@ fiber_recycle(struct fiber *fiber);
 static void
 fiber_destroy(struct cord *cord, struct fiber *f);
 
+/**
+ * Account the time a fiber spent in cord->ready before being
+ * run in the statistics of its priority class.
+ */
+static inline void
+fiber_account_wait(struct cord *cord, struct fiber *fiber)
+{
+	if (fiber->wakeup_time == 0)
+		return;
+	double wait = clock_monotonic() - fiber->wakeup_time;
+	fiber->wakeup_time = 0;
+	struct fiber_prio_stat *stat = &cord->prio_stat[fiber->prio];
+	stat->count++;
+	stat->wait += wait;
+	if (wait > stat->wait_max)
+		stat->wait_max = wait;
+}
+
 /**
  * Transfer control to callee fiber.
  */
@@ -176,6 +206,7 @@ fiber_call_impl(struct fiber *callee)
 	assert(caller);
 	assert(caller != callee);
 
+	fiber_account_wait(cord, callee);
 	cord->fiber = callee;
 
 	callee->flags &= ~FIBER_IS_READY;
@@ -194,6 +225,8 @@ fiber_call(struct fiber *callee)
 	assert(! (callee->caller->flags & FIBER_IS_READY));
 	assert(rlist_empty(&callee->state));
 	assert(! (callee->flags & FIBER_IS_READY));
+	/* Not a wakeup, see fiber_account_wait(). */
+	callee->wakeup_time = 0;
 	callee->flags |= FIBER_IS_READY;
 	callee->caller->flags |= FIBER_IS_READY;
 	fiber_call_impl(callee);
@@ -213,6 +246,17 @@ fiber_checkstack()
 	return false;
 }
 
+/** Check if any fiber of the cord is waiting in cord->ready. */
+static inline bool
+cord_has_ready(struct cord *cord)
+{
+	for (int prio = 0; prio < FIBER_PRIO_MAX; prio++) {
+		if (!rlist_empty(&cord->ready[prio]))
+			return true;
+	}
+	return false;
+}
+
 /**
  * Interrupt a synchronous wait of a fiber inside the event loop.
  * We do so by keeping an "async" event in every fiber, solely
@@ -224,6 +268,12 @@ fiber_checkstack()
  */
 void
 fiber_wakeup(struct fiber *f)
+{
+	fiber_wakeup_prio(f, f->prio);
+}
+
+void
+fiber_wakeup_prio(struct fiber *f, enum fiber_prio prio)
 {
 	assert(! (f->flags & FIBER_IS_DEAD));
 	/**
@@ -250,7 +300,7 @@ fiber_wakeup(struct fiber *f)
 	if (f->flags & (FIBER_IS_READY | FIBER_IS_DEAD))
 		return;
 	struct cord *cord = cord();
-	if (rlist_empty(&cord->ready)) {
+	if (!cord_has_ready(cord)) {
 		/*
 		 * ev_feed_event(EV_CUSTOM) gets scheduled in the
 		 * same event loop iteration, and we rely on this
@@ -269,8 +319,16 @@ fiber_wakeup(struct fiber *f)
 	 * (see tx_schedule_commit()/tx_schedule_rollback() in
 	 * box/wal.cc)
 	 */
-	rlist_move_tail_entry(&cord->ready, f, state);
+	rlist_move_tail_entry(&cord->ready[prio], f, state);
 	f->flags |= FIBER_IS_READY;
+	f->wakeup_time = clock_monotonic();
+}
+
+void
+fiber_set_prio(struct fiber *fiber, enum fiber_prio prio)
+{
+	assert(prio < FIBER_PRIO_MAX);
+	fiber->prio = prio;
 }
 
 /** Cancel the subject fiber.
@@ -416,6 +474,7 @@ fiber_yield(void)
 
 	assert(callee->flags & FIBER_IS_READY || callee == &cord->sched);
 	assert(! (callee->flags & FIBER_IS_DEAD));
+	fiber_account_wait(cord, callee);
 	cord->fiber = callee;
 	callee->csw++;
 	callee->flags &= ~FIBER_IS_READY;
@@ -508,7 +567,7 @@ fiber_schedule_list(struct rlist *list)
 
 	/*
 	 * Happens when a fiber exits and is removed from cord->ready
-	 * resulting in the empty list.
+	 * resulting in the empty lists.
 	 */
 	if (rlist_empty(list))
 		return;
@@ -526,6 +585,16 @@ fiber_schedule_list(struct rlist *list)
 	fiber_call_impl(first);
 }
 
+/**
+ * Run all fibers in cord->ready. Fibers of FIBER_PRIO_SYSTEM
+ * go first, the other classes are merged by weighted fair
+ * queuing: each class has a virtual time, which advances by
+ * 1 / weight per scheduled fiber, and the class with the
+ * earliest virtual time goes next. A class that has been idle
+ * starts at the virtual time of the last scheduled fiber, so
+ * it can't save up turns. Within a class, fibers run in the
+ * order they were woken up.
+ */
 static void
 fiber_schedule_wakeup(ev_loop *loop, ev_async *watcher, int revents)
 {
@@ -533,7 +602,32 @@ fiber_schedule_wakeup(ev_loop *loop, ev_async *watcher, int revents)
 	(void) watcher;
 	(void) revents;
 	struct cord *cord = cord();
-	fiber_schedule_list(&cord->ready);
+	struct rlist list;
+	rlist_create(&list);
+	struct rlist *system = &cord->ready[FIBER_PRIO_SYSTEM];
+	while (!rlist_empty(system))
+		rlist_move_tail(&list, rlist_first(system));
+	for (int prio = FIBER_PRIO_SYSTEM + 1; prio < FIBER_PRIO_MAX; prio++) {
+		if (!rlist_empty(&cord->ready[prio]))
+			cord->prio_vtime[prio] = MAX(cord->prio_vtime[prio],
+						     cord->sched_vtime);
+	}
+	while (true) {
+		int next = -1;
+		for (int prio = FIBER_PRIO_SYSTEM + 1;
+		     prio < FIBER_PRIO_MAX; prio++) {
+			if (!rlist_empty(&cord->ready[prio]) &&
+			    (next < 0 || cord->prio_vtime[prio] <
+					 cord->prio_vtime[next]))
+				next = prio;
+		}
+		if (next < 0)
+			break;
+		rlist_move_tail(&list, rlist_first(&cord->ready[next]));
+		cord->sched_vtime = cord->prio_vtime[next];
+		cord->prio_vtime[next] += 1 / fiber_prio_weight[next];
+	}
+	fiber_schedule_list(&list);
 }
 
 static void
@@ -595,6 +689,8 @@ fiber_reset(struct fiber *fiber)
 	rlist_create(&fiber->on_yield);
 	rlist_create(&fiber->on_stop);
 	fiber->flags = FIBER_DEFAULT_FLAGS;
+	fiber->prio = FIBER_PRIO_INTERACTIVE;
+	fiber->wakeup_time = 0;
 }
 
 /** Destroy an active fiber and prepare it for reuse. */
@@ -614,6 +710,8 @@ fiber_recycle(struct fiber *fiber)
 	fiber->fid = 0;
 	region_free(&fiber->gc);
 	if (!has_custom_stack) {
+		/* Don't keep the memory of a deep call in the cache. */
+		fiber_stack_shrink(fiber);
 		rlist_move_entry(&cord()->dead, fiber, link);
 	} else {
 		fiber_destroy(cord(), fiber);
@@ -697,6 +795,143 @@ page_align_up(void *ptr)
 	return page_align_down(ptr + page_size - 1);
 }
 
+/**
+ * Values put on a fiber stack past the watermark. Overwriting
+ * any of them means the fiber has used the stack beyond the
+ * watermark. The marks are spread over a page, so that a deep
+ * call is unlikely to step over all of them.
+ */
+static const uint64_t stack_watermark_marks[] = {
+	0x6c19f6bcb6e7d4a1ULL, 0x3f0a5d92e45b8c17ULL,
+	0xd48e21a7c90f365bULL, 0x8b5c3e6f17a2d094ULL,
+	0x27f4b8d05e19ca63ULL, 0xe95a0c3d74b6f218ULL,
+	0x5d13e7a98c2f40b6ULL, 0xa0c62f4b39d8e57dULL,
+};
+
+static void
+fiber_stack_put_watermark(struct fiber *fiber)
+{
+	uint64_t *page = fiber->stack_watermark;
+	size_t step = page_size / sizeof(*page) /
+		      lengthof(stack_watermark_marks);
+	for (size_t i = 0; i < lengthof(stack_watermark_marks); i++)
+		page[i * step] = stack_watermark_marks[i];
+}
+
+static bool
+fiber_stack_has_watermark(struct fiber *fiber)
+{
+	const uint64_t *page = fiber->stack_watermark;
+#if ENABLE_ASAN
+	/* Frames that used to be there may be left poisoned. */
+	ASAN_UNPOISON_MEMORY_REGION(page, page_size);
+#endif
+	size_t step = page_size / sizeof(*page) /
+		      lengthof(stack_watermark_marks);
+	for (size_t i = 0; i < lengthof(stack_watermark_marks); i++) {
+		if (page[i * step] != stack_watermark_marks[i])
+			return false;
+	}
+	return true;
+}
+
+/**
+ * Set up the watermark of a new fiber stack. The marks occupy
+ * the first page past FIBER_STACK_SIZE_WATERMARK bytes from
+ * the stack base.
+ */
+static void
+fiber_stack_create_watermark(struct fiber *fiber)
+{
+	fiber->stack_watermark = NULL;
+	void *stack_end = fiber->stack + fiber->stack_size;
+	void *page;
+	if (stack_direction < 0) {
+		page = page_align_down(stack_end -
+				       FIBER_STACK_SIZE_WATERMARK) - page_size;
+		if (page < fiber->stack)
+			return;
+	} else {
+		page = page_align_up(fiber->stack +
+				     FIBER_STACK_SIZE_WATERMARK);
+		if (page + page_size > stack_end)
+			return;
+	}
+	fiber->stack_watermark = page;
+	fiber_stack_put_watermark(fiber);
+}
+
+size_t
+fiber_stack_used(struct fiber *fiber)
+{
+	if (fiber->stack == NULL)
+		return 0;
+	void *begin = page_align_down(fiber->stack);
+	void *end = page_align_up(fiber->stack + fiber->stack_size);
+	size_t page_count = (end - begin) / page_size;
+	/*
+	 * The stack is touched from its base on, so the
+	 * resident page farthest from the base shows how deep
+	 * the stack has grown. The page with the watermark is
+	 * touched on creation, so it only counts if the marks
+	 * were overwritten.
+	 */
+	bool skip_watermark = fiber->stack_watermark != NULL &&
+			      fiber_stack_has_watermark(fiber);
+	unsigned char vec[256];
+	for (size_t done = 0; done < page_count; ) {
+		size_t n = MIN(page_count - done, sizeof(vec));
+		void *chunk = stack_direction < 0 ?
+			      begin + done * page_size :
+			      end - (done + n) * page_size;
+		if (mincore(chunk, n * page_size, (void *)vec) != 0) {
+			say_syserror("mincore");
+			return fiber->stack_size;
+		}
+		for (size_t i = 0; i < n; i++) {
+			size_t idx = stack_direction < 0 ? i : n - 1 - i;
+			void *page = chunk + idx * page_size;
+			if ((vec[idx] & 1) == 0 ||
+			    (skip_watermark && page == fiber->stack_watermark))
+				continue;
+			size_t used = stack_direction < 0 ?
+				      (size_t)(fiber->stack +
+					       fiber->stack_size - page) :
+				      (size_t)(page + page_size - fiber->stack);
+			return MIN(used, fiber->stack_size);
+		}
+		done += n;
+	}
+	return 0;
+}
+
+size_t
+fiber_stack_shrink(struct fiber *fiber)
+{
+	if (fiber->stack_watermark == NULL ||
+	    fiber_stack_has_watermark(fiber))
+		return 0;
+	size_t used = fiber_stack_used(fiber);
+	/* Release the watermark page along with the rest. */
+	void *start, *end;
+	if (stack_direction < 0) {
+		start = fiber->stack;
+		end = fiber->stack_watermark + page_size;
+	} else {
+		start = fiber->stack_watermark;
+		end = fiber->stack + fiber->stack_size;
+	}
+	/* The frames in use must stay intact. */
+	assert(fiber != fiber() ||
+	       (stack_direction < 0 ?
+		__builtin_frame_address(0) >= end :
+		__builtin_frame_address(0) < start));
+	if (madvise(start, end - start, MADV_DONTNEED) != 0)
+		say_syserror("madvise");
+	fiber_stack_put_watermark(fiber);
+	return used;
+}
+
 static int
 fiber_stack_create(struct fiber *fiber, size_t stack_size)
 {
@@ -738,6 +973,7 @@ fiber_stack_create(struct fiber *fiber, size_t stack_size)
 						  fiber->stack_size);
 
 	mprotect(guard, page_size, PROT_NONE);
+	fiber_stack_create_watermark(fiber);
 	return 0;
 }
 
@@ -879,7 +1115,12 @@ cord_create(struct cord *cord, const char *name)
 	mempool_create(&cord->fiber_mempool, &cord->slabc,
 		       sizeof(struct fiber));
 	rlist_create(&cord->alive);
-	rlist_create(&cord->ready);
+	for (int prio = 0; prio < FIBER_PRIO_MAX; prio++) {
+		rlist_create(&cord->ready[prio]);
+		cord->prio_vtime[prio] = 0;
+	}
+	cord->sched_vtime = 0;
+	memset(cord->prio_stat, 0, sizeof(cord->prio_stat));
 	rlist_create(&cord->dead);
 	cord->fiber_registry = mh_i32ptr_new();
 
@@ -92,6 +92,35 @@ enum {
 	FIBER_DEFAULT_FLAGS = FIBER_IS_CANCELLABLE
 };
 
+/**
+ * Priority classes of fibers. Fibers woken up in the same event
+ * loop iteration are run in the order of their classes, see
+ * fiber_schedule_wakeup().
+ */
+enum fiber_prio {
+	/** Work other fibers wait for. Always goes first. */
+	FIBER_PRIO_SYSTEM,
+	/** Replication: appliers, JOIN and SUBSCRIBE requests. */
+	FIBER_PRIO_REPLICATION,
+	/** Client requests and everything else, the default. */
+	FIBER_PRIO_INTERACTIVE,
+	/** Heavy work that may wait for others. */
+	FIBER_PRIO_BATCH,
+	FIBER_PRIO_MAX
+};
+
+extern const char *fiber_prio_STRS[];
+
+/** Scheduling statistics of a fiber priority class. */
+struct fiber_prio_stat {
+	/** Number of times fibers were run after a wakeup. */
+	int64_t count;
+	/** Total time between wakeups and runs, in seconds. */
+	double wait;
+	/** The longest time between a wakeup and a run. */
+	double wait_max;
+};
+
 /**
  * \brief Pre-defined key for fiber local storage
  */
@@ -331,6 +360,18 @@ cord_slab_cache(void);
 
 /** \endcond public */
 
+enum {
+	/* The minimum allowable fiber stack size in bytes */
+	FIBER_STACK_SIZE_MINIMAL = 16384,
+	/* Default fiber stack size in bytes */
+	FIBER_STACK_SIZE_DEFAULT = 65536,
+	/*
+	 * Stack memory a fiber may keep after it finishes its
+	 * work, see fiber_stack_shrink().
+	 */
+	FIBER_STACK_SIZE_WATERMARK = 32768,
+};
+
 /**
  * Fiber attribute container
  */
@@ -355,6 +396,12 @@ struct fiber {
 	void *stack;
 	/** Coro stack size. */
 	size_t stack_size;
+	/**
+	 * Page with marks the fiber overwrites once its stack
+	 * grows past FIBER_STACK_SIZE_WATERMARK, or NULL if the
+	 * stack is too small to have a watermark.
+	 */
+	void *stack_watermark;
 	/** Valgrind stack id. */
 	unsigned int stack_id;
 	/* A garbage-collected memory pool. */
@@ -374,6 +421,13 @@ struct fiber {
 	struct rlist link;
 	/** Link in cord->ready list. */
 	struct rlist state;
+	/** Priority class, see fiber_set_prio(). */
+	enum fiber_prio prio;
+	/**
+	 * Time of the wakeup which put the fiber into
+	 * cord->ready or 0, for scheduling statistics.
+	 */
+	double wakeup_time;
 
 	/** Triggers invoked before this fiber yields. Must not throw. */
 	struct rlist on_yield;
@@ -424,8 +478,16 @@ struct cord {
 	struct mh_i32ptr_t *fiber_registry;
 	/** All fibers */
 	struct rlist alive;
-	/** Fibers, ready for execution */
-	struct rlist ready;
+	/** Fibers, ready for execution, by priority class */
+	struct rlist ready[FIBER_PRIO_MAX];
+	/**
+	 * Virtual time of each priority class and of the last
+	 * scheduled fiber, see fiber_schedule_wakeup().
+	 */
+	double prio_vtime[FIBER_PRIO_MAX];
+	double sched_vtime;
+	/** Scheduling statistics of each priority class. */
+	struct fiber_prio_stat prio_stat[FIBER_PRIO_MAX];
 	/** A cache of dead fibers for reuse */
 	struct rlist dead;
 	/** A watcher to have a single async event for all ready fibers.
@@ -553,6 +615,41 @@ fiber_name(struct fiber *f)
 bool
 fiber_checkstack();
 
+/**
+ * Set the priority class of a fiber. If the fiber is already
+ * waiting in cord->ready, the class applies from its next
+ * wakeup.
+ */
+void
+fiber_set_prio(struct fiber *fiber, enum fiber_prio prio);
+
+/**
+ * Wake up a fiber as if it belonged to the given priority
+ * class. Use it for fibers that must run in the order they
+ * are woken up, whatever classes they belong to.
+ */
+void
+fiber_wakeup_prio(struct fiber *f, enum fiber_prio prio);
+
+/**
+ * Get the amount of stack memory the fiber has touched since
+ * it was created or its stack was last shrunk, as told by the
+ * kernel. The result is rounded up to the page size.
+ */
+size_t
+fiber_stack_used(struct fiber *fiber);
+
+/**
+ * Return the stack memory past FIBER_STACK_SIZE_WATERMARK to
+ * the system if the fiber has used it. The next calls deep
+ * enough will fault the pages in again. Must only be called
+ * when the fiber itself, if running, is above the watermark.
+ * @return Stack usage before the shrink, see fiber_stack_used(),
+ *         or 0 if the stack hasn't grown past the watermark.
+ */
+size_t
+fiber_stack_shrink(struct fiber *fiber);
+
 /**
  * @brief yield & check for timeout
  * @return true if timeout exceeded
@@ -29,6 +29,27 @@
  * SUCH DAMAGE.
  */
 #include "fiber_pool.h"
+
+/**
+ * All fiber pools, for statistics. Pools are only created
+ * in the TX thread.
+ */
+static RLIST_HEAD(fiber_pools);
+
+/**
+ * Release the stack memory a worker has used past the
+ * watermark while handling the last batch of messages.
+ */
+static inline void
+fiber_pool_shrink_stack(struct fiber_pool *pool, struct fiber *f)
+{
+	size_t used = fiber_stack_shrink(f);
+	if (used == 0)
+		return;
+	pool->stack_used_max = MAX(pool->stack_used_max, used);
+	pool->stack_shrink_count++;
+}
+
 /**
  * Main function of the fiber invoked to handle all outstanding
  * tasks in a queue.
@@ -61,13 +82,20 @@ restart:
 			f->caller->flags |= FIBER_IS_READY;
 			assert(f->caller->caller == &cord->sched);
 		}
+		/*
+		 * Messages may change the priority class of
+		 * the fiber, don't let it leak to the next one.
+		 */
+		fiber_set_prio(f, FIBER_PRIO_INTERACTIVE);
 		cmsg_deliver(msg);
 	}
 	/** Put the current fiber into a fiber cache. */
 	if (msg != NULL ||
 	    ev_monotonic_now(loop) - last_active_at < pool->idle_timeout) {
-		if (msg != NULL)
+		if (msg != NULL) {
 			last_active_at = ev_monotonic_now(loop);
+			fiber_pool_shrink_stack(pool, f);
+		}
 		/*
 		 * Add the fiber to the front of the list, so that
 		 * it is most likely to get scheduled again.
@@ -76,6 +104,7 @@ restart:
 		fiber_yield();
 		goto restart;
 	}
+	pool->stack_used_max = MAX(pool->stack_used_max, fiber_stack_used(f));
 	pool->size--;
 	fiber_cond_signal(&pool->worker_cond);
 
@@ -117,7 +146,8 @@ fiber_pool_cb(ev_loop *loop, struct ev_watcher *watcher, int events)
 			f = rlist_shift_entry(&pool->idle, struct fiber, state);
 			fiber_call(f);
 		} else if (pool->size < pool->max_size) {
-			f = fiber_new(cord_name(cord()), fiber_pool_f);
+			f = fiber_new_ex(cord_name(cord()),
+					 &pool->worker_attr, fiber_pool_f);
 			if (f == NULL) {
 				diag_log();
 				break;
@@ -138,7 +168,7 @@ fiber_pool_cb(ev_loop *loop, struct ev_watcher *watcher, int events)
 
 void
 fiber_pool_create(struct fiber_pool *pool, const char *name, int max_pool_size,
-		  float idle_timeout)
+		  float idle_timeout, size_t stack_size)
 {
 	pool->consumer = loop();
 	pool->idle_timeout = idle_timeout;
@@ -151,6 +181,13 @@ fiber_pool_create(struct fiber_pool *pool, const char *name, int max_pool_size,
 	pool->max_size = max_pool_size;
 	stailq_create(&pool->output);
 	fiber_cond_create(&pool->worker_cond);
+	fiber_attr_create(&pool->worker_attr);
+	MAYBE_UNUSED int rc = fiber_attr_setstacksize(&pool->worker_attr,
+						      stack_size);
+	assert(rc == 0); /* checked by the caller */
+	pool->stack_used_max = 0;
+	pool->stack_shrink_count = 0;
+	rlist_add_tail_entry(&fiber_pools, pool, in_pools);
 	/* Join fiber pool to cbus */
 	cbus_endpoint_create(&pool->endpoint, name, fiber_pool_cb, pool);
 }
@@ -177,5 +214,18 @@ fiber_pool_destroy(struct fiber_pool *pool)
 	while (pool->size > 0)
 		fiber_cond_wait(&pool->worker_cond);
 	fiber_cond_destroy(&pool->worker_cond);
+	rlist_del_entry(pool, in_pools);
+}
+
+int
+fiber_pool_stat(fiber_pool_stat_cb cb, void *cb_ctx)
+{
+	struct fiber_pool *pool;
+	rlist_foreach_entry(pool, &fiber_pools, in_pools) {
+		int rc = cb(pool, cb_ctx);
+		if (rc != 0)
+			return rc;
+	}
+	return 0;
 }
 
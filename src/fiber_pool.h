@@ -66,6 +66,17 @@ struct fiber_pool {
 		struct ev_timer idle_timer;
 		/** Condition for worker exit signaling */
 		struct fiber_cond worker_cond;
+		/** Attributes of worker fibers. */
+		struct fiber_attr worker_attr;
+		/**
+		 * The deepest stack a worker was seen to use,
+		 * see fiber_stack_used().
+		 */
+		size_t stack_used_max;
+		/** Number of times worker stacks were shrunk. */
+		int64_t stack_shrink_count;
+		/** Link in the list of all pools. */
+		struct rlist in_pools;
 	};
 	struct {
 		/** The consumer thread loop. */
@@ -78,10 +89,12 @@ struct fiber_pool {
 /**
  * Initialize a fiber pool and connect it to a pipe. Currently
  * must be done before the pipe is actively used by a bus.
+ * @param stack_size Stack size of worker fibers, must be at
+ *        least FIBER_STACK_SIZE_MINIMAL.
  */
 void
 fiber_pool_create(struct fiber_pool *pool, const char *name, int max_pool_size,
-		  float idle_timeout);
+		  float idle_timeout, size_t stack_size);
 
 /**
  * Destroy a fiber pool
@@ -89,6 +102,15 @@ fiber_pool_create(struct fiber_pool *pool, const char *name, int max_pool_size,
 void
 fiber_pool_destroy(struct fiber_pool *pool);
 
+typedef int (*fiber_pool_stat_cb)(struct fiber_pool *pool, void *cb_ctx);
+
+/**
+ * Call @a cb for each fiber pool. Stop and return the value
+ * returned by the callback if it isn't 0.
+ */
+int
+fiber_pool_stat(fiber_pool_stat_cb cb, void *cb_ctx);
+
 #if defined(__cplusplus)
 }
 #endif /* defined(__cplusplus) */
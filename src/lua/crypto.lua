@@ -2,6 +2,9 @@
 
 local ffi = require('ffi')
 local buffer = require('buffer')
+-- Internal C module, see digest.c. One-shot digests of large
+-- strings are calculated there in the coio thread pool.
+local internal = require('digest')
 
 ffi.cdef[[
     int tnt_openssl_init(void);
@@ -324,11 +327,7 @@ for class, digest in pairs(digests) do
             if type(str) ~= 'string' then
                 error("Usage: digest."..class.."(string)")
             end
-            local ctx = digest_new(digest)
-            ctx:update(str)
-            local res = ctx:result()
-            ctx:free()
-            return res
+            return internal.evp(class, str)
         end
     })
 end
@@ -347,11 +346,10 @@ for class, digest in pairs(hmacs) do
             if type(str) ~= 'string' then
                 error("Usage: hmac."..class.."(key, string)")
             end
-            local ctx = hmac_new(digest, key)
-            ctx:update(str)
-            local res = ctx:result()
-            ctx:free()
-            return res
+            if key == nil then
+                return error('Key should be specified for HMAC operations')
+            end
+            return internal.hmac(class, key, str)
         end
     })
     hmac_api[class .. '_hex'] = function (key, str)
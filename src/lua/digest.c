@@ -33,13 +33,39 @@
 #include <lua/digest.h>
 #include <third_party/sha1.h>
 #include <openssl/evp.h>
+#include <openssl/hmac.h>
 #include <coio_task.h>
+#include <fiber.h>
 #include <lua.h>
 #include <lauxlib.h>
 #include "utils.h"
 
 #define PBKDF2_MAX_DIGEST_SIZE 128
 
+enum {
+	/**
+	 * Default size of input starting from which digests
+	 * are calculated in the coio thread pool.
+	 */
+	DIGEST_OFFLOAD_THRESHOLD_DEFAULT = 64 * 1024,
+};
+
+/** See lua_digest_offload_threshold(). */
+static size_t digest_offload_threshold = DIGEST_OFFLOAD_THRESHOLD_DEFAULT;
+
+/**
+ * Check if a digest of @a size bytes should be calculated
+ * in the coio thread pool rather than in the calling fiber.
+ * This makes the fiber yield, which is not allowed inside
+ * a transaction, and coio is only available in the main cord.
+ */
+static bool
+digest_should_offload(size_t size)
+{
+	return size >= digest_offload_threshold && cord_is_main() &&
+	       fiber_get_key(fiber(), FIBER_KEY_TXN) == NULL;
+}
+
 unsigned char *
 SHA1internal(const unsigned char *d, size_t n, unsigned char *md)
 {
@@ -90,11 +116,157 @@ lua_pbkdf2(lua_State *L)
 	return 1;
 }
 
+static ssize_t
+digest_sha1_f(va_list ap)
+{
+	const unsigned char *data = va_arg(ap, unsigned char *);
+	size_t size = va_arg(ap, size_t);
+	unsigned char *digest = va_arg(ap, unsigned char *);
+	SHA1internal(data, size, digest);
+	return 0;
+}
+
+/**
+ * digest.sha1() for large strings: same as SHA1internal(),
+ * but may run in the coio thread pool.
+ */
+static int
+lua_digest_sha1(lua_State *L)
+{
+	size_t size;
+	const char *data = luaL_checklstring(L, 1, &size);
+	unsigned char digest[20];
+	if (digest_should_offload(size)) {
+		if (coio_call(digest_sha1_f, data, size, digest) < 0)
+			return luaL_error(L, "Can't calculate digest");
+	} else {
+		SHA1internal((const unsigned char *) data, size, digest);
+	}
+	lua_pushlstring(L, (char *) digest, sizeof(digest));
+	return 1;
+}
+
+static ssize_t
+digest_evp_f(va_list ap)
+{
+	const char *data = va_arg(ap, char *);
+	size_t size = va_arg(ap, size_t);
+	const EVP_MD *md = va_arg(ap, EVP_MD *);
+	unsigned char *digest = va_arg(ap, unsigned char *);
+	unsigned int *digest_len = va_arg(ap, unsigned int *);
+	if (EVP_Digest(data, size, digest, digest_len, md, NULL) != 1)
+		return -1;
+	return 0;
+}
+
+/**
+ * One-shot OpenSSL digest of a string, calculated in the
+ * coio thread pool if the string is large. Arguments: digest
+ * name as accepted by EVP_get_digestbyname(), the string.
+ */
+static int
+lua_digest_evp(lua_State *L)
+{
+	const char *name = luaL_checkstring(L, 1);
+	size_t size;
+	const char *data = luaL_checklstring(L, 2, &size);
+	const EVP_MD *md = EVP_get_digestbyname(name);
+	if (md == NULL)
+		return luaL_error(L, "Digest method \"%s\" is not supported",
+				  name);
+	unsigned char digest[EVP_MAX_MD_SIZE];
+	unsigned int digest_len;
+	int rc;
+	if (digest_should_offload(size)) {
+		rc = coio_call(digest_evp_f, data, size, md, digest,
+			       &digest_len);
+	} else {
+		rc = EVP_Digest(data, size, digest, &digest_len,
+				md, NULL) == 1 ? 0 : -1;
+	}
+	if (rc != 0)
+		return luaL_error(L, "Can't calculate digest");
+	lua_pushlstring(L, (char *) digest, digest_len);
+	return 1;
+}
+
+static ssize_t
+digest_hmac_f(va_list ap)
+{
+	const char *data = va_arg(ap, char *);
+	size_t size = va_arg(ap, size_t);
+	const EVP_MD *md = va_arg(ap, EVP_MD *);
+	const char *key = va_arg(ap, char *);
+	size_t key_len = va_arg(ap, size_t);
+	unsigned char *digest = va_arg(ap, unsigned char *);
+	unsigned int *digest_len = va_arg(ap, unsigned int *);
+	if (HMAC(md, key, key_len, (const unsigned char *) data, size,
+		 digest, digest_len) == NULL)
+		return -1;
+	return 0;
+}
+
+/**
+ * Same as lua_digest_evp(), but calculates HMAC. Arguments:
+ * digest name, key, the string.
+ */
+static int
+lua_digest_hmac(lua_State *L)
+{
+	const char *name = luaL_checkstring(L, 1);
+	size_t key_len;
+	const char *key = luaL_checklstring(L, 2, &key_len);
+	size_t size;
+	const char *data = luaL_checklstring(L, 3, &size);
+	const EVP_MD *md = EVP_get_digestbyname(name);
+	if (md == NULL)
+		return luaL_error(L, "HMAC method \"%s\" is not supported",
+				  name);
+	unsigned char digest[EVP_MAX_MD_SIZE];
+	unsigned int digest_len;
+	int rc;
+	if (digest_should_offload(size)) {
+		rc = coio_call(digest_hmac_f, data, size, md, key, key_len,
+			       digest, &digest_len);
+	} else {
+		rc = HMAC(md, key, key_len, (const unsigned char *) data,
+			  size, digest, &digest_len) != NULL ? 0 : -1;
+	}
+	if (rc != 0)
+		return luaL_error(L, "Can't calculate HMAC");
+	lua_pushlstring(L, (char *) digest, digest_len);
+	return 1;
+}
+
+/**
+ * Get or set the size of input starting from which digests
+ * are calculated in the coio thread pool so as not to block
+ * the event loop. 0 means always.
+ */
+static int
+lua_digest_offload_threshold(lua_State *L)
+{
+	if (lua_gettop(L) > 0) {
+		lua_Integer threshold = luaL_checkinteger(L, 1);
+		if (threshold < 0)
+			return luaL_error(L, "Usage: "
+					  "digest.offload_threshold(bytes)");
+		digest_offload_threshold = threshold;
+		return 0;
+	}
+	luaL_pushuint64(L, digest_offload_threshold);
+	return 1;
+}
+
 void
 tarantool_lua_digest_init(struct lua_State *L)
 {
 	static const struct luaL_Reg lua_digest_methods [] = {
 		{"pbkdf2", lua_pbkdf2},
+		{"sha1", lua_digest_sha1},
+		{"evp", lua_digest_evp},
+		{"hmac", lua_digest_hmac},
+		{"offload_threshold", lua_digest_offload_threshold},
 		{NULL, NULL}
 	};
 	luaL_register_module(L, "digest", lua_digest_methods);
@@ -209,16 +209,14 @@ local m = {
         if type(str) ~= 'string' then
             error("Usage: digest.sha1(string)")
         end
-        local r = ffi.C.SHA1internal(str, #str, nil)
-        return ffi.string(r, 20)
+        return internal.sha1(str)
     end,
 
     sha1_hex = function(str)
         if type(str) ~= 'string' then
             error("Usage: digest.sha1_hex(string)")
         end
-        local r = ffi.C.SHA1internal(str, #str, nil)
-        return string.hex(ffi.string(r, 20))
+        return string.hex(internal.sha1(str))
     end,
 
     guava = function(state, buckets)
@@ -238,6 +236,8 @@ local m = {
 
     pbkdf2 = pbkdf2,
 
+    offload_threshold = internal.offload_threshold,
+
     pbkdf2_hex = function(pass, salt, iters, digest_len)
         if type(pass) ~= 'string' or type(salt) ~= 'string' then
             error("Usage: digest.pbkdf2_hex(pass, salt)")
@@ -31,6 +31,7 @@
 #include "lua/fiber.h"
 
 #include <fiber.h>
+#include "fiber_pool.h"
 #include "lua/utils.h"
 #include "backtrace.h"
 
@@ -225,6 +226,9 @@ lbox_fiber_statof(struct fiber *f, void *cb_ctx, bool backtrace)
 	lua_pushnumber(L, region_total(&f->gc) + f->stack_size +
 		       sizeof(struct fiber));
 	lua_settable(L, -3);
+	lua_pushstring(L, "stack_used");
+	lua_pushnumber(L, fiber_stack_used(f));
+	lua_settable(L, -3);
 	lua_settable(L, -3);
 
 	if (backtrace) {
@@ -565,9 +569,113 @@ lbox_fiber_wakeup(struct lua_State *L)
 	return 0;
 }
 
+static int
+lbox_fiber_pool_statof(struct fiber_pool *pool, void *cb_ctx)
+{
+	struct lua_State *L = (struct lua_State *) cb_ctx;
+
+	lua_pushstring(L, pool->endpoint.name);
+	lua_newtable(L);
+
+	lua_pushstring(L, "size");
+	lua_pushnumber(L, pool->size);
+	lua_settable(L, -3);
+
+	lua_pushstring(L, "max_size");
+	lua_pushnumber(L, pool->max_size);
+	lua_settable(L, -3);
+
+	lua_pushstring(L, "stack_size");
+	lua_pushnumber(L, fiber_attr_getstacksize(&pool->worker_attr));
+	lua_settable(L, -3);
+
+	lua_pushstring(L, "stack_used_max");
+	lua_pushnumber(L, pool->stack_used_max);
+	lua_settable(L, -3);
+
+	lua_pushstring(L, "stack_shrink_count");
+	luaL_pushint64(L, pool->stack_shrink_count);
+	lua_settable(L, -3);
+
+	lua_settable(L, -3);
+	return 0;
+}
+
+/**
+ * Get or set the priority class of a fiber, the current one
+ * by default. A new class applies from the next wakeup.
+ */
+static int
+lbox_fiber_prio(struct lua_State *L)
+{
+	struct fiber *f = fiber();
+	int prio_index = 1;
+	if (lua_type(L, 1) == LUA_TUSERDATA) {
+		f = lbox_checkfiber(L, 1);
+		prio_index = 2;
+	}
+	if (lua_gettop(L) == prio_index) {
+		const char *str = luaL_checkstring(L, prio_index);
+		uint32_t prio = strindex(fiber_prio_STRS, str,
+					 FIBER_PRIO_MAX);
+		if (prio == FIBER_PRIO_MAX)
+			return luaL_error(L, "Unknown fiber priority '%s'",
+					  str);
+		fiber_set_prio(f, (enum fiber_prio) prio);
+		return 0;
+	}
+	lua_pushstring(L, fiber_prio_STRS[f->prio]);
+	return 1;
+}
+
+/**
+ * Return scheduling statistics of fiber priority classes:
+ * the number of wakeups, total and max time in seconds spent
+ * by woken up fibers waiting for their turn to run.
+ */
+static int
+lbox_fiber_sched_info(struct lua_State *L)
+{
+	struct cord *cord = cord();
+	lua_newtable(L);
+	for (int prio = 0; prio < FIBER_PRIO_MAX; prio++) {
+		struct fiber_prio_stat *stat = &cord->prio_stat[prio];
+		lua_pushstring(L, fiber_prio_STRS[prio]);
+		lua_newtable(L);
+
+		lua_pushstring(L, "count");
+		luaL_pushint64(L, stat->count);
+		lua_settable(L, -3);
+
+		lua_pushstring(L, "wait");
+		lua_pushnumber(L, stat->wait);
+		lua_settable(L, -3);
+
+		lua_pushstring(L, "wait_max");
+		lua_pushnumber(L, stat->wait_max);
+		lua_settable(L, -3);
+
+		lua_settable(L, -3);
+	}
+	return 1;
+}
+
+/**
+ * Return statistics of fiber pools, which run fibers to
+ * handle requests coming from other threads.
+ */
+static int
+lbox_fiber_pool_info(struct lua_State *L)
+{
+	lua_newtable(L);
+	fiber_pool_stat(lbox_fiber_pool_statof, L);
+	return 1;
+}
+
 static const struct luaL_Reg lbox_fiber_meta [] = {
 	{"id", lbox_fiber_id},
 	{"name", lbox_fiber_name},
+	{"prio", lbox_fiber_prio},
 	{"cancel", lbox_fiber_cancel},
 	{"status", lbox_fiber_status},
 	{"testcancel", lbox_fiber_testcancel},
@@ -580,6 +688,8 @@ static const struct luaL_Reg lbox_fiber_meta [] = {
 
 static const struct luaL_Reg fiberlib[] = {
 	{"info", lbox_fiber_info},
+	{"pool_info", lbox_fiber_pool_info},
+	{"sched_info", lbox_fiber_sched_info},
 	{"sleep", lbox_fiber_sleep},
 	{"yield", lbox_fiber_yield},
 	{"self", lbox_fiber_self},
@@ -592,6 +702,7 @@ static const struct luaL_Reg fiberlib[] = {
 	{"create", lbox_fiber_create},
 	{"status", lbox_fiber_status},
 	{"name", lbox_fiber_name},
+	{"prio", lbox_fiber_prio},
 	{NULL, NULL}
 };
 
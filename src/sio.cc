@@ -392,32 +392,28 @@ sio_lseek(int fd, off_t offset, int whence)
 ssize_t
 sio_sendfile(int sock_fd, int file_fd, off_t *offset, size_t size)
 {
-	ssize_t send_res = sendfile(sock_fd, file_fd, offset, size);
-	if (send_res < 0 || (size_t)send_res < size)
+	assert(offset != NULL);
+	ssize_t n = sendfile(sock_fd, file_fd, offset, size);
+	if (n < 0 && errno != EAGAIN &&
+	    errno != EWOULDBLOCK && errno != EINTR)
 		tnt_raise(SocketError, sock_fd, "sendfile");
-	return send_res;
+	return n;
 }
 #else
 ssize_t
 sio_sendfile(int sock_fd, int file_fd, off_t *offset, size_t size)
 {
-	if (offset)
-		sio_lseek(file_fd, *offset, SEEK_SET);
-
-	const size_t buffer_size = 8192;
-	char buffer[buffer_size];
-	size_t bytes_sent = 0;
-	while (bytes_sent < size) {
-		size_t to_send_now = MIN(size - bytes_sent, buffer_size);
-		ssize_t n = sio_read(file_fd, buffer, to_send_now);
-		sio_writen(sock_fd, buffer, n);
-		bytes_sent += n;
-	}
-
-	if (offset)
-		lseek(file_fd, *offset, SEEK_SET);
-
-	return bytes_sent;
+	assert(offset != NULL);
+	char buffer[8192];
+	ssize_t n = pread(file_fd, buffer, MIN(size, sizeof(buffer)), *offset);
+	if (n < 0)
+		tnt_raise(SystemError, "pread");
+	if (n == 0)
+		return 0;
+	ssize_t nwr = sio_write(sock_fd, buffer, n);
+	if (nwr > 0)
+		*offset += nwr;
+	return nwr;
 }
 #endif
 
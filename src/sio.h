@@ -177,7 +177,10 @@ ssize_t
 sio_writev_all(int fd, struct iovec *iov, int iovcnt);
 
 /**
- * A wrapper over sendfile.
+ * A wrapper over sendfile: send up to @a size bytes of a file
+ * starting at @a offset, which is advanced past the data sent.
+ * Like sio_write(), returns -1 if the socket is not ready and
+ * may send less than requested, 0 means end of file.
  * Throw if send file failed.
  */
 ssize_t
@@ -173,5 +173,26 @@ err:match("Usage")
 s, err = pcall(digest.pbkdf2_hex, "password", "salt", "lol", "lol")
 s
 err:match("number")
+
+--
+-- Digests of large strings are calculated in the coio thread pool.
+--
+crypto = require('crypto')
+fiber = require('fiber')
+digest.offload_threshold()
+big = string.rep('a', 100000)
+csw = fiber.info()[fiber.id()].csw
+digest.sha1_hex(big)
+digest.sha256_hex(big)
+string.hex(crypto.hmac.sha256('key', big))
+fiber.info()[fiber.id()].csw > csw
+ctx = crypto.digest.sha256.new()
+ctx:update(big)
+ctx:result() == digest.sha256(big)
+box.begin() digest.sha1_hex(big) box.commit()
+digest.offload_threshold(0)
+digest.sha1_hex('tarantool')
+digest.offload_threshold(-1)
+digest.offload_threshold(64 * 1024)
 digest = nil
 test_run:cmd("clear filter")
@@ -423,4 +423,23 @@ fiber.name(f)
 fiber.name(f, long_name, {truncate = true})
 fiber.name(f)
 
+--
+-- Fiber priority classes.
+--
+fiber.prio()
+f = fiber.self()
+fiber.prio(f, 'batch')
+f:prio()
+fiber.prio('unknown')
+fiber.prio('interactive')
+order = {}
+cond = fiber.cond()
+function waiter(prio) fiber.prio(prio) cond:wait() table.insert(order, prio) end
+count = fiber.sched_info().batch.count
+for _, prio in ipairs({'batch', 'interactive', 'replication', 'system'}) do fiber.create(waiter, prio) end
+cond:broadcast()
+while #order < 4 do fiber.sleep(0.001) end
+order[1]
+fiber.sched_info().batch.count > count
+
 test_run:cmd("clear filter")
@@ -0,0 +1,82 @@
+test_run = require('test_run').new()
+
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+
+-- Restrictions.
+s:create_index('c', {type = 'column', parts = {2, 'string'}})
+s:create_index('c', {type = 'column', parts = {2, 'unsigned'}, unique = true})
+s.index.pk:aggregate()
+
+c = s:create_index('c', {type = 'column', parts = {2, 'unsigned', 3, 'integer'}})
+c.type
+a = c:aggregate()
+a.count, a.sum, a.min, a.max
+
+for i = 1, 3000 do s:insert{i, math.floor(i / 100), i % 7 - 3} end
+a = c:aggregate(1)
+a.count, a.sum, a.min, a.max
+a = c:aggregate(2)
+a.count, a.sum, a.min, a.max
+c:aggregate(3)
+c:len(), c:count()
+info = c:info()
+info.blocks, info.vectors.plain, info.vectors.rle, info.vectors.dict
+c:select({}, {limit = 3})
+c:select({1, 1}, {iterator = 'EQ'})
+
+-- Compare with a full scan of the primary key.
+test_run:cmd("setopt delimiter ';'")
+function check(part)
+    local count, sum, min, max = 0, 0, nil, nil
+    for _, t in s:pairs() do
+        local v = t[part + 1]
+        count = count + 1
+        sum = sum + v
+        if min == nil or v < min then min = v end
+        if max == nil or v > max then max = v end
+    end
+    local a = c:aggregate(part)
+    return a.count == count and a.sum == sum and
+           a.min == min and a.max == max and
+           c:count() == count and #c:select() == count
+end;
+test_run:cmd("setopt delimiter ''");
+
+for i = 1, 3000, 2 do s:delete{i} end
+check(1), check(2)
+c:select({}, {limit = 3})
+-- Sparse blocks are compacted.
+for i = 1, 2048 do if i % 10 ~= 0 then s:delete{i} end end
+check(1), check(2)
+for i = 1, 3000 do s:replace{i, i, -i} end
+check(1), check(2)
+s:truncate()
+check(1), check(2)
+
+-- Recovery from a snapshot and WAL.
+for i = 1, 2000 do s:insert{i, i % 11, i % 5} end
+box.snapshot()
+for i = 1, 1000 do s:delete{i * 2} end
+for i = 2001, 2500 do s:insert{i, i % 13, -i} end
+test_run:cmd('restart server default')
+s = box.space.test
+c = s.index.c
+test_run:cmd("setopt delimiter ';'")
+function check(part)
+    local count, sum, min, max = 0, 0, nil, nil
+    for _, t in s:pairs() do
+        local v = t[part + 1]
+        count = count + 1
+        sum = sum + v
+        if min == nil or v < min then min = v end
+        if max == nil or v > max then max = v end
+    end
+    local a = c:aggregate(part)
+    return a.count == count and a.sum == sum and
+           a.min == min and a.max == max and
+           c:count() == count and #c:select() == count
+end;
+test_run:cmd("setopt delimiter ''");
+check(1), check(2)
+s:drop()
@@ -0,0 +1,89 @@
+test_run = require('test_run').new()
+
+-- Invalid options.
+box.schema.space.create('test', {compression = 'lz4'})
+box.schema.space.create('test', {engine = 'vinyl', compression = 'zstd'})
+
+--
+-- Non-indexed fields of tuples of a compressed space are
+-- stored compressed and decompressed on access.
+--
+s = box.schema.space.create('test', {compression = 'zstd'})
+_ = s:create_index('pk')
+_ = s:create_index('sk', {parts = {2, 'string'}})
+plain = box.schema.space.create('plain')
+_ = plain:create_index('pk')
+
+test_run:cmd("setopt delimiter ';'")
+function text(i)
+    return string.rep('abcdefgh', 16) .. i
+end;
+function check()
+    for i = 1, 1000 do
+        local a, b = s:get(i), plain:get(i)
+        if a == nil or #a ~= #b or a[2] ~= b[2] or
+           a[3] ~= b[3] or a[4] ~= b[4] then
+            return i
+        end
+    end
+    return s:count() == plain:count()
+end;
+test_run:cmd("setopt delimiter ''");
+
+for i = 1, 1000 do s:insert{i, 'k' .. i, text(i), i * 10} end
+for i = 1, 1000 do plain:insert{i, 'k' .. i, text(i), i * 10} end
+s:bsize() < plain:bsize() / 2
+check()
+s.index.sk:get('k10')[3] == text(10)
+#s:select({}, {limit = 10})
+{s:get(5):unpack(4)}
+s:get(5):totable()[3] == text(5)
+
+-- Update and upsert of non-indexed fields.
+s:update(1, {{'+', 4, 1}})[4]
+plain:update(1, {{'+', 4, 1}})[4]
+s:upsert({2, 'k2', 'x', 0}, {{'=', 3, text(0)}})
+plain:upsert({2, 'k2', 'x', 0}, {{'=', 3, text(0)}})
+s:get(2)[3] == text(0)
+check()
+
+-- Compressed fields can't be indexed unless the space is empty.
+s:create_index('sk2', {parts = {4, 'unsigned'}})
+sk2 = s:create_index('sk2', {parts = {2, 'string', 1, 'unsigned'}})
+sk2:get{'k3', 3}[4]
+sk2:drop()
+
+-- Compressed tuples are written to snapshots decompressed.
+box.snapshot()
+test_run:cmd('restart server default')
+s = box.space.test
+plain = box.space.plain
+test_run:cmd("setopt delimiter ';'")
+function text(i)
+    return string.rep('abcdefgh', 16) .. i
+end;
+function check()
+    for i = 1, 1000 do
+        local a, b = s:get(i), plain:get(i)
+        if a == nil or #a ~= #b or a[2] ~= b[2] or
+           a[3] ~= b[3] or a[4] ~= b[4] then
+            return i
+        end
+    end
+    return s:count() == plain:count()
+end;
+test_run:cmd("setopt delimiter ''");
+check()
+s:bsize() < plain:bsize() / 2
+
+-- Compression can be switched off, old tuples stay compressed.
+_ = box.space._space:update(s.id, {{'=', 6, {compression = 'none'}}})
+_ = s:replace{3, 'k3', text(3), 3}
+_ = plain:replace{3, 'k3', text(3), 3}
+check()
+s:create_index('sk2', {parts = {4, 'unsigned'}})
+s:truncate()
+_ = s:create_index('sk2', {parts = {4, 'unsigned'}})
+
+s:drop()
+plain:drop()
@@ -0,0 +1,67 @@
+test_run = require('test_run').new()
+fiber = require('fiber')
+
+-- Invalid values.
+box.cfg{memtx_defrag_threshold = -0.1}
+box.cfg{memtx_defrag_threshold = 1.5}
+box.cfg.memtx_defrag_threshold
+
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+_ = s:create_index('sk', {parts = {2, 'string'}})
+
+-- Size class the tuples of the space are allocated from.
+test_run:cmd("setopt delimiter ';'")
+function class()
+    local c = nil
+    for _, v in ipairs(box.slab.stats()) do
+        if c == nil or v.item_count > c.item_count then c = v end
+    end
+    return c
+end;
+function wait_slab_count(n)
+    for i = 1, 1000 do
+        if class().slab_count < n then return true end
+        fiber.sleep(0.01)
+    end
+    return false
+end;
+function check()
+    for i = 2, 20000, 2 do
+        local t = s:get(i)
+        if t == nil or t[2] ~= string.rep('x', 190) .. i then return i end
+        if s.index.sk:get(t[2]) ~= t then return i end
+    end
+    return s:count() == 10000 and s.index.sk:count() == 10000
+end;
+test_run:cmd("setopt delimiter ''");
+
+for i = 1, 20000 do s:insert{i, string.rep('x', 190) .. i} end
+-- Make the class sparse.
+for i = 1, 20000, 2 do s:delete{i} end
+c = class()
+c.item_count
+slab_count = c.slab_count
+slab_count > 1
+c.mem_used < (c.mem_used + c.mem_free) * 0.75
+
+-- Memory is not defragmented unless enabled.
+fiber.sleep(0.1)
+class().slab_count == slab_count
+
+-- Tuples referenced from Lua stay in place.
+t = s:get(2)
+box.cfg{memtx_defrag_threshold = 0.75}
+wait_slab_count(slab_count)
+t == s:get(2)
+t = nil
+check()
+box.cfg{memtx_defrag_threshold = 0}
+
+-- Relocated tuples survive restart.
+box.snapshot()
+test_run:cmd('restart server default')
+s = box.space.test
+s:count()
+s:get(20000)[2] == string.rep('x', 190) .. 20000
+s:drop()
@@ -99,6 +99,19 @@ box.runtime.info().maxalloc > 0;
 --
 type(require('yaml').encode(box.slab.info()));
 
+-- Huge page coverage of memtx memory, /proc/self/smaps is Linux only
+function check_huge_pages()
+    if jit.os ~= 'Linux' then
+        return true
+    end
+    local pages = box.slab.huge_pages()
+    return pages.pages == 'none' and pages.numa_node == -1 and
+           pages.resident > 0 and pages.huge <= pages.resident and
+           pages.page_size > 0
+end;
+check_huge_pages();
+check_huge_pages = nil;
+
 ----------------
 -- # box.error
 ----------------
@@ -0,0 +1,10 @@
+#!/usr/bin/env tarantool
+os = require('os')
+
+box.cfg{
+    listen              = os.getenv("LISTEN"),
+    memtx_memory        = 50 * 1024 * 1024,
+    memtx_use_mvcc_engine = true,
+}
+
+require('console').listen(os.getenv('ADMIN'))
@@ -0,0 +1,129 @@
+test_run = require('test_run').new()
+test_run:cmd("create server mvcc with script='box/mvcc.lua'")
+test_run:cmd("start server mvcc")
+test_run:cmd("switch mvcc")
+
+box.cfg.memtx_use_mvcc_engine
+fiber = require('fiber')
+
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+_ = s:create_index('sk', {parts = {2, 'unsigned'}})
+
+-- Run a transaction in a separate fiber, statement by statement.
+test_run:cmd("setopt delimiter ';'")
+function tx_new()
+    local t = {req = fiber.channel(1), res = fiber.channel(1)}
+    fiber.create(function()
+        box.begin()
+        while true do
+            local f = t.req:get()
+            local ok, r = pcall(f)
+            if not ok then r = tostring(r) end
+            t.res:put({ok, r})
+            if f == box.commit or f == box.rollback then break end
+        end
+    end)
+    return t
+end;
+function tx_do(t, f) t.req:put(f) return unpack(t.res:get()) end;
+test_run:cmd("setopt delimiter ''");
+
+-- A transaction may yield between statements.
+box.begin() s:insert{1, 10} fiber.sleep(0) s:insert{2, 20} box.commit()
+s:select()
+
+-- Changes are invisible to others until committed.
+t = tx_new()
+tx_do(t, function() return s:replace{3, 30} end)
+s:get{3}
+tx_do(t, function() return s:get{3} end)
+tx_do(t, box.commit)
+s:get{3}
+
+-- A reader is sent to a read view when a tuple it read is
+-- overwritten, and can't commit writes after that.
+t = tx_new()
+tx_do(t, function() return s:get{1} end)
+s:replace{1, 11}
+tx_do(t, function() return s:get{1} end)
+tx_do(t, function() return s:replace{4, 40} end)
+tx_do(t, box.rollback)
+s:get{1}
+
+-- Of two transactions updating the same tuple, the one that
+-- commits first wins.
+t1 = tx_new()
+t2 = tx_new()
+tx_do(t1, function() return s:update({2}, {{'=', 2, 21}}) end)
+tx_do(t2, function() return s:update({2}, {{'=', 2, 22}}) end)
+tx_do(t1, box.commit)
+tx_do(t2, box.commit)
+s:get{2}
+
+-- A duplicate in a unique secondary index is detected on commit.
+t1 = tx_new()
+t2 = tx_new()
+tx_do(t1, function() return s:insert{5, 50} end)
+tx_do(t2, function() return s:insert{6, 50} end)
+tx_do(t1, box.commit)
+tx_do(t2, box.commit)
+s:select()
+s.index.sk:select()
+
+-- Rolled back changes leave no trace.
+box.begin() s:delete{1} s:replace{3, 33} s:insert{7, 70} fiber.sleep(0) box.rollback()
+s:select()
+s.index.sk:select()
+
+-- A column index aggregates only tuples visible to the reader
+-- while other transactions are open.
+c = s:create_index('c', {type = 'column', parts = {2, 'unsigned'}})
+t = tx_new()
+tx_do(t, function() return s:replace{8, 80} end)
+tx_do(t, function() return s:delete{2} end)
+a = c:aggregate()
+a.count, a.sum, a.min, a.max
+tx_do(t, function() local a = c:aggregate() return {a.count, a.sum, a.min, a.max} end)
+tx_do(t, box.commit)
+a = c:aggregate()
+a.count, a.sum, a.min, a.max
+
+-- DDL aborts transactions that wrote to or read from the space
+-- and drops their uncommitted changes before rebuilding indexes.
+d = box.schema.space.create('ddl')
+_ = d:create_index('pk')
+_ = d:insert{1, 10}
+t1 = tx_new()
+t2 = tx_new()
+tx_do(t1, function() return d:replace{2, 20} end)
+tx_do(t2, function() return d:get{1} end)
+_ = d:create_index('sk', {parts = {2, 'unsigned'}})
+tx_do(t1, box.commit)
+tx_do(t2, box.commit)
+d:select()
+d.index.sk:select()
+d:drop()
+
+-- A snapshot contains only committed data even if it is made
+-- while some transactions are open.
+sn = box.schema.space.create('snap')
+_ = sn:create_index('pk')
+_ = sn:insert{1, 10}
+_ = sn:insert{2, 20}
+t = tx_new()
+tx_do(t, function() return sn:replace{1, 11} end)
+tx_do(t, function() return sn:delete{2} end)
+tx_do(t, function() return sn:insert{3, 30} end)
+_ = sn:insert{4, 40}
+box.snapshot()
+tx_do(t, box.rollback)
+test_run:cmd("switch default")
+test_run:cmd("restart server mvcc")
+test_run:cmd("switch mvcc")
+box.space.snap:select()
+box.space.snap:drop()
+box.space.test:drop()
+test_run:cmd("switch default")
+test_run:cmd("stop server mvcc")
+test_run:cmd("cleanup server mvcc")
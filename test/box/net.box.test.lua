@@ -846,3 +846,64 @@ x
 c:close()
 
 box.schema.user.revoke('guest', 'execute', 'universe')
+
+--
+-- Asynchronous requests.
+--
+box.schema.user.grant('guest', 'read,write,execute', 'universe')
+space = box.schema.space.create('test')
+_ = space:create_index('pk')
+c = net.connect(box.cfg.listen)
+cspace = c.space.test
+future = cspace:insert({1, 2, 3}, {is_async = true})
+future:wait_result()
+future:is_ready()
+-- Duplicate key error is returned, not raised.
+future = cspace:insert({1}, {is_async = true})
+future:wait_result()
+-- All requests are encoded before yield and sent in one batch.
+futures = {}
+for i = 2, 10 do futures[i] = cspace:replace({i}, {is_async = true}) end
+ok = true
+for i = 2, 10 do ok = ok and futures[i]:wait_result()[1] == i end
+ok
+#cspace:select()
+function async_call(...) return ... end
+future = c:call('async_call', {1, 2}, {is_async = true})
+future:wait_result()
+future = c:eval('return 3, 4', {}, {is_async = true})
+future:wait_result()
+future = cspace.index.pk:get(1, {is_async = true})
+future:wait_result()
+future = cspace.index.pk:count(nil, {is_async = true})
+future:wait_result()
+-- Timeout and discard.
+future = c:eval('require("fiber").sleep(0.5)', {}, {is_async = true})
+future:is_ready()
+future:wait_result(0.01)
+future:discard()
+future:is_ready()
+future:result()
+c:close()
+space:drop()
+box.schema.user.revoke('guest', 'read,write,execute', 'universe')
+
+--
+-- SELECT and DML responses are decoded to tuples in C.
+--
+ffi = require('ffi')
+decode_select = require('net.box.lib').decode_select
+body = msgpack.encode({[0x30] = {{1, 'a'}, {2, {3}}}})
+p = ffi.cast('const char *', body)
+tuples, body_end = decode_select(p)
+#tuples
+box.tuple.is(tuples[1]), box.tuple.is(tuples[2])
+tuples[1], tuples[2]
+tonumber(body_end - p) == #body
+-- A body without IPROTO_DATA is decoded to an empty table.
+body = msgpack.encode({[0x31] = 'x'})
+p = ffi.cast('const char *', body)
+tuples, body_end = decode_select(p)
+#tuples
+tonumber(body_end - p) == #body
+body, p, tuples, body_end = nil
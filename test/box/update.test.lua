@@ -268,4 +268,16 @@ s:replace({1, 2, 3})
 t:update({{'=', 3, map}})
 s:update(1, {{'=', 3, map}})
 
+--
+-- Updates which don't change field sizes patch a copy of
+-- the old tuple, others rebuild it.
+--
+t = box.tuple.new({1, 'abc', 100, 5})
+t:update({{'+', 3, 1}, {'=', 2, 'xyz'}, {'|', -1, 2}})
+t:update({{'+', 3, 28}})
+t:update({{'=', 2, 'abcd'}})
+t:update({{'+', 3, 1}, {'-', 3, 1}})
+t:update({{'+', 2, 1}})
+t
+
 s:drop()
@@ -0,0 +1,48 @@
+test_run = require('test_run').new()
+engine = test_run:get_cfg('engine')
+
+--
+-- A replica can be bootstrapped from checkpoint files of the
+-- master rather than from rows.
+--
+box.schema.user.grant('guest', 'replication')
+s = box.schema.space.create('test', {engine = engine})
+_ = s:create_index('pk')
+_ = s:create_index('sk', {parts = {2, 'unsigned'}})
+for i = 1, 100 do s:insert{i, 1000 - i} end
+-- Vinyl blob files have no log meta and are sent intact.
+b = box.schema.space.create('blob', {engine = 'vinyl'})
+_ = b:create_index('pk', {blob_threshold = 100})
+for i = 1, 10 do b:insert{i, string.rep(tostring(i), 200)} end
+box.snapshot()
+-- Rows written after the checkpoint are sent on final join.
+for i = 101, 110 do s:insert{i, 1000 - i} end
+
+test_run:cmd("create server replica with rpl_master=default, script='replication/replica_file_join.lua'")
+test_run:cmd("start server replica")
+test_run:cmd("switch replica")
+box.info.status
+box.cfg.replication_file_join
+box.space.test:count()
+box.space.test.index.sk:min()
+box.space.test:get{1}
+box.space.blob:count()
+box.space.blob:get{7}[2] == string.rep('7', 200)
+test_run:cmd("switch default")
+
+-- The replica keeps its own uuid.
+test_run:eval('replica', 'return box.info.uuid')[1] ~= box.info.uuid
+
+-- The replica recovers from its own checkpoint after restart.
+test_run:cmd("restart server replica")
+s:insert{111, 0}
+test_run:cmd("switch replica")
+while box.space.test:get{111} == nil do require('fiber').sleep(0.01) end
+box.space.test:count()
+test_run:cmd("switch default")
+
+test_run:cmd("stop server replica")
+test_run:cmd("cleanup server replica")
+s:drop()
+b:drop()
+box.schema.user.revoke('guest', 'replication')
@@ -0,0 +1,42 @@
+test_run = require('test_run').new()
+
+--
+-- A replica joins from a chain of incremental snapshots even
+-- if the schema changed after the checkpoint.
+--
+box.schema.user.grant('guest', 'replication')
+box.cfg{memtx_snap_deltas = 2}
+
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+for i = 1, 10 do s:insert{i, i * 10} end
+d = box.schema.space.create('dropped')
+_ = d:create_index('pk')
+for i = 1, 10 do d:insert{i} end
+box.snapshot()
+
+s:delete{1}
+s:replace{5, 55}
+d:replace{5, 5}
+box.snapshot()
+
+-- Drop a space and change the primary key of another one.
+d:drop()
+s.index.pk:alter{parts = {2, 'unsigned'}}
+
+test_run:cmd("create server replica with rpl_master=default, script='replication/replica.lua'")
+test_run:cmd("start server replica")
+test_run:cmd("switch replica")
+box.space.dropped
+s = box.space.test
+s:count()
+s.index.pk.parts[1].fieldno
+s:get{55}
+s:select({}, {limit = 2})
+test_run:cmd("switch default")
+
+test_run:cmd("stop server replica")
+test_run:cmd("cleanup server replica")
+s:drop()
+box.cfg{memtx_snap_deltas = 0}
+box.schema.user.revoke('guest', 'replication')
@@ -3,6 +3,8 @@
 #include "unit.h"
 #include "trivia/util.h"
 
+#include <unistd.h>
+
 static int
 noop_f(va_list ap)
 {
@@ -68,6 +70,43 @@ test_stack_f(va_list ap)
 	return 0;
 }
 
+static int
+stack_shrink_f(va_list ap)
+{
+	struct fiber *f = fiber();
+	/* A shallow call leaves the stack intact. */
+	fail_unless(fiber_stack_shrink(f) == 0);
+	char s;
+	stack_expand(&s);
+	size_t used = fiber_stack_shrink(f);
+	fail_unless(used > FIBER_STACK_SIZE_WATERMARK);
+	fail_unless(fiber_stack_used(f) <= FIBER_STACK_SIZE_WATERMARK +
+					   (size_t)getpagesize());
+	/* The watermark is restored. */
+	fail_unless(fiber_stack_shrink(f) == 0);
+	return 0;
+}
+
+static void
+fiber_stack_test()
+{
+	header();
+
+	struct fiber_attr *fiber_attr = fiber_attr_new();
+	fiber_attr_setstacksize(fiber_attr, fiber_stack_size_default * 2);
+	struct fiber *fiber = fiber_new_ex("stack_shrink", fiber_attr,
+					   stack_shrink_f);
+	fiber_attr_delete(fiber_attr);
+	if (fiber == NULL)
+		diag_raise();
+	fiber_set_joinable(fiber, true);
+	fiber_wakeup(fiber);
+	fiber_join(fiber);
+	note("stack past the watermark is released");
+
+	footer();
+}
+
 static void
 fiber_join_test()
 {
@@ -166,6 +205,7 @@ main_f(va_list ap)
 {
 	fiber_name_test();
 	fiber_join_test();
+	fiber_stack_test();
 	ev_break(loop(), EVBREAK_ALL);
 	return 0;
 }
@@ -0,0 +1,258 @@
+#include "memory.h"
+#include "fiber.h"
+#include "say.h"
+#include "unit.h"
+#include "msgpuck.h"
+#include "trivia/util.h"
+#include "tuple.h"
+#include "tuple_compare.h"
+#include "key_def.h"
+
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+
+/**
+ * Check comparators specialized by key part types against
+ * a reference comparison of the values the tuples were made
+ * of. Run with --bench to compare their speed with the generic
+ * comparison loop.
+ */
+
+enum {
+	FIELD_COUNT = 4,
+	TUPLE_COUNT = 64,
+	VALUE_MAX = 10,
+	BENCH_ITERATIONS = 10000000,
+};
+
+/** Types of the tuple fields. */
+static const enum field_type field_types[FIELD_COUNT] = {
+	FIELD_TYPE_UNSIGNED,
+	FIELD_TYPE_STRING,
+	FIELD_TYPE_INTEGER,
+	FIELD_TYPE_UNSIGNED,
+};
+
+/** Key layouts to test, not covered by precompiled comparators. */
+struct key_template {
+	uint32_t part_count;
+	uint32_t fieldno[3];
+};
+
+static const struct key_template keys[] = {
+	{ 1, { 2 } },
+	{ 2, { 3, 1 } },
+	{ 2, { 1, 2 } },
+	{ 3, { 3, 2, 0 } },
+	{ 3, { 2, 1, 3 } },
+};
+
+static int values[TUPLE_COUNT][FIELD_COUNT];
+static struct tuple *tuples[TUPLE_COUNT];
+
+static char *
+encode_field(char *pos, uint32_t fieldno, int value)
+{
+	char str[16];
+	switch (field_types[fieldno]) {
+	case FIELD_TYPE_UNSIGNED:
+		return mp_encode_uint(pos, value);
+	case FIELD_TYPE_INTEGER:
+		/* Make some values negative. */
+		value -= VALUE_MAX / 2;
+		return value < 0 ? mp_encode_int(pos, value) :
+				   mp_encode_uint(pos, value);
+	case FIELD_TYPE_STRING:
+		snprintf(str, sizeof(str), "s%02d", value);
+		return mp_encode_str(pos, str, strlen(str));
+	default:
+		unreachable();
+		return pos;
+	}
+}
+
+static void
+create_tuples(void)
+{
+	char buf[128];
+	srand(0);
+	for (int i = 0; i < TUPLE_COUNT; i++) {
+		char *pos = mp_encode_array(buf, FIELD_COUNT);
+		for (uint32_t j = 0; j < FIELD_COUNT; j++) {
+			values[i][j] = rand() % VALUE_MAX;
+			pos = encode_field(pos, j, values[i][j]);
+		}
+		tuples[i] = box_tuple_new(box_tuple_format_default(),
+					  buf, pos);
+		fail_if(tuples[i] == NULL);
+		tuple_ref(tuples[i]);
+	}
+}
+
+static void
+destroy_tuples(void)
+{
+	for (int i = 0; i < TUPLE_COUNT; i++)
+		tuple_unref(tuples[i]);
+}
+
+static struct key_def *
+create_key_def(const struct key_template *templ, bool is_nullable)
+{
+	struct key_def *def = key_def_new(templ->part_count);
+	fail_if(def == NULL);
+	for (uint32_t i = 0; i < templ->part_count; i++) {
+		uint32_t fieldno = templ->fieldno[i];
+		key_def_set_part(def, i, fieldno, field_types[fieldno],
+				 is_nullable, NULL);
+	}
+	return def;
+}
+
+static int
+sign(int x)
+{
+	return x < 0 ? -1 : x > 0;
+}
+
+/** Return a string listing the fields of a key, e.g. "{3, 1}". */
+static const char *
+key_str(const struct key_template *templ)
+{
+	static char buf[32];
+	int len = snprintf(buf, sizeof(buf), "{");
+	for (uint32_t i = 0; i < templ->part_count; i++) {
+		len += snprintf(buf + len, sizeof(buf) - len, "%s%u",
+				i > 0 ? ", " : "", templ->fieldno[i]);
+	}
+	snprintf(buf + len, sizeof(buf) - len, "}");
+	return buf;
+}
+
+/** Compare first @a part_count parts of two source tuples. */
+static int
+reference_compare(const struct key_template *templ, uint32_t part_count,
+		  int a, int b)
+{
+	for (uint32_t i = 0; i < part_count; i++) {
+		uint32_t fieldno = templ->fieldno[i];
+		int r = values[a][fieldno] - values[b][fieldno];
+		if (r != 0)
+			return sign(r);
+	}
+	return 0;
+}
+
+static void
+test_tuple_compare(const struct key_template *templ)
+{
+	struct key_def *def = create_key_def(templ, false);
+	bool is_ok = true;
+	for (int a = 0; a < TUPLE_COUNT; a++) {
+		for (int b = 0; b < TUPLE_COUNT; b++) {
+			int r = tuple_compare(tuples[a], tuples[b], def);
+			if (sign(r) != reference_compare(templ,
+							 templ->part_count,
+							 a, b))
+				is_ok = false;
+		}
+	}
+	ok(is_ok, "tuple_compare, key %s", key_str(templ));
+	box_key_def_delete(def);
+}
+
+static void
+test_tuple_compare_with_key(const struct key_template *templ)
+{
+	struct key_def *def = create_key_def(templ, false);
+	bool is_ok = true;
+	char key[128];
+	for (int b = 0; b < TUPLE_COUNT; b++) {
+		char *pos = key;
+		for (uint32_t i = 0; i < templ->part_count; i++) {
+			uint32_t fieldno = templ->fieldno[i];
+			pos = encode_field(pos, fieldno, values[b][fieldno]);
+		}
+		for (uint32_t part_count = 0;
+		     part_count <= templ->part_count; part_count++) {
+			for (int a = 0; a < TUPLE_COUNT; a++) {
+				int r = tuple_compare_with_key(tuples[a], key,
+							       part_count, def);
+				if (sign(r) != reference_compare(templ,
+								 part_count,
+								 a, b))
+					is_ok = false;
+			}
+		}
+	}
+	ok(is_ok, "tuple_compare_with_key, key %s", key_str(templ));
+	box_key_def_delete(def);
+}
+
+static double
+bench_tuple_compare(struct key_def *def)
+{
+	clock_t start = clock();
+	int sum = 0;
+	for (int i = 0; i < BENCH_ITERATIONS; i++) {
+		struct tuple *a = tuples[i % TUPLE_COUNT];
+		struct tuple *b = tuples[(i / TUPLE_COUNT) % TUPLE_COUNT];
+		sum += tuple_compare(a, b, def);
+	}
+	/* Do not let the compiler throw the loop away. */
+	if (sum == INT_MAX)
+		note("unlikely");
+	return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+/**
+ * Nullable key definitions are always served by the generic
+ * comparison loop, so use them as the baseline. There are no
+ * NULLs in the data, hence the result is the same.
+ */
+static void
+bench(void)
+{
+	for (size_t i = 0; i < lengthof(keys); i++) {
+		struct key_def *typed = create_key_def(&keys[i], false);
+		struct key_def *generic = create_key_def(&keys[i], true);
+		double typed_time = bench_tuple_compare(typed);
+		double generic_time = bench_tuple_compare(generic);
+		printf("key %zu, %u parts: typed %.3fs, generic %.3fs\n",
+		       i, keys[i].part_count, typed_time, generic_time);
+		box_key_def_delete(typed);
+		box_key_def_delete(generic);
+	}
+}
+
+int
+main(int argc, char *argv[])
+{
+	/* Suppress info messages. */
+	say_set_log_level(S_WARN);
+	memory_init();
+	fiber_init(fiber_c_invoke);
+	tuple_init(NULL);
+	create_tuples();
+
+	int rc = 0;
+	if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+		bench();
+	} else {
+		header();
+		plan(2 * lengthof(keys));
+		for (size_t i = 0; i < lengthof(keys); i++) {
+			test_tuple_compare(&keys[i]);
+			test_tuple_compare_with_key(&keys[i]);
+		}
+		rc = check_plan();
+		footer();
+	}
+
+	destroy_tuples();
+	tuple_free();
+	fiber_free();
+	memory_free();
+	return rc;
+}
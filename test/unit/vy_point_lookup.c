@@ -17,7 +17,7 @@ static void
 test_basic()
 {
 	header();
-	plan(15);
+	plan(17);
 
 	/** Suppress info messages from vy_run_write(). */
 	say_set_log_level(S_WARN);
@@ -44,7 +44,7 @@ test_basic()
 	struct key_def *key_def = box_key_def_new(fields, types, 1);
 	isnt(key_def, NULL, "key_def is not NULL");
 
-	vy_cache_create(&cache, &cache_env, key_def);
+	vy_cache_create(&cache, &cache_env, key_def, SIZE_MAX);
 	struct tuple_format *format = tuple_format_new(&vy_tuple_format_vtab,
 						       &key_def, 1, 0, NULL, 0,
 						       NULL);
@@ -158,14 +158,14 @@ test_basic()
 	struct vy_stmt_stream *write_stream
 		= vy_write_iterator_new(pk->cmp_def, pk->disk_format,
 					pk->upsert_format, pk->id == 0,
-					true, &read_views);
-	vy_write_iterator_new_mem(write_stream, run_mem);
+					true, &read_views, NULL);
+	vy_write_iterator_new_mem(write_stream, run_mem, NULL, NULL);
 	struct vy_run *run = vy_run_new(&run_env, 1);
 	isnt(run, NULL, "vy_run_new");
 
 	rc = vy_run_write(run, dir_name, 0, pk->id,
 			  write_stream, 4096, pk->cmp_def, pk->key_def,
-			  100500, 0.1);
+			  100500, 0.1, 0);
 	is(rc, 0, "vy_run_write");
 
 	write_stream->iface->close(write_stream);
@@ -195,14 +195,14 @@ test_basic()
 	write_stream
 		= vy_write_iterator_new(pk->cmp_def, pk->disk_format,
 					pk->upsert_format, pk->id == 0,
-					true, &read_views);
-	vy_write_iterator_new_mem(write_stream, run_mem);
+					true, &read_views, NULL);
+	vy_write_iterator_new_mem(write_stream, run_mem, NULL, NULL);
 	run = vy_run_new(&run_env, 2);
 	isnt(run, NULL, "vy_run_new");
 
 	rc = vy_run_write(run, dir_name, 0, pk->id,
 			  write_stream, 4096, pk->cmp_def, pk->key_def,
-			  100500, 0.1);
+			  100500, 0.1, 0);
 	is(rc, 0, "vy_run_write");
 
 	write_stream->iface->close(write_stream);
@@ -213,68 +213,78 @@ test_basic()
 	vy_range_add_slice(range, slice);
 	vy_run_unref(run);
 
-	/* Compare with expected */
-	bool results_ok = true;
-	bool has_errors = false;
-	for (int64_t vlsn = 0; vlsn <= 6; vlsn++) {
-		struct vy_read_view rv;
-		rv.vlsn = vlsn == 6 ? INT64_MAX : vlsn;
-		const struct vy_read_view *prv = &rv;
-
-		for (size_t i = 0; i < num_of_keys; i++) {
-			uint32_t expect = 0;
-			int64_t expect_lsn = 0;
-			if (in_run2[i] && vlsn >= 1) {
-				expect += 8;
-				expect_lsn = 1;
-			}
-			if (in_run1[i] && vlsn >= 2) {
-				expect += 4;
-				expect_lsn = 2;
-			}
-			if (in_mem2[i] && vlsn >= 3) {
-				expect += 2;
-				expect_lsn = 3;
-			}
-			if (in_mem1[i] && vlsn >= 4) {
-				expect += 1;
-				expect_lsn = 4;
-			}
+	/*
+	 * Compare with expected, reading runs one by one and
+	 * in parallel.
+	 */
+	for (int parallel = 0; parallel <= 1; parallel++) {
+		index_env.parallel_lookup = parallel;
+		bool results_ok = true;
+		bool has_errors = false;
+		for (int64_t vlsn = 0; vlsn <= 6; vlsn++) {
+			struct vy_read_view rv;
+			rv.vlsn = vlsn == 6 ? INT64_MAX : vlsn;
+			const struct vy_read_view *prv = &rv;
+
+			for (size_t i = 0; i < num_of_keys; i++) {
+				uint32_t expect = 0;
+				int64_t expect_lsn = 0;
+				if (in_run2[i] && vlsn >= 1) {
+					expect += 8;
+					expect_lsn = 1;
+				}
+				if (in_run1[i] && vlsn >= 2) {
+					expect += 4;
+					expect_lsn = 2;
+				}
+				if (in_mem2[i] && vlsn >= 3) {
+					expect += 2;
+					expect_lsn = 3;
+				}
+				if (in_mem1[i] && vlsn >= 4) {
+					expect += 1;
+					expect_lsn = 4;
+				}
 
-			struct vy_stmt_template tmpl_key =
-				STMT_TEMPLATE(0, SELECT, i);
-			struct tuple *key =
-				vy_new_simple_stmt(format, pk->upsert_format,
-						   pk->mem_format_with_colmask,
-						   &tmpl_key);
-			struct tuple *res;
-			rc = vy_point_lookup(pk, NULL, &prv, key, &res);
-			tuple_unref(key);
-			if (rc != 0) {
-				has_errors = true;
-				continue;
-			}
-			if (expect == 0) {
-				/* No value expected. */
-				if (res != NULL)
-					results_ok = false;
-				continue;
-			} else {
-				if (res == NULL) {
-					results_ok = false;
+				struct vy_stmt_template tmpl_key =
+					STMT_TEMPLATE(0, SELECT, i);
+				struct tuple *key = vy_new_simple_stmt(format,
+						pk->upsert_format,
+						pk->mem_format_with_colmask,
+						&tmpl_key);
+				struct tuple *res;
+				rc = vy_point_lookup(pk, NULL, &prv,
+						     key, &res);
+				tuple_unref(key);
+				if (rc != 0) {
+					has_errors = true;
 					continue;
 				}
+				if (expect == 0) {
+					/* No value expected. */
+					if (res != NULL)
+						results_ok = false;
+					continue;
+				} else {
+					if (res == NULL) {
+						results_ok = false;
+						continue;
+					}
+				}
+				uint32_t got = 0;
+				tuple_field_u32(res, 1, &got);
+				if (got != expect &&
+				    expect_lsn != vy_stmt_lsn(res))
+					results_ok = false;
+				tuple_unref(res);
 			}
-			uint32_t got = 0;
-			tuple_field_u32(res, 1, &got);
-			if (got != expect && expect_lsn != vy_stmt_lsn(res))
-				results_ok = false;
-			tuple_unref(res);
 		}
-	}
 
-	is(results_ok, true, "select results");
-	is(has_errors, false, "no errors happened");
+		is(results_ok, true, "select results%s",
+		   parallel ? ", parallel lookup" : "");
+		is(has_errors, false, "no errors happened%s",
+		   parallel ? ", parallel lookup" : "");
+	}
 
 	vy_index_unref(pk);
 	index_def_delete(index_def);
@@ -38,9 +38,10 @@ compare_write_iterator_results(struct key_def *key_def,
 
 	struct vy_stmt_stream *wi =
 		vy_write_iterator_new(key_def, mem->format, mem->upsert_format,
-				      is_primary, is_last_level, &rv_list);
+				      is_primary, is_last_level, &rv_list,
+				      NULL);
 	fail_if(wi == NULL);
-	fail_if(vy_write_iterator_new_mem(wi, mem) != 0);
+	fail_if(vy_write_iterator_new_mem(wi, mem, NULL, NULL) != 0);
 
 	struct tuple *ret;
 	fail_if(wi->iface->start(wi) != 0);
@@ -507,12 +508,110 @@ test_basic(void)
 	check_plan();
 }
 
+/**
+ * Deferred DELETE handler that remembers LSNs of purged statements
+ * and statements that overwrote them.
+ */
+struct test_deferred_delete_handler {
+	struct vy_deferred_delete_handler base;
+	int count;
+	int64_t old_lsn[8];
+	int64_t new_lsn[8];
+};
+
+static int
+test_deferred_delete_process(struct vy_deferred_delete_handler *base,
+			     struct tuple *old_stmt, struct tuple *new_stmt)
+{
+	struct test_deferred_delete_handler *handler =
+		(struct test_deferred_delete_handler *)base;
+	fail_if(handler->count >= (int)lengthof(handler->old_lsn));
+	handler->old_lsn[handler->count] = vy_stmt_lsn(old_stmt);
+	handler->new_lsn[handler->count] = vy_stmt_lsn(new_stmt);
+	handler->count++;
+	return 0;
+}
+
+static const struct vy_deferred_delete_handler_iface
+test_deferred_delete_iface = {
+	.process = test_deferred_delete_process,
+};
+
+void
+test_deferred_delete(void)
+{
+	header();
+	plan(3);
+
+	uint32_t fields[] = { 0 };
+	uint32_t types[] = { FIELD_TYPE_UNSIGNED };
+	struct key_def *key_def = box_key_def_new(fields, types, 1);
+	assert(key_def != NULL);
+/*
+ * STATEMENT: REPL REPL  DEL  REPL | INS  UPS  REPL
+ * LSN:        5     6    7    8   |  9   10   11
+ * READ VIEW:        *             |
+ *
+ * REPLACE 5 and INSERT 9 are purged and reported to the handler
+ * along with the newest statement for the same key. DELETE 7
+ * and UPSERT 10 are purged too, but there's nothing to delete
+ * from secondary indexes for them.
+ */
+	const struct vy_stmt_template content[] = {
+		STMT_TEMPLATE(5, REPLACE, 1, 1),
+		STMT_TEMPLATE(6, REPLACE, 1, 2),
+		STMT_TEMPLATE(7, DELETE, 1),
+		STMT_TEMPLATE(8, REPLACE, 1, 3),
+		STMT_TEMPLATE(9, INSERT, 2, 1),
+		STMT_TEMPLATE(10, UPSERT, 2, 2),
+		STMT_TEMPLATE(11, REPLACE, 2, 3),
+	};
+	const int vlsns[] = {6};
+	struct vy_mem *mem = create_test_mem(key_def);
+	for (size_t i = 0; i < lengthof(content); ++i)
+		vy_mem_insert_template(mem, &content[i]);
+	struct rlist rv_list;
+	struct vy_read_view rv_array[lengthof(vlsns)];
+	init_read_views_list(&rv_list, rv_array, vlsns, lengthof(vlsns));
+
+	struct test_deferred_delete_handler handler;
+	memset(&handler, 0, sizeof(handler));
+	handler.base.iface = &test_deferred_delete_iface;
+	struct vy_stmt_stream *wi =
+		vy_write_iterator_new(key_def, mem->format, mem->upsert_format,
+				      true, false, &rv_list, &handler.base);
+	fail_if(wi == NULL);
+	fail_if(vy_write_iterator_new_mem(wi, mem, NULL, NULL) != 0);
+	fail_if(wi->iface->start(wi) != 0);
+	int count = 0;
+	struct tuple *ret;
+	do {
+		fail_if(wi->iface->next(wi, &ret) != 0);
+		if (ret != NULL)
+			count++;
+	} while (ret != NULL);
+	wi->iface->close(wi);
+	vy_mem_delete(mem);
+
+	is(count, 3, "statements written");
+	is(handler.count, 2, "statements purged");
+	ok(handler.old_lsn[0] == 5 && handler.new_lsn[0] == 8 &&
+	   handler.old_lsn[1] == 9 && handler.new_lsn[1] == 11,
+	   "purged statements reported with the newest statements");
+
+	box_key_def_delete(key_def);
+	fiber_gc();
+	footer();
+	check_plan();
+}
+
 int
 main(int argc, char *argv[])
 {
 	vy_iterator_C_test_init(0);
 
 	test_basic();
+	test_deferred_delete();
 
 	vy_iterator_C_test_finish();
 	return 0;
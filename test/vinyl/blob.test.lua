@@ -0,0 +1,66 @@
+test_run = require('test_run').new()
+fiber = require('fiber')
+fio = require('fio')
+
+--
+-- Bodies of primary index statements larger than blob_threshold
+-- are stored in blob files, which are referenced rather than
+-- rewritten by compaction.
+--
+s = box.schema.space.create('test', {engine = 'vinyl'})
+pk = s:create_index('pk', {run_count_per_level = 1, blob_threshold = -1})
+pk = s:create_index('pk', {run_count_per_level = 1, blob_threshold = 100})
+sk = s:create_index('sk', {parts = {2, 'string'}, unique = false})
+
+path = fio.pathjoin(box.cfg.vinyl_dir, tostring(s.id), tostring(pk.id))
+function ls_blob() return #fio.glob(fio.pathjoin(path, '*.blob')) end
+function blob_info() local i = pk:info().disk.blob return {i.files, i.bytes, i.garbage} end
+function compact() box.snapshot() while pk:info().run_count > 1 do fiber.sleep(0.01) end end
+
+big = string.rep('x', 200)
+function check(n) for i = 1, 10 do local t = s:get(i) if i % 2 == 0 and i > n and t[2] ~= big then return t end end return true end
+
+blob_info()
+for i = 1, 10 do s:replace{i, i % 2 == 0 and big or 'small'} end
+box.snapshot()
+blob_info()
+ls_blob()
+sk:info().disk.blob
+check(0)
+#s:select()
+#sk:select{big}
+
+-- Overwritten bodies turn into garbage, but the blob file
+-- is still referenced by the new run.
+for i = 2, 6, 2 do s:replace{i, 'small'} end
+compact()
+blob_info()
+check(6)
+
+-- If most of a blob file is garbage, live bodies are
+-- relocated to a new blob file on compaction.
+s:replace{1, 'small'}
+compact()
+blob_info()
+check(6)
+
+-- Statements produced by compaction are moved to blob files.
+s:upsert({8, 'small'}, {{'=', 2, big}, {'=', 3, 'y'}})
+compact()
+blob_info()
+s:get(8)[3]
+check(6)
+
+-- Blob files are recovered after restart.
+test_run:cmd('restart server default')
+fiber = require('fiber')
+s = box.space.test
+pk = s.index.pk
+big = string.rep('x', 200)
+function blob_info() local i = pk:info().disk.blob return {i.files, i.bytes, i.garbage} end
+function check(n) for i = 1, 10 do local t = s:get(i) if i % 2 == 0 and i > n and t[2] ~= big then return t end end return true end
+blob_info()
+check(6)
+#s.index.sk:select{big}
+
+s:drop()
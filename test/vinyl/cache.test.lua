@@ -334,3 +334,48 @@ sk:select('key2')
 s:insert{5, 'key1'}
 sk:select('key1')
 s:drop()
+
+--
+-- Cache hits are accounted separately for point lookups
+-- and range iterators.
+--
+s = box.schema.space.create('test', {engine = 'vinyl'})
+pk = s:create_index('pk')
+s:replace{1}
+s:replace{2}
+_ = s:get(1)
+_ = s:get(1)
+c = pk:info().cache
+c.point.lookup, c.point.hit
+_ = s:select()
+c = pk:info().cache
+c.range.lookup > 0, c.range.hit > 0
+s:drop()
+
+--
+-- A full scan doesn't evict statements that were read from
+-- the cache more than once.
+--
+assert(box.cfg.vinyl_cache <= 10 * 1024)
+s = box.schema.space.create('test', {engine = 'vinyl'})
+pk = s:create_index('pk')
+pad = string.rep('x', 400)
+for i = 1, 100 do s:replace{i, pad} end
+for i = 1, 5 do s:get(i) s:get(i) end
+#s:select()
+hit = pk:info().cache.point.hit
+for i = 1, 5 do s:get(i) end
+pk:info().cache.point.hit - hit
+s:drop()
+
+--
+-- The cache of an index can be limited with cache_size.
+--
+s = box.schema.space.create('test', {engine = 'vinyl'})
+pk = s:create_index('pk', {cache_size = -1})
+pk = s:create_index('pk', {cache_size = 2048})
+for i = 1, 20 do s:replace{i, pad} end
+#s:select()
+c = pk:info().cache
+c.rows > 0 and c.rows <= 5
+s:drop()
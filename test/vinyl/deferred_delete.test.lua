@@ -0,0 +1,50 @@
+test_run = require('test_run').new()
+fiber = require('fiber')
+
+--
+-- If defer_deletes is set, REPLACE and DELETE don't look up
+-- the old tuple in the primary index. Instead, the old tuple
+-- is deleted from secondary indexes when it is purged from
+-- the primary index by dump or compaction.
+--
+s = box.schema.space.create('test', {engine = 'memtx', defer_deletes = true})
+
+s = box.schema.space.create('test', {engine = 'vinyl', defer_deletes = true})
+pk = s:create_index('pk', {run_count_per_level = 1})
+sk = s:create_index('sk', {parts = {2, 'unsigned'}, unique = false, run_count_per_level = 1})
+
+for i = 1, 10 do s:replace{i, i} end
+box.snapshot()
+
+lookup = pk:info().lookup
+for i = 1, 10 do s:replace{i, i + 10} end
+for i = 1, 5 do s:delete{i} end
+pk:info().lookup - lookup
+
+-- Stale secondary index entries are skipped on read.
+sk:select()
+s:select()
+
+-- Dump generates DELETEs for tuples overwritten in memory,
+-- compaction for tuples overwritten on disk.
+box.snapshot()
+while pk:info().run_count > 1 or sk:info().run_count > 1 do fiber.sleep(0.01) end
+sk:info().memory.rows
+sk:select()
+
+box.snapshot()
+while sk:info().run_count > 1 do fiber.sleep(0.01) end
+sk:info().disk.rows
+sk:select()
+
+-- No DELETE is generated if the secondary key didn't change.
+s:replace{6, 16, 'x'}
+box.snapshot()
+while pk:info().run_count > 1 do fiber.sleep(0.01) end
+sk:info().memory.rows
+sk:select()
+
+-- The flag can't be switched on a non-empty space.
+box.space._space:update(s.id, {{'=', 6, {}}})
+
+s:drop()
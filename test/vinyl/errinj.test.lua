@@ -466,3 +466,24 @@ value
 box.commit()
 
 s:drop()
+
+--
+-- A scan over a secondary index looks up full tuples in the
+-- primary index in batches, each lookup in a separate fiber.
+--
+s = box.schema.space.create('test', {engine = 'vinyl'})
+_ = s:create_index('pk')
+_ = s:create_index('sk', {parts = {2, 'unsigned'}})
+for i = 1, 100 do s:replace{i, 100 - i} end
+box.snapshot()
+errinj.set("ERRINJ_VY_READ_PAGE_TIMEOUT", true)
+ch = fiber.channel(1)
+_ = fiber.create(function() ch:put(s.index.sk:select({}, {limit = 40})) end)
+function lookup_fibers() local n = 0 for _, f in pairs(fiber.info()) do if f.name == 'vinyl.lookup' then n = n + 1 end end return n end
+test_run:wait_cond(function() return lookup_fibers() > 0 end, 10)
+errinj.set("ERRINJ_VY_READ_PAGE_TIMEOUT", false)
+t = ch:get(10)
+#t
+t[1], t[40]
+lookup_fibers()
+s:drop()
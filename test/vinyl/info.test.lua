@@ -68,10 +68,13 @@ end;
 -- Return index statistics.
 --
 -- Note, latency measurement is beyond the scope of this test
--- so we just filter it out.
+-- so we just filter it out. Cache hits by lookup kind are
+-- checked by vinyl/cache.test.lua.
 function istat()
     local st = box.space.test.index.pk:info()
     st.latency = nil
+    st.cache.point = nil
+    st.cache.range = nil
     return st
 end;
 
@@ -84,6 +87,9 @@ function gstat()
     st.quota.use_rate = nil
     st.quota.dump_bandwidth = nil
     st.quota.watermark = nil
+    st.quota.rate_limit = nil
+    st.quota.throttled = nil
+    st.quota.throttle_time = nil
     return st
 end;
 
@@ -4,6 +4,7 @@ test_run:cmd("create server test with script='vinyl/low_quota.lua'")
 test_run:cmd("start server test with args='1048576'")
 test_run:cmd('switch test')
 
+test_run = require('test_run').new()
 fiber = require 'fiber'
 
 box.cfg{vinyl_timeout=0.01}
@@ -57,6 +58,29 @@ box.info.vinyl().quota.used
 --
 s2:auto_increment{pad}
 
+--
+-- Check that transactions are throttled once the watermark
+-- is exceeded so that they don't stall on hitting the limit.
+--
+box.cfg{vinyl_timeout = 60}
+box.error.injection.set('ERRINJ_VY_RUN_WRITE_TIMEOUT', 0.5)
+pad = string.rep('x', box.cfg.vinyl_memory / 100)
+throttled = box.info.vinyl().quota.throttled
+test_run:wait_cond(function() s2:auto_increment{pad} return box.info.vinyl().quota.rate_limit > 0 end, 10)
+for i = 1, 5 do s2:auto_increment{pad} end
+box.info.vinyl().quota.throttled > throttled
+box.error.injection.set('ERRINJ_VY_RUN_WRITE_TIMEOUT', 0)
+
+--
+-- Check that a transaction that hits the limit while being
+-- throttled waits for the dump, not for the timeout.
+--
+box.error.injection.set('ERRINJ_VY_RUN_WRITE', true)
+ch = fiber.channel(1)
+_ = fiber.create(function() for i = 1, 200 do s2:auto_increment{pad} end ch:put(true) end)
+test_run:wait_cond(function() return box.info.vinyl().quota.used + 2 * #pad >= box.cfg.vinyl_memory end, 10)
+box.error.injection.set('ERRINJ_VY_RUN_WRITE', false)
+ch:get(10)
 test_run:cmd('switch default')
 test_run:cmd("stop server test")
 test_run:cmd("cleanup server test")
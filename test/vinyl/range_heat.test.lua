@@ -0,0 +1,67 @@
+test_run = require('test_run').new()
+
+--
+-- Check that the target size of a range depends on its heat:
+-- a cold range is allowed to grow bigger than range_size before
+-- it is split. Freeze the heat clock so that the heat doesn't
+-- decay while the test runs.
+--
+box.error.injection.set('ERRINJ_VY_RANGE_HEAT_TIME', 1)
+
+s = box.schema.space.create('test', {engine = 'vinyl'})
+pk = s:create_index('pk', {page_size = 256, range_size = 4096, run_count_per_level = 1, run_size_ratio = 1000})
+
+-- Number of keys that take about twice range_size on disk.
+N = 128
+test_run:cmd("setopt delimiter ';'")
+function pad()
+    local t = {}
+    for i = 1, 40 do t[i] = string.char(math.random(0, 255)) end
+    return table.concat(t)
+end;
+function compacted()
+    return test_run:wait_cond(function()
+        return pk:info().run_histogram:match('^%[1%]:%d+$') ~= nil
+    end, 10)
+end;
+test_run:cmd("setopt delimiter ''");
+
+-- Write even keys three times. The range is compacted after
+-- the second dump and split in two after the third one.
+test_run:cmd("setopt delimiter ';'")
+for i = 1, 3 do
+    for k = 1, N do s:replace{2 * k, pad()} end
+    box.snapshot()
+    compacted()
+end;
+test_run:cmd("setopt delimiter ''");
+pk:info().range_count
+
+-- Heat up the right range by writing to it only.
+test_run:cmd("setopt delimiter ';'")
+for i = 1, 30 do
+    for k = 80, N do s:replace{2 * k, pad()} end
+    box.snapshot()
+end;
+test_run:cmd("setopt delimiter ''");
+compacted()
+pk:info().range_count
+
+-- Double the size of both ranges. The ranges aren't split yet,
+-- because a range is split by the size of its oldest run.
+for k = 1, N do s:replace{2 * k - 1, pad()} end
+box.snapshot()
+compacted()
+pk:info().range_count
+
+-- Trigger compaction of both ranges. The right range is split,
+-- while the left range, which is cold, is not.
+_ = s:replace{1, pad()}
+_ = s:replace{2 * N, pad()}
+box.snapshot()
+compacted()
+pk:info().range_count
+s:count()
+
+box.error.injection.set('ERRINJ_VY_RANGE_HEAT_TIME', 0)
+s:drop()
@@ -0,0 +1,47 @@
+test_run = require('test_run').new()
+fiber = require('fiber')
+errinj = box.error.injection
+
+--
+-- Check that pages read ahead on run scans are used in order
+-- and that pages still being read when the iterator is closed
+-- are freed.
+--
+s = box.schema.space.create('test', {engine = 'vinyl'})
+pk = s:create_index('pk', {page_size = 256, range_size = 1024 * 1024, run_count_per_level = 10})
+pad = string.rep('x', 20)
+for i = 1, 1000 do s:replace{i, pad} end
+box.snapshot()
+pk:info().disk.pages > 50
+
+-- Forward scan.
+t = s:select({}, {iterator = 'GE'})
+#t
+bad = 0
+for i = 1, #t do if t[i][1] ~= i then bad = bad + 1 end end
+bad
+
+-- Reverse scan.
+t = s:select({}, {iterator = 'LE'})
+#t
+for i = 1, #t do if t[i][1] ~= 1001 - i then bad = bad + 1 end end
+bad
+
+-- Scan starting in the middle of the run.
+t = s:select({500}, {iterator = 'GT', limit = 200})
+#t, t[1][1], t[200][1]
+t = s:select({500}, {iterator = 'LT', limit = 200})
+#t, t[1][1], t[200][1]
+
+-- Drop an iterator while pages are being read ahead.
+errinj.set('ERRINJ_VY_READ_PAGE_TIMEOUT', true)
+gen, param, state = s:pairs({}, {iterator = 'GE'})
+for i = 1, 40 do state, tuple = gen(param, state) end
+tuple[1]
+gen, param, state, tuple = nil
+_ = collectgarbage('collect')
+errinj.set('ERRINJ_VY_READ_PAGE_TIMEOUT', false)
+fiber.sleep(0.5)
+#s:select()
+
+s:drop()
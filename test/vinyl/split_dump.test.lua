@@ -0,0 +1,77 @@
+test_run = require('test_run').new()
+fiber = require('fiber')
+
+-- Temporary table to restore variables after restart.
+var = box.schema.space.create('var')
+_ = var:create_index('primary', {parts = {1, 'string'}})
+
+--
+-- Lower the min size of a dump part so that a small index
+-- is dumped in parts written by different workers.
+--
+box.error.injection.set('ERRINJ_VY_DUMP_PART_SIZE', 1)
+pad = string.rep('x', 50)
+
+--
+-- The first dump of an index, which has only one range, is
+-- split by keys sampled from the in-memory tree.
+--
+s1 = box.schema.space.create('test1', {engine = 'vinyl'})
+_ = s1:create_index('pk', {page_size = 256, run_count_per_level = 100})
+_ = s1:create_index('sk', {parts = {2, 'unsigned'}, page_size = 256, run_count_per_level = 100})
+for k = 1, 500 do s1:replace{k, 1000 - k, pad} end
+box.snapshot()
+s1.index.pk:info().range_count
+s1.index.pk:info().run_count > 1
+s1.index.sk:info().run_count > 1
+s1:count()
+s1.index.sk:select({}, {limit = 3})
+
+--
+-- A dump of an index that has several ranges is split by
+-- range boundaries.
+--
+s2 = box.schema.space.create('test2', {engine = 'vinyl'})
+_ = s2:create_index('pk', {page_size = 256, range_size = 2048, run_count_per_level = 1, run_size_ratio = 1000})
+test_run:cmd("setopt delimiter ';'")
+while s2.index.pk:info().range_count < 4 do
+    for k = 1, 500 do s2:replace{k, 0, pad} end
+    box.snapshot()
+    fiber.sleep(0.01)
+end;
+test_run:cmd("setopt delimiter ''");
+-- Stop compaction so that it doesn't change the run count.
+s2.index.pk:alter{run_count_per_level = 100}
+test_run:wait_cond(function() local c = s2.index.pk:info().disk.compact.count fiber.sleep(0.1) return s2.index.pk:info().disk.compact.count == c end, 10)
+run_count = s2.index.pk:info().run_count
+for k = 1, 500 do s2:replace{k, k, pad} end
+box.snapshot()
+s2.index.pk:info().run_count - run_count > 1
+s2:count()
+
+box.error.injection.set('ERRINJ_VY_DUMP_PART_SIZE', -1)
+
+-- Check that the runs written by dump parts are recovered.
+_ = var:insert{'run_count1', s1.index.pk:info().run_count}
+_ = var:insert{'run_count2', s2.index.pk:info().run_count}
+test_run:cmd('restart server default')
+
+var = box.space.var
+s1 = box.space.test1
+s2 = box.space.test2
+s1.index.pk:info().run_count == var:get('run_count1')[2]
+s2.index.pk:info().run_count == var:get('run_count2')[2]
+s1:count()
+s1.index.sk:count()
+bad = 0
+for k = 1, 500 do local t = s1:get(k) if t == nil or t[2] ~= 1000 - k then bad = bad + 1 end end
+bad
+for k = 1, 500 do local t = s1.index.sk:get(1000 - k) if t == nil or t[1] ~= k then bad = bad + 1 end end
+bad
+s2:count()
+for k = 1, 500 do local t = s2:get(k) if t == nil or t[2] ~= k then bad = bad + 1 end end
+bad
+
+s1:drop()
+s2:drop()
+var:drop()
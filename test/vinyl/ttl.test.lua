@@ -0,0 +1,59 @@
+test_run = require('test_run').new()
+
+--
+-- Tuples that have lived longer than ttl seconds since the time
+-- stored in ttl_field are hidden from reads and purged on dump
+-- and compaction.
+--
+s = box.schema.space.create('test', {engine = 'vinyl'})
+pk = s:create_index('pk', {ttl = -1, ttl_field = 3})
+pk = s:create_index('pk', {ttl = 3600})
+pk = s:create_index('pk', {ttl = 3600, ttl_field = 3})
+sk = s:create_index('sk', {parts = {2, 'unsigned'}, ttl = 3600, ttl_field = 3})
+sk = s:create_index('sk', {parts = {2, 'unsigned'}})
+
+function ids(index) local r = {} for _, t in index:pairs() do table.insert(r, t[1]) end return r end
+
+now = os.time()
+for i = 1, 10 do s:replace{i, i * 10, i % 2 == 0 and now - 7200 or now} end
+ids(pk)
+ids(sk)
+s:get(2)
+s:get(3)[1]
+sk:get(40)
+sk:get(50)[1]
+
+-- Expired tuples are not written to disk.
+box.snapshot()
+pk:info().disk.rows
+ids(pk)
+ids(sk)
+
+-- Expired tuples don't conflict with new ones.
+s:insert{2, 20, now}[1]
+s:insert{12, 40, now}[1]
+ids(pk)
+ids(sk)
+
+s:drop()
+
+--
+-- An UPSERT over an expired tuple is applied as an INSERT,
+-- whether the tuple has been purged by compaction or not.
+--
+fiber = require('fiber')
+s = box.schema.space.create('test', {engine = 'vinyl'})
+pk = s:create_index('pk', {ttl = 1, ttl_field = 3, run_count_per_level = 1})
+_ = s:replace{1, 10, fiber.time()}
+_ = s:replace{2, 20, fiber.time()}
+box.snapshot()
+fiber.sleep(1.1)
+s:get(1)
+s:upsert({1, 100, 1e10}, {{'+', 2, 1}, {'=', 3, 1e10}})
+s:upsert({2, 200, 1e10}, {{'+', 2, 1}, {'=', 3, 1e10}})
+s:select()
+box.snapshot()
+while pk:info().run_count > 1 do fiber.sleep(0.01) end
+s:select()
+
+s:drop()
@@ -0,0 +1,38 @@
+test_run = require('test_run').new()
+test_run:cmd('restart server default with cleanup=1')
+fio = require('fio')
+
+--
+-- A snapshot can store only tuples changed since the previous
+-- one. Recovery applies the chain on top of the full snapshot.
+--
+box.cfg{memtx_snap_deltas = -1}
+box.cfg{memtx_snap_deltas = 2}
+
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+for i = 1, 100 do s:insert{i} end
+box.snapshot()
+prev_lsn = box.info.lsn
+
+for i = 1, 10 do s:delete{i} end
+for i = 91, 100 do s:replace{i, i} end
+box.snapshot()
+
+-- The incremental snapshot refers to the previous one.
+snap_name = fio.pathjoin(box.cfg.memtx_dir, string.format("%020d.snap", box.info.lsn))
+f = io.open(snap_name) for i = 1, 6 do line = f:read() end f:close()
+line == string.format('Prev: %d', prev_lsn)
+
+s:replace{50, 50}
+box.snapshot()
+
+test_run:cmd('restart server default')
+s = box.space.test
+s:count()
+s:min()
+s:get{50}
+s:max()
+
+s:drop()
+box.cfg{memtx_snap_deltas = 0}
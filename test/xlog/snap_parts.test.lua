@@ -0,0 +1,35 @@
+test_run = require('test_run').new()
+test_run:cmd('restart server default with cleanup=1')
+fio = require('fio')
+
+--
+-- A snapshot can be split into several files, which are
+-- written and recovered by separate threads.
+--
+box.cfg{memtx_snap_parts = 0}
+box.cfg{memtx_snap_parts = 65}
+box.cfg{memtx_snap_parts = 4}
+
+s1 = box.schema.space.create('test1')
+_ = s1:create_index('pk')
+s2 = box.schema.space.create('test2')
+_ = s2:create_index('pk')
+_ = s2:create_index('sk', {parts = {2, 'unsigned'}})
+for i = 1, 100 do s1:insert{i} s2:insert{i, 1000 - i} end
+box.snapshot()
+
+-- The main file stores the number of parts.
+snap_name = fio.pathjoin(box.cfg.memtx_dir, string.format("%020d.snap", box.info.lsn))
+#fio.glob(snap_name .. '.*')
+f = io.open(snap_name) for i = 1, 6 do line = f:read() end f:close()
+line
+
+test_run:cmd('restart server default')
+s1 = box.space.test1
+s2 = box.space.test2
+s1:count()
+s2:count()
+s2.index.sk:min()
+
+s1:drop()
+s2:drop()